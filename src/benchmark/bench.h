@@ -0,0 +1,474 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+//
+// This code is licensed under the MIT License.
+//
+// Shared plumbing for the user-mode benchmarks: argument parsing, timing,
+// reporting, and builders for NBL chains and MDL chains.
+//
+// Each benchmark program includes this header after <ndis.h> and the NDL
+// headers it measures.  Every program accepts the same arguments:
+//
+//     --quick     Run each measurement briefly and skip the largest sizes.
+//                 Used by the smoke tests; the numbers are noisy.
+//
+//     <filter>    Only run measurements whose name contains this string.
+//
+// Results are printed one per line, in a format that is easy to diff or to
+// paste into a spreadsheet:
+//
+//     <name>    <ns per item>    <GB/s>
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct BENCH_OPTIONS_t
+{
+    BOOLEAN Quick;
+    char const *Filter;
+
+    // Minimum wall-clock time for one timed repetition
+    ULONG64 MinimumNanoseconds;
+
+    // Number of timed repetitions; the fastest one is reported
+    ULONG Repetitions;
+} BENCH_OPTIONS;
+
+static BENCH_OPTIONS BenchOptions;
+
+// A routine under measurement.  Each call performs one iteration.
+typedef void BENCH_ROUTINE(void *Context);
+
+static inline void
+BenchParseArguments(
+    int argc,
+    char **argv)
+{
+    BenchOptions.Quick = FALSE;
+    BenchOptions.Filter = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            BenchOptions.Quick = TRUE;
+        }
+        else if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "usage: %s [--quick] [filter]\n", argv[0]);
+            exit(2);
+        }
+        else
+        {
+            BenchOptions.Filter = argv[i];
+        }
+    }
+
+    BenchOptions.MinimumNanoseconds = BenchOptions.Quick ? 1000000ull : 100000000ull;
+    BenchOptions.Repetitions = BenchOptions.Quick ? 1 : 5;
+}
+
+static inline BOOLEAN
+BenchShouldRun(
+    char const *Name)
+{
+    return BenchOptions.Filter == NULL || strstr(Name, BenchOptions.Filter) != NULL;
+}
+
+// Keeps the compiler from discarding a computation whose result is unused
+static inline void
+BenchDoNotOptimize(
+    void const *Value)
+{
+    __asm__ __volatile__("" : : "r"(Value) : "memory");
+}
+
+static inline double
+BenchMeasure(
+    BENCH_ROUTINE *Routine,
+    void *Context)
+/*++
+
+Routine Description:
+
+    Returns the number of nanoseconds one call to Routine takes
+
+    The iteration count is doubled until a repetition runs for at least
+    BenchOptions.MinimumNanoseconds, then the fastest of
+    BenchOptions.Repetitions repetitions is reported.
+
+--*/
+{
+    ULONG64 Iterations = 1;
+    ULONG64 Elapsed;
+
+    // Warm up caches and calibrate the iteration count
+    while (TRUE)
+    {
+        ULONG64 const Start = MockQueryNanoseconds();
+        for (ULONG64 i = 0; i < Iterations; i++)
+        {
+            Routine(Context);
+        }
+        Elapsed = MockQueryNanoseconds() - Start;
+
+        if (Elapsed >= BenchOptions.MinimumNanoseconds)
+        {
+            break;
+        }
+
+        Iterations *= 2;
+    }
+
+    double Best = (double)Elapsed / (double)Iterations;
+
+    for (ULONG Repetition = 1; Repetition < BenchOptions.Repetitions; Repetition++)
+    {
+        ULONG64 const Start = MockQueryNanoseconds();
+        for (ULONG64 i = 0; i < Iterations; i++)
+        {
+            Routine(Context);
+        }
+        Elapsed = MockQueryNanoseconds() - Start;
+
+        double const PerIteration = (double)Elapsed / (double)Iterations;
+        if (PerIteration < Best)
+        {
+            Best = PerIteration;
+        }
+    }
+
+    return Best;
+}
+
+static inline void
+BenchReport(
+    char const *Name,
+    double NanosecondsPerIteration,
+    SIZE_T ItemsPerIteration,
+    SIZE_T BytesPerIteration)
+/*++
+
+Routine Description:
+
+    Prints one result line
+
+Arguments:
+
+    Name - The name of the measurement
+
+    NanosecondsPerIteration - As returned by BenchMeasure, possibly adjusted
+
+    ItemsPerIteration - The number of NBLs (or other items) handled by each
+        iteration, used to compute the ns/item column.  May be 0.
+
+    BytesPerIteration - The number of payload bytes handled by each
+        iteration, used to compute the GB/s column.  May be 0.
+
+--*/
+{
+    printf("%-48s", Name);
+
+    if (ItemsPerIteration != 0)
+    {
+        printf(" %10.2f ns/item", NanosecondsPerIteration / (double)ItemsPerIteration);
+    }
+    else
+    {
+        printf(" %10.2f ns/iter", NanosecondsPerIteration);
+    }
+
+    if (BytesPerIteration != 0 && NanosecondsPerIteration > 0)
+    {
+        printf(" %10.2f GB/s", (double)BytesPerIteration / NanosecondsPerIteration);
+    }
+
+    printf("\n");
+    fflush(stdout);
+}
+
+// xorshift64*, so results are reproducible across runs and platforms
+static inline ULONG64
+BenchRandom(
+    ULONG64 *State)
+{
+    ULONG64 x = *State;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *State = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+static inline void
+BenchShuffle(
+    SIZE_T *Array,
+    SIZE_T Count,
+    ULONG64 Seed)
+{
+    ULONG64 State = Seed | 1;
+
+    for (SIZE_T i = Count; i > 1; i--)
+    {
+        SIZE_T const j = (SIZE_T)(BenchRandom(&State) % i);
+        SIZE_T const Temp = Array[i - 1];
+        Array[i - 1] = Array[j];
+        Array[j] = Temp;
+    }
+}
+
+//
+// NBL chains
+//
+// A BENCH_NBL_POOL owns a set of NBLs, each with one NET_BUFFER and one
+// MDL.  The NBLs are allocated in a single arena but visited in a shuffled
+// order, so a walk over a long chain is a pointer chase through memory, the
+// way it would be on a real datapath.  Each NBL's flow identifier is stored in
+// its NetBufferListHashValue info slot.
+//
+
+#define BENCH_FLOW_INFO NetBufferListHashValue
+
+typedef struct BENCH_NBL_t
+{
+    NET_BUFFER_LIST Nbl;
+    NET_BUFFER Nb;
+    MDL Mdl;
+} BENCH_NBL;
+
+typedef struct BENCH_NBL_POOL_t
+{
+    SIZE_T Count;
+    BENCH_NBL *Arena;
+
+    // Arena in visiting order
+    NET_BUFFER_LIST **Order;
+
+    // Every NBL's NET_BUFFER points into this payload buffer
+    UCHAR Payload[64];
+} BENCH_NBL_POOL;
+
+static inline BENCH_NBL_POOL *
+BenchCreateNblPool(
+    SIZE_T Count,
+    BOOLEAN Shuffle)
+{
+    BENCH_NBL_POOL *Pool = (BENCH_NBL_POOL *)calloc(1, sizeof(*Pool));
+    SIZE_T *Permutation = (SIZE_T *)malloc(Count * sizeof(SIZE_T));
+
+    Pool->Count = Count;
+    Pool->Arena = (BENCH_NBL *)ExAllocatePool2(POOL_FLAG_NON_PAGED, Count * sizeof(BENCH_NBL), 'hcnB');
+    Pool->Order = (NET_BUFFER_LIST **)malloc(Count * sizeof(NET_BUFFER_LIST *));
+
+    if (Pool->Arena == NULL || Pool->Order == NULL || Permutation == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (SIZE_T i = 0; i < Count; i++)
+    {
+        BENCH_NBL *const Entry = &Pool->Arena[i];
+
+        MockInitializeMdl(&Entry->Mdl, Pool->Payload, sizeof(Pool->Payload));
+        Entry->Nb.MdlChain = &Entry->Mdl;
+        Entry->Nb.CurrentMdl = &Entry->Mdl;
+        Entry->Nb.DataLength = sizeof(Pool->Payload);
+        Entry->Nbl.FirstNetBuffer = &Entry->Nb;
+
+        Permutation[i] = i;
+    }
+
+    if (Shuffle)
+    {
+        BenchShuffle(Permutation, Count, 0x6e626c73ull);
+    }
+
+    for (SIZE_T i = 0; i < Count; i++)
+    {
+        Pool->Order[i] = &Pool->Arena[Permutation[i]].Nbl;
+    }
+
+    free(Permutation);
+    return Pool;
+}
+
+static inline void
+BenchDestroyNblPool(
+    BENCH_NBL_POOL *Pool)
+{
+    ExFreePool(Pool->Arena);
+    free(Pool->Order);
+    free(Pool);
+}
+
+static inline ULONG_PTR
+BenchGetFlow(
+    NET_BUFFER_LIST const *Nbl)
+{
+    return (ULONG_PTR)NET_BUFFER_LIST_INFO(Nbl, BENCH_FLOW_INFO);
+}
+
+static inline void
+BenchSetFlow(
+    NET_BUFFER_LIST *Nbl,
+    ULONG_PTR Flow)
+{
+    NET_BUFFER_LIST_INFO(Nbl, BENCH_FLOW_INFO) = (PVOID)Flow;
+}
+
+typedef enum BENCH_FLOW_PATTERN_t
+{
+    // Every NBL belongs to the same flow
+    BenchFlowSingle,
+
+    // 4 flows, interleaved one NBL at a time: 0 1 2 3 0 1 2 3 ...
+    BenchFlowRoundRobin4,
+
+    // 4 flows, interleaved in bursts of 8 NBLs, as a NIC with interrupt
+    // moderation tends to deliver them
+    BenchFlowBursts4,
+
+    // 64 flows, chosen at random
+    BenchFlowRandom64,
+
+    BenchFlowMaximum
+} BENCH_FLOW_PATTERN;
+
+static char const *const BenchFlowPatternNames[BenchFlowMaximum] =
+{
+    "1flow",
+    "4flows-rr",
+    "4flows-burst8",
+    "64flows-random",
+};
+
+static inline void
+BenchAssignFlows(
+    BENCH_NBL_POOL *Pool,
+    BENCH_FLOW_PATTERN Pattern)
+{
+    ULONG64 State = 0x666c6f77ull;
+
+    for (SIZE_T i = 0; i < Pool->Count; i++)
+    {
+        ULONG_PTR Flow;
+
+        switch (Pattern)
+        {
+        case BenchFlowRoundRobin4:
+            Flow = i % 4;
+            break;
+        case BenchFlowBursts4:
+            Flow = (i / 8) % 4;
+            break;
+        case BenchFlowRandom64:
+            Flow = (ULONG_PTR)(BenchRandom(&State) % 64);
+            break;
+        default:
+            Flow = 0;
+            break;
+        }
+
+        BenchSetFlow(Pool->Order[i], Flow);
+    }
+}
+
+// Links Order[First..First+Length) into a chain and returns its head
+static inline NET_BUFFER_LIST *
+BenchLinkNblChain(
+    BENCH_NBL_POOL *Pool,
+    SIZE_T First,
+    SIZE_T Length)
+{
+    NET_BUFFER_LIST **const Order = Pool->Order + First;
+
+    for (SIZE_T i = 0; i + 1 < Length; i++)
+    {
+        Order[i]->Next = Order[i + 1];
+    }
+
+    Order[Length - 1]->Next = NULL;
+    return Order[0];
+}
+
+//
+// MDL chains
+//
+// A BENCH_MDL_CHAIN describes Length bytes split into fragments of
+// FragmentSize bytes.  Fragments are carved from a backing buffer at
+// FragmentStride intervals and linked in a shuffled order, so consecutive
+// fragments are not adjacent in memory.  A FragmentSize of 0 describes
+// the whole buffer with a single MDL.
+//
+
+typedef struct BENCH_MDL_CHAIN_t
+{
+    MDL *Mdls;
+    SIZE_T MdlCount;
+    UCHAR *Buffer;
+    SIZE_T Length;
+} BENCH_MDL_CHAIN;
+
+static inline void
+BenchCreateMdlChain(
+    BENCH_MDL_CHAIN *Chain,
+    SIZE_T Length,
+    SIZE_T FragmentSize,
+    SIZE_T FragmentStride,
+    ULONG64 Seed)
+{
+    if (FragmentSize == 0)
+    {
+        FragmentSize = Length;
+        FragmentStride = ALIGN_UP_BY(Length, PAGE_SIZE);
+    }
+
+    SIZE_T const MdlCount = (Length + FragmentSize - 1) / FragmentSize;
+    SIZE_T *Permutation = (SIZE_T *)malloc(MdlCount * sizeof(SIZE_T));
+
+    Chain->Length = Length;
+    Chain->MdlCount = MdlCount;
+    Chain->Mdls = (MDL *)calloc(MdlCount, sizeof(MDL));
+    Chain->Buffer = (UCHAR *)ExAllocatePool2(POOL_FLAG_NON_PAGED, MdlCount * FragmentStride, 'ldmB');
+
+    if (Chain->Mdls == NULL || Chain->Buffer == NULL || Permutation == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    memset(Chain->Buffer, 0x5a, MdlCount * FragmentStride);
+
+    for (SIZE_T i = 0; i < MdlCount; i++)
+    {
+        Permutation[i] = i;
+    }
+
+    BenchShuffle(Permutation, MdlCount, Seed);
+
+    SIZE_T Remaining = Length;
+    for (SIZE_T i = 0; i < MdlCount; i++)
+    {
+        SIZE_T const ThisLength = Remaining < FragmentSize ? Remaining : FragmentSize;
+
+        MockInitializeMdl(&Chain->Mdls[i], Chain->Buffer + Permutation[i] * FragmentStride, (ULONG)ThisLength);
+        Chain->Mdls[i].Next = (i + 1 < MdlCount) ? &Chain->Mdls[i + 1] : NULL;
+
+        Remaining -= ThisLength;
+    }
+
+    free(Permutation);
+}
+
+static inline void
+BenchDestroyMdlChain(
+    BENCH_MDL_CHAIN *Chain)
+{
+    ExFreePool(Chain->Buffer);
+    free(Chain->Mdls);
+}
@@ -0,0 +1,342 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+//
+// This code is licensed under the MIT License.
+//
+// Measures the C++ wrappers in the headers against the C routines they
+// wrap: the ndis::nbl_chain and ndis::mdl_chain ranges, and the
+// ndis::classify_* templates.
+//
+// This is the only C++ translation unit in the benchmarks, so it is also
+// what compiles those wrappers at all.  Before measuring anything, it checks
+// that each wrapper visits the same NBLs, MDLs, and batches as the C
+// routine, and fails if any of them differ.
+//
+
+#include <ndis.h>
+#include <ndis/ndl/nblchain.h>
+#include <ndis/ndl/nblqueue.h>
+#include <ndis/ndl/nblclassify.h>
+#include <ndis/ndl/mdl.h>
+
+#include "bench.h"
+
+#define CXX_BENCH_MAXIMUM_CHAIN_LENGTH 1024
+
+static SIZE_T const ChainLengths[] = { 1, 64, 1024 };
+
+typedef struct CXX_BENCH_CONTEXT_t
+{
+    BENCH_NBL_POOL *Pool;
+    SIZE_T Length;
+    NET_BUFFER_LIST *Chain;
+    SIZE_T Batches;
+} CXX_BENCH_CONTEXT;
+
+//
+// Callbacks
+//
+
+static ULONG_PTR
+ClassifyByFlowValue(
+    PVOID ClassificationContext,
+    NET_BUFFER_LIST *Nbl)
+{
+    UNREFERENCED_PARAMETER(ClassificationContext);
+    return BenchGetFlow(Nbl);
+}
+
+static void
+CountBatch(
+    PVOID FlushContext,
+    ULONG_PTR ClassificationResult,
+    NBL_QUEUE *Queue)
+{
+    CXX_BENCH_CONTEXT *const Context = (CXX_BENCH_CONTEXT *)FlushContext;
+
+    UNREFERENCED_PARAMETER(ClassificationResult);
+
+    Context->Batches += 1;
+    BenchDoNotOptimize(Queue->First);
+}
+
+//
+// Routines under measurement
+//
+
+static void
+RelinkOnly(
+    void *ContextArg)
+{
+    CXX_BENCH_CONTEXT *const Context = (CXX_BENCH_CONTEXT *)ContextArg;
+
+    Context->Chain = BenchLinkNblChain(Context->Pool, 0, Context->Length);
+    BenchDoNotOptimize(Context->Chain);
+}
+
+static void
+WalkNblChainLoop(
+    void *ContextArg)
+{
+    CXX_BENCH_CONTEXT *const Context = (CXX_BENCH_CONTEXT *)ContextArg;
+
+    for (NET_BUFFER_LIST *Nbl = Context->Chain; Nbl != NULL; Nbl = Nbl->Next)
+    {
+        BenchDoNotOptimize(Nbl);
+    }
+}
+
+static void
+WalkNblChainRange(
+    void *ContextArg)
+{
+    CXX_BENCH_CONTEXT *const Context = (CXX_BENCH_CONTEXT *)ContextArg;
+
+    for (auto Nbl : ndis::nbl_chain(Context->Chain))
+    {
+        BenchDoNotOptimize(Nbl);
+    }
+}
+
+static void
+ByValue(
+    void *ContextArg)
+{
+    CXX_BENCH_CONTEXT *const Context = (CXX_BENCH_CONTEXT *)ContextArg;
+
+    NdisClassifyNblChainByValue(
+        BenchLinkNblChain(Context->Pool, 0, Context->Length),
+        ClassifyByFlowValue, NULL, CountBatch, Context);
+}
+
+static void
+ByValueTemplate(
+    void *ContextArg)
+{
+    CXX_BENCH_CONTEXT *const Context = (CXX_BENCH_CONTEXT *)ContextArg;
+
+    ndis::classify_nbl_chain_by_value(
+        BenchLinkNblChain(Context->Pool, 0, Context->Length),
+        [](NET_BUFFER_LIST *Nbl)
+        {
+            return BenchGetFlow(Nbl);
+        },
+        [Context](ULONG_PTR, NBL_QUEUE *Queue)
+        {
+            Context->Batches += 1;
+            BenchDoNotOptimize(Queue->First);
+        });
+}
+
+//
+// Sanity checks
+//
+
+static bool
+CheckEqual(
+    char const *What,
+    SIZE_T Expected,
+    SIZE_T Actual)
+{
+    if (Expected != Actual)
+    {
+        fprintf(stderr, "%s: expected %zu, got %zu\n", What, Expected, Actual);
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+VerifyNblWrappers(
+    BENCH_NBL_POOL *Pool)
+{
+    SIZE_T const Length = CXX_BENCH_MAXIMUM_CHAIN_LENGTH;
+    bool Success = true;
+
+    NET_BUFFER_LIST *const Chain = BenchLinkNblChain(Pool, 0, Length);
+
+    SIZE_T Nbls = 0;
+    SIZE_T Nbs = 0;
+    for (auto Nbl : ndis::nbl_chain(Chain))
+    {
+        Nbls += 1;
+        for (auto Nb : ndis::nb_chain(NET_BUFFER_LIST_FIRST_NB(Nbl)))
+        {
+            UNREFERENCED_PARAMETER(Nb);
+            Nbs += 1;
+        }
+    }
+
+    Success &= CheckEqual("nbl_chain", NdisNumNblsInNblChain(Chain), Nbls);
+    Success &= CheckEqual("nb_chain", NdisNumNbsInNblChain(Chain), Nbs);
+
+    ndis::nbl_queue Queue{ Chain };
+    SIZE_T Queued = 0;
+    for (auto Nbl : Queue)
+    {
+        UNREFERENCED_PARAMETER(Nbl);
+        Queued += 1;
+    }
+
+    Success &= CheckEqual("nbl_queue", Length, Queued);
+
+    for (int Pattern = 0; Pattern < BenchFlowMaximum; Pattern++)
+    {
+        BenchAssignFlows(Pool, (BENCH_FLOW_PATTERN)Pattern);
+
+        CXX_BENCH_CONTEXT Expected = { Pool, Length, NULL, 0 };
+        ByValue(&Expected);
+
+        CXX_BENCH_CONTEXT Actual = { Pool, Length, NULL, 0 };
+        SIZE_T Classified = 0;
+        ndis::classify_nbl_chain_by_value<NBL_COUNTED_QUEUE>(
+            BenchLinkNblChain(Pool, 0, Length),
+            [](NET_BUFFER_LIST *Nbl)
+            {
+                return BenchGetFlow(Nbl);
+            },
+            [&](ULONG_PTR Flow, NBL_COUNTED_QUEUE *Batch)
+            {
+                Actual.Batches += 1;
+                Classified += Batch->NblCount;
+                for (auto Nbl : ndis::nbl_chain(Batch->Queue.First))
+                {
+                    if (BenchGetFlow(Nbl) != Flow)
+                    {
+                        fprintf(stderr, "classify_nbl_chain_by_value: mixed flows in one batch\n");
+                        Success = false;
+                    }
+                }
+            });
+
+        Success &= CheckEqual("classify_nbl_chain_by_value batches", Expected.Batches, Actual.Batches);
+        Success &= CheckEqual("classify_nbl_chain_by_value NBLs", Length, Classified);
+    }
+
+    return Success;
+}
+
+static bool
+VerifyMdlWrappers()
+{
+    bool Success = true;
+    BENCH_MDL_CHAIN Chain;
+
+    BenchCreateMdlChain(&Chain, 4096, 100, 128, 1);
+
+    SIZE_T Mdls = 0;
+    SIZE_T Bytes = 0;
+    for (auto Mdl : ndis::mdl_chain(Chain.Mdls))
+    {
+        Mdls += 1;
+        Bytes += MmGetMdlByteCount(Mdl);
+    }
+
+    Success &= CheckEqual("mdl_chain MDLs", Chain.MdlCount, Mdls);
+    Success &= CheckEqual("mdl_chain bytes", Chain.Length, Bytes);
+
+    MDL_SPAN const Span = { { Chain.Mdls, 50 }, Chain.Length - 100 };
+    SIZE_T Fragments = 0;
+    Bytes = 0;
+    for (auto const &Fragment : ndis::mdl_span_fragments(Span))
+    {
+        Fragments += 1;
+        Bytes += Fragment.Length;
+    }
+
+    Success &= CheckEqual("mdl_span_fragments bytes", Span.Length, Bytes);
+    Success &= CheckEqual("mdl_span_fragments fragments", Chain.MdlCount, Fragments);
+
+    BenchDestroyMdlChain(&Chain);
+    return Success;
+}
+
+//
+// Drivers
+//
+
+typedef struct CXX_BENCH_CASE_t
+{
+    char const *Name;
+    BENCH_ROUTINE *Routine;
+    bool Consumes;
+} CXX_BENCH_CASE;
+
+static CXX_BENCH_CASE const Cases[] =
+{
+    { "walk/loop",          WalkNblChainLoop,   false },
+    { "walk/nbl_chain",     WalkNblChainRange,  false },
+    { "byvalue",            ByValue,            true },
+    { "byvalue-template",   ByValueTemplate,    true },
+};
+
+static void
+RunBenchmarks(
+    BENCH_NBL_POOL *Pool)
+{
+    char Name[128];
+
+    for (int Pattern = 0; Pattern < BenchFlowMaximum; Pattern++)
+    {
+        BenchAssignFlows(Pool, (BENCH_FLOW_PATTERN)Pattern);
+
+        for (SIZE_T l = 0; l < ARRAYSIZE(ChainLengths); l++)
+        {
+            CXX_BENCH_CONTEXT Context = { Pool, ChainLengths[l], NULL, 0 };
+            double Relink = -1;
+
+            for (SIZE_T c = 0; c < ARRAYSIZE(Cases); c++)
+            {
+                snprintf(Name, sizeof(Name), "%s/%s/%zu",
+                    Cases[c].Name, BenchFlowPatternNames[Pattern], Context.Length);
+                if (!BenchShouldRun(Name))
+                {
+                    continue;
+                }
+
+                double Elapsed;
+                if (Cases[c].Consumes)
+                {
+                    // As in nblbench, subtract the cost of relinking the chain
+                    if (Relink < 0)
+                    {
+                        Relink = BenchMeasure(RelinkOnly, &Context);
+                    }
+
+                    Elapsed = BenchMeasure(Cases[c].Routine, &Context) - Relink;
+                    if (Elapsed < 0)
+                    {
+                        Elapsed = 0;
+                    }
+                }
+                else
+                {
+                    Context.Chain = BenchLinkNblChain(Pool, 0, Context.Length);
+                    Elapsed = BenchMeasure(Cases[c].Routine, &Context);
+                }
+
+                BenchReport(Name, Elapsed, Context.Length, 0);
+            }
+        }
+    }
+}
+
+int
+main(
+    int argc,
+    char **argv)
+{
+    BenchParseArguments(argc, argv);
+
+    BENCH_NBL_POOL *const Pool = BenchCreateNblPool(CXX_BENCH_MAXIMUM_CHAIN_LENGTH, TRUE);
+
+    bool const Verified = VerifyNblWrappers(Pool) && VerifyMdlWrappers();
+    if (Verified)
+    {
+        RunBenchmarks(Pool);
+    }
+
+    BenchDestroyNblPool(Pool);
+    return Verified ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+//
+// This code is licensed under the MIT License.
+//
+// Measures the MDL copy routines: flat buffer to MDL chain, MDL chain to
+// flat buffer, and MDL chain to MDL chain, each with the temporal,
+// NonTemporal, and Auto variants.  Filling an MDL chain with a byte and with
+// an 8-byte pattern, and the -WithPrefetch MDL chain to MDL chain copies, are
+// measured the same way.  The mock has one NUMA node, so the prefetching
+// copies show their overhead on local memory, not their benefit on remote
+// memory.
+//
+// Every copy is measured against three MDL layouts:
+//
+//     contiguous  A single MDL covering the whole payload
+//     frag1500    1500-byte fragments in 2KB receive buffers, as a NIC
+//                 would produce for a chain of MTU-sized frames
+//     page        One fragment per 4KB page, with pages in shuffled order
+//
+// Because the mock keeps the default 1MB non-temporal threshold, the Auto
+// variants switch to non-temporal stores at that size on every machine.
+//
+
+#include <ndis.h>
+#include <ndis/ndl/mdl.h>
+
+#include "bench.h"
+
+typedef enum MDL_BENCH_LAYOUT_t
+{
+    MdlBenchContiguous,
+    MdlBenchFragments1500,
+    MdlBenchPages,
+    MdlBenchLayoutMaximum
+} MDL_BENCH_LAYOUT;
+
+static char const *const LayoutNames[MdlBenchLayoutMaximum] =
+{
+    "contiguous",
+    "frag1500",
+    "page",
+};
+
+static SIZE_T const FragmentSizes[MdlBenchLayoutMaximum] = { 0, 1500, PAGE_SIZE };
+static SIZE_T const FragmentStrides[MdlBenchLayoutMaximum] = { 0, 2048, PAGE_SIZE };
+
+static SIZE_T const CopySizes[] =
+{
+    64,
+    1500,
+    4096,
+    64 * 1024,
+    1024 * 1024,
+    16 * 1024 * 1024,
+};
+
+// With --quick, sizes above this are skipped
+#define MDL_BENCH_QUICK_MAXIMUM_SIZE (64 * 1024)
+
+typedef NTSTATUS MDL_BENCH_FLAT_TO_MDL(MDL *, SIZE_T, UCHAR const *, SIZE_T);
+typedef NTSTATUS MDL_BENCH_MDL_TO_FLAT(UCHAR *, MDL *, SIZE_T, SIZE_T);
+typedef NTSTATUS MDL_BENCH_MDL_TO_MDL(MDL *, SIZE_T, MDL *, SIZE_T, SIZE_T);
+typedef NTSTATUS MDL_BENCH_FILL(MDL *, SIZE_T, SIZE_T, UCHAR);
+typedef NTSTATUS MDL_BENCH_FILL_PATTERN(MDL *, SIZE_T, SIZE_T, UCHAR const *, SIZE_T);
+
+typedef struct MDL_BENCH_VARIANT_t
+{
+    char const *Name;
+    MDL_BENCH_FLAT_TO_MDL *FlatToMdl;
+    MDL_BENCH_MDL_TO_FLAT *MdlToFlat;
+    MDL_BENCH_MDL_TO_MDL *MdlToMdl;
+    MDL_BENCH_MDL_TO_MDL *MdlToMdlWithPrefetch;
+    MDL_BENCH_FILL *Fill;
+    MDL_BENCH_FILL_PATTERN *FillPattern;
+} MDL_BENCH_VARIANT;
+
+static MDL_BENCH_VARIANT const Variants[] =
+{
+    {
+        "temporal",
+        MdlCopyFlatBufferToMdlChainAtOffset,
+        MdlCopyMdlChainAtOffsetToFlatBuffer,
+        MdlCopyMdlChainToMdlChainAtOffset,
+        MdlCopyMdlChainToMdlChainAtOffsetWithPrefetch,
+        MdlChainFillBuffersAtOffset,
+        MdlChainFillBuffersAtOffsetWithPattern,
+    },
+    {
+        "nontemporal",
+        MdlCopyFlatBufferToMdlChainAtOffsetNonTemporal,
+        MdlCopyMdlChainAtOffsetToFlatBufferNonTemporal,
+        MdlCopyMdlChainToMdlChainAtOffsetNonTemporal,
+        MdlCopyMdlChainToMdlChainAtOffsetWithPrefetchNonTemporal,
+        MdlChainFillBuffersAtOffsetNonTemporal,
+        MdlChainFillBuffersAtOffsetWithPatternNonTemporal,
+    },
+    {
+        "auto",
+        MdlCopyFlatBufferToMdlChainAtOffsetAuto,
+        MdlCopyMdlChainAtOffsetToFlatBufferAuto,
+        MdlCopyMdlChainToMdlChainAtOffsetAuto,
+        MdlCopyMdlChainToMdlChainAtOffsetWithPrefetchAuto,
+        MdlChainFillBuffersAtOffsetAuto,
+        MdlChainFillBuffersAtOffsetWithPatternAuto,
+    },
+};
+
+typedef struct MDL_BENCH_CONTEXT_t
+{
+    MDL_BENCH_VARIANT const *Variant;
+    BENCH_MDL_CHAIN Source;
+    BENCH_MDL_CHAIN Destination;
+    UCHAR *Flat;
+    SIZE_T Length;
+} MDL_BENCH_CONTEXT;
+
+static void
+CopyFlatToMdl(
+    void *ContextArg)
+{
+    MDL_BENCH_CONTEXT *const Context = (MDL_BENCH_CONTEXT *)ContextArg;
+
+    Context->Variant->FlatToMdl(Context->Destination.Mdls, 0, Context->Flat, Context->Length);
+    BenchDoNotOptimize(Context->Destination.Buffer);
+}
+
+static void
+CopyMdlToFlat(
+    void *ContextArg)
+{
+    MDL_BENCH_CONTEXT *const Context = (MDL_BENCH_CONTEXT *)ContextArg;
+
+    Context->Variant->MdlToFlat(Context->Flat, Context->Source.Mdls, 0, Context->Length);
+    BenchDoNotOptimize(Context->Flat);
+}
+
+static void
+CopyMdlToMdl(
+    void *ContextArg)
+{
+    MDL_BENCH_CONTEXT *const Context = (MDL_BENCH_CONTEXT *)ContextArg;
+
+    Context->Variant->MdlToMdl(Context->Destination.Mdls, 0, Context->Source.Mdls, 0, Context->Length);
+    BenchDoNotOptimize(Context->Destination.Buffer);
+}
+
+static void
+CopyMdlToMdlWithPrefetch(
+    void *ContextArg)
+{
+    MDL_BENCH_CONTEXT *const Context = (MDL_BENCH_CONTEXT *)ContextArg;
+
+    Context->Variant->MdlToMdlWithPrefetch(Context->Destination.Mdls, 0, Context->Source.Mdls, 0, Context->Length);
+    BenchDoNotOptimize(Context->Destination.Buffer);
+}
+
+static void
+FillWithByte(
+    void *ContextArg)
+{
+    MDL_BENCH_CONTEXT *const Context = (MDL_BENCH_CONTEXT *)ContextArg;
+
+    Context->Variant->Fill(Context->Destination.Mdls, 0, Context->Length, 0xa5);
+    BenchDoNotOptimize(Context->Destination.Buffer);
+}
+
+static void
+FillWithPattern8(
+    void *ContextArg)
+{
+    MDL_BENCH_CONTEXT *const Context = (MDL_BENCH_CONTEXT *)ContextArg;
+    static UCHAR const Pattern[8] = { 0xde, 0xad, 0xbe, 0xef, 0x01, 0x23, 0x45, 0x67 };
+
+    Context->Variant->FillPattern(Context->Destination.Mdls, 0, Context->Length, Pattern, sizeof(Pattern));
+    BenchDoNotOptimize(Context->Destination.Buffer);
+}
+
+typedef struct MDL_BENCH_DIRECTION_t
+{
+    char const *Name;
+    BENCH_ROUTINE *Routine;
+} MDL_BENCH_DIRECTION;
+
+static MDL_BENCH_DIRECTION const Directions[] =
+{
+    { "flat-to-mdl",   CopyFlatToMdl },
+    { "mdl-to-flat",   CopyMdlToFlat },
+    { "mdl-to-mdl",    CopyMdlToMdl },
+    { "mdl-to-mdl-prefetch", CopyMdlToMdlWithPrefetch },
+    { "fill-byte",     FillWithByte },
+    { "fill-pattern8", FillWithPattern8 },
+};
+
+int
+main(
+    int argc,
+    char **argv)
+{
+    char Name[128];
+
+    BenchParseArguments(argc, argv);
+    MdlInitializeNonTemporalThreshold();
+
+    for (SIZE_T s = 0; s < ARRAYSIZE(CopySizes); s++)
+    {
+        SIZE_T const Length = CopySizes[s];
+
+        if (BenchOptions.Quick && Length > MDL_BENCH_QUICK_MAXIMUM_SIZE)
+        {
+            continue;
+        }
+
+        for (int Layout = 0; Layout < MdlBenchLayoutMaximum; Layout++)
+        {
+            MDL_BENCH_CONTEXT Context = { 0 };
+            BOOLEAN Allocated = FALSE;
+
+            for (SIZE_T d = 0; d < ARRAYSIZE(Directions); d++)
+            {
+                for (SIZE_T v = 0; v < ARRAYSIZE(Variants); v++)
+                {
+                    snprintf(Name, sizeof(Name), "%s/%s/%s/%zu",
+                        Directions[d].Name, LayoutNames[Layout], Variants[v].Name, Length);
+                    if (!BenchShouldRun(Name))
+                    {
+                        continue;
+                    }
+
+                    if (!Allocated)
+                    {
+                        BenchCreateMdlChain(&Context.Source, Length,
+                            FragmentSizes[Layout], FragmentStrides[Layout], 0x737263ull);
+                        BenchCreateMdlChain(&Context.Destination, Length,
+                            FragmentSizes[Layout], FragmentStrides[Layout], 0x647374ull);
+                        Context.Flat = (UCHAR *)ExAllocatePool2(POOL_FLAG_NON_PAGED, Length, 'tlfB');
+                        if (Context.Flat == NULL)
+                        {
+                            fprintf(stderr, "out of memory\n");
+                            return 1;
+                        }
+
+                        Context.Length = Length;
+                        Allocated = TRUE;
+                    }
+
+                    Context.Variant = &Variants[v];
+                    BenchReport(Name, BenchMeasure(Directions[d].Routine, &Context), 0, Length);
+                }
+            }
+
+            if (Allocated)
+            {
+                BenchDestroyMdlChain(&Context.Source);
+                BenchDestroyMdlChain(&Context.Destination);
+                ExFreePool(Context.Flat);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,485 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+//
+// This code is licensed under the MIT License.
+//
+// Checks the parts of mdl.h that have a vector code path against a plain
+// byte-at-a-time reference.  The vector paths are only compiled when the
+// architecture macro (_M_AMD64 or _M_ARM64) is defined, which the mock never
+// does on its own, so CMakeLists.txt builds this file twice: once as is, for
+// the portable paths, and once with the macro defined for the build machine's
+// architecture.
+//
+// MdlCompareBufferContentsAtOffset runs FindFirstMismatch on each pair of
+// fragments.  It is checked with a mismatch at every offset of every length
+// up to a few vectors, with no mismatch at all, with more mismatches after
+// the first, with every alignment of both bases within a vector, and with
+// the buffers split into fragments of awkward sizes.
+//
+// The CRC32C routines are checked against the known answers in RFC 3720,
+// appendix B.4, and against a bitwise reference.  In a build with the
+// architecture macro, each check runs twice: once with the CRC32C
+// instructions, and once with the feature masked off in the mock so that
+// the table is used.  Both must agree at every length and fragment boundary,
+// including when the data is copied at the same time.
+//
+
+#include <ndis.h>
+#include <ndis/ndl/mdl.h>
+
+#include "bench.h"
+
+#if defined(_M_AMD64)
+#  define MDL_VERIFY_PATHS "amd64"
+#elif defined(_M_ARM64)
+#  define MDL_VERIFY_PATHS "arm64"
+#else
+#  define MDL_VERIFY_PATHS "portable"
+#endif
+
+// Long enough for several 16-byte vectors, 8-byte words, and a byte tail
+#define MDL_VERIFY_MAXIMUM_LENGTH 160
+
+// Room to start either buffer at any offset within a vector
+#define MDL_VERIFY_ALIGNMENTS 16
+
+// At most this many fragments per chain
+#define MDL_VERIFY_MAXIMUM_FRAGMENTS 8
+
+static SIZE_T const FragmentSizes[] = { 0, 1, 7, 15, 17, 33 };
+
+//
+// An MDL chain over one flat buffer.  The last fragment takes whatever is
+// left once MDL_VERIFY_MAXIMUM_FRAGMENTS - 1 fragments have been used.
+//
+
+typedef struct MDL_VERIFY_CHAIN_t
+{
+    MDL Mdls[MDL_VERIFY_MAXIMUM_FRAGMENTS];
+} MDL_VERIFY_CHAIN;
+
+static MDL *
+BuildChain(
+    MDL_VERIFY_CHAIN *Chain,
+    UCHAR *Buffer,
+    SIZE_T Length,
+    SIZE_T FragmentSize)
+{
+    // A chain always has at least one MDL, even for 0 bytes
+    if (FragmentSize == 0 || FragmentSize >= Length)
+    {
+        FragmentSize = Length ? Length : 1;
+    }
+
+    SIZE_T Offset = 0;
+    SIZE_T i = 0;
+    do
+    {
+        SIZE_T const ThisLength = (i + 1 == MDL_VERIFY_MAXIMUM_FRAGMENTS || Length - Offset < FragmentSize)
+            ? Length - Offset
+            : FragmentSize;
+
+        MockInitializeMdl(&Chain->Mdls[i], Buffer + Offset, (ULONG)ThisLength);
+        Chain->Mdls[i].Next = NULL;
+        if (i > 0)
+        {
+            Chain->Mdls[i - 1].Next = &Chain->Mdls[i];
+        }
+
+        Offset += ThisLength;
+        i += 1;
+    } while (Offset < Length);
+
+    return &Chain->Mdls[0];
+}
+
+static BOOLEAN
+CheckEqual(
+    char const *What,
+    SIZE_T Expected,
+    SIZE_T Actual,
+    SIZE_T Length,
+    SIZE_T Alignment1,
+    SIZE_T Alignment2,
+    SIZE_T FragmentSize)
+{
+    if (Expected != Actual)
+    {
+        fprintf(stderr,
+            "%s: expected %zu, got %zu (length %zu, alignments %zu/%zu, fragments of %zu)\n",
+            What, Expected, Actual, Length, Alignment1, Alignment2, FragmentSize);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+//
+// FindFirstMismatch
+//
+
+static SIZE_T
+ReferenceFindFirstMismatch(
+    UCHAR const *Buffer1,
+    UCHAR const *Buffer2,
+    SIZE_T Length)
+{
+    SIZE_T Offset = 0;
+    while (Offset < Length && Buffer1[Offset] == Buffer2[Offset])
+    {
+        Offset += 1;
+    }
+
+    return Offset;
+}
+
+static BOOLEAN
+VerifyCompareOnce(
+    UCHAR *Buffer1,
+    UCHAR *Buffer2,
+    SIZE_T Length,
+    SIZE_T Alignment1,
+    SIZE_T Alignment2,
+    SIZE_T FragmentSize)
+{
+    MDL_VERIFY_CHAIN Chain1;
+    MDL_VERIFY_CHAIN Chain2;
+
+    // Split each side differently, so fragment boundaries don't line up
+    MDL *const Mdl1 = BuildChain(&Chain1, Buffer1, Length + Alignment1, FragmentSize);
+    MDL *const Mdl2 = BuildChain(&Chain2, Buffer2, Length + Alignment2, FragmentSize + 3);
+
+    SIZE_T Mismatch = MAXSIZE_T;
+    NTSTATUS const NtStatus = MdlCompareBufferContentsAtOffset(
+        Mdl1, Alignment1, Mdl2, Alignment2, Length, &Mismatch);
+
+    return CheckEqual("MdlCompareBufferContents status", STATUS_SUCCESS, (SIZE_T)NtStatus,
+            Length, Alignment1, Alignment2, FragmentSize)
+        && CheckEqual("MdlCompareBufferContents mismatch",
+            ReferenceFindFirstMismatch(Buffer1 + Alignment1, Buffer2 + Alignment2, Length), Mismatch,
+            Length, Alignment1, Alignment2, FragmentSize);
+}
+
+static BOOLEAN
+VerifyCompare(
+    SIZE_T *Cases)
+{
+    static UCHAR Storage1[MDL_VERIFY_MAXIMUM_LENGTH + MDL_VERIFY_ALIGNMENTS] DECLSPEC_ALIGN(16);
+    static UCHAR Storage2[MDL_VERIFY_MAXIMUM_LENGTH + MDL_VERIFY_ALIGNMENTS] DECLSPEC_ALIGN(16);
+
+    for (SIZE_T Length = 0; Length <= MDL_VERIFY_MAXIMUM_LENGTH; Length++)
+    {
+        for (SIZE_T Alignment1 = 0; Alignment1 < MDL_VERIFY_ALIGNMENTS; Alignment1++)
+        {
+            for (SIZE_T Alignment2 = 0; Alignment2 < MDL_VERIFY_ALIGNMENTS; Alignment2 += 5)
+            {
+                for (SIZE_T f = 0; f < ARRAYSIZE(FragmentSizes); f++)
+                {
+                    UCHAR *const Buffer1 = Storage1 + Alignment1;
+                    UCHAR *const Buffer2 = Storage2 + Alignment2;
+
+                    for (SIZE_T i = 0; i < Length; i++)
+                    {
+                        Buffer1[i] = (UCHAR)(i * 7 + 3);
+                    }
+
+                    RtlCopyMemory(Buffer2, Buffer1, Length);
+
+                    // Bytes just past the end differ, and must not be reported
+                    Buffer1[Length] = 0x11;
+                    Buffer2[Length] = 0x22;
+
+                    if (!VerifyCompareOnce(Storage1, Storage2, Length, Alignment1, Alignment2, FragmentSizes[f]))
+                    {
+                        return FALSE;
+                    }
+
+                    *Cases += 1;
+
+                    for (SIZE_T Mismatch = 0; Mismatch < Length; Mismatch++)
+                    {
+                        // A single bit, so every bit position of the byte is
+                        // exercised across the loop
+                        Buffer2[Mismatch] ^= (UCHAR)(1u << (Mismatch & 7));
+
+                        // A later mismatch must not win over the first one
+                        if (Mismatch + 9 < Length)
+                        {
+                            Buffer2[Mismatch + 9] ^= 0x80;
+                        }
+
+                        BOOLEAN const Success = VerifyCompareOnce(
+                            Storage1, Storage2, Length, Alignment1, Alignment2, FragmentSizes[f]);
+
+                        Buffer2[Mismatch] ^= (UCHAR)(1u << (Mismatch & 7));
+                        if (Mismatch + 9 < Length)
+                        {
+                            Buffer2[Mismatch + 9] ^= 0x80;
+                        }
+
+                        if (!Success)
+                        {
+                            return FALSE;
+                        }
+
+                        *Cases += 1;
+                    }
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+//
+// ComputeCrc32c
+//
+
+typedef struct MDL_VERIFY_CRC32C_VECTOR_t
+{
+    char const *Name;
+    UCHAR Data[48];
+    SIZE_T Length;
+    ULONG Crc32c;
+} MDL_VERIFY_CRC32C_VECTOR;
+
+static MDL_VERIFY_CRC32C_VECTOR Crc32cVectors[] =
+{
+    // RFC 3720, appendix B.4; the data of the first four is filled in by
+    // InitializeCrc32cVectors
+    { "32 bytes of zeroes", { 0 }, 32, 0x8A9136AA },
+    { "32 bytes of ones", { 0 }, 32, 0x62A8AB43 },
+    { "32 incrementing bytes", { 0 }, 32, 0x46DD794E },
+    { "32 decrementing bytes", { 0 }, 32, 0x113FDB5C },
+    {
+        "an iSCSI - SCSI Read (10) Command PDU",
+        {
+            0x01, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+            0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x18,
+            0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        },
+        48,
+        0xD9963A56,
+    },
+    // The usual check value for a CRC
+    { "\"123456789\"", "123456789", 9, 0xE3069283 },
+};
+
+static void
+InitializeCrc32cVectors(void)
+{
+    for (SIZE_T i = 0; i < 32; i++)
+    {
+        Crc32cVectors[1].Data[i] = 0xFF;
+        Crc32cVectors[2].Data[i] = (UCHAR)i;
+        Crc32cVectors[3].Data[i] = (UCHAR)(31 - i);
+    }
+}
+
+static ULONG
+ReferenceCrc32c(
+    ULONG InitialChecksum,
+    UCHAR const *Buffer,
+    SIZE_T Length)
+{
+    ULONG Crc = ~InitialChecksum;
+    for (SIZE_T i = 0; i < Length; i++)
+    {
+        Crc ^= Buffer[i];
+        for (int Bit = 0; Bit < 8; Bit++)
+        {
+            Crc = (Crc >> 1) ^ (0x82F63B78 & (0 - (Crc & 1)));
+        }
+    }
+
+    return ~Crc;
+}
+
+#if defined(_M_AMD64)
+#  define MDL_VERIFY_CRC32C_FEATURE PF_SSE4_2_INSTRUCTIONS_AVAILABLE
+#elif defined(_M_ARM64)
+#  define MDL_VERIFY_CRC32C_FEATURE PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE
+#endif
+
+// Returns TRUE if mdl.h will use the CRC32C instructions once enabled
+static BOOLEAN
+SetCrc32cHardwareEnabled(
+    BOOLEAN Enabled)
+{
+#if defined(MDL_VERIFY_CRC32C_FEATURE)
+    if (Enabled)
+    {
+        MockDisabledProcessorFeatures &= ~(1ull << MDL_VERIFY_CRC32C_FEATURE);
+    }
+    else
+    {
+        MockDisabledProcessorFeatures |= 1ull << MDL_VERIFY_CRC32C_FEATURE;
+    }
+
+    return ExIsProcessorFeaturePresent(MDL_VERIFY_CRC32C_FEATURE);
+#else
+    UNREFERENCED_PARAMETER(Enabled);
+    return FALSE;
+#endif
+}
+
+static BOOLEAN
+VerifyCrc32cOnce(
+    UCHAR *Buffer,
+    SIZE_T Length,
+    SIZE_T Alignment,
+    SIZE_T FragmentSize,
+    ULONG InitialChecksum)
+{
+    static UCHAR Copy[MDL_VERIFY_MAXIMUM_LENGTH + MDL_VERIFY_ALIGNMENTS];
+    static UCHAR CopyStorage[MDL_VERIFY_MAXIMUM_LENGTH + MDL_VERIFY_ALIGNMENTS];
+    MDL_VERIFY_CHAIN Chain;
+    MDL_VERIFY_CHAIN CopyChain;
+    ULONG Checksum = 0;
+
+    ULONG const Expected = ReferenceCrc32c(InitialChecksum, Buffer + Alignment, Length);
+
+    MDL *const Mdl = BuildChain(&Chain, Buffer, Length + Alignment, FragmentSize);
+    MDL_SPAN const Span = { { Mdl, Alignment }, Length };
+
+    NTSTATUS NtStatus = MdlChainComputeCrc32cAtOffset(Mdl, Alignment, Length, InitialChecksum, &Checksum);
+    if (!CheckEqual("MdlChainComputeCrc32cAtOffset status", STATUS_SUCCESS, (SIZE_T)NtStatus,
+            Length, Alignment, 0, FragmentSize)
+        || !CheckEqual("MdlChainComputeCrc32cAtOffset", Expected, Checksum,
+            Length, Alignment, 0, FragmentSize))
+    {
+        return FALSE;
+    }
+
+    // Copying out of the chain takes the same path with a destination
+    memset(Copy, 0, sizeof(Copy));
+    NtStatus = MdlCopyMdlSpanToFlatBufferWithCrc32c(Copy, &Span, InitialChecksum, &Checksum);
+    if (!CheckEqual("MdlCopyMdlSpanToFlatBufferWithCrc32c status", STATUS_SUCCESS, (SIZE_T)NtStatus,
+            Length, Alignment, 0, FragmentSize)
+        || !CheckEqual("MdlCopyMdlSpanToFlatBufferWithCrc32c", Expected, Checksum,
+            Length, Alignment, 0, FragmentSize)
+        || !CheckEqual("MdlCopyMdlSpanToFlatBufferWithCrc32c copy", 0,
+            (SIZE_T)memcmp(Copy, Buffer + Alignment, Length), Length, Alignment, 0, FragmentSize))
+    {
+        return FALSE;
+    }
+
+    // And so does copying into another chain, split differently
+    memset(CopyStorage, 0, sizeof(CopyStorage));
+    MDL *const CopyMdl = BuildChain(&CopyChain, CopyStorage, Length + 1, FragmentSize + 5);
+    MDL_SPAN const CopySpan = { { CopyMdl, 1 }, Length };
+
+    NtStatus = MdlCopyFlatBufferToMdlSpanWithCrc32c(&CopySpan, Buffer + Alignment, InitialChecksum, &Checksum);
+    if (!CheckEqual("MdlCopyFlatBufferToMdlSpanWithCrc32c status", STATUS_SUCCESS, (SIZE_T)NtStatus,
+            Length, Alignment, 0, FragmentSize)
+        || !CheckEqual("MdlCopyFlatBufferToMdlSpanWithCrc32c", Expected, Checksum,
+            Length, Alignment, 0, FragmentSize)
+        || !CheckEqual("MdlCopyFlatBufferToMdlSpanWithCrc32c copy", 0,
+            (SIZE_T)memcmp(CopyStorage + 1, Buffer + Alignment, Length), Length, Alignment, 0, FragmentSize))
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static BOOLEAN
+VerifyCrc32c(
+    SIZE_T *Cases)
+{
+    static UCHAR Storage[MDL_VERIFY_MAXIMUM_LENGTH + MDL_VERIFY_ALIGNMENTS];
+
+    for (SIZE_T v = 0; v < ARRAYSIZE(Crc32cVectors); v++)
+    {
+        MDL_VERIFY_CRC32C_VECTOR const *const Vector = &Crc32cVectors[v];
+
+        if (!CheckEqual(Vector->Name, Vector->Crc32c,
+                ReferenceCrc32c(0, Vector->Data, Vector->Length), Vector->Length, 0, 0, 0))
+        {
+            return FALSE;
+        }
+
+        for (SIZE_T f = 0; f < ARRAYSIZE(FragmentSizes); f++)
+        {
+            for (SIZE_T Alignment = 0; Alignment < 8; Alignment++)
+            {
+                RtlCopyMemory(Storage + Alignment, Vector->Data, Vector->Length);
+
+                if (!VerifyCrc32cOnce(Storage, Vector->Length, Alignment, FragmentSizes[f], 0))
+                {
+                    fprintf(stderr, "... while checking %s\n", Vector->Name);
+                    return FALSE;
+                }
+
+                *Cases += 1;
+            }
+        }
+    }
+
+    ULONG64 Seed = 0x63726333326364ull;
+    for (SIZE_T i = 0; i < sizeof(Storage); i++)
+    {
+        Seed = Seed * 6364136223846793005ull + 1442695040888963407ull;
+        Storage[i] = (UCHAR)(Seed >> 56);
+    }
+
+    for (SIZE_T Length = 0; Length <= MDL_VERIFY_MAXIMUM_LENGTH; Length++)
+    {
+        for (SIZE_T Alignment = 0; Alignment < MDL_VERIFY_ALIGNMENTS; Alignment++)
+        {
+            for (SIZE_T f = 0; f < ARRAYSIZE(FragmentSizes); f++)
+            {
+                // Continuing from an earlier CRC must work as well as
+                // starting from 0
+                ULONG const InitialChecksum = (Length & 1) ? 0 : 0x12345678;
+
+                if (!VerifyCrc32cOnce(Storage, Length, Alignment, FragmentSizes[f], InitialChecksum))
+                {
+                    return FALSE;
+                }
+
+                *Cases += 1;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+int
+main(
+    int argc,
+    char **argv)
+{
+    UNREFERENCED_PARAMETER(argc);
+    UNREFERENCED_PARAMETER(argv);
+
+    SIZE_T Cases = 0;
+    BOOLEAN const Compared = VerifyCompare(&Cases);
+    printf("%s: compare, %zu cases %s\n", MDL_VERIFY_PATHS, Cases, Compared ? "passed" : "FAILED");
+
+    InitializeCrc32cVectors();
+
+    BOOLEAN Success = Compared;
+    for (int Hardware = 1; Hardware >= 0; Hardware--)
+    {
+        char const *const Path = Hardware ? "instructions" : "table";
+
+        if (SetCrc32cHardwareEnabled((BOOLEAN)Hardware) != (BOOLEAN)Hardware)
+        {
+            printf("%s: crc32c %s, skipped: not in this build or on this processor\n", MDL_VERIFY_PATHS, Path);
+            continue;
+        }
+
+        Cases = 0;
+        BOOLEAN const Checksummed = VerifyCrc32c(&Cases);
+        printf("%s: crc32c %s, %zu cases %s\n", MDL_VERIFY_PATHS, Path, Cases, Checksummed ? "passed" : "FAILED");
+        Success &= Checksummed;
+    }
+
+    return Success ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+//
+// This code is licensed under the MIT License.
+//
+// Stand-in for the MSVC <intrin.h> that mdl.h includes when _M_AMD64 or
+// _M_ARM64 is defined.  The mock never defines those macros itself, so this
+// is only used by a build that defines one of them on the matching GCC or
+// Clang target to compile the vector code paths.
+//
+
+#pragma once
+
+#if defined(_M_AMD64)
+#  if !defined(__x86_64__)
+#    error _M_AMD64 requires an x86-64 target
+#  endif
+#  include <immintrin.h>
+#elif defined(_M_ARM64)
+#  if !defined(__aarch64__)
+#    error _M_ARM64 requires an AArch64 target
+#  endif
+#  include <arm_acle.h>
+#endif
+
+static inline UCHAR _BitScanForward(ULONG *Index, ULONG Mask)
+{
+    if (Mask == 0)
+    {
+        return 0;
+    }
+
+    *Index = (ULONG)__builtin_ctz(Mask);
+    return 1;
+}
+
+static inline UCHAR _BitScanForward64(ULONG *Index, ULONG64 Mask)
+{
+    if (Mask == 0)
+    {
+        return 0;
+    }
+
+    *Index = (ULONG)__builtin_ctzll(Mask);
+    return 1;
+}
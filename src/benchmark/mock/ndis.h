@@ -0,0 +1,627 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+//
+// This code is licensed under the MIT License.
+//
+// Minimal user-mode stand-in for the parts of the WDK that nblchain.h,
+// nblqueue.h, nblclassify.h, mdl.h and statistics.h use.  It exists only so
+// those headers can be compiled and measured with an ordinary compiler; it is
+// NOT a faithful emulation of NDIS or the kernel.
+//
+// The NET_BUFFER_LIST, NET_BUFFER and MDL structures keep the field order
+// and approximate size of their kernel counterparts, so that benchmarks touch
+// roughly the same number of cache lines the kernel would.  MDLs are always
+// "mapped": MmGetSystemAddressForMdlSafe returns MappedSystemVa.
+//
+// Requires GCC or Clang.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+//
+// SAL annotations
+//
+
+#define _In_
+#define _In_opt_
+#define _In_reads_(Count)
+#define _In_reads_opt_(Count)
+#define _In_reads_bytes_(Size)
+#define _In_range_(Low, High)
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(Count)
+#define _Out_writes_opt_(Count)
+#define _Out_writes_to_(Count, Written)
+#define _Out_writes_bytes_(Size)
+#define _Out_writes_bytes_to_(Size, Written)
+#define _Outptr_
+#define _Outptr_result_maybenull_
+#define _Outptr_result_bytebuffer_(Size)
+#define _Inout_
+#define _Inout_opt_
+#define _Inout_updates_(Count)
+#define _Inout_updates_bytes_(Size)
+#define _Field_size_(Count)
+#define _Field_size_opt_(Count)
+#define _Field_size_bytes_(Size)
+#define _Ret_maybenull_
+#define _Ret_range_(Low, High)
+#define _Must_inspect_result_
+#define _Check_return_
+#define _Success_(Expression)
+#define _When_(Condition, Annotation)
+#define _Pre_satisfies_(Expression)
+#define _Post_satisfies_(Expression)
+#define _Analysis_assume_(Expression)
+#define _Use_decl_annotations_
+#define _Function_class_(Name)
+#define _IRQL_requires_(Irql)
+#define _IRQL_requires_max_(Irql)
+#define _IRQL_requires_min_(Irql)
+#define _IRQL_requires_same_
+
+#define __pragma(x)
+#define __declspec(x)
+
+//
+// Basic types and constants
+//
+
+typedef void VOID, *PVOID;
+typedef unsigned char UCHAR, *PUCHAR, BOOLEAN;
+typedef char CCHAR;
+typedef unsigned short USHORT;
+typedef unsigned int ULONG, UINT;
+typedef int LONG;
+typedef long long LONG64, LONGLONG;
+typedef unsigned long long ULONG64, ULONGLONG;
+typedef size_t SIZE_T;
+typedef uintptr_t ULONG_PTR, UINT_PTR;
+typedef intptr_t LONG_PTR;
+typedef LONG NTSTATUS;
+typedef LONG NDIS_STATUS;
+typedef PVOID NDIS_HANDLE;
+typedef UCHAR KIRQL;
+
+#define TRUE 1
+#define FALSE 0
+
+#define PASSIVE_LEVEL 0
+#define APC_LEVEL 1
+#define DISPATCH_LEVEL 2
+#define HIGH_LEVEL 15
+
+#define STATUS_SUCCESS ((NTSTATUS)0x00000000L)
+#define STATUS_PENDING ((NTSTATUS)0x00000103L)
+#define STATUS_INVALID_PARAMETER ((NTSTATUS)0xC000000DL)
+#define STATUS_INSUFFICIENT_RESOURCES ((NTSTATUS)0xC000009AL)
+#define STATUS_NOT_SUPPORTED ((NTSTATUS)0xC00000BBL)
+#define STATUS_BUFFER_TOO_SMALL ((NTSTATUS)0xC0000023L)
+#define STATUS_INTEGER_OVERFLOW ((NTSTATUS)0xC0000095L)
+#define NT_SUCCESS(Status) (((NTSTATUS)(Status)) >= 0)
+
+#define NDIS_STATUS_SUCCESS ((NDIS_STATUS)STATUS_SUCCESS)
+
+#define MAXSIZE_T ((SIZE_T)~((SIZE_T)0))
+#define MAXULONG 0xffffffffUL
+#define MAX_NATURAL_ALIGNMENT sizeof(ULONG64)
+#define SYSTEM_CACHE_ALIGNMENT_SIZE 64
+#define PAGE_SIZE 4096
+#define PAGE_SHIFT 12
+
+#define DECLSPEC_CACHEALIGN __attribute__((aligned(SYSTEM_CACHE_ALIGNMENT_SIZE)))
+#define DECLSPEC_ALIGN(Alignment) __attribute__((aligned(Alignment)))
+#define DECLSPEC_NOINLINE __attribute__((noinline))
+#define DECLSPEC_NORETURN __attribute__((noreturn))
+#define DECLSPEC_SELECTANY __attribute__((weak))
+#define FORCEINLINE static inline __attribute__((always_inline))
+
+#ifdef __cplusplus
+#  define C_ASSERT(Expression) static_assert((Expression), #Expression)
+#else
+#  define C_ASSERT(Expression) _Static_assert((Expression), #Expression)
+#endif
+
+#define FIELD_OFFSET(Type, Field) ((LONG)offsetof(Type, Field))
+#define FIELD_SIZE(Type, Field) (sizeof(((Type *)0)->Field))
+#define CONTAINING_RECORD(Address, Type, Field) \
+    ((Type *)((UCHAR *)(Address) - offsetof(Type, Field)))
+#define ARRAYSIZE(Array) (sizeof(Array) / sizeof((Array)[0]))
+#define UNREFERENCED_PARAMETER(Parameter) ((void)(Parameter))
+#define ARGUMENT_PRESENT(Pointer) ((Pointer) != NULL)
+#define PtrToUlong(Pointer) ((ULONG)(ULONG_PTR)(Pointer))
+#define ULongToPtr(Value) ((PVOID)(ULONG_PTR)(ULONG)(Value))
+#define ALIGN_UP_BY(Value, Alignment) \
+    (((ULONG_PTR)(Value) + ((Alignment) - 1)) & ~((ULONG_PTR)(Alignment) - 1))
+#define ALIGN_DOWN_BY(Value, Alignment) \
+    ((ULONG_PTR)(Value) & ~((ULONG_PTR)(Alignment) - 1))
+#define BYTE_OFFSET(Va) ((ULONG)((ULONG_PTR)(Va) & (PAGE_SIZE - 1)))
+#define ADDRESS_AND_SIZE_TO_SPAN_PAGES(Va, Size) \
+    ((BYTE_OFFSET(Va) + ((SIZE_T)(Size)) + (PAGE_SIZE - 1)) >> PAGE_SHIFT)
+
+#define NT_ASSERT(Expression) assert(Expression)
+
+#define FAST_FAIL_INVALID_ARG 5
+#define FAST_FAIL_INVALID_BUFFER_ACCESS 28
+#define RtlFailFast(Code) abort()
+
+//
+// Processors, memory, and interlocked operations
+//
+// The benchmarks are single-threaded, so there is exactly one processor.
+//
+
+#define ALL_PROCESSOR_GROUPS 0xffff
+
+typedef struct _PROCESSOR_NUMBER
+{
+    USHORT Group;
+    UCHAR Number;
+    UCHAR Reserved;
+} PROCESSOR_NUMBER;
+
+typedef struct _GROUP_AFFINITY
+{
+    ULONG_PTR Mask;
+    USHORT Group;
+    USHORT Reserved[3];
+} GROUP_AFFINITY;
+
+typedef enum _LOGICAL_PROCESSOR_RELATIONSHIP
+{
+    RelationProcessorCore,
+    RelationNumaNode,
+    RelationCache,
+    RelationProcessorPackage,
+    RelationGroup,
+    RelationAll = 0xffff
+} LOGICAL_PROCESSOR_RELATIONSHIP;
+
+typedef enum _PROCESSOR_CACHE_TYPE
+{
+    CacheUnified,
+    CacheInstruction,
+    CacheData,
+    CacheTrace
+} PROCESSOR_CACHE_TYPE;
+
+typedef struct _CACHE_RELATIONSHIP
+{
+    UCHAR Level;
+    UCHAR Associativity;
+    USHORT LineSize;
+    ULONG CacheSize;
+    PROCESSOR_CACHE_TYPE Type;
+    UCHAR Reserved[18];
+    USHORT GroupCount;
+    GROUP_AFFINITY GroupMask;
+} CACHE_RELATIONSHIP;
+
+typedef struct _SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX
+{
+    LOGICAL_PROCESSOR_RELATIONSHIP Relationship;
+    ULONG Size;
+    union
+    {
+        CACHE_RELATIONSHIP Cache;
+    };
+} SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX;
+
+#define KeQueryMaximumProcessorCountEx(GroupNumber) ((ULONG)1)
+#define KeQueryActiveProcessorCountEx(GroupNumber) ((ULONG)1)
+#define KeGetCurrentProcessorIndex() ((ULONG)0)
+#define KeGetCurrentIrql() ((KIRQL)PASSIVE_LEVEL)
+#define KeRaiseIrql(NewIrql, OldIrql) (*(OldIrql) = PASSIVE_LEVEL)
+#define KeLowerIrql(NewIrql) ((void)(NewIrql))
+
+static inline NTSTATUS KeGetProcessorNumberFromIndex(ULONG Index, PROCESSOR_NUMBER *ProcessorNumber)
+{
+    ProcessorNumber->Group = 0;
+    ProcessorNumber->Number = (UCHAR)Index;
+    ProcessorNumber->Reserved = 0;
+    return Index == 0 ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+}
+
+// The cache topology is not emulated, so MdlInitializeNonTemporalThreshold
+// leaves its default threshold in place.
+static inline NTSTATUS KeQueryLogicalProcessorRelationship(
+    PROCESSOR_NUMBER *ProcessorNumber,
+    LOGICAL_PROCESSOR_RELATIONSHIP RelationshipType,
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *Information,
+    ULONG *Length)
+{
+    (void)ProcessorNumber;
+    (void)RelationshipType;
+    (void)Information;
+    (void)Length;
+    return STATUS_NOT_SUPPORTED;
+}
+
+// There is a single NUMA node, holding the single processor
+#define KeGetCurrentNodeNumber() ((USHORT)0)
+
+static inline void KeQueryNodeActiveAffinity(USHORT NodeNumber, GROUP_AFFINITY *Affinity, USHORT *Count)
+{
+    memset(Affinity, 0, sizeof(*Affinity));
+    Affinity->Mask = NodeNumber == 0 ? 1 : 0;
+    if (Count != NULL)
+    {
+        *Count = NodeNumber == 0 ? 1 : 0;
+    }
+}
+
+static inline ULONG64 MockQueryNanoseconds(void);
+#define KeQueryInterruptTime() (MockQueryNanoseconds() / 100)
+
+typedef ULONG64 POOL_FLAGS;
+#define POOL_FLAG_UNINITIALIZED 0x0000000000000002ULL
+#define POOL_FLAG_CACHE_ALIGNED 0x0000000000000008ULL
+#define POOL_FLAG_NON_PAGED 0x0000000000000040ULL
+#define POOL_FLAG_PAGED 0x0000000000000100ULL
+
+static inline PVOID ExAllocatePool2(POOL_FLAGS Flags, SIZE_T NumberOfBytes, ULONG Tag)
+{
+    (void)Tag;
+    SIZE_T const Rounded = (NumberOfBytes + SYSTEM_CACHE_ALIGNMENT_SIZE - 1) & ~(SIZE_T)(SYSTEM_CACHE_ALIGNMENT_SIZE - 1);
+    PVOID Buffer = aligned_alloc(SYSTEM_CACHE_ALIGNMENT_SIZE, Rounded ? Rounded : SYSTEM_CACHE_ALIGNMENT_SIZE);
+    if (Buffer && !(Flags & POOL_FLAG_UNINITIALIZED))
+    {
+        memset(Buffer, 0, NumberOfBytes);
+    }
+    return Buffer;
+}
+
+#define ExFreePool(Buffer) free(Buffer)
+#define ExFreePoolWithTag(Buffer, Tag) free(Buffer)
+
+//
+// Processor features are only reported for the architecture macro the build
+// defines, since the headers only use them in code for that architecture.
+// A test may set a feature's bit in MockDisabledProcessorFeatures to make
+// the headers take their portable path instead.
+//
+
+#if defined(_M_AMD64)
+#  define PF_SSE4_2_INSTRUCTIONS_AVAILABLE 38
+#elif defined(_M_ARM64)
+#  define PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE 31
+#endif
+
+static ULONG64 MockDisabledProcessorFeatures;
+
+static inline BOOLEAN ExIsProcessorFeaturePresent(ULONG ProcessorFeature)
+{
+    if (ProcessorFeature >= 64 || (MockDisabledProcessorFeatures & (1ull << ProcessorFeature)))
+    {
+        return FALSE;
+    }
+
+#if defined(_M_AMD64)
+    if (ProcessorFeature == PF_SSE4_2_INSTRUCTIONS_AVAILABLE)
+    {
+        return __builtin_cpu_supports("sse4.2") ? TRUE : FALSE;
+    }
+#elif defined(_M_ARM64)
+    // The build targets armv8-a+crc, so the compiler already assumes it
+    if (ProcessorFeature == PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE)
+    {
+        return TRUE;
+    }
+#endif
+
+    return FALSE;
+}
+
+#define PF_TEMPORAL_LEVEL_1 3
+#define PF_NON_TEMPORAL_LEVEL_ALL 0
+#define PreFetchCacheLine(Level, Address) __builtin_prefetch((void const *)(Address), 0, (Level))
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define YieldProcessor() __builtin_ia32_pause()
+#else
+#  define YieldProcessor() ((void)0)
+#endif
+
+static inline PVOID ReadPointerNoFence(PVOID const volatile *Source) { return __atomic_load_n(Source, __ATOMIC_RELAXED); }
+static inline PVOID ReadPointerAcquire(PVOID const volatile *Source) { return __atomic_load_n(Source, __ATOMIC_ACQUIRE); }
+static inline void WritePointerNoFence(PVOID volatile *Destination, PVOID Value) { __atomic_store_n(Destination, Value, __ATOMIC_RELAXED); }
+static inline void WritePointerRelease(PVOID volatile *Destination, PVOID Value) { __atomic_store_n(Destination, Value, __ATOMIC_RELEASE); }
+static inline PVOID InterlockedExchangePointer(PVOID volatile *Target, PVOID Value) { return __atomic_exchange_n(Target, Value, __ATOMIC_SEQ_CST); }
+static inline LONG InterlockedDecrement(LONG volatile *Target) { return __atomic_sub_fetch(Target, 1, __ATOMIC_SEQ_CST); }
+static inline LONG InterlockedCompareExchange(LONG volatile *Target, LONG Exchange, LONG Comparand)
+{
+    __atomic_compare_exchange_n(Target, &Comparand, Exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return Comparand;
+}
+
+//
+// DPCs
+//
+// With one processor, a DPC runs as soon as it is queued.
+//
+
+typedef struct _KDPC KDPC;
+typedef void KDEFERRED_ROUTINE(KDPC *Dpc, PVOID DeferredContext, PVOID SystemArgument1, PVOID SystemArgument2);
+
+struct _KDPC
+{
+    KDEFERRED_ROUTINE *DeferredRoutine;
+    PVOID DeferredContext;
+};
+
+typedef enum _KDPC_IMPORTANCE
+{
+    LowImportance,
+    MediumImportance,
+    HighImportance,
+    MediumHighImportance
+} KDPC_IMPORTANCE;
+
+static inline void KeInitializeDpc(KDPC *Dpc, KDEFERRED_ROUTINE *DeferredRoutine, PVOID DeferredContext)
+{
+    Dpc->DeferredRoutine = DeferredRoutine;
+    Dpc->DeferredContext = DeferredContext;
+}
+
+static inline NTSTATUS KeSetTargetProcessorDpcEx(KDPC *Dpc, PROCESSOR_NUMBER *ProcessorNumber)
+{
+    (void)Dpc;
+    (void)ProcessorNumber;
+    return STATUS_SUCCESS;
+}
+
+#define KeSetImportanceDpc(Dpc, Importance) ((void)0)
+
+static inline BOOLEAN KeInsertQueueDpc(KDPC *Dpc, PVOID SystemArgument1, PVOID SystemArgument2)
+{
+    Dpc->DeferredRoutine(Dpc, Dpc->DeferredContext, SystemArgument1, SystemArgument2);
+    return TRUE;
+}
+
+//
+// Memory routines
+//
+
+#define RtlCopyMemory(Destination, Source, Length) memcpy((Destination), (Source), (Length))
+#define RtlMoveMemory(Destination, Source, Length) memmove((Destination), (Source), (Length))
+#define RtlZeroMemory(Destination, Length) memset((Destination), 0, (Length))
+#define RtlSecureZeroMemory(Destination, Length) memset((Destination), 0, (Length))
+#define RtlFillMemory(Destination, Length, Fill) memset((Destination), (Fill), (Length))
+#define RtlEqualMemory(Source1, Source2, Length) (memcmp((Source1), (Source2), (Length)) == 0)
+
+static inline SIZE_T RtlCompareMemory(void const *Source1, void const *Source2, SIZE_T Length)
+{
+    SIZE_T i = 0;
+    while (i < Length && ((UCHAR const *)Source1)[i] == ((UCHAR const *)Source2)[i])
+    {
+        i++;
+    }
+    return i;
+}
+
+static inline CCHAR RtlFindMostSignificantBit(ULONGLONG Set)
+{
+    return Set ? (CCHAR)(63 - __builtin_clzll(Set)) : (CCHAR)-1;
+}
+
+static inline CCHAR RtlFindLeastSignificantBit(ULONGLONG Set)
+{
+    return Set ? (CCHAR)__builtin_ctzll(Set) : (CCHAR)-1;
+}
+
+static inline ULONG RtlNumberOfSetBitsUlongPtr(ULONG_PTR Target)
+{
+    return (ULONG)__builtin_popcountll((ULONGLONG)Target);
+}
+
+//
+// Like the kernel's routines, these use streaming stores where the processor
+// has them, so the destination does not displace the cache.
+//
+
+static inline void RtlCopyMemoryNonTemporal(void *Destination, void const *Source, SIZE_T Length)
+{
+#if defined(__SSE2__)
+    UCHAR *d = (UCHAR *)Destination;
+    UCHAR const *s = (UCHAR const *)Source;
+
+    SIZE_T const Head = (16 - ((ULONG_PTR)d & 15)) & 15;
+    if (Length < Head + 64)
+    {
+        memcpy(d, s, Length);
+        return;
+    }
+
+    memcpy(d, s, Head);
+    d += Head;
+    s += Head;
+    Length -= Head;
+
+    for (; Length >= 64; Length -= 64, d += 64, s += 64)
+    {
+        __m128i const a = _mm_loadu_si128((__m128i const *)(s + 0));
+        __m128i const b = _mm_loadu_si128((__m128i const *)(s + 16));
+        __m128i const c = _mm_loadu_si128((__m128i const *)(s + 32));
+        __m128i const e = _mm_loadu_si128((__m128i const *)(s + 48));
+        _mm_stream_si128((__m128i *)(d + 0), a);
+        _mm_stream_si128((__m128i *)(d + 16), b);
+        _mm_stream_si128((__m128i *)(d + 32), c);
+        _mm_stream_si128((__m128i *)(d + 48), e);
+    }
+
+    _mm_sfence();
+    memcpy(d, s, Length);
+#else
+    memcpy(Destination, Source, Length);
+#endif
+}
+
+static inline void RtlFillMemoryNonTemporal(void *Destination, SIZE_T Length, UCHAR Fill)
+{
+#if defined(__SSE2__)
+    UCHAR *d = (UCHAR *)Destination;
+
+    SIZE_T const Head = (16 - ((ULONG_PTR)d & 15)) & 15;
+    if (Length < Head + 64)
+    {
+        memset(d, Fill, Length);
+        return;
+    }
+
+    memset(d, Fill, Head);
+    d += Head;
+    Length -= Head;
+
+    __m128i const Value = _mm_set1_epi8((char)Fill);
+    for (; Length >= 64; Length -= 64, d += 64)
+    {
+        _mm_stream_si128((__m128i *)(d + 0), Value);
+        _mm_stream_si128((__m128i *)(d + 16), Value);
+        _mm_stream_si128((__m128i *)(d + 32), Value);
+        _mm_stream_si128((__m128i *)(d + 48), Value);
+    }
+
+    _mm_sfence();
+    memset(d, Fill, Length);
+#else
+    memset(Destination, Fill, Length);
+#endif
+}
+
+//
+// MDLs
+//
+
+typedef struct _MDL
+{
+    struct _MDL *Next;
+    short Size;
+    short MdlFlags;
+    struct _EPROCESS *Process;
+    PVOID MappedSystemVa;
+    PVOID StartVa;
+    ULONG ByteCount;
+    ULONG ByteOffset;
+} MDL, *PMDL;
+
+#define MDL_MAPPED_TO_SYSTEM_VA 0x0001
+#define MDL_SOURCE_IS_NONPAGED_POOL 0x0004
+#define MDL_PARTIAL 0x0010
+
+#define LowPagePriority 0
+#define NormalPagePriority 16
+#define HighPagePriority 32
+#define MdlMappingNoExecute 0x40000000
+
+#define MmGetMdlByteCount(Mdl) ((Mdl)->ByteCount)
+#define MmGetMdlByteOffset(Mdl) ((Mdl)->ByteOffset)
+#define MmGetMdlVirtualAddress(Mdl) ((PVOID)((UCHAR *)((Mdl)->StartVa) + (Mdl)->ByteOffset))
+#define MmGetSystemAddressForMdlSafe(Mdl, Priority) ((Mdl)->MappedSystemVa)
+
+// Describes Length bytes at Buffer; the MDL is treated as already mapped
+static inline void MockInitializeMdl(MDL *Mdl, void *Buffer, ULONG Length)
+{
+    memset(Mdl, 0, sizeof(*Mdl));
+    Mdl->MdlFlags = MDL_SOURCE_IS_NONPAGED_POOL | MDL_MAPPED_TO_SYSTEM_VA;
+    Mdl->StartVa = (PVOID)ALIGN_DOWN_BY(Buffer, PAGE_SIZE);
+    Mdl->ByteOffset = BYTE_OFFSET(Buffer);
+    Mdl->ByteCount = Length;
+    Mdl->MappedSystemVa = Buffer;
+}
+
+static inline void IoBuildPartialMdl(MDL *SourceMdl, MDL *TargetMdl, PVOID VirtualAddress, ULONG Length)
+{
+    ULONG_PTR const Delta = (ULONG_PTR)((UCHAR *)VirtualAddress - (UCHAR *)MmGetMdlVirtualAddress(SourceMdl));
+    MockInitializeMdl(TargetMdl, (UCHAR *)SourceMdl->MappedSystemVa + Delta, Length);
+    TargetMdl->MdlFlags |= MDL_PARTIAL;
+}
+
+//
+// NET_BUFFER and NET_BUFFER_LIST
+//
+
+typedef struct _NET_BUFFER
+{
+    struct _NET_BUFFER *Next;
+    MDL *CurrentMdl;
+    ULONG CurrentMdlOffset;
+    ULONG DataLength;
+    MDL *MdlChain;
+    ULONG DataOffset;
+    USHORT ChecksumBias;
+    USHORT Reserved;
+    NDIS_HANDLE NdisPoolHandle;
+    PVOID NdisReserved[2];
+    PVOID ProtocolReserved[6];
+    PVOID MiniportReserved[4];
+    ULONG64 DataPhysicalAddress;
+    PVOID SharedMemoryInfo;
+} NET_BUFFER;
+
+typedef enum _NDIS_NET_BUFFER_LIST_INFO
+{
+    TcpIpChecksumNetBufferListInfo,
+    TcpLargeSendNetBufferListInfo,
+    Ieee8021QNetBufferListInfo,
+    NetBufferListCancelId,
+    MediaSpecificInformation,
+    NetBufferListFrameType,
+    NetBufferListHashValue,
+    NetBufferListHashInfo,
+    MaxNetBufferListInfo = 29
+} NDIS_NET_BUFFER_LIST_INFO;
+
+typedef struct _NET_BUFFER_LIST
+{
+    struct _NET_BUFFER_LIST *Next;
+    NET_BUFFER *FirstNetBuffer;
+    PVOID Context;
+    struct _NET_BUFFER_LIST *ParentNetBufferList;
+    NDIS_HANDLE NdisPoolHandle;
+    PVOID NdisReserved[2];
+    PVOID ProtocolReserved[4];
+    PVOID MiniportReserved[2];
+    PVOID Scratch;
+    NDIS_HANDLE SourceHandle;
+    ULONG NblFlags;
+    LONG ChildRefCount;
+    ULONG Flags;
+    NDIS_STATUS Status;
+    PVOID NetBufferListInfo[MaxNetBufferListInfo];
+} NET_BUFFER_LIST;
+
+#define NET_BUFFER_LIST_FIRST_NB(Nbl) ((Nbl)->FirstNetBuffer)
+#define NET_BUFFER_LIST_NEXT_NBL(Nbl) ((Nbl)->Next)
+#define NET_BUFFER_LIST_INFO(Nbl, Id) ((Nbl)->NetBufferListInfo[(Id)])
+#define NET_BUFFER_LIST_STATUS(Nbl) ((Nbl)->Status)
+#define NET_BUFFER_NEXT_NB(Nb) ((Nb)->Next)
+#define NET_BUFFER_FIRST_MDL(Nb) ((Nb)->MdlChain)
+#define NET_BUFFER_CURRENT_MDL(Nb) ((Nb)->CurrentMdl)
+#define NET_BUFFER_CURRENT_MDL_OFFSET(Nb) ((Nb)->CurrentMdlOffset)
+#define NET_BUFFER_DATA_LENGTH(Nb) ((Nb)->DataLength)
+#define NET_BUFFER_DATA_OFFSET(Nb) ((Nb)->DataOffset)
+#define NDIS_GET_NET_BUFFER_LIST_CANCEL_ID(Nbl) (NET_BUFFER_LIST_INFO((Nbl), NetBufferListCancelId))
+
+//
+// Timing, used by KeQueryInterruptTime and by the benchmarks
+//
+
+#include <time.h>
+
+static inline ULONG64 MockQueryNanoseconds(void)
+{
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (ULONG64)Now.tv_sec * 1000000000ull + (ULONG64)Now.tv_nsec;
+}
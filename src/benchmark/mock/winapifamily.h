@@ -0,0 +1,16 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+//
+// This code is licensed under the MIT License.
+//
+// Minimal stand-in for the Windows SDK's winapifamily.h, so the NDL headers
+// can be compiled in user mode for benchmarking.  See ndis.h in this
+// directory.
+//
+
+#pragma once
+
+#define WINAPI_PARTITION_SYSTEM 0x1
+#define WINAPI_PARTITION_DESKTOP 0x2
+
+#define WINAPI_FAMILY_PARTITION(Partitions) 1
@@ -0,0 +1,386 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+//
+// This code is licensed under the MIT License.
+//
+// Measures the NBL chain, queue, and classification routines, and reading
+// the headers of each NBL in a chain.
+//
+// The classifiers consume their input chain, so each iteration relinks the
+// chain before classifying it.  The cost of relinking alone is measured
+// separately for each chain length and subtracted from the classifier
+// results, so the ns/item column is the cost of classification only.
+//
+
+#include <ndis.h>
+#include <ndis/ndl/nblchain.h>
+#include <ndis/ndl/nblqueue.h>
+#include <ndis/ndl/nblclassify.h>
+#include <ndis/ndl/nblheader.h>
+
+#include "bench.h"
+
+#define NBL_BENCH_MAXIMUM_CHAIN_LENGTH 1024
+
+static SIZE_T const ChainLengths[] = { 1, 8, 64, 256, 1024 };
+
+typedef struct NBL_BENCH_CONTEXT_t
+{
+    BENCH_NBL_POOL *Pool;
+    SIZE_T Length;
+    NET_BUFFER_LIST *Chain;
+    SIZE_T Batches;
+} NBL_BENCH_CONTEXT;
+
+// Sized for the longest chain, so neither hashed routine ever overflows
+static NBL_CLASSIFICATION_HASH_TABLE ScratchTable;
+static ULONG_PTR ScratchTableStorage[
+    NBL_CLASSIFICATION_HASH_TABLE_STORAGE_SIZE(NBL_BENCH_MAXIMUM_CHAIN_LENGTH) / sizeof(ULONG_PTR)];
+
+// Enough for an Ethernet, IPv4, and TCP header
+#define NBL_BENCH_HEADER_LENGTH 54
+
+static UCHAR HeaderStorage[NBL_BENCH_MAXIMUM_CHAIN_LENGTH * NBL_BENCH_HEADER_LENGTH];
+static NBL_CONTIGUOUS_HEADER Headers[NBL_BENCH_MAXIMUM_CHAIN_LENGTH];
+
+//
+// Callbacks
+//
+
+static SIZE_T
+ClassifyByFlowIndex(
+    PVOID ClassificationContext,
+    NET_BUFFER_LIST *Nbl)
+{
+    UNREFERENCED_PARAMETER(ClassificationContext);
+    return BenchGetFlow(Nbl) & 1;
+}
+
+static ULONG_PTR
+ClassifyByFlowValue(
+    PVOID ClassificationContext,
+    NET_BUFFER_LIST *Nbl)
+{
+    UNREFERENCED_PARAMETER(ClassificationContext);
+    return BenchGetFlow(Nbl);
+}
+
+static void
+CountBatch(
+    PVOID FlushContext,
+    ULONG_PTR ClassificationResult,
+    NBL_QUEUE *Queue)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)FlushContext;
+
+    UNREFERENCED_PARAMETER(ClassificationResult);
+
+    Context->Batches += 1;
+    BenchDoNotOptimize(Queue->First);
+}
+
+//
+// Routines under measurement
+//
+
+static void
+RelinkOnly(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+
+    Context->Chain = BenchLinkNblChain(Context->Pool, 0, Context->Length);
+    BenchDoNotOptimize(Context->Chain);
+}
+
+static void
+CountNbls(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+
+    SIZE_T const Count = NdisNumNblsInNblChain(Context->Chain);
+    BenchDoNotOptimize(&Count);
+}
+
+static void
+AppendSingleThenPopAll(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+    NET_BUFFER_LIST **const Order = Context->Pool->Order;
+
+    NBL_QUEUE Queue;
+    NdisInitializeNblQueue(&Queue);
+
+    for (SIZE_T i = 0; i < Context->Length; i++)
+    {
+        Order[i]->Next = NULL;
+        NdisAppendSingleNblToNblQueue(&Queue, Order[i]);
+    }
+
+    BenchDoNotOptimize(NdisPopAllFromNblQueue(&Queue));
+}
+
+static void
+PopFirstUntilEmpty(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+
+    NBL_QUEUE Queue;
+    NdisInitializeNblQueue(&Queue);
+    NdisAppendNblChainToNblQueue(&Queue, BenchLinkNblChain(Context->Pool, 0, Context->Length));
+
+    while (!NdisIsNblQueueEmpty(&Queue))
+    {
+        BenchDoNotOptimize(NdisPopFirstNblFromNblQueue(&Queue));
+    }
+}
+
+static void
+GetHeadersBatched(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+
+    SIZE_T NumberOfHeaders;
+    NdisGetNblChainContiguousHeaders(
+        Context->Chain, NBL_BENCH_HEADER_LENGTH, HeaderStorage,
+        Headers, ARRAYSIZE(Headers), &NumberOfHeaders);
+
+    BenchDoNotOptimize(Headers);
+}
+
+static void
+CopyHeadersOneByOne(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+    UCHAR *Storage = HeaderStorage;
+
+    // The usual pattern: copy each header out of its NET_BUFFER
+    for (NET_BUFFER_LIST *Nbl = Context->Chain; Nbl != NULL; Nbl = Nbl->Next)
+    {
+        NET_BUFFER *const Nb = NET_BUFFER_LIST_FIRST_NB(Nbl);
+
+        MdlCopyMdlChainAtOffsetToFlatBuffer(
+            Storage, NET_BUFFER_CURRENT_MDL(Nb), NET_BUFFER_CURRENT_MDL_OFFSET(Nb), NBL_BENCH_HEADER_LENGTH);
+        Storage += NBL_BENCH_HEADER_LENGTH;
+    }
+
+    BenchDoNotOptimize(HeaderStorage);
+}
+
+static void
+LibraryClassify2(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+
+    NBL_QUEUE Queue0, Queue1;
+    NdisInitializeNblQueue(&Queue0);
+    NdisInitializeNblQueue(&Queue1);
+
+    NdisClassifyNblChain2(
+        BenchLinkNblChain(Context->Pool, 0, Context->Length),
+        ClassifyByFlowIndex, NULL, &Queue0, &Queue1);
+
+    BenchDoNotOptimize(Queue0.First);
+    BenchDoNotOptimize(Queue1.First);
+}
+
+static void
+NaiveClassify2(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+
+    NBL_QUEUE Queues[2];
+    NdisInitializeNblQueue(&Queues[0]);
+    NdisInitializeNblQueue(&Queues[1]);
+
+    // The straightforward loop that NdisClassifyNblChain2 replaces: unlink
+    // each NBL and append it to its queue, one at a time.
+    NET_BUFFER_LIST *Nbl = BenchLinkNblChain(Context->Pool, 0, Context->Length);
+    while (Nbl != NULL)
+    {
+        NET_BUFFER_LIST *const Next = Nbl->Next;
+        Nbl->Next = NULL;
+        NdisAppendSingleNblToNblQueue(&Queues[ClassifyByFlowIndex(NULL, Nbl)], Nbl);
+        Nbl = Next;
+    }
+
+    BenchDoNotOptimize(Queues[0].First);
+    BenchDoNotOptimize(Queues[1].First);
+}
+
+static void
+ByValue(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+
+    NdisClassifyNblChainByValue(
+        BenchLinkNblChain(Context->Pool, 0, Context->Length),
+        ClassifyByFlowValue, NULL, CountBatch, Context);
+}
+
+static void
+ByValueLookahead(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+
+    NdisClassifyNblChainByValueLookahead(
+        BenchLinkNblChain(Context->Pool, 0, Context->Length),
+        ClassifyByFlowValue, NULL, CountBatch, Context);
+}
+
+static void
+ByValueHashed(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+
+    NdisClassifyNblChainByValueHashed(
+        BenchLinkNblChain(Context->Pool, 0, Context->Length),
+        ClassifyByFlowValue, NULL, CountBatch, Context, &ScratchTable);
+}
+
+static void
+GroupByValue(
+    void *ContextArg)
+{
+    NBL_BENCH_CONTEXT *const Context = (NBL_BENCH_CONTEXT *)ContextArg;
+
+    BenchDoNotOptimize(NdisGroupNblChainByValue(
+        BenchLinkNblChain(Context->Pool, 0, Context->Length),
+        ClassifyByFlowValue, NULL, &ScratchTable));
+}
+
+//
+// Drivers
+//
+
+typedef struct NBL_BENCH_CASE_t
+{
+    char const *Name;
+    BENCH_ROUTINE *Routine;
+} NBL_BENCH_CASE;
+
+static NBL_BENCH_CASE const ClassifyCases[] =
+{
+    { "classify2",          LibraryClassify2 },
+    { "classify2-naive",    NaiveClassify2 },
+    { "byvalue",            ByValue },
+    { "byvalue-lookahead",  ByValueLookahead },
+    { "byvalue-hashed",     ByValueHashed },
+    { "group-byvalue",      GroupByValue },
+};
+
+static void
+RunChainBenchmarks(
+    BENCH_NBL_POOL *Pool)
+{
+    char Name[128];
+
+    for (SIZE_T l = 0; l < ARRAYSIZE(ChainLengths); l++)
+    {
+        NBL_BENCH_CONTEXT Context = { Pool, ChainLengths[l], NULL, 0 };
+
+        snprintf(Name, sizeof(Name), "chain/count/%zu", Context.Length);
+        if (BenchShouldRun(Name))
+        {
+            Context.Chain = BenchLinkNblChain(Pool, 0, Context.Length);
+            BenchReport(Name, BenchMeasure(CountNbls, &Context), Context.Length, 0);
+        }
+
+        snprintf(Name, sizeof(Name), "queue/append-single+pop-all/%zu", Context.Length);
+        if (BenchShouldRun(Name))
+        {
+            BenchReport(Name, BenchMeasure(AppendSingleThenPopAll, &Context), Context.Length, 0);
+        }
+
+        snprintf(Name, sizeof(Name), "headers/batched/%zu", Context.Length);
+        if (BenchShouldRun(Name))
+        {
+            Context.Chain = BenchLinkNblChain(Pool, 0, Context.Length);
+            BenchReport(Name, BenchMeasure(GetHeadersBatched, &Context), Context.Length, 0);
+        }
+
+        snprintf(Name, sizeof(Name), "headers/copy-each/%zu", Context.Length);
+        if (BenchShouldRun(Name))
+        {
+            Context.Chain = BenchLinkNblChain(Pool, 0, Context.Length);
+            BenchReport(Name, BenchMeasure(CopyHeadersOneByOne, &Context), Context.Length, 0);
+        }
+
+        snprintf(Name, sizeof(Name), "queue/pop-first/%zu", Context.Length);
+        if (BenchShouldRun(Name))
+        {
+            double const Relink = BenchMeasure(RelinkOnly, &Context);
+            BenchReport(Name, BenchMeasure(PopFirstUntilEmpty, &Context) - Relink, Context.Length, 0);
+        }
+    }
+}
+
+static void
+RunClassifyBenchmarks(
+    BENCH_NBL_POOL *Pool)
+{
+    char Name[128];
+
+    for (int Pattern = 0; Pattern < BenchFlowMaximum; Pattern++)
+    {
+        BenchAssignFlows(Pool, (BENCH_FLOW_PATTERN)Pattern);
+
+        for (SIZE_T l = 0; l < ARRAYSIZE(ChainLengths); l++)
+        {
+            NBL_BENCH_CONTEXT Context = { Pool, ChainLengths[l], NULL, 0 };
+            double Relink = -1;
+
+            for (SIZE_T c = 0; c < ARRAYSIZE(ClassifyCases); c++)
+            {
+                snprintf(Name, sizeof(Name), "%s/%s/%zu",
+                    ClassifyCases[c].Name, BenchFlowPatternNames[Pattern], Context.Length);
+                if (!BenchShouldRun(Name))
+                {
+                    continue;
+                }
+
+                if (Relink < 0)
+                {
+                    Relink = BenchMeasure(RelinkOnly, &Context);
+                }
+
+                double Elapsed = BenchMeasure(ClassifyCases[c].Routine, &Context) - Relink;
+                if (Elapsed < 0)
+                {
+                    Elapsed = 0;
+                }
+
+                BenchReport(Name, Elapsed, Context.Length, 0);
+            }
+        }
+    }
+}
+
+int
+main(
+    int argc,
+    char **argv)
+{
+    BenchParseArguments(argc, argv);
+
+    BENCH_NBL_POOL *const Pool = BenchCreateNblPool(NBL_BENCH_MAXIMUM_CHAIN_LENGTH, TRUE);
+
+    NdisInitializeNblClassificationHashTable(
+        &ScratchTable, ScratchTableStorage, sizeof(ScratchTableStorage));
+
+    RunChainBenchmarks(Pool);
+    RunClassifyBenchmarks(Pool);
+
+    BenchDestroyNblPool(Pool);
+    return 0;
+}
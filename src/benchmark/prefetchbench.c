@@ -0,0 +1,139 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+//
+// This code is licensed under the MIT License.
+//
+// Measures the effect of NDIS_NBL_PREFETCH_DISTANCE on classifying NBL chains
+// that are not in the cache.
+//
+// NDIS_NBL_PREFETCH_DISTANCE is a compile-time setting, so this file is built
+// once per distance (see CMakeLists.txt); each executable reports the distance
+// it was built with.  Compare the same measurement across executables to pick
+// a distance for your workload.
+//
+// The NBL pool is much larger than the last-level cache and is linked in
+// shuffled order, so every NBL visited is a likely cache miss.  Each
+// iteration classifies the next chain in the pool.  All NBLs belong to the
+// same flow, so the classifier hands each chain back intact and the pool
+// never has to be relinked (relinking would pull the NBLs into the cache).
+//
+
+#ifndef NDIS_NBL_PREFETCH_DISTANCE
+#   define NDIS_NBL_PREFETCH_DISTANCE 1
+#endif
+
+#define NDIS_CLASSIFY_NBL_PREFETCH_FLAGS NDIS_NBL_PREFETCH_NET_BUFFER
+
+#include <ndis.h>
+#include <ndis/ndl/nblchain.h>
+#include <ndis/ndl/nblqueue.h>
+#include <ndis/ndl/nblclassify.h>
+
+#include "bench.h"
+
+// About 256MB of NBLs, NET_BUFFERs, and MDLs
+#define PREFETCH_BENCH_POOL_SIZE (512 * 1024)
+#define PREFETCH_BENCH_QUICK_POOL_SIZE (16 * 1024)
+
+static SIZE_T const ChainLengths[] = { 8, 64, 256, 1024 };
+
+typedef struct PREFETCH_BENCH_CONTEXT_t
+{
+    BENCH_NBL_POOL *Pool;
+    SIZE_T Length;
+    SIZE_T NumberOfChains;
+    SIZE_T NextChain;
+    NDIS_NBL_CLASSIFICATION_VALUE_CALLBACK *Classifier;
+} PREFETCH_BENCH_CONTEXT;
+
+// Touches only the NBL
+static ULONG_PTR
+ClassifyNbl(
+    PVOID ClassificationContext,
+    NET_BUFFER_LIST *Nbl)
+{
+    UNREFERENCED_PARAMETER(ClassificationContext);
+    return BenchGetFlow(Nbl);
+}
+
+// Touches the NBL and its first NET_BUFFER, as a classifier that parses
+// packet lengths or offsets would
+static ULONG_PTR
+ClassifyNblAndNb(
+    PVOID ClassificationContext,
+    NET_BUFFER_LIST *Nbl)
+{
+    UNREFERENCED_PARAMETER(ClassificationContext);
+    return BenchGetFlow(Nbl) + (NET_BUFFER_DATA_LENGTH(NET_BUFFER_LIST_FIRST_NB(Nbl)) == 0);
+}
+
+static void
+DiscardBatch(
+    PVOID FlushContext,
+    ULONG_PTR ClassificationResult,
+    NBL_QUEUE *Queue)
+{
+    UNREFERENCED_PARAMETER(FlushContext);
+    UNREFERENCED_PARAMETER(ClassificationResult);
+    BenchDoNotOptimize(Queue->First);
+}
+
+static void
+ClassifyNextChain(
+    void *ContextArg)
+{
+    PREFETCH_BENCH_CONTEXT *const Context = (PREFETCH_BENCH_CONTEXT *)ContextArg;
+
+    NET_BUFFER_LIST *const Chain = Context->Pool->Order[Context->NextChain * Context->Length];
+
+    Context->NextChain += 1;
+    if (Context->NextChain == Context->NumberOfChains)
+    {
+        Context->NextChain = 0;
+    }
+
+    NdisClassifyNblChainByValue(Chain, Context->Classifier, NULL, DiscardBatch, NULL);
+}
+
+int
+main(
+    int argc,
+    char **argv)
+{
+    char Name[128];
+
+    BenchParseArguments(argc, argv);
+
+    SIZE_T const PoolSize = BenchOptions.Quick ? PREFETCH_BENCH_QUICK_POOL_SIZE : PREFETCH_BENCH_POOL_SIZE;
+    BENCH_NBL_POOL *const Pool = BenchCreateNblPool(PoolSize, TRUE);
+    BenchAssignFlows(Pool, BenchFlowSingle);
+
+    for (SIZE_T l = 0; l < ARRAYSIZE(ChainLengths); l++)
+    {
+        PREFETCH_BENCH_CONTEXT Context = { Pool, ChainLengths[l], PoolSize / ChainLengths[l], 0, NULL };
+
+        for (SIZE_T i = 0; i < Context.NumberOfChains; i++)
+        {
+            BenchLinkNblChain(Pool, i * Context.Length, Context.Length);
+        }
+
+        snprintf(Name, sizeof(Name), "prefetch-d%u/classify-nbl/%zu",
+            (unsigned)NDIS_NBL_PREFETCH_DISTANCE, Context.Length);
+        if (BenchShouldRun(Name))
+        {
+            Context.Classifier = ClassifyNbl;
+            BenchReport(Name, BenchMeasure(ClassifyNextChain, &Context), Context.Length, 0);
+        }
+
+        snprintf(Name, sizeof(Name), "prefetch-d%u/classify-nbl+nb/%zu",
+            (unsigned)NDIS_NBL_PREFETCH_DISTANCE, Context.Length);
+        if (BenchShouldRun(Name))
+        {
+            Context.Classifier = ClassifyNblAndNb;
+            BenchReport(Name, BenchMeasure(ClassifyNextChain, &Context), Context.Length, 0);
+        }
+    }
+
+    BenchDestroyNblPool(Pool);
+    return 0;
+}
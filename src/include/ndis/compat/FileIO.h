@@ -27,12 +27,37 @@ Abstract:
     NDIS.h will also not provide the legacy function definitions to avoid
     name conflict.
 
+    NdisCompatOpenFile copies the whole file into nonpaged pool, which stays
+    allocated until the file is closed. Two extensions reduce that cost:
+
+    NdisCompatOpenFileEx accepts an NDIS_COMPAT_FILE_STORAGE, so the file
+    image can be kept in paged pool or in a read-only section view instead.
+    Either way, the mapped buffer may only be accessed at PASSIVE_LEVEL.
+
+    NdisCompatReadFileInChunks never holds the whole file in memory. It reads
+    the file sequentially into a buffer that you provide and reuse, and calls
+    you back with each chunk. It also has no 4GB limit on the file size.
+
+    If your driver opens the same file from several handles (for example,
+    once per adapter), call NdisCompatInitializeFileCache in DriverEntry.
+    From then on, every handle opened with the same file name and storage
+    shares one reference-counted image, which is read from disk once and
+    freed when the last handle is closed. Because the image is shared, you
+    must not modify the buffer from NdisCompatMapFile while the cache is
+    enabled. Close every handle before you call
+    NdisCompatUninitializeFileCache; if any cached file is still open, that
+    routine crashes the system.
+
 Table of Contents:
 
         NdisCompatOpenFile
+        NdisCompatOpenFileEx
         NdisCompatCloseFile
         NdisCompatMapFile
         NdisCompatUnmapFile
+        NdisCompatReadFileInChunks
+        NdisCompatInitializeFileCache
+        NdisCompatUninitializeFileCache
 
 Environment:
 
@@ -65,10 +90,85 @@ Environment:
 #define NDIS_COMPAT_TAG_FILE_DESCRIPTOR 'dfDN'
 #endif
 
+#ifndef NDIS_COMPAT_TAG_FILE_CACHE
+#define NDIS_COMPAT_TAG_FILE_CACHE 'cfDN'
+#endif
+
+//
+// You may replace NDIS_COMPAT_REPORT_FATAL_ERROR if you need to terminate the
+// system in a different manner than a simple __fastfail instruction. Note that
+// you MUST NOT allow execution to continue once a fatal error has been
+// reported.
+//
+#ifndef NDIS_COMPAT_REPORT_FATAL_ERROR
+#  define NDIS_COMPAT_REPORT_FATAL_ERROR() \
+        RtlFailFast(FAST_FAIL_INVALID_ARG)
+#endif
+
+typedef enum NDIS_COMPAT_FILE_STORAGE
+{
+    // The file image is in nonpaged pool; this is what NdisCompatOpenFile uses
+    NdisCompatFileStorageNonPaged = 0,
+
+    // The file image is in paged pool
+    NdisCompatFileStoragePaged = 1,
+
+    // The file image is a read-only view of the file, paged in on demand
+    NdisCompatFileStorageSectionView = 2,
+} NDIS_COMPAT_FILE_STORAGE;
+
+typedef
+_IRQL_requires_(PASSIVE_LEVEL)
+_Function_class_(NDIS_COMPAT_FILE_CHUNK_CALLBACK)
+NDIS_STATUS
+NDIS_COMPAT_FILE_CHUNK_CALLBACK(
+    _In_opt_ void *Context,
+    _In_ ULONG64 FileOffset,
+    _In_reads_bytes_(ChunkLength) void const *Chunk,
+    _In_ ULONG ChunkLength);
+
+struct NDIS_COMPAT_FILE_CACHE_ENTRY
+{
+    // Links the entry into NdisCompatFileCache.Entries, while InCache is TRUE
+    LIST_ENTRY Link;
+
+    // Protected by NdisCompatFileCache.Lock
+    ULONG ReferenceCount;
+    BOOLEAN InCache;
+
+    // NDIS_STATUS_PENDING until LoadedEvent is set
+    NDIS_STATUS Status;
+    KEVENT LoadedEvent;
+
+    void *Data;
+    UINT Length;
+    NDIS_COMPAT_FILE_STORAGE Storage;
+    void *Section;
+
+    // The buffer immediately follows this structure
+    UNICODE_STRING FileName;
+};
+
+struct NDIS_COMPAT_FILE_CACHE
+{
+    EX_PUSH_LOCK Lock;
+    LIST_ENTRY Entries;
+    BOOLEAN Enabled;
+};
+
+DECLSPEC_SELECTANY struct NDIS_COMPAT_FILE_CACHE NdisCompatFileCache;
+
 struct NDIS_COMPAT_FILE_DESCRIPTOR
 {
     void *Data;
     BOOLEAN Mapped;
+    NDIS_COMPAT_FILE_STORAGE Storage;
+
+    // NdisCompatFileStorageSectionView only: the referenced section object
+    void *Section;
+
+    // Non-NULL if the image is shared through the file cache
+    struct NDIS_COMPAT_FILE_CACHE_ENTRY *CacheEntry;
 };
 
 _IRQL_requires_(PASSIVE_LEVEL)
@@ -168,13 +268,11 @@ NdisCompatCreateFile(
 _IRQL_requires_(PASSIVE_LEVEL)
 inline
 NDIS_STATUS
-NdisCompatReadFile(
+NdisCompatQueryFileLength(
     _In_ HANDLE NtFileHandle,
-    _Out_ void **FileImage,
-    _Out_ UINT *FileLength
+    _Out_ ULONG *FileLength
 )
 {
-    *FileImage = NULL;
     *FileLength = 0;
 
     //
@@ -211,12 +309,41 @@ NdisCompatReadFile(
         return NDIS_STATUS_ERROR_READING_FILE;
     }
 
+    *FileLength = lengthOfFile;
+
+    return NDIS_STATUS_SUCCESS;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NDIS_STATUS
+NdisCompatReadFile(
+    _In_ HANDLE NtFileHandle,
+    _In_ POOL_FLAGS PoolFlags,
+    _Out_ void **FileImage,
+    _Out_ UINT *FileLength
+)
+{
+    *FileImage = NULL;
+    *FileLength = 0;
+
+    ULONG lengthOfFile = 0;
+
+    NDIS_STATUS status = NdisCompatQueryFileLength(
+        NtFileHandle,
+        &lengthOfFile);
+
+    if (NDIS_STATUS_SUCCESS != status)
+    {
+        return status;
+    }
+
     //
     // Allocate buffer for this file
     //
 
     void *fileImage = ExAllocatePool2(
-        POOL_FLAG_NON_PAGED | POOL_FLAG_UNINITIALIZED,
+        PoolFlags | POOL_FLAG_UNINITIALIZED,
         lengthOfFile,
         NDIS_COMPAT_TAG_FILE_IMAGE);
 
@@ -229,7 +356,9 @@ NdisCompatReadFile(
     // Read the file into our buffer.
     //
 
-    ntStatus = ZwReadFile(
+    IO_STATUS_BLOCK ioStatus = { 0 };
+
+    NTSTATUS ntStatus = ZwReadFile(
         NtFileHandle,
         NULL,
         NULL,
@@ -255,13 +384,133 @@ NdisCompatReadFile(
 _IRQL_requires_(PASSIVE_LEVEL)
 inline
 NDIS_STATUS
-NdisCompatOpenFileInner(
-    _Out_ NDIS_HANDLE *FileHandle,
-    _Out_ UINT *FileLength,
-    _In_ UNICODE_STRING const *FileName
+NdisCompatMapFileSection(
+    _In_ HANDLE NtFileHandle,
+    _Out_ void **Section,
+    _Out_ void **FileImage,
+    _Out_ UINT *FileLength
 )
 {
-    *FileHandle = NULL;
+    *Section = NULL;
+    *FileImage = NULL;
+    *FileLength = 0;
+
+    ULONG lengthOfFile = 0;
+
+    NDIS_STATUS status = NdisCompatQueryFileLength(
+        NtFileHandle,
+        &lengthOfFile);
+
+    if (NDIS_STATUS_SUCCESS != status)
+    {
+        return status;
+    }
+
+    OBJECT_ATTRIBUTES objectAttributes = { 0 };
+
+    InitializeObjectAttributes(
+        &objectAttributes,
+        NULL,
+        OBJ_KERNEL_HANDLE,
+        NULL,
+        NULL);
+
+    HANDLE sectionHandle = NULL;
+
+    NTSTATUS ntStatus = ZwCreateSection(
+        &sectionHandle,
+        SECTION_MAP_READ,
+        &objectAttributes,
+        NULL,
+        PAGE_READONLY,
+        SEC_COMMIT,
+        NtFileHandle);
+
+    if (STATUS_SUCCESS != ntStatus)
+    {
+        return NDIS_STATUS_ERROR_READING_FILE;
+    }
+
+    //
+    // Keep a reference to the section object itself, so the handle can be
+    // closed now.
+    //
+    void *section = NULL;
+
+    ntStatus = ObReferenceObjectByHandle(
+        sectionHandle,
+        SECTION_MAP_READ,
+        NULL,
+        KernelMode,
+        &section,
+        NULL);
+
+    ZwClose(sectionHandle);
+
+    if (STATUS_SUCCESS != ntStatus)
+    {
+        return NDIS_STATUS_ERROR_READING_FILE;
+    }
+
+    void *view = NULL;
+    SIZE_T viewSize = 0;
+
+    ntStatus = MmMapViewInSystemSpace(
+        section,
+        &view,
+        &viewSize);
+
+    if (STATUS_SUCCESS != ntStatus || viewSize < lengthOfFile)
+    {
+        if (STATUS_SUCCESS == ntStatus)
+        {
+            MmUnmapViewInSystemSpace(view);
+        }
+
+        ObDereferenceObject(section);
+        return NDIS_STATUS_ERROR_READING_FILE;
+    }
+
+    *Section = section;
+    *FileImage = view;
+    *FileLength = lengthOfFile;
+
+    return NDIS_STATUS_SUCCESS;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+void
+NdisCompatFreeFileImage(
+    _In_ NDIS_COMPAT_FILE_STORAGE Storage,
+    _In_ void *FileImage,
+    _In_opt_ void *Section
+)
+{
+    if (Storage == NdisCompatFileStorageSectionView)
+    {
+        MmUnmapViewInSystemSpace(FileImage);
+        ObDereferenceObject(Section);
+    }
+    else
+    {
+        ExFreePool(FileImage);
+    }
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NDIS_STATUS
+NdisCompatLoadFileImage(
+    _In_ UNICODE_STRING const *FileName,
+    _In_ NDIS_COMPAT_FILE_STORAGE Storage,
+    _Out_ void **FileImage,
+    _Out_ void **Section,
+    _Out_ UINT *FileLength
+)
+{
+    *FileImage = NULL;
+    *Section = NULL;
     *FileLength = 0;
 
     HANDLE ntFileHandle = { 0 };
@@ -275,21 +524,249 @@ NdisCompatOpenFileInner(
         return status;
     }
 
-    void *fileImage = NULL;
-    UINT fileLength = 0;
-
-    status = NdisCompatReadFile(
-        ntFileHandle,
-        &fileImage,
-        &fileLength);
+    switch (Storage)
+    {
+    case NdisCompatFileStorageNonPaged:
+        status = NdisCompatReadFile(
+            ntFileHandle,
+            POOL_FLAG_NON_PAGED,
+            FileImage,
+            FileLength);
+        break;
+
+    case NdisCompatFileStoragePaged:
+        status = NdisCompatReadFile(
+            ntFileHandle,
+            POOL_FLAG_PAGED,
+            FileImage,
+            FileLength);
+        break;
+
+    case NdisCompatFileStorageSectionView:
+        status = NdisCompatMapFileSection(
+            ntFileHandle,
+            Section,
+            FileImage,
+            FileLength);
+        break;
+
+    default:
+        status = NDIS_STATUS_INVALID_PARAMETER;
+        break;
+    }
 
     ZwClose(ntFileHandle);
 
+    return status;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+void
+NdisCompatDereferenceCachedFile(
+    _In_ struct NDIS_COMPAT_FILE_CACHE_ENTRY *CacheEntry
+)
+{
+    BOOLEAN lastReference = FALSE;
+
+    KeEnterCriticalRegion();
+    ExAcquirePushLockExclusive(&NdisCompatFileCache.Lock);
+
+    CacheEntry->ReferenceCount -= 1;
+
+    if (CacheEntry->ReferenceCount == 0)
+    {
+        lastReference = TRUE;
+
+        if (CacheEntry->InCache)
+        {
+            RemoveEntryList(&CacheEntry->Link);
+            CacheEntry->InCache = FALSE;
+        }
+    }
+
+    ExReleasePushLockExclusive(&NdisCompatFileCache.Lock);
+    KeLeaveCriticalRegion();
+
+    if (lastReference)
+    {
+        if (CacheEntry->Status == NDIS_STATUS_SUCCESS)
+        {
+            NdisCompatFreeFileImage(
+                CacheEntry->Storage,
+                CacheEntry->Data,
+                CacheEntry->Section);
+        }
+
+        ExFreePool(CacheEntry);
+    }
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+struct NDIS_COMPAT_FILE_CACHE_ENTRY *
+NdisCompatFindCachedFile(
+    _In_ UNICODE_STRING const *FileName,
+    _In_ NDIS_COMPAT_FILE_STORAGE Storage
+)
+{
+    for (LIST_ENTRY *link = NdisCompatFileCache.Entries.Flink;
+        link != &NdisCompatFileCache.Entries;
+        link = link->Flink)
+    {
+        struct NDIS_COMPAT_FILE_CACHE_ENTRY *cacheEntry = CONTAINING_RECORD(
+            link, struct NDIS_COMPAT_FILE_CACHE_ENTRY, Link);
+
+        if (cacheEntry->Storage == Storage &&
+            RtlEqualUnicodeString(&cacheEntry->FileName, FileName, TRUE))
+        {
+            return cacheEntry;
+        }
+    }
+
+    return NULL;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NDIS_STATUS
+NdisCompatReferenceCachedFile(
+    _In_ UNICODE_STRING const *FileName,
+    _In_ NDIS_COMPAT_FILE_STORAGE Storage,
+    _Out_ struct NDIS_COMPAT_FILE_CACHE_ENTRY **CacheEntry
+)
+{
+    *CacheEntry = NULL;
+
+    //
+    // Allocate a new entry up front, because we can't allocate while
+    // holding the lock. It's freed again if the file is already cached.
+    //
+    SIZE_T entrySize = 0;
+
+    NTSTATUS ntStatus = RtlSIZETAdd(
+        sizeof(struct NDIS_COMPAT_FILE_CACHE_ENTRY),
+        FileName->Length,
+        &entrySize);
+
+    if (STATUS_SUCCESS != ntStatus)
+    {
+        return NDIS_STATUS_BUFFER_OVERFLOW;
+    }
+
+    struct NDIS_COMPAT_FILE_CACHE_ENTRY *newEntry = (struct NDIS_COMPAT_FILE_CACHE_ENTRY *)ExAllocatePool2(
+        POOL_FLAG_NON_PAGED,
+        entrySize,
+        NDIS_COMPAT_TAG_FILE_CACHE);
+
+    if (newEntry == NULL)
+    {
+        return NDIS_STATUS_RESOURCES;
+    }
+
+    newEntry->FileName.Buffer = (WCHAR *)(newEntry + 1);
+    newEntry->FileName.Length = FileName->Length;
+    newEntry->FileName.MaximumLength = FileName->Length;
+    RtlCopyMemory(newEntry->FileName.Buffer, FileName->Buffer, FileName->Length);
+
+    newEntry->Storage = Storage;
+    newEntry->Status = NDIS_STATUS_PENDING;
+    newEntry->ReferenceCount = 1;
+    newEntry->InCache = TRUE;
+    KeInitializeEvent(&newEntry->LoadedEvent, NotificationEvent, FALSE);
+
+    KeEnterCriticalRegion();
+    ExAcquirePushLockExclusive(&NdisCompatFileCache.Lock);
+
+    struct NDIS_COMPAT_FILE_CACHE_ENTRY *cacheEntry = NdisCompatFindCachedFile(
+        FileName,
+        Storage);
+
+    if (cacheEntry != NULL)
+    {
+        cacheEntry->ReferenceCount += 1;
+    }
+    else
+    {
+        InsertTailList(&NdisCompatFileCache.Entries, &newEntry->Link);
+    }
+
+    ExReleasePushLockExclusive(&NdisCompatFileCache.Lock);
+    KeLeaveCriticalRegion();
+
+    if (cacheEntry != NULL)
+    {
+        ExFreePool(newEntry);
+
+        //
+        // Another handle is already loading the file; wait for it to finish.
+        //
+        KeWaitForSingleObject(
+            &cacheEntry->LoadedEvent,
+            Executive,
+            KernelMode,
+            FALSE,
+            NULL);
+
+        if (cacheEntry->Status != NDIS_STATUS_SUCCESS)
+        {
+            NDIS_STATUS status = cacheEntry->Status;
+            NdisCompatDereferenceCachedFile(cacheEntry);
+            return status;
+        }
+
+        *CacheEntry = cacheEntry;
+        return NDIS_STATUS_SUCCESS;
+    }
+
+    NDIS_STATUS status = NdisCompatLoadFileImage(
+        FileName,
+        Storage,
+        &newEntry->Data,
+        &newEntry->Section,
+        &newEntry->Length);
+
+    if (NDIS_STATUS_SUCCESS != status)
+    {
+        //
+        // Take the entry out of the cache, so the next open tries again.
+        //
+        KeEnterCriticalRegion();
+        ExAcquirePushLockExclusive(&NdisCompatFileCache.Lock);
+
+        RemoveEntryList(&newEntry->Link);
+        newEntry->InCache = FALSE;
+
+        ExReleasePushLockExclusive(&NdisCompatFileCache.Lock);
+        KeLeaveCriticalRegion();
+    }
+
+    newEntry->Status = status;
+    KeSetEvent(&newEntry->LoadedEvent, IO_NO_INCREMENT, FALSE);
+
     if (NDIS_STATUS_SUCCESS != status)
     {
+        NdisCompatDereferenceCachedFile(newEntry);
         return status;
     }
 
+    *CacheEntry = newEntry;
+    return NDIS_STATUS_SUCCESS;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NDIS_STATUS
+NdisCompatOpenFileInner(
+    _Out_ NDIS_HANDLE *FileHandle,
+    _Out_ UINT *FileLength,
+    _In_ UNICODE_STRING const *FileName,
+    _In_ NDIS_COMPAT_FILE_STORAGE Storage
+)
+{
+    *FileHandle = NULL;
+    *FileLength = 0;
+
     //
     // Allocate a structure to describe the file.
     //
@@ -300,12 +777,49 @@ NdisCompatOpenFileInner(
 
     if (fileDescriptor == NULL)
     {
-        ExFreePool(fileImage);
         return NDIS_STATUS_RESOURCES;
     }
 
-    fileDescriptor->Data = fileImage;
+    NDIS_STATUS status;
+    UINT fileLength = 0;
+
+    if (NdisCompatFileCache.Enabled)
+    {
+        struct NDIS_COMPAT_FILE_CACHE_ENTRY *cacheEntry = NULL;
+
+        status = NdisCompatReferenceCachedFile(
+            FileName,
+            Storage,
+            &cacheEntry);
+
+        if (NDIS_STATUS_SUCCESS == status)
+        {
+            fileDescriptor->Data = cacheEntry->Data;
+            fileDescriptor->Section = NULL;
+            fileDescriptor->CacheEntry = cacheEntry;
+            fileLength = cacheEntry->Length;
+        }
+    }
+    else
+    {
+        status = NdisCompatLoadFileImage(
+            FileName,
+            Storage,
+            &fileDescriptor->Data,
+            &fileDescriptor->Section,
+            &fileLength);
+
+        fileDescriptor->CacheEntry = NULL;
+    }
+
+    if (NDIS_STATUS_SUCCESS != status)
+    {
+        ExFreePool(fileDescriptor);
+        return status;
+    }
+
     fileDescriptor->Mapped = FALSE;
+    fileDescriptor->Storage = Storage;
 
     *FileHandle = (NDIS_HANDLE)fileDescriptor;
     *FileLength = fileLength;
@@ -329,7 +843,26 @@ NdisCompatOpenFile(
     *Status = NdisCompatOpenFileInner(
         FileHandle,
         FileLength,
-        FileName);
+        FileName,
+        NdisCompatFileStorageNonPaged);
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+void
+NdisCompatOpenFileEx(
+    _Out_ NDIS_STATUS *Status,
+    _Out_ NDIS_HANDLE *FileHandle,
+    _Out_ UINT *FileLength,
+    _In_ UNICODE_STRING const *FileName,
+    _In_ NDIS_COMPAT_FILE_STORAGE Storage
+)
+{
+    *Status = NdisCompatOpenFileInner(
+        FileHandle,
+        FileLength,
+        FileName,
+        Storage);
 }
 
 _IRQL_requires_(PASSIVE_LEVEL)
@@ -341,7 +874,18 @@ NdisCompatCloseFile(
 {
     struct NDIS_COMPAT_FILE_DESCRIPTOR *fileDescriptor = (struct NDIS_COMPAT_FILE_DESCRIPTOR *)FileHandle;
 
-    ExFreePool(fileDescriptor->Data);
+    if (fileDescriptor->CacheEntry != NULL)
+    {
+        NdisCompatDereferenceCachedFile(fileDescriptor->CacheEntry);
+    }
+    else
+    {
+        NdisCompatFreeFileImage(
+            fileDescriptor->Storage,
+            fileDescriptor->Data,
+            fileDescriptor->Section);
+    }
+
     fileDescriptor->Data = NULL;
 
     ExFreePool(fileDescriptor);
@@ -385,14 +929,150 @@ NdisCompatUnmapFile(
     fileDescriptor->Mapped = FALSE;
 }
 
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+void
+NdisCompatInitializeFileCache(
+    void
+)
+{
+    ExInitializePushLock(&NdisCompatFileCache.Lock);
+    InitializeListHead(&NdisCompatFileCache.Entries);
+    NdisCompatFileCache.Enabled = TRUE;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+void
+NdisCompatUninitializeFileCache(
+    void
+)
+{
+    //
+    // Every cached file must have been closed already.  The handles that are
+    // still open point into their cache entries, so neither freeing the
+    // entries nor leaking them is safe.
+    //
+    if (!IsListEmpty(&NdisCompatFileCache.Entries))
+    {
+        NDIS_COMPAT_REPORT_FATAL_ERROR();
+    }
+
+    NdisCompatFileCache.Enabled = FALSE;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NDIS_STATUS
+NdisCompatReadFileInChunks(
+    _In_ UNICODE_STRING const *FileName,
+    _Out_writes_bytes_(ChunkBufferLength) void *ChunkBuffer,
+    _In_ ULONG ChunkBufferLength,
+    _In_ NDIS_COMPAT_FILE_CHUNK_CALLBACK *ChunkCallback,
+    _In_opt_ void *Context
+)
+{
+    if (ChunkBufferLength < 1)
+    {
+        return NDIS_STATUS_INVALID_LENGTH;
+    }
+
+    HANDLE ntFileHandle = { 0 };
+
+    NDIS_STATUS status = NdisCompatCreateFile(
+        FileName,
+        &ntFileHandle);
+
+    if (NDIS_STATUS_SUCCESS != status)
+    {
+        return status;
+    }
+
+    LARGE_INTEGER fileOffset = { 0 };
+
+    for (;;)
+    {
+        IO_STATUS_BLOCK ioStatus = { 0 };
+
+        NTSTATUS ntStatus = ZwReadFile(
+            ntFileHandle,
+            NULL,
+            NULL,
+            NULL,
+            &ioStatus,
+            ChunkBuffer,
+            ChunkBufferLength,
+            &fileOffset,
+            NULL);
+
+        if (STATUS_END_OF_FILE == ntStatus)
+        {
+            status = NDIS_STATUS_SUCCESS;
+            break;
+        }
+
+        if (STATUS_SUCCESS != ntStatus || ioStatus.Information > ChunkBufferLength)
+        {
+            status = NDIS_STATUS_ERROR_READING_FILE;
+            break;
+        }
+
+        if (ioStatus.Information == 0)
+        {
+            status = NDIS_STATUS_SUCCESS;
+            break;
+        }
+
+        //
+        // Any status other than success from the callback stops the read.
+        //
+        status = ChunkCallback(
+            Context,
+            (ULONG64)fileOffset.QuadPart,
+            ChunkBuffer,
+            (ULONG)ioStatus.Information);
+
+        if (NDIS_STATUS_SUCCESS != status)
+        {
+            break;
+        }
+
+        fileOffset.QuadPart += ioStatus.Information;
+    }
+
+    ZwClose(ntFileHandle);
+
+    return status;
+}
+
 #if defined(NDIS_COMPAT_REPLACE_LEGACY_ROUTINES) && NDIS_COMPAT_REPLACE_LEGACY_ROUTINES == 1
 #define NdisCompatCreateFile DoNotUseDirectly_InsteadUse_NdisOpenFile
 #define NdisCompatReadFile DoNotUseDirectly_InsteadUse_NdisOpenFile
 #define NdisCompatOpenFileInner DoNotUseDirectly_InsteadUse_NdisOpenFile
+#define NdisCompatQueryFileLength DoNotUseDirectly_InsteadUse_NdisOpenFile
+#define NdisCompatMapFileSection DoNotUseDirectly_InsteadUse_NdisOpenFile
+#define NdisCompatFreeFileImage DoNotUseDirectly_InsteadUse_NdisOpenFile
+#define NdisCompatLoadFileImage DoNotUseDirectly_InsteadUse_NdisOpenFile
+#define NdisCompatDereferenceCachedFile DoNotUseDirectly_InsteadUse_NdisOpenFile
+#define NdisCompatFindCachedFile DoNotUseDirectly_InsteadUse_NdisOpenFile
+#define NdisCompatReferenceCachedFile DoNotUseDirectly_InsteadUse_NdisOpenFile
+#define NdisCompatFileCache DoNotUseDirectly_InsteadUse_NdisOpenFile
+#define NDIS_COMPAT_FILE_CACHE_ENTRY DoNotUseDirectly_InsteadUse_NdisOpenFile
+#define NDIS_COMPAT_FILE_CACHE DoNotUseDirectly_InsteadUse_NdisOpenFile
 #define NDIS_COMPAT_FILE_DESCRIPTOR DoNotUseDirectly_InsteadUse_NdisOpenFile
 #else
 #define NdisCompatCreateFile DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
 #define NdisCompatReadFile DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
 #define NdisCompatOpenFileInner DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
+#define NdisCompatQueryFileLength DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
+#define NdisCompatMapFileSection DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
+#define NdisCompatFreeFileImage DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
+#define NdisCompatLoadFileImage DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
+#define NdisCompatDereferenceCachedFile DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
+#define NdisCompatFindCachedFile DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
+#define NdisCompatReferenceCachedFile DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
+#define NdisCompatFileCache DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
+#define NDIS_COMPAT_FILE_CACHE_ENTRY DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
+#define NDIS_COMPAT_FILE_CACHE DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
 #define NDIS_COMPAT_FILE_DESCRIPTOR DoNotUseDirectly_InsteadUse_NdisCompatOpenFile
 #endif
@@ -0,0 +1,144 @@
+/*++
+
+    Copyright (c) Microsoft. All rights reserved.
+
+    This code is licensed under the MIT License.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+
+Module Name:
+
+    chainiterator.h
+
+Provenance:
+
+    Version 1.2.0 from https://github.com/microsoft/ndis-driver-library
+
+Abstract:
+
+    A C++ forward iterator over any NULL-terminated singly-linked list whose
+    nodes have a Next field, such as an NBL chain, an NB chain, or an MDL
+    chain
+
+    You don't need to include this header yourself.  The ranges built on it
+    are ndis::nbl_chain and ndis::nb_chain in nblchain.h, and ndis::mdl_chain
+    in mdl.h.  This header has no dependency on NDIS.H, so mdl.h can use it
+    without dragging in any network-specific definitions.
+
+Environment:
+
+    Kernel mode
+
+--*/
+
+#pragma once
+
+#pragma region System Family (kernel drivers) with Desktop Family for compat
+#include <winapifamily.h>
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+
+#ifdef __cplusplus
+
+namespace ndis
+{
+
+namespace details
+{
+
+inline void prefetch_cacheline(_In_opt_ void const *address)
+{
+    PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, address);
+}
+
+//
+// A forward iterator over a NULL-terminated chain of NBLs, NBs, or MDLs.
+// Don't use this directly; use ndis::nbl_chain and friends instead.
+//
+// The iterator prefetches node->Next as soon as it arrives at a node, so the
+// next cache miss overlaps with the work the loop body does on the current
+// node.  If Safe is true, the iterator also reads node->Next before it yields
+// the node, so the loop body may unlink the node or append it to another
+// chain.
+//
+// By default, the iterator has no iterator_category, since kernel-mode C++
+// usually has no <iterator>.  To use the iterators with the standard
+// algorithms, define NDIS_ITERATOR_CATEGORY before including this header:
+//
+//      #include <iterator>
+//      #define NDIS_ITERATOR_CATEGORY std::forward_iterator_tag
+//
+template <typename Node, bool Safe, void (*Prefetch)(void const *)>
+class chain_iterator
+{
+public:
+#ifdef NDIS_ITERATOR_CATEGORY
+    using iterator_category = NDIS_ITERATOR_CATEGORY;
+#endif
+    using difference_type = LONG_PTR;
+    using value_type = Node *;
+    using pointer = Node *const *;
+    using reference = Node *;
+
+    chain_iterator() = default;
+    explicit chain_iterator(_In_opt_ Node *first) : current{first} { arrive(); }
+
+    Node *operator*() const { return current; }
+
+    chain_iterator &operator++()
+    {
+        current = Safe ? next : current->Next;
+        arrive();
+        return *this;
+    }
+
+    chain_iterator operator++(int)
+    {
+        chain_iterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    bool operator==(chain_iterator const &rhs) const { return current == rhs.current; }
+    bool operator!=(chain_iterator const &rhs) const { return current != rhs.current; }
+
+private:
+    void arrive()
+    {
+        if (current)
+        {
+            Node *const following = current->Next;
+            next = Safe ? following : nullptr;
+            Prefetch(following);
+        }
+    }
+
+    Node *current = nullptr;
+    Node *next = nullptr;
+};
+
+template <typename Node, bool Safe, void (*Prefetch)(void const *) = prefetch_cacheline>
+class chain_range
+{
+public:
+    using iterator = chain_iterator<Node, Safe, Prefetch>;
+
+    explicit chain_range(_In_opt_ Node *chain) : first{chain} {}
+
+    iterator begin() const { return iterator{first}; }
+    iterator end() const { return iterator{}; }
+    bool empty() const { return first == nullptr; }
+
+private:
+    Node *first;
+};
+
+} // namespace details
+
+} // namespace ndis
+
+#endif // __cplusplus
+
+#endif // WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+#pragma endregion
@@ -14,7 +14,7 @@ Module Name:
 
 Provenance:
 
-    Version 1.1.0 from https://github.com/microsoft/ndis-driver-library
+    Version 1.2.0 from https://github.com/microsoft/ndis-driver-library
 
 Abstract:
 
@@ -66,6 +66,16 @@ Data structures:
         of the MDL chain's buffers. That is, an MDL span is a tuple of
         <MdlChain, Offset, Length>.
 
+    MDL_MAPPED_SPAN
+        A mapped span is an MDL span that has been mapped into system address
+        space and flattened into an array of <VirtualAddress, Length>
+        fragments. See the topic "Mapped spans".
+
+    MDL_CURSOR
+        An MDL cursor reads through an MDL span from front to back, remembering
+        its position and the current MDL's mapping between reads. See the topic
+        "Cursors".
+
 Inputs:
 
     While this module offers MDL_POINTER and MDL_SPAN to save you some typing,
@@ -96,6 +106,11 @@ Operations:
     MdlChainEnsureMappedSystemAddress
         Map each MDL in the chain into system virtual address space.
 
+    MdlChainMapFragments
+    MdlSpanMapFragments
+        Map each MDL into system virtual address space, and describe the
+        mapped buffers as an MDL_MAPPED_SPAN.
+
     MdlChainGetInformation
     MdlChainGetMdlCount
     MdlChainGetByteCount
@@ -114,6 +129,10 @@ Operations:
     MdlPointerNormalize
         Updates an MDL pointer to normal form. See the topic "Normalization".
 
+    MdlInitializeNonTemporalThreshold
+        Sizes the threshold used by the -Auto variants from the processor's
+        last-level cache. See the topic "Temporal and non-temporal".
+
     MdlChainZeroBuffers
     MdlSpanZeroBuffers
     MdlChainZeroBuffersAtOffset
@@ -126,6 +145,13 @@ Operations:
         Fills the buffer(s) associated with the MDL chain with a specific byte.
         Conceptually: RtlFillMemory(Mdl, FillPattern).
 
+    MdlChainFillBuffersWithPattern
+    MdlSpanFillBuffersWithPattern
+    MdlChainFillBuffersAtOffsetWithPattern
+        Fills the buffer(s) associated with the MDL chain with a repeating 1-,
+        2-, 4-, 8-, or 16-byte pattern, keeping the pattern's phase across MDL
+        boundaries.
+
     MdlCopyFlatBufferToMdlSpan
     MdlCopyFlatBufferToMdlChainAtOffset
         Copies data from a single buffer into some subset of an MDL chain.
@@ -141,11 +167,53 @@ Operations:
         Copies data from some subset of an MDL chain to a subset of another MDL
         chain. Conceptually: RtlCopyMemory(Mdl1, Mdl2).
 
+    MdlCopyMdlSpansToMdlPointers
+        Executes a batch of copies from MDL spans into MDL chains in one call,
+        picking temporal or non-temporal copies for each entry by its size, as
+        the -Auto variants do.
+
+    MdlCopyMdlPointerToMdlPointerWithPrefetch
+    MdlCopyMdlChainToMdlChainAtOffsetWithPrefetch
+        Copies data from some subset of an MDL chain to a subset of another MDL
+        chain, prefetching the source ahead of the copy. See the topic "NUMA".
+
+    MdlCopyMdlPointerToMdlPointerOnNode
+        Copies data between MDL chains on processors of the NUMA node that
+        holds the destination, splitting a large copy into chunks that run in
+        parallel. See the topic "NUMA".
+
     MdlEqualBufferContents
     MdlEqualBufferContentsAtOffset
         Determines whether the data in subsets of 2 MDL chains is equal.
         Conceptually: RtlEqualMemory(Mdl1, Mdl2).
 
+    MdlCompareBufferContents
+    MdlSpanCompareBufferContents
+    MdlCompareBufferContentsAtOffset
+        Finds the offset of the first byte that differs between subsets of 2
+        MDL chains. Conceptually: RtlCompareMemory(Mdl1, Mdl2).
+
+    MdlSpanComputeInternetChecksum
+    MdlChainComputeInternetChecksumAtOffset
+    MdlSpanComputeCrc32c
+    MdlChainComputeCrc32cAtOffset
+        Computes the RFC 1071 Internet checksum or the CRC32C (Castagnoli) of
+        some subset of an MDL chain, without copying it to a flat buffer.
+
+    MdlCopyMdlSpanToFlatBufferWithInternetChecksum
+    MdlCopyFlatBufferToMdlSpanWithInternetChecksum
+    MdlCopyMdlSpanToFlatBufferWithCrc32c
+    MdlCopyFlatBufferToMdlSpanWithCrc32c
+        Copies data between an MDL span and a single buffer, and computes a
+        checksum of the data in the same pass.
+
+    MdlSpanBuildPartialMdlChain
+    MdlSpanSplitIntoChains
+    MdlFreePartialMdlChain
+        Builds new MDL chains that describe the same memory as some subset of
+        an existing MDL chain, using IoBuildPartialMdl, without copying any
+        payload. Useful to segment a large send or to mirror a packet.
+
 Variants:
 
     This module offers a number of variations on each routine. The variations
@@ -161,6 +229,12 @@ Variants:
         to avoid polluting the cache with data that won't be accessed soon
         again. Compare with RtlCopyMemoryNonTemporal.
 
+    -Auto
+        The routine behaves like the -NonTemporal variant if the total length
+        of the operation is large enough to displace a good part of the cache,
+        and like the regular variant otherwise. See the topic "Temporal and
+        non-temporal".
+
     -Secure
         The routine suppresses compiler optimizations to ensure that writes to
         memory are definitely not optimized away for any reason. Compare with
@@ -173,6 +247,67 @@ Variants:
         access an MDL chain in fixed-length batches. For example, you may want
         to copy the payload of an MDL chain in chunks no larger than 64kb.)
 
+Mapped spans:
+
+    Each routine in this module maps each MDL that it touches, and walks the
+    MDL chain to find the bytes it needs. If you run several operations over
+    the same bytes (say, compare them, then checksum them, then copy them), you
+    can do the mapping and the walk once, up front:
+
+        MDL_MAPPED_FRAGMENT Fragments[8];
+        MDL_MAPPED_SPAN Mapped;
+        NtStatus = MdlSpanMapFragments(&Span, Fragments, 8, &Mapped);
+
+    Afterwards, Mapped.Fragments is a plain array of virtual addresses and
+    lengths. Buffers that happen to be adjacent in virtual memory are merged
+    into a single fragment. These routines operate on a mapped span directly:
+
+        MdlCopyFlatBufferToMdlMappedSpan
+        MdlCopyMdlMappedSpanToFlatBuffer
+        MdlCopyMdlMappedSpanToMdlMappedSpan
+        MdlMappedSpanCompareBufferContents
+        MdlMappedSpanComputeInternetChecksum
+        MdlMappedSpanComputeCrc32c
+
+    A mapped span does not refer to the MDLs at all, so it stays valid only as
+    long as the MDLs' buffers and system mappings stay valid.
+
+Cursors:
+
+    Protocol parsers tend to read an MDL chain in many small, sequential
+    pieces: an Ethernet header, then an IP header, then some TCP options. If
+    you use MdlCopyMdlChainAtOffsetToFlatBuffer for each piece, each call walks
+    the chain from the first MDL again, which adds up when the chain is long.
+
+    An MDL_CURSOR remembers where the last read ended, so each read only
+    touches the MDLs that contain the bytes being read:
+
+    MdlCursorInitialize
+        Begins reading at the start of an MDL span.
+
+    MdlCursorRead
+    MdlCursorPeek
+        Copies bytes from the cursor into a flat buffer, and either advances
+        the cursor past them or leaves the cursor where it is.
+
+    MdlCursorSkip
+        Advances the cursor without reading the bytes.
+
+    MdlCursorGetContiguous
+        Returns a pointer to the next N bytes and advances the cursor past
+        them. If the bytes are all in one MDL, the pointer points directly into
+        the MDL's buffer; otherwise, the bytes are copied into a buffer that you
+        provide. This is usually what you want to read a protocol header.
+
+    MdlSpanGetContiguousOrCopy
+        The same, for a single read of an MDL span without a cursor. It also
+        reports whether the bytes had to be copied.
+
+    The cursor's position is always in normal form (see the topic
+    "Normalization"). The cursor never reads past the end of the span it was
+    initialized with; if you ask for more bytes than are left, the routine
+    fails with STATUS_BUFFER_TOO_SMALL and leaves the cursor unchanged.
+
 Iteration:
 
     The various high-level routines offered by this module are based on a few
@@ -216,6 +351,19 @@ Iteration:
      to implement one for memcmp at all, since MdlEqualBufferContents is
      already implemented for you.
 
+    C++ code may also walk the buffers of a span with a range-based for loop,
+    which is usually easier to read than a callback:
+
+        for (auto const &fragment : ndis::mdl_span_fragments(span))
+        {
+            . . . fragment.Start.Mdl, fragment.Start.Offset, fragment.Length . . .
+        }
+
+    Each fragment is the MDL_SPAN that MdlSpanIterateBuffers would pass to its
+    callback. ndis::mdl_chain and ndis::mdl_chain_safe walk each MDL of an MDL
+    chain, including empty ones. Like the iterator routines, all of these
+    prefetch each MDL's successor with MDL_PREFETCH_CACHELINE.
+
 Normalization:
 
     A pointer is in normal form if the pointer points directly into the MDL
@@ -239,6 +387,60 @@ Normalization:
     If you would like to normalize a pointer yourself, you can call
     MdlPointerNormalize.
 
+Temporal and non-temporal:
+
+    Non-temporal instructions bypass the processor's data cache, so a large
+    copy does not evict data that other code will access again soon. But
+    they have a fixed cost, and the destination is not in the cache
+    afterwards, so they are a poor choice for a 64 byte header that is about
+    to be read again. The -Auto variants choose between the two on each call,
+    by comparing the total length of the operation against a threshold.
+
+    The MdlChainXxxAuto routines that process an entire MDL chain don't know
+    its total length up front, and counting it would mean walking the chain
+    twice. Instead, they use regular instructions for the first threshold
+    bytes of the chain, and non-temporal instructions for the rest.
+
+    By default, the threshold is 1MB until you call
+    MdlInitializeNonTemporalThreshold. That routine queries the size of the
+    last-level cache and sets the threshold to half of it. Call it once from
+    DriverEntry. Alternatively, define MDL_NON_TEMPORAL_THRESHOLD to a fixed
+    number of bytes, and the threshold is never queried.
+
+NUMA:
+
+    On a machine with more than one NUMA node, a copy whose source or
+    destination is on another node than the processor doing the copy pays
+    the cross-node latency for every cache line. The processor's own
+    prefetchers don't run far enough ahead to hide it.
+
+    The -WithPrefetch copies prefetch the source MDL_COPY_PREFETCH_DISTANCE
+    bytes ahead of the bytes being copied, so several cache lines are in
+    flight at once. They are otherwise the same as the copies without the
+    suffix.
+
+    MdlCopyMdlPointerToMdlPointerOnNode goes further. If the destination is
+    on another node than the current processor, and the copy is at least
+    MDL_NUMA_COPY_MINIMUM_CHUNK_LENGTH bytes, it splits the copy into chunks
+    and queues a DPC for each chunk to a processor of the destination's node.
+    The stores are then local, only the loads cross nodes, and the chunks run
+    in parallel. No DPC copies more than MDL_NUMA_COPY_MAXIMUM_DPC_LENGTH
+    bytes; a longer chunk queues its DPC again to copy the rest, so other
+    DPCs on that processor get to run in between. Otherwise, it copies on the
+    current processor. You provide
+    the node, for example the node you passed to MmAllocateNodePagesForMdlEx
+    or that NDIS reported for the receive queue:
+
+        MDL_NUMA_COPY NumaCopy;
+        MDL_NUMA_COPY_CHUNK Chunks[4];
+        NtStatus = MdlCopyMdlPointerToMdlPointerOnNode(
+            &NumaCopy, Chunks, 4, &Destination, &Source, CopyLength,
+            DestinationNode, CopyComplete, Request);
+        if (NtStatus != STATUS_PENDING)
+        {
+            // The copy already finished, and CopyComplete is not invoked
+        }
+
 Customization:
 
     You may optionally define any of the following macros to customize the
@@ -253,7 +455,8 @@ Customization:
     MDL_MAP_BUFFER
     MDL_MAP_CONST_BUFFER
         Select which routine performs MDL mapping. You may inject additional
-        logic, for example, statistical counters.
+        logic, for example, statistical counters. To keep the counters in
+        ndis/ndl/statistics.h, wrap your routine in NDL_STATISTICS_RECORD_MDL_MAP.
 
     MDL_REPORT_FATAL_OVERFLOW
         Terminate the system when a programming error has been detected. This
@@ -262,11 +465,34 @@ Customization:
     MDL_PREFETCH_CACHELINE
         Prefetch data from RAM to improve performance.
 
+    MDL_NON_TEMPORAL_THRESHOLD
+        The minimum length, in bytes, of an operation that the -Auto variants
+        perform with non-temporal instructions. If you do not define this
+        macro, the threshold is derived from the last-level cache size.
+
+    MDL_COPY_BATCH_SOURCE_CURSORS
+        The number of distinct source MDL chains whose position is remembered
+        between entries of a batched copy.
+
+    MDL_COPY_PREFETCH_DISTANCE
+        How many bytes ahead of the copy the -WithPrefetch copies prefetch the
+        source. See the topic "NUMA".
+
+    MDL_NUMA_COPY_MINIMUM_CHUNK_LENGTH
+        The smallest chunk that MdlCopyMdlPointerToMdlPointerOnNode queues to
+        another processor.
+
+    MDL_NUMA_COPY_MAXIMUM_DPC_LENGTH
+        The most bytes that one DPC of MdlCopyMdlPointerToMdlPointerOnNode
+        copies before it queues itself again.
+
 Table of Contents:
 
     MdlChainIterateBuffers
     MdlSpanIterateBuffers
     MdlChainEnsureMappedSystemAddress
+    MdlSpanMapFragments
+    MdlChainMapFragments
     MdlChainGetInformation
     MdlChainGetMdlCount
     MdlChainGetByteCount
@@ -276,6 +502,7 @@ Table of Contents:
     MdlPointerAdvanceBytes
     MdlPairwiseIterateBuffersUpdateInputs
     MdlPairwiseIterateBuffers
+    MdlInitializeNonTemporalThreshold
     MdlChainZeroBuffers
     MdlSpanZeroBuffers
     MdlChainZeroBuffersAtOffset
@@ -285,12 +512,27 @@ Table of Contents:
     MdlChainZeroBuffersSecure
     MdlSpanZeroBuffersSecure
     MdlChainZeroBuffersAtOffsetSecure
+    MdlChainZeroBuffersAuto
+    MdlSpanZeroBuffersAuto
+    MdlChainZeroBuffersAtOffsetAuto
     MdlChainFillBuffers
     MdlSpanFillBuffers
     MdlChainFillBuffersAtOffset
     MdlChainFillBuffersNonTemporal
     MdlSpanFillBuffersNonTemporal
     MdlChainFillBuffersAtOffsetNonTemporal
+    MdlChainFillBuffersAuto
+    MdlSpanFillBuffersAuto
+    MdlChainFillBuffersAtOffsetAuto
+    MdlChainFillBuffersWithPattern
+    MdlSpanFillBuffersWithPattern
+    MdlChainFillBuffersAtOffsetWithPattern
+    MdlChainFillBuffersWithPatternNonTemporal
+    MdlSpanFillBuffersWithPatternNonTemporal
+    MdlChainFillBuffersAtOffsetWithPatternNonTemporal
+    MdlChainFillBuffersWithPatternAuto
+    MdlSpanFillBuffersWithPatternAuto
+    MdlChainFillBuffersAtOffsetWithPatternAuto
     MdlCopyFlatBufferToMdlSpan
     MdlCopyFlatBufferToMdlChainAtOffset
     MdlCopyMdlSpanToFlatBuffer
@@ -298,6 +540,11 @@ Table of Contents:
     MdlCopyMdlPointerToMdlPointer
     MdlCopyMdlPointerToMdlPointerUpdateInputs
     MdlCopyMdlChainToMdlChainAtOffset
+    MdlCopyMdlPointerToMdlPointerWithPrefetch
+    MdlCopyMdlChainToMdlChainAtOffsetWithPrefetch
+    MdlCopyFlatBufferToMdlMappedSpan
+    MdlCopyMdlMappedSpanToFlatBuffer
+    MdlCopyMdlMappedSpanToMdlMappedSpan
     MdlCopyFlatBufferToMdlSpanNonTemporal
     MdlCopyFlatBufferToMdlChainAtOffsetNonTemporal
     MdlCopyMdlSpanToFlatBufferNonTemporal
@@ -305,9 +552,52 @@ Table of Contents:
     MdlCopyMdlPointerToMdlPointerNonTemporal
     MdlCopyMdlPointerToMdlPointerUpdateInputsNonTemporal
     MdlCopyMdlChainToMdlChainAtOffsetNonTemporal
+    MdlCopyMdlPointerToMdlPointerWithPrefetchNonTemporal
+    MdlCopyMdlChainToMdlChainAtOffsetWithPrefetchNonTemporal
+    MdlCopyFlatBufferToMdlMappedSpanNonTemporal
+    MdlCopyMdlMappedSpanToFlatBufferNonTemporal
+    MdlCopyMdlMappedSpanToMdlMappedSpanNonTemporal
+    MdlCopyFlatBufferToMdlSpanAuto
+    MdlCopyFlatBufferToMdlChainAtOffsetAuto
+    MdlCopyMdlSpanToFlatBufferAuto
+    MdlCopyMdlChainAtOffsetToFlatBufferAuto
+    MdlCopyMdlPointerToMdlPointerAuto
+    MdlCopyMdlPointerToMdlPointerUpdateInputsAuto
+    MdlCopyMdlChainToMdlChainAtOffsetAuto
+    MdlCopyMdlPointerToMdlPointerWithPrefetchAuto
+    MdlCopyMdlChainToMdlChainAtOffsetWithPrefetchAuto
+    MdlCopyFlatBufferToMdlMappedSpanAuto
+    MdlCopyMdlMappedSpanToFlatBufferAuto
+    MdlCopyMdlMappedSpanToMdlMappedSpanAuto
+    MdlCopyMdlSpansToMdlPointers
+    MdlCopyMdlPointerToMdlPointerOnNode
     MdlEqualBufferContents
     MdlEqualBufferContentsUpdateInputs
     MdlEqualBufferContentsAtOffset
+    MdlCompareBufferContents
+    MdlCompareBufferContentsUpdateInputs
+    MdlSpanCompareBufferContents
+    MdlCompareBufferContentsAtOffset
+    MdlMappedSpanCompareBufferContents
+    MdlSpanComputeInternetChecksum
+    MdlChainComputeInternetChecksumAtOffset
+    MdlCopyMdlSpanToFlatBufferWithInternetChecksum
+    MdlCopyFlatBufferToMdlSpanWithInternetChecksum
+    MdlMappedSpanComputeInternetChecksum
+    MdlSpanComputeCrc32c
+    MdlChainComputeCrc32cAtOffset
+    MdlCopyMdlSpanToFlatBufferWithCrc32c
+    MdlCopyFlatBufferToMdlSpanWithCrc32c
+    MdlMappedSpanComputeCrc32c
+    MdlCursorInitialize
+    MdlCursorRead
+    MdlCursorPeek
+    MdlCursorSkip
+    MdlCursorGetContiguous
+    MdlSpanGetContiguousOrCopy
+    MdlFreePartialMdlChain
+    MdlSpanBuildPartialMdlChain
+    MdlSpanSplitIntoChains
 
 Environment:
 
@@ -325,6 +615,9 @@ Environment:
 #pragma warning(push)
 #pragma warning(disable : 4514) // Unreferenced inline function has been removed
 
+#include <ndis/ndl/chainiterator.h>
+#include <ndis/ndl/statistics.h>
+
 // You may replace MDL_MAPPING_OPTIONS if you want to customize the page
 // priority used by MmGetSystemAddressForMdlSafe.
 #ifndef MDL_MAPPING_OPTIONS
@@ -333,13 +626,17 @@ Environment:
 
 // You may replace MDL_MAP_BUFFER and MDL_MAP_CONST_BUFFER if you have special
 // needs for how MDLs are mapped into system address space.
+// If you do, wrap your routine in NDL_STATISTICS_RECORD_MDL_MAP to keep the
+// mapping counters in ndis/ndl/statistics.h.
 #ifndef MDL_MAP_BUFFER
 #  define MDL_MAP_BUFFER(Mdl) \
-       (UCHAR*)MmGetSystemAddressForMdlSafe(Mdl, MDL_MAPPING_OPTIONS)
+       (UCHAR*)NDL_STATISTICS_RECORD_MDL_MAP( \
+           MmGetSystemAddressForMdlSafe(Mdl, MDL_MAPPING_OPTIONS))
 #endif
 #ifndef MDL_MAP_CONST_BUFFER
 #  define MDL_MAP_CONST_BUFFER(Mdl) \
-       (UCHAR const*)MmGetSystemAddressForMdlSafe(Mdl, MDL_MAPPING_OPTIONS)
+       (UCHAR const*)NDL_STATISTICS_RECORD_MDL_MAP( \
+           MmGetSystemAddressForMdlSafe(Mdl, MDL_MAPPING_OPTIONS))
 #endif
 
 // You may replace MDL_REPORT_FATAL_OVERFLOW if you need to terminate the
@@ -358,6 +655,51 @@ Environment:
        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Address)
 #endif
 
+// You may define MDL_NON_TEMPORAL_THRESHOLD to a fixed number of bytes, if
+// you'd rather not have the -Auto variants consult the last-level cache size.
+// #define MDL_NON_TEMPORAL_THRESHOLD (256 * 1024)
+
+// You may replace MDL_COPY_BATCH_SOURCE_CURSORS if your batches gather from
+// more (or fewer) source MDL chains in an interleaved order.
+#ifndef MDL_COPY_BATCH_SOURCE_CURSORS
+#  define MDL_COPY_BATCH_SOURCE_CURSORS 4
+#endif
+
+#if MDL_COPY_BATCH_SOURCE_CURSORS < 1
+#  error MDL_COPY_BATCH_SOURCE_CURSORS must be at least 1
+#endif
+
+// You may replace MDL_COPY_PREFETCH_DISTANCE if your source buffers are
+// further away (or closer) than a typical remote NUMA node.
+#ifndef MDL_COPY_PREFETCH_DISTANCE
+#  define MDL_COPY_PREFETCH_DISTANCE 4096
+#endif
+
+#if MDL_COPY_PREFETCH_DISTANCE < 1
+#  error MDL_COPY_PREFETCH_DISTANCE must be at least 1
+#endif
+
+// You may replace MDL_NUMA_COPY_MINIMUM_CHUNK_LENGTH to change how large a
+// remote copy must be before it is worth queuing to another processor.
+#ifndef MDL_NUMA_COPY_MINIMUM_CHUNK_LENGTH
+#  define MDL_NUMA_COPY_MINIMUM_CHUNK_LENGTH (64 * 1024)
+#endif
+
+// You may replace MDL_NUMA_COPY_MAXIMUM_DPC_LENGTH to bound how long one DPC
+// of a remote copy runs. The default takes tens of microseconds to copy,
+// even across nodes.
+#ifndef MDL_NUMA_COPY_MAXIMUM_DPC_LENGTH
+#  define MDL_NUMA_COPY_MAXIMUM_DPC_LENGTH (256 * 1024)
+#endif
+
+#if MDL_NUMA_COPY_MAXIMUM_DPC_LENGTH < 1
+#  error MDL_NUMA_COPY_MAXIMUM_DPC_LENGTH must be at least 1
+#endif
+
+#if defined(_M_AMD64) || defined(_M_ARM64)
+#  include <intrin.h>
+#endif
+
 // This signals that the callback is done iterating over an MDL chain's buffers
 #define STATUS_STOP_ITERATION ((NTSTATUS)1L)
 
@@ -378,6 +720,121 @@ typedef struct MDL_SPAN_t
     SIZE_T Length;
 } MDL_SPAN;
 
+// An MDL_MAPPED_FRAGMENT is one virtually-contiguous buffer of a mapped span.
+typedef struct MDL_MAPPED_FRAGMENT_t
+{
+    UCHAR* Buffer;
+    SIZE_T Length;
+} MDL_MAPPED_FRAGMENT;
+
+// An MDL_MAPPED_SPAN represents the buffers of an MDL span after they were
+// mapped into system address space. The array of fragments is owned by you.
+typedef struct MDL_MAPPED_SPAN_t
+{
+    // The non-empty buffers of the span, in order
+    MDL_MAPPED_FRAGMENT* Fragments;
+
+    // The number of elements of Fragments that are in use
+    SIZE_T NumberOfFragments;
+
+    // The total length of every fragment
+    SIZE_T Length;
+} MDL_MAPPED_SPAN;
+
+// An MDL_CURSOR reads sequentially through an MDL span. Initialize it with
+// MdlCursorInitialize; all fields are read-only to you.
+typedef struct MDL_CURSOR_t
+{
+    // The current position, in normal form
+    MDL_POINTER Position;
+
+    // The number of bytes between Position and the end of the span
+    SIZE_T BytesRemaining;
+
+    // The system address of Position.Mdl's buffer, or NULL if it has not been
+    // mapped yet
+    UCHAR const* MappedBuffer;
+} MDL_CURSOR;
+
+// An MDL_COPY_DESCRIPTOR is one entry in a batch of copies that is executed by
+// MdlCopyMdlSpansToMdlPointers.
+typedef struct MDL_COPY_DESCRIPTOR_t
+{
+    // The data to copy
+    MDL_SPAN Source;
+
+    // The location to copy the data to. If Destination.Mdl is NULL, the data
+    // is written immediately after the data of the previous descriptor.
+    MDL_POINTER Destination;
+} MDL_COPY_DESCRIPTOR;
+
+typedef struct MDL_NUMA_COPY_t MDL_NUMA_COPY;
+
+typedef
+_IRQL_requires_(DISPATCH_LEVEL)
+_IRQL_requires_same_
+_Function_class_(MDL_NUMA_COPY_COMPLETION)
+void
+MDL_NUMA_COPY_COMPLETION(
+    _In_ MDL_NUMA_COPY* NumaCopy,
+    _In_opt_ PVOID CompletionContext,
+    _In_ NTSTATUS NtStatus);
+/*++
+
+Routine Description:
+
+    A callback that is invoked once every chunk of a copy started by
+    MdlCopyMdlPointerToMdlPointerOnNode has finished
+
+    Once this callback is invoked, you may free or reuse the MDL_NUMA_COPY and
+    its chunks.
+
+Arguments:
+
+    NumaCopy
+        The MDL_NUMA_COPY that you passed to MdlCopyMdlPointerToMdlPointerOnNode
+
+    CompletionContext
+        The context that you passed to MdlCopyMdlPointerToMdlPointerOnNode
+
+    NtStatus
+        STATUS_SUCCESS if every chunk was copied, or
+        STATUS_INSUFFICIENT_RESOURCES if the system was unable to map an MDL
+        into system address space. Some chunks may have been copied anyway.
+
+--*/
+
+// An MDL_NUMA_COPY_CHUNK is one piece of a copy that
+// MdlCopyMdlPointerToMdlPointerOnNode runs on another processor. Its
+// contents are an implementation detail.
+typedef struct MDL_NUMA_COPY_CHUNK_t
+{
+    KDPC Dpc;
+    MDL_NUMA_COPY* NumaCopy;
+
+    // Where the next DPC resumes, and how many bytes it has left
+    MDL_POINTER Destination;
+    MDL_POINTER Source;
+    SIZE_T Length;
+} MDL_NUMA_COPY_CHUNK;
+
+// An MDL_NUMA_COPY tracks a copy that MdlCopyMdlPointerToMdlPointerOnNode has
+// split into chunks. Its contents are an implementation detail.
+typedef struct MDL_NUMA_COPY_t
+{
+    MDL_NUMA_COPY_COMPLETION* CompletionRoutine;
+    PVOID CompletionContext;
+
+    // TRUE if the chunks are copied with non-temporal instructions
+    BOOLEAN NonTemporal;
+
+    // The number of chunks that have not finished yet
+    LONG volatile ChunksRemaining;
+
+    // The first failure of any chunk, or STATUS_SUCCESS
+    NTSTATUS volatile NtStatus;
+} MDL_NUMA_COPY;
+
 typedef
 _IRQL_requires_max_(DISPATCH_LEVEL)
 _IRQL_requires_same_
@@ -714,6 +1171,231 @@ Return Value:
     return MdlChainIterateBuffers(MdlChain, MapOperator, NULL);
 }
 
+#define MAP_FRAGMENTS_CONTEXT_t _MdlPrivate_MAP_FRAGMENTS_CONTEXT_t
+#define MAP_FRAGMENTS_CONTEXT _MdlPrivate_MAP_FRAGMENTS_CONTEXT
+
+typedef struct MAP_FRAGMENTS_CONTEXT_t
+{
+    // The caller's array of fragments
+    MDL_MAPPED_FRAGMENT* Fragments;
+    SIZE_T MaximumFragments;
+
+    // The number of fragments needed so far, which may exceed MaximumFragments
+    SIZE_T NumberOfFragments;
+
+    // The total number of bytes mapped so far
+    SIZE_T Length;
+
+    // The virtual address just past the end of the last fragment
+    UCHAR* LastFragmentEnd;
+} MAP_FRAGMENTS_CONTEXT;
+
+#define MapFragmentsOperator _MdlPrivate_MapFragmentsOperator
+
+MDL_BUFFER_OPERATOR MapFragmentsOperator;
+
+_Use_decl_annotations_
+inline
+NTSTATUS MapFragmentsOperator(
+    PVOID OperatorContext,
+    MDL_SPAN const* Span)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    MAP_FRAGMENTS_CONTEXT* Context = (MAP_FRAGMENTS_CONTEXT*)OperatorContext;
+
+    UCHAR* Buffer = MDL_MAP_BUFFER(Span->Start.Mdl);
+    if (!Buffer)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Buffer += Span->Start.Offset;
+
+    if (Context->NumberOfFragments > 0 && Buffer == Context->LastFragmentEnd)
+    {
+        // This buffer picks up where the previous one left off
+        if (Context->NumberOfFragments <= Context->MaximumFragments)
+        {
+            Context->Fragments[Context->NumberOfFragments - 1].Length += Span->Length;
+        }
+    }
+    else
+    {
+        if (Context->NumberOfFragments < Context->MaximumFragments)
+        {
+            Context->Fragments[Context->NumberOfFragments].Buffer = Buffer;
+            Context->Fragments[Context->NumberOfFragments].Length = Span->Length;
+        }
+
+        Context->NumberOfFragments += 1;
+    }
+
+    Context->LastFragmentEnd = Buffer + Span->Length;
+    Context->Length += Span->Length;
+
+    return STATUS_SUCCESS;
+}
+
+#define FinishMapFragments _MdlPrivate_FinishMapFragments
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS FinishMapFragments(
+    _In_ NTSTATUS NtStatus,
+    _In_ MAP_FRAGMENTS_CONTEXT const* Context,
+    _Out_ MDL_MAPPED_SPAN* MappedSpan)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    MappedSpan->Fragments = Context->Fragments;
+    MappedSpan->NumberOfFragments = Context->NumberOfFragments;
+    MappedSpan->Length = Context->Length;
+
+    if (STATUS_SUCCESS != NtStatus)
+    {
+        MappedSpan->NumberOfFragments = 0;
+        MappedSpan->Length = 0;
+        return NtStatus;
+    }
+
+    if (Context->NumberOfFragments > Context->MaximumFragments)
+    {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlSpanMapFragments(
+    _In_ MDL_SPAN const* Span,
+    _Out_writes_(MaximumFragments) MDL_MAPPED_FRAGMENT* Fragments,
+    _In_ SIZE_T MaximumFragments,
+    _Out_ MDL_MAPPED_SPAN* MappedSpan)
+/*++
+
+Routine Description:
+
+    Maps the buffers of an MDL span into system address space, and describes
+    them as an array of fragments
+
+    MdlChainGetInformation's NumberOfNonEmptyMdls is always enough fragments,
+    but fewer may be needed, since virtually-adjacent buffers are merged.
+
+    For more information, refer to the topic "Mapped spans" at the top of this
+    header file.
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+Arguments:
+
+    Span
+        The MDL span to map
+
+    Fragments
+        Storage for the mapped span's fragments
+
+    MaximumFragments
+        The number of elements in the Fragments array
+
+    MappedSpan
+        Receives the mapped span. Its Fragments member points to Fragments.
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was mapped
+
+    STATUS_BUFFER_TOO_SMALL
+        The Fragments array is too small. MappedSpan->NumberOfFragments
+        receives the number of fragments needed, and MappedSpan is unusable.
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MAP_FRAGMENTS_CONTEXT Context = { 0 };
+    Context.Fragments = Fragments;
+    Context.MaximumFragments = MaximumFragments;
+
+    NTSTATUS NtStatus = MdlSpanIterateBuffers(Span, MapFragmentsOperator, &Context);
+
+    return FinishMapFragments(NtStatus, &Context, MappedSpan);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlChainMapFragments(
+    _In_ MDL* MdlChain,
+    _Out_writes_(MaximumFragments) MDL_MAPPED_FRAGMENT* Fragments,
+    _In_ SIZE_T MaximumFragments,
+    _Out_ MDL_MAPPED_SPAN* MappedSpan)
+/*++
+
+Routine Description:
+
+    Maps every buffer of an MDL chain into system address space, and describes
+    them as an array of fragments
+
+    MdlChainGetInformation's NumberOfNonEmptyMdls is always enough fragments,
+    but fewer may be needed, since virtually-adjacent buffers are merged.
+
+    For more information, refer to the topic "Mapped spans" at the top of this
+    header file.
+
+Arguments:
+
+    MdlChain
+        The MDL chain to map
+
+    Fragments
+        Storage for the mapped span's fragments
+
+    MaximumFragments
+        The number of elements in the Fragments array
+
+    MappedSpan
+        Receives the mapped span. Its Fragments member points to Fragments.
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was mapped
+
+    STATUS_BUFFER_TOO_SMALL
+        The Fragments array is too small. MappedSpan->NumberOfFragments
+        receives the number of fragments needed, and MappedSpan is unusable.
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MAP_FRAGMENTS_CONTEXT Context = { 0 };
+    Context.Fragments = Fragments;
+    Context.MaximumFragments = MaximumFragments;
+
+    NTSTATUS NtStatus = MdlChainIterateBuffers(MdlChain, MapFragmentsOperator, &Context);
+
+    return FinishMapFragments(NtStatus, &Context, MappedSpan);
+}
+
 typedef struct MDL_CHAIN_INFORMATION_t
 {
     // The total number of MDLs in this MDL chain
@@ -1258,15 +1940,20 @@ Return Value:
             OperatorContext);
 }
 
-#define ZeroOperator _MdlPrivate_ZeroOperator
+#define NonTemporalThreshold _MdlPrivate_NonTemporalThreshold
+#define GetNonTemporalThreshold _MdlPrivate_GetNonTemporalThreshold
+#define ShouldUseNonTemporal _MdlPrivate_ShouldUseNonTemporal
 
-MDL_BUFFER_OPERATOR ZeroOperator;
+#ifndef MDL_NON_TEMPORAL_THRESHOLD
 
-_Use_decl_annotations_
+// The threshold used by the -Auto variants; see MdlInitializeNonTemporalThreshold
+DECLSPEC_SELECTANY SIZE_T NonTemporalThreshold = 1024 * 1024;
+
+#endif
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
 inline
-NTSTATUS ZeroOperator(
-    PVOID OperatorContext,
-    MDL_SPAN const* Span)
+SIZE_T GetNonTemporalThreshold()
 /*++
 
 Routine Description:
@@ -1275,22 +1962,217 @@ Routine Description:
 
 --*/
 {
-    UNREFERENCED_PARAMETER(OperatorContext);
-
-    UCHAR* Buffer = MDL_MAP_BUFFER(Span->Start.Mdl);
-    if (!Buffer)
-    {
-        return STATUS_INSUFFICIENT_RESOURCES;
-    }
-
-    RtlZeroMemory(Buffer + Span->Start.Offset, Span->Length);
-
-    return STATUS_SUCCESS;
+#ifdef MDL_NON_TEMPORAL_THRESHOLD
+    return (SIZE_T)(MDL_NON_TEMPORAL_THRESHOLD);
+#else
+    return NonTemporalThreshold;
+#endif
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
-NTSTATUS
+BOOLEAN ShouldUseNonTemporal(
+    _In_ SIZE_T Length)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    return Length >= GetNonTemporalThreshold();
+}
+
+#define AUTO_OPERATOR_CONTEXT_t _MdlPrivate_AUTO_OPERATOR_CONTEXT_t
+#define AUTO_OPERATOR_CONTEXT _MdlPrivate_AUTO_OPERATOR_CONTEXT
+#define InitializeAutoOperator _MdlPrivate_InitializeAutoOperator
+
+typedef struct AUTO_OPERATOR_CONTEXT_t
+{
+    MDL_BUFFER_OPERATOR* Temporal;
+    MDL_BUFFER_OPERATOR* NonTemporal;
+    PVOID OperatorContext;
+
+    // The number of bytes left to pass to Temporal; the rest go to NonTemporal
+    SIZE_T TemporalBytesRemaining;
+} AUTO_OPERATOR_CONTEXT;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void InitializeAutoOperator(
+    _Out_ AUTO_OPERATOR_CONTEXT* Context,
+    _In_ MDL_BUFFER_OPERATOR* Temporal,
+    _In_ MDL_BUFFER_OPERATOR* NonTemporal,
+    _In_opt_ PVOID OperatorContext)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    Context->Temporal = Temporal;
+    Context->NonTemporal = NonTemporal;
+    Context->OperatorContext = OperatorContext;
+    Context->TemporalBytesRemaining = GetNonTemporalThreshold();
+}
+
+#define AutoOperator _MdlPrivate_AutoOperator
+
+MDL_BUFFER_OPERATOR AutoOperator;
+
+_Use_decl_annotations_
+inline
+NTSTATUS AutoOperator(
+    PVOID OperatorContext,
+    MDL_SPAN const* Span)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Passes the first NonTemporalThreshold bytes of a walk to the temporal
+    operator, and everything after that to the non-temporal operator, so the
+    -Auto variants that take a whole MDL chain don't have to walk it twice.
+
+--*/
+{
+    AUTO_OPERATOR_CONTEXT* Context = (AUTO_OPERATOR_CONTEXT*)OperatorContext;
+    MDL_SPAN Subspan = *Span;
+
+    if (0 < Context->TemporalBytesRemaining)
+    {
+        Subspan.Length = MinSizeT(Span->Length, Context->TemporalBytesRemaining);
+
+#pragma warning(suppress:6387) // 'OperatorContext' could be NULL
+        NTSTATUS NtStatus = Context->Temporal(Context->OperatorContext, &Subspan);
+        if (STATUS_SUCCESS != NtStatus)
+        {
+            return NtStatus;
+        }
+
+        Context->TemporalBytesRemaining -= Subspan.Length;
+
+        if (Subspan.Length == Span->Length)
+        {
+            return STATUS_SUCCESS;
+        }
+
+        Subspan.Start.Offset += Subspan.Length;
+        Subspan.Length = Span->Length - Subspan.Length;
+    }
+
+#pragma warning(suppress:6387) // 'OperatorContext' could be NULL
+    return Context->NonTemporal(Context->OperatorContext, &Subspan);
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+void
+MdlInitializeNonTemporalThreshold(
+    void)
+/*++
+
+Routine Description:
+
+    Sets the threshold used by the -Auto variants to half the size of the
+    processor's last-level cache
+
+    Call this routine once, before using any -Auto variant. If the cache
+    topology cannot be queried, the threshold is left at its default of 1MB.
+
+    If MDL_NON_TEMPORAL_THRESHOLD is defined, this routine does nothing.
+
+    For more information, refer to the topic "Temporal and non-temporal" at
+    the top of this header file.
+
+--*/
+{
+#ifndef MDL_NON_TEMPORAL_THRESHOLD
+    PROCESSOR_NUMBER ProcessorNumber;
+    union
+    {
+        SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX Information;
+        UCHAR Buffer[1024];
+    } Relationship;
+    ULONG RelationshipLength = sizeof(Relationship);
+
+    if (!NT_SUCCESS(KeGetProcessorNumberFromIndex(0, &ProcessorNumber)) ||
+        !NT_SUCCESS(KeQueryLogicalProcessorRelationship(
+            &ProcessorNumber, RelationCache, &Relationship.Information, &RelationshipLength)))
+    {
+        return;
+    }
+
+    UCHAR LastLevel = 0;
+    ULONG LastLevelSize = 0;
+
+    SIZE_T Offset = 0;
+    while (Offset + sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX) <= RelationshipLength)
+    {
+        SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX const* Entry =
+            (SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX const*)(Relationship.Buffer + Offset);
+
+        if (0 == Entry->Size)
+        {
+            break;
+        }
+
+        if (RelationCache == Entry->Relationship &&
+            CacheInstruction != Entry->Cache.Type &&
+            (Entry->Cache.Level > LastLevel ||
+                (Entry->Cache.Level == LastLevel && Entry->Cache.CacheSize > LastLevelSize)))
+        {
+            LastLevel = Entry->Cache.Level;
+            LastLevelSize = Entry->Cache.CacheSize;
+        }
+
+        Offset += Entry->Size;
+    }
+
+    if (0 != LastLevelSize)
+    {
+        NonTemporalThreshold = LastLevelSize / 2;
+    }
+#endif
+}
+
+#define ZeroOperator _MdlPrivate_ZeroOperator
+
+MDL_BUFFER_OPERATOR ZeroOperator;
+
+_Use_decl_annotations_
+inline
+NTSTATUS ZeroOperator(
+    PVOID OperatorContext,
+    MDL_SPAN const* Span)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    UNREFERENCED_PARAMETER(OperatorContext);
+
+    UCHAR* Buffer = MDL_MAP_BUFFER(Span->Start.Mdl);
+    if (!Buffer)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(Buffer + Span->Start.Offset, Span->Length);
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
 MdlChainZeroBuffers(
     _In_ MDL* MdlChain)
 /*++
@@ -1684,6 +2566,132 @@ Return Value:
     return MdlSpanZeroBuffersSecure(&Span);
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlChainZeroBuffersAuto(
+    _In_ MDL* MdlChain)
+/*++
+
+Routine Description:
+
+    Zeros every byte of every buffer associated with the provided MDL chain
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    MdlChain
+        The MDL chain to process
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    AUTO_OPERATOR_CONTEXT Context;
+    InitializeAutoOperator(&Context, ZeroOperator, ZeroOperatorNonTemporal, NULL);
+
+    return MdlChainIterateBuffers(MdlChain, AutoOperator, &Context);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlSpanZeroBuffersAuto(
+    _In_ MDL_SPAN const* Span)
+/*++
+
+Routine Description:
+
+    Zeros the buffers contained in the MDL span
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    Span
+        The MDL span to process
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    if (ShouldUseNonTemporal(Span->Length))
+    {
+        return MdlSpanZeroBuffersNonTemporal(Span);
+    }
+
+    return MdlSpanZeroBuffers(Span);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlChainZeroBuffersAtOffsetAuto(
+    _In_ MDL* MdlChain,
+    _In_ SIZE_T Offset,
+    _In_ SIZE_T ZeroLength)
+/*++
+
+Routine Description:
+
+    Zeros the buffers at some subset of an MDL chain
+
+    If Offset plus ZeroLength extends past the end of the MDL chain, this
+    routine crashes the system with a fatal overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    MdlChain
+        The MDL chain to process
+
+    Offset
+        The offset into the MDL chain's buffers at which to begin zeroing
+
+    ZeroLength
+        The total number of bytes to zero
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_SPAN Span = { { 0 } };
+    Span.Start.Mdl = MdlChain;
+    Span.Start.Offset = Offset;
+    Span.Length = ZeroLength;
+
+    return MdlSpanZeroBuffersAuto(&Span);
+}
+
 #define FillOperator _MdlPrivate_FillOperator
 
 MDL_BUFFER_OPERATOR FillOperator;
@@ -2003,59 +3011,72 @@ Return Value:
     return MdlSpanFillBuffersNonTemporal(&Span, FillByte);
 }
 
-#define WriteOperator _MdlPrivate_WriteOperator
-
-MDL_BUFFER_OPERATOR WriteOperator;
-
-_Use_decl_annotations_
+_IRQL_requires_max_(DISPATCH_LEVEL)
 inline
-NTSTATUS WriteOperator(
-    PVOID OperatorContext,
-    MDL_SPAN const* Span)
+NTSTATUS
+MdlChainFillBuffersAuto(
+    _In_ MDL* MdlChain,
+    _In_ UCHAR FillByte)
 /*++
 
 Routine Description:
 
-    Implementation detail - do not invoke this routine directly
+    Fills every byte of the buffers associated with an MDL chain with a byte value
 
---*/
-{
-    UCHAR const** Source = (UCHAR const**)OperatorContext;
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
 
-    UCHAR* Buffer = MDL_MAP_BUFFER(Span->Start.Mdl);
-    if (!Buffer)
-    {
-        return STATUS_INSUFFICIENT_RESOURCES;
-    }
+Arguments:
 
-    RtlCopyMemory(Buffer + Span->Start.Offset, *Source, Span->Length);
-    *Source += Span->Length;
+    MdlChain
+        The MDL chain to process
 
-    return STATUS_SUCCESS;
+    FillByte
+        The byte to fill the buffers with
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    AUTO_OPERATOR_CONTEXT Context;
+    InitializeAutoOperator(&Context, FillOperator, FillOperatorNonTemporal, ULongToPtr(FillByte));
+
+    return MdlChainIterateBuffers(MdlChain, AutoOperator, &Context);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlCopyFlatBufferToMdlSpan(
-    _In_ MDL_SPAN const* DestinationSpan,
-    _In_reads_(DestinationSpan->Length) UCHAR const* SourceBuffer)
+MdlSpanFillBuffersAuto(
+    _In_ MDL_SPAN const* Span,
+    _In_ UCHAR FillByte)
 /*++
 
 Routine Description:
 
-    Copies data from a single buffer into an MDL chain
+    Fills the buffers contained in the MDL span with a byte value
 
     If the Span extends past the end of the MDL chain, this routine crashes the
     system with a fatal overflow error.
 
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
 Arguments:
 
-    DestinationSpan
-        The span of bytes to write into
+    Span
+        The MDL span to process
 
-    SourceBuffer
-        The buffer to read from
+    FillByte
+        The byte to fill the buffers with
 
 Return Value:
 
@@ -2067,43 +3088,48 @@ Return Value:
 
 --*/
 {
-    return MdlSpanIterateBuffers(
-        DestinationSpan,
-        WriteOperator,
-        &SourceBuffer);
+    if (ShouldUseNonTemporal(Span->Length))
+    {
+        return MdlSpanFillBuffersNonTemporal(Span, FillByte);
+    }
+
+    return MdlSpanFillBuffers(Span, FillByte);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlCopyFlatBufferToMdlChainAtOffset(
-    _In_ MDL* DestinationMdlChain,
-    _In_ SIZE_T DestinationOffset,
-    _In_reads_(CopyLength) UCHAR const* SourceBuffer,
-    _In_ SIZE_T CopyLength)
+MdlChainFillBuffersAtOffsetAuto(
+    _In_ MDL* MdlChain,
+    _In_ SIZE_T Offset,
+    _In_ SIZE_T FillLength,
+    _In_ UCHAR FillByte)
 /*++
 
 Routine Description:
 
-    Copies data from a single buffer into an MDL chain
+    Fills the buffers at some subset of an MDL chain with a byte value
 
-    If the DestinationOffset plus CopyLength is greater than the total length
-    of the MDL chain, this routine crashes the system wtih a fatal overflow
-    error.
+    If Offset plus FillLength extends past the end of the MDL chain, this
+    routine crashes the system with a fatal overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
 
 Arguments:
 
-    DestinationMdlChain
-        The MDL chain to write into
+    MdlChain
+        The chain of MDLs to process
 
-    DestinationOffset
-        The byte offset at which to begin writing into
+    Offset
+        The offset into the MDL chain at which to begin writing the fill pattern
 
-    SourceBuffer
-        The buffer to read from
+    FillLength
+        The number of bytes to write
 
-    CopyLength
-        The number of bytes to copy
+    FillByte
+        The byte to fill the buffers with
 
 Return Value:
 
@@ -2115,24 +3141,37 @@ Return Value:
 
 --*/
 {
-    MDL_SPAN Destination = { { 0 } };
-    Destination.Start.Mdl = DestinationMdlChain;
-    Destination.Start.Offset = DestinationOffset;
-    Destination.Length = CopyLength;
+    MDL_SPAN Span = { { 0 } };
+    Span.Start.Mdl = MdlChain;
+    Span.Start.Offset = Offset;
+    Span.Length = FillLength;
 
-    return MdlCopyFlatBufferToMdlSpan(
-        &Destination,
-        SourceBuffer);
+    return MdlSpanFillBuffersAuto(&Span, FillByte);
 }
 
-#define ReadOperator _MdlPrivate_ReadOperator
-MDL_BUFFER_OPERATOR ReadOperator;
+#define FILL_PATTERN_CONTEXT_t _MdlPrivate_FILL_PATTERN_CONTEXT_t
+#define FILL_PATTERN_CONTEXT _MdlPrivate_FILL_PATTERN_CONTEXT
 
-_Use_decl_annotations_
+typedef struct FILL_PATTERN_CONTEXT_t
+{
+    // The pattern, repeated out to 32 bytes. Because the pattern length
+    // divides 16, the 16 bytes that start at Pattern + Phase are the pattern
+    // rotated by Phase.
+    UCHAR Pattern[32];
+
+    // The position in Pattern of the next byte to write, from 0 to 15. This
+    // carries the phase of the pattern from one buffer to the next.
+    SIZE_T Phase;
+} FILL_PATTERN_CONTEXT;
+
+#define InitializeFillPattern _MdlPrivate_InitializeFillPattern
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
 inline
-NTSTATUS ReadOperator(
-    PVOID OperatorContext,
-    MDL_SPAN const* Span)
+NTSTATUS InitializeFillPattern(
+    _Out_ FILL_PATTERN_CONTEXT* Context,
+    _In_reads_bytes_(PatternLength) UCHAR const* Pattern,
+    _In_ SIZE_T PatternLength)
 /*++
 
 Routine Description:
@@ -2141,125 +3180,113 @@ Routine Description:
 
 --*/
 {
-    UCHAR** Destination = (UCHAR**)OperatorContext;
-
-    UCHAR const* Buffer = MDL_MAP_CONST_BUFFER(Span->Start.Mdl);
-    if (!Buffer)
+    switch (PatternLength)
     {
-        return STATUS_INSUFFICIENT_RESOURCES;
+    case 1:
+    case 2:
+    case 4:
+    case 8:
+    case 16:
+        break;
+
+    default:
+        return STATUS_INVALID_PARAMETER;
     }
 
-    RtlCopyMemory(
-        *Destination,
-        Buffer + Span->Start.Offset,
-        Span->Length);
+    for (SIZE_T i = 0; i < sizeof(Context->Pattern); i++)
+    {
+        Context->Pattern[i] = Pattern[i & (PatternLength - 1)];
+    }
 
-    *Destination += Span->Length;
+    Context->Phase = 0;
 
     return STATUS_SUCCESS;
 }
 
+#define FillWithPattern _MdlPrivate_FillWithPattern
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
-NTSTATUS
-MdlCopyMdlSpanToFlatBuffer(
-    _Out_writes_(Source->Length) UCHAR* DestinationBuffer,
-    _In_ MDL_SPAN const* Source)
+void FillWithPattern(
+    _Out_writes_bytes_(Length) UCHAR* Buffer,
+    _In_ SIZE_T Length,
+    _Inout_ FILL_PATTERN_CONTEXT* Context,
+    _In_ BOOLEAN NonTemporal)
 /*++
 
 Routine Description:
 
-    Copies data from an MDL span into a buffer
-
-    If the Span extends past the end of the MDL chain, this routine crashes the
-    system with a fatal overflow error.
-
-Arguments:
-
-    DestinationBuffer
-        The buffer to write into
-
-    Source
-        The MDL span to read from
-
-Return Value:
-
-    STATUS_SUCCESS
-        Every buffer was processed successfully
+    Implementation detail - do not invoke this routine directly
 
-    STATUS_INSUFFICIENT_RESOURCES
-        The system was unable to map an MDL into system address space
+    Writes the pattern to a buffer, starting at the phase left behind by the
+    previous buffer. Bytes up to the first 16-byte boundary are written one
+    at a time; the rest of the buffer is written with 16-byte stores.
 
 --*/
 {
-    return MdlSpanIterateBuffers(
-        Source,
-        ReadOperator,
-        &DestinationBuffer);
-}
-
-_IRQL_requires_max_(DISPATCH_LEVEL)
-inline
-NTSTATUS
-MdlCopyMdlChainAtOffsetToFlatBuffer(
-    _Out_writes_(CopyLength) UCHAR* DestinationBuffer,
-    _In_ MDL* SourceMdlChain,
-    _In_ SIZE_T SourceOffset,
-    _In_ SIZE_T CopyLength)
-/*++
-
-Routine Description:
-
-    Copies data from an MDL chain into a buffer
+    SIZE_T Phase = Context->Phase;
+    SIZE_T Offset = 0;
 
-    If SourceOffset plus CopyLength is greater than the total length of the MDL
-    chain, this routine crashes the system with a fatal overflow error.
-
-Arguments:
-
-    DestinationBuffer
-        The buffer to write into
+    SIZE_T Head = (SIZE_T)(0 - (ULONG_PTR)Buffer) & 15;
+    if (Head > Length)
+    {
+        Head = Length;
+    }
 
-    SourceMdlChain
-        The MDL chain to read from
+    for (; Offset < Head; Offset++)
+    {
+        Buffer[Offset] = Context->Pattern[Phase];
+        Phase = (Phase + 1) & 15;
+    }
 
-    SourceOffset
-        The offset into the MDL chain at which to begin reading
+#if defined(_M_AMD64)
+    __m128i const Bytes = _mm_loadu_si128((__m128i const*)(Context->Pattern + Phase));
 
-    CopyLength
-        The number of bytes to copy
+    if (NonTemporal)
+    {
+        for (; Length - Offset >= sizeof(__m128i); Offset += sizeof(__m128i))
+        {
+            _mm_stream_si128((__m128i*)(Buffer + Offset), Bytes);
+        }
 
-Return Value:
+        _mm_sfence();
+    }
+    else
+    {
+        for (; Length - Offset >= sizeof(__m128i); Offset += sizeof(__m128i))
+        {
+            _mm_store_si128((__m128i*)(Buffer + Offset), Bytes);
+        }
+    }
+#else
+    UNREFERENCED_PARAMETER(NonTemporal);
 
-    STATUS_SUCCESS
-        Every buffer was processed successfully
+    UCHAR const* const Bytes = Context->Pattern + Phase;
 
-    STATUS_INSUFFICIENT_RESOURCES
-        The system was unable to map an MDL into system address space
+    for (; Length - Offset >= 16; Offset += 16)
+    {
+        RtlCopyMemory(Buffer + Offset, Bytes, 16);
+    }
+#endif
 
---*/
-{
-    MDL_SPAN Source = { { 0 } };
-    Source.Start.Mdl = SourceMdlChain;
-    Source.Start.Offset = SourceOffset;
-    Source.Length = CopyLength;
+    for (; Offset < Length; Offset++)
+    {
+        Buffer[Offset] = Context->Pattern[Phase];
+        Phase = (Phase + 1) & 15;
+    }
 
-    return MdlCopyMdlSpanToFlatBuffer(
-        DestinationBuffer,
-        &Source);
+    Context->Phase = Phase;
 }
 
-#define PairwiseCopy _MdlPrivate_PairwiseCopy
+#define FillPatternOperator _MdlPrivate_FillPatternOperator
 
-MDL_BUFFER_PAIRWISE_OPERATOR PairwiseCopy;
+MDL_BUFFER_OPERATOR FillPatternOperator;
 
 _Use_decl_annotations_
 inline
-NTSTATUS PairwiseCopy(
+NTSTATUS FillPatternOperator(
     PVOID OperatorContext,
-    MDL_POINTER const* MdlPointer1,
-    MDL_POINTER const* MdlPointer2,
-    SIZE_T BufferLength)
+    MDL_SPAN const* Span)
 /*++
 
 Routine Description:
@@ -2268,20 +3295,17 @@ Routine Description:
 
 --*/
 {
-    UNREFERENCED_PARAMETER(OperatorContext);
-
-    UCHAR* DestinationBuffer = MDL_MAP_BUFFER(MdlPointer1->Mdl);
-    UCHAR const* SourceBuffer = MDL_MAP_CONST_BUFFER(MdlPointer2->Mdl);
-
-    if (!SourceBuffer || !DestinationBuffer)
+    UCHAR* Buffer = MDL_MAP_BUFFER(Span->Start.Mdl);
+    if (!Buffer)
     {
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    RtlCopyMemory(
-        DestinationBuffer + MdlPointer1->Offset,
-        SourceBuffer + MdlPointer2->Offset,
-        BufferLength);
+    FillWithPattern(
+        Buffer + Span->Start.Offset,
+        Span->Length,
+        (FILL_PATTERN_CONTEXT*)OperatorContext,
+        FALSE);
 
     return STATUS_SUCCESS;
 }
@@ -2289,166 +3313,179 @@ Routine Description:
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlCopyMdlPointerToMdlPointer(
-    _In_ MDL_POINTER const* Destination,
-    _In_ MDL_POINTER const* Source,
-    _In_ SIZE_T CopyLength)
+MdlChainFillBuffersWithPattern(
+    _In_ MDL* MdlChain,
+    _In_reads_bytes_(PatternLength) UCHAR const* Pattern,
+    _In_ SIZE_T PatternLength)
 /*++
 
 Routine Description:
 
-    Copies data from one MDL chain to another MDL chain
+    Fills the buffers associated with an MDL chain with a repeating pattern
 
-    If CopyLength plus either pointer's Offset is greater than the length
-    of that pointer's MDL chain, this routine crashes the system with a fatal
-    overflow error.
+    The pattern continues across MDL boundaries without restarting, so the
+    byte at offset N into the chain is Pattern[N % PatternLength].
 
 Arguments:
 
-    Destination
-        A pointer at which to begin writing
+    MdlChain
+        The MDL chain to process
 
-    Source
-        A pointer at which to begin reading
+    Pattern
+        The bytes to repeat
 
-    CopyLength
-        The number of bytes to copy
+    PatternLength
+        The length of Pattern, in bytes. Must be 1, 2, 4, 8, or 16.
 
 Return Value:
 
     STATUS_SUCCESS
         Every buffer was processed successfully
 
+    STATUS_INVALID_PARAMETER
+        PatternLength is not supported; no buffers were modified
+
     STATUS_INSUFFICIENT_RESOURCES
         The system was unable to map an MDL into system address space
 
 --*/
 {
-    return MdlPairwiseIterateBuffers(
-        Destination,
-        Source,
-        CopyLength,
-        PairwiseCopy,
-        NULL);
+    FILL_PATTERN_CONTEXT Context;
+    NTSTATUS const Status = InitializeFillPattern(&Context, Pattern, PatternLength);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    return MdlChainIterateBuffers(
+        MdlChain,
+        FillPatternOperator,
+        &Context);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlCopyMdlPointerToMdlPointerUpdateInputs(
-    _Inout_ MDL_POINTER* Destination,
-    _Inout_ MDL_POINTER* Source,
-    _In_ SIZE_T CopyLength)
+MdlSpanFillBuffersWithPattern(
+    _In_ MDL_SPAN const* Span,
+    _In_reads_bytes_(PatternLength) UCHAR const* Pattern,
+    _In_ SIZE_T PatternLength)
 /*++
 
 Routine Description:
 
-    Copies data from one MDL chain to another MDL chain
+    Fills the buffers contained in the MDL span with a repeating pattern
 
-    If CopyLength plus either pointer's Offset is greater than the length
-    of that pointer's MDL chain, this routine crashes the system with a fatal
-    overflow error.
+    The pattern starts at the beginning of the span and continues across MDL
+    boundaries without restarting, so the byte at offset N into the span is
+    Pattern[N % PatternLength].
 
-    This routine updates the MDL_POINTER parameters in-place to point to the
-    end of the buffer that was processed. If the entire buffer was processed,
-    the MDL_POINTER is set to a NULL Mdl with 0 Offset.
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
 
 Arguments:
 
-    Destination
-        A pointer at which to begin writing
+    Span
+        The MDL span to process
 
-    Source
-        A pointer at which to begin reading
+    Pattern
+        The bytes to repeat
 
-    CopyLength
-        The number of bytes to copy
+    PatternLength
+        The length of Pattern, in bytes. Must be 1, 2, 4, 8, or 16.
 
 Return Value:
 
     STATUS_SUCCESS
         Every buffer was processed successfully
 
+    STATUS_INVALID_PARAMETER
+        PatternLength is not supported; no buffers were modified
+
     STATUS_INSUFFICIENT_RESOURCES
         The system was unable to map an MDL into system address space
 
 --*/
 {
-    return MdlPairwiseIterateBuffersUpdateInputs(
-        Destination,
-        Source,
-        CopyLength,
-        PairwiseCopy,
-        NULL);
+    FILL_PATTERN_CONTEXT Context;
+    NTSTATUS const Status = InitializeFillPattern(&Context, Pattern, PatternLength);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    return MdlSpanIterateBuffers(
+        Span,
+        FillPatternOperator,
+        &Context);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlCopyMdlChainToMdlChainAtOffset(
-    _In_ MDL* DestinationMdlChain,
-    _In_ SIZE_T DestinationOffset,
-    _In_ MDL* SourceMdlChain,
-    _In_ SIZE_T SourceOffset,
-    _In_ SIZE_T CopyLength)
+MdlChainFillBuffersAtOffsetWithPattern(
+    _In_ MDL* MdlChain,
+    _In_ SIZE_T Offset,
+    _In_ SIZE_T FillLength,
+    _In_reads_bytes_(PatternLength) UCHAR const* Pattern,
+    _In_ SIZE_T PatternLength)
 /*++
 
 Routine Description:
 
-    Copies data from one MDL chain to another MDL chain
+    Fills the buffers at some subset of an MDL chain with a repeating pattern
 
-    If CopyLength plus either Offset is greater than the length of the
-    corresponding MDL chain, this routine crashes the system with a fatal
-    overflow error.
+    The pattern starts at Offset, so the byte at Offset + N is
+    Pattern[N % PatternLength].
+
+    If Offset plus FillLength extends past the end of the MDL chain, this
+    routine crashes the system with a fatal overflow error.
 
 Arguments:
 
-    DestinationMdlChain
-        The MDL chain to write into
+    MdlChain
+        The chain of MDLs to process
 
-    DestinationOffset
-        The byte offset at which to begin writing
+    Offset
+        The offset into the MDL chain at which to begin writing the pattern
 
-    SourceMdlChain
-        The MDL chain to read from
+    FillLength
+        The number of bytes to write
 
-    SourceOffset
-        The byte offset at which to begin reading
+    Pattern
+        The bytes to repeat
 
-    CopyLength
-        The number of bytes to copy
+    PatternLength
+        The length of Pattern, in bytes. Must be 1, 2, 4, 8, or 16.
 
 Return Value:
 
     STATUS_SUCCESS
         Every buffer was processed successfully
 
+    STATUS_INVALID_PARAMETER
+        PatternLength is not supported; no buffers were modified
+
     STATUS_INSUFFICIENT_RESOURCES
         The system was unable to map an MDL into system address space
 
 --*/
 {
-    MDL_POINTER Source = { 0 };
-    Source.Mdl = SourceMdlChain;
-    Source.Offset = SourceOffset;
-
-    MDL_POINTER Destination = { 0 };
-    Destination.Mdl = DestinationMdlChain;
-    Destination.Offset = DestinationOffset;
+    MDL_SPAN Span = { { 0 } };
+    Span.Start.Mdl = MdlChain;
+    Span.Start.Offset = Offset;
+    Span.Length = FillLength;
 
-    return MdlCopyMdlPointerToMdlPointerUpdateInputs(
-        &Destination,
-        &Source,
-        CopyLength);
+    return MdlSpanFillBuffersWithPattern(&Span, Pattern, PatternLength);
 }
 
-#define WriteOperatorNonTemporal _MdlPrivate_WriteOperatorNonTemporal
+#define FillPatternOperatorNonTemporal _MdlPrivate_FillPatternOperatorNonTemporal
 
-MDL_BUFFER_OPERATOR WriteOperatorNonTemporal;
+MDL_BUFFER_OPERATOR FillPatternOperatorNonTemporal;
 
 _Use_decl_annotations_
 inline
-NTSTATUS WriteOperatorNonTemporal(
+NTSTATUS FillPatternOperatorNonTemporal(
     PVOID OperatorContext,
     MDL_SPAN const* Span)
 /*++
@@ -2459,16 +3496,17 @@ Routine Description:
 
 --*/
 {
-    UCHAR const** Source = (UCHAR const**)OperatorContext;
-
     UCHAR* Buffer = MDL_MAP_BUFFER(Span->Start.Mdl);
     if (!Buffer)
     {
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    RtlCopyMemoryNonTemporal(Buffer + Span->Start.Offset, *Source, Span->Length);
-    *Source += Span->Length;
+    FillWithPattern(
+        Buffer + Span->Start.Offset,
+        Span->Length,
+        (FILL_PATTERN_CONTEXT*)OperatorContext,
+        TRUE);
 
     return STATUS_SUCCESS;
 }
@@ -2476,443 +3514,468 @@ Routine Description:
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlCopyFlatBufferToMdlSpanNonTemporal(
-    _In_ MDL_SPAN const* DestinationSpan,
-    _In_reads_(DestinationSpan->Length) UCHAR const* SourceBuffer)
+MdlChainFillBuffersWithPatternNonTemporal(
+    _In_ MDL* MdlChain,
+    _In_reads_bytes_(PatternLength) UCHAR const* Pattern,
+    _In_ SIZE_T PatternLength)
 /*++
 
 Routine Description:
 
-    Copies data from a single buffer into an MDL chain
+    Fills the buffers associated with an MDL chain with a repeating pattern
 
-    If the Span extends past the end of the MDL chain, this routine crashes the
-    system with a fatal overflow error.
+    The pattern continues across MDL boundaries without restarting, so the
+    byte at offset N into the chain is Pattern[N % PatternLength].
 
     If permitted by the processor, this routine uses non-temporal instructions
     to avoid placing the MDL buffers into the processor's data cache.
 
 Arguments:
 
-    DestinationSpan
-        The span of bytes to write into
+    MdlChain
+        The MDL chain to process
 
-    SourceBuffer
-        The buffer to read from
+    Pattern
+        The bytes to repeat
+
+    PatternLength
+        The length of Pattern, in bytes. Must be 1, 2, 4, 8, or 16.
 
 Return Value:
 
     STATUS_SUCCESS
         Every buffer was processed successfully
 
+    STATUS_INVALID_PARAMETER
+        PatternLength is not supported; no buffers were modified
+
     STATUS_INSUFFICIENT_RESOURCES
         The system was unable to map an MDL into system address space
 
 --*/
 {
-    return MdlSpanIterateBuffers(
-        DestinationSpan,
-        WriteOperatorNonTemporal,
-        &SourceBuffer);
+    FILL_PATTERN_CONTEXT Context;
+    NTSTATUS const Status = InitializeFillPattern(&Context, Pattern, PatternLength);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
+
+    return MdlChainIterateBuffers(
+        MdlChain,
+        FillPatternOperatorNonTemporal,
+        &Context);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlCopyFlatBufferToMdlChainAtOffsetNonTemporal(
-    _In_ MDL* DestinationMdlChain,
-    _In_ SIZE_T DestinationOffset,
-    _In_reads_(CopyLength) UCHAR const* SourceBuffer,
-    _In_ SIZE_T CopyLength)
+MdlSpanFillBuffersWithPatternNonTemporal(
+    _In_ MDL_SPAN const* Span,
+    _In_reads_bytes_(PatternLength) UCHAR const* Pattern,
+    _In_ SIZE_T PatternLength)
 /*++
 
 Routine Description:
 
-    Copies data from a single buffer into an MDL chain
+    Fills the buffers contained in the MDL span with a repeating pattern
 
-    If the DestinationOffset plus CopyLength is greater than the total length
-    of the MDL chain, this routine crashes the system wtih a fatal overflow
-    error.
+    The pattern starts at the beginning of the span and continues across MDL
+    boundaries without restarting, so the byte at offset N into the span is
+    Pattern[N % PatternLength].
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
 
     If permitted by the processor, this routine uses non-temporal instructions
     to avoid placing the MDL buffers into the processor's data cache.
 
 Arguments:
 
-    DestinationMdlChain
-        The MDL chain to write into
-
-    DestinationOffset
-        The byte offset at which to begin writing into
+    Span
+        The MDL span to process
 
-    SourceBuffer
-        The buffer to read from
+    Pattern
+        The bytes to repeat
 
-    CopyLength
-        The number of bytes to copy
+    PatternLength
+        The length of Pattern, in bytes. Must be 1, 2, 4, 8, or 16.
 
 Return Value:
 
     STATUS_SUCCESS
         Every buffer was processed successfully
 
+    STATUS_INVALID_PARAMETER
+        PatternLength is not supported; no buffers were modified
+
     STATUS_INSUFFICIENT_RESOURCES
         The system was unable to map an MDL into system address space
 
 --*/
 {
-    MDL_SPAN Destination = { { 0 } };
-    Destination.Start.Mdl = DestinationMdlChain;
-    Destination.Start.Offset = DestinationOffset;
-    Destination.Length = CopyLength;
-
-    return MdlCopyFlatBufferToMdlSpanNonTemporal(
-        &Destination,
-        SourceBuffer);
-}
-
-#define ReadOperatorNonTemporal _MdlPrivate_ReadOperatorNonTemporal
-MDL_BUFFER_OPERATOR ReadOperatorNonTemporal;
-
-_Use_decl_annotations_
-inline
-NTSTATUS ReadOperatorNonTemporal(
-    PVOID OperatorContext,
-    MDL_SPAN const* Span)
-/*++
-
-Routine Description:
-
-    Implementation detail - do not invoke this routine directly
-
---*/
-{
-    UCHAR** Destination = (UCHAR**)OperatorContext;
-
-    UCHAR const* Buffer = MDL_MAP_CONST_BUFFER(Span->Start.Mdl);
-    if (!Buffer)
+    FILL_PATTERN_CONTEXT Context;
+    NTSTATUS const Status = InitializeFillPattern(&Context, Pattern, PatternLength);
+    if (!NT_SUCCESS(Status))
     {
-        return STATUS_INSUFFICIENT_RESOURCES;
+        return Status;
     }
 
-    RtlCopyMemoryNonTemporal(
-        *Destination,
-        Buffer + Span->Start.Offset,
-        Span->Length);
-
-    *Destination += Span->Length;
-
-    return STATUS_SUCCESS;
+    return MdlSpanIterateBuffers(
+        Span,
+        FillPatternOperatorNonTemporal,
+        &Context);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlCopyMdlSpanToFlatBufferNonTemporal(
-    _Out_writes_(Source->Length) UCHAR* DestinationBuffer,
-    _In_ MDL_SPAN const* Source)
+MdlChainFillBuffersAtOffsetWithPatternNonTemporal(
+    _In_ MDL* MdlChain,
+    _In_ SIZE_T Offset,
+    _In_ SIZE_T FillLength,
+    _In_reads_bytes_(PatternLength) UCHAR const* Pattern,
+    _In_ SIZE_T PatternLength)
 /*++
 
 Routine Description:
 
-    Copies data from an MDL span into a buffer
+    Fills the buffers at some subset of an MDL chain with a repeating pattern
 
-    If the Span extends past the end of the MDL chain, this routine crashes the
-    system with a fatal overflow error.
+    The pattern starts at Offset, so the byte at Offset + N is
+    Pattern[N % PatternLength].
+
+    If Offset plus FillLength extends past the end of the MDL chain, this
+    routine crashes the system with a fatal overflow error.
 
     If permitted by the processor, this routine uses non-temporal instructions
     to avoid placing the MDL buffers into the processor's data cache.
 
 Arguments:
 
-    DestinationBuffer
-        The buffer to write into
+    MdlChain
+        The chain of MDLs to process
 
-    Source
-        The MDL span to read from
+    Offset
+        The offset into the MDL chain at which to begin writing the pattern
+
+    FillLength
+        The number of bytes to write
+
+    Pattern
+        The bytes to repeat
+
+    PatternLength
+        The length of Pattern, in bytes. Must be 1, 2, 4, 8, or 16.
 
 Return Value:
 
     STATUS_SUCCESS
         Every buffer was processed successfully
 
+    STATUS_INVALID_PARAMETER
+        PatternLength is not supported; no buffers were modified
+
     STATUS_INSUFFICIENT_RESOURCES
         The system was unable to map an MDL into system address space
 
 --*/
 {
-    return MdlSpanIterateBuffers(
-        Source,
-        ReadOperatorNonTemporal,
-        &DestinationBuffer);
+    MDL_SPAN Span = { { 0 } };
+    Span.Start.Mdl = MdlChain;
+    Span.Start.Offset = Offset;
+    Span.Length = FillLength;
+
+    return MdlSpanFillBuffersWithPatternNonTemporal(&Span, Pattern, PatternLength);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlCopyMdlChainAtOffsetToFlatBufferNonTemporal(
-    _Out_writes_(CopyLength) UCHAR* DestinationBuffer,
-    _In_ MDL* SourceMdlChain,
-    _In_ SIZE_T SourceOffset,
-    _In_ SIZE_T CopyLength)
+MdlChainFillBuffersWithPatternAuto(
+    _In_ MDL* MdlChain,
+    _In_reads_bytes_(PatternLength) UCHAR const* Pattern,
+    _In_ SIZE_T PatternLength)
 /*++
 
 Routine Description:
 
-    Copies data from an MDL chain into a buffer
+    Fills the buffers associated with an MDL chain with a repeating pattern
 
-    If SourceOffset plus CopyLength is greater than the total length of the MDL
-    chain, this routine crashes the system with a fatal overflow error.
+    The pattern continues across MDL boundaries without restarting, so the
+    byte at offset N into the chain is Pattern[N % PatternLength].
 
-    If permitted by the processor, this routine uses non-temporal instructions
-    to avoid placing the MDL buffers into the processor's data cache.
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
 
 Arguments:
 
-    DestinationBuffer
-        The buffer to write into
-
-    SourceMdlChain
-        The MDL chain to read from
+    MdlChain
+        The MDL chain to process
 
-    SourceOffset
-        The offset into the MDL chain at which to begin reading
+    Pattern
+        The bytes to repeat
 
-    CopyLength
-        The number of bytes to copy
+    PatternLength
+        The length of Pattern, in bytes. Must be 1, 2, 4, 8, or 16.
 
 Return Value:
 
     STATUS_SUCCESS
         Every buffer was processed successfully
 
+    STATUS_INVALID_PARAMETER
+        PatternLength is not supported; no buffers were modified
+
     STATUS_INSUFFICIENT_RESOURCES
         The system was unable to map an MDL into system address space
 
 --*/
 {
-    MDL_SPAN Source = { { 0 } };
-    Source.Start.Mdl = SourceMdlChain;
-    Source.Start.Offset = SourceOffset;
-    Source.Length = CopyLength;
-
-    return MdlCopyMdlSpanToFlatBufferNonTemporal(
-        DestinationBuffer,
-        &Source);
-}
+    FILL_PATTERN_CONTEXT PatternContext;
+    NTSTATUS const Status = InitializeFillPattern(&PatternContext, Pattern, PatternLength);
+    if (!NT_SUCCESS(Status))
+    {
+        return Status;
+    }
 
-#define PairwiseCopyNonTemporal _MdlPrivate_PairwiseCopyNonTemporal
+    AUTO_OPERATOR_CONTEXT Context;
+    InitializeAutoOperator(&Context, FillPatternOperator, FillPatternOperatorNonTemporal, &PatternContext);
 
-MDL_BUFFER_PAIRWISE_OPERATOR PairwiseCopyNonTemporal;
+    return MdlChainIterateBuffers(MdlChain, AutoOperator, &Context);
+}
 
-_Use_decl_annotations_
+_IRQL_requires_max_(DISPATCH_LEVEL)
 inline
-NTSTATUS PairwiseCopyNonTemporal(
-    PVOID OperatorContext,
-    MDL_POINTER const* MdlPointer1,
-    MDL_POINTER const* MdlPointer2,
-    SIZE_T BufferLength)
+NTSTATUS
+MdlSpanFillBuffersWithPatternAuto(
+    _In_ MDL_SPAN const* Span,
+    _In_reads_bytes_(PatternLength) UCHAR const* Pattern,
+    _In_ SIZE_T PatternLength)
 /*++
 
 Routine Description:
 
-    Implementation detail - do not invoke this routine directly
+    Fills the buffers contained in the MDL span with a repeating pattern
 
---*/
-{
-    UNREFERENCED_PARAMETER(OperatorContext);
+    The pattern starts at the beginning of the span and continues across MDL
+    boundaries without restarting, so the byte at offset N into the span is
+    Pattern[N % PatternLength].
 
-    UCHAR* DestinationBuffer = MDL_MAP_BUFFER(MdlPointer1->Mdl);
-    UCHAR const* SourceBuffer = MDL_MAP_CONST_BUFFER(MdlPointer2->Mdl);
-
-    if (!SourceBuffer || !DestinationBuffer)
-    {
-        return STATUS_INSUFFICIENT_RESOURCES;
-    }
-
-    RtlCopyMemoryNonTemporal(
-        DestinationBuffer + MdlPointer1->Offset,
-        SourceBuffer + MdlPointer2->Offset,
-        BufferLength);
-
-    return STATUS_SUCCESS;
-}
-
-_IRQL_requires_max_(DISPATCH_LEVEL)
-inline
-NTSTATUS
-MdlCopyMdlPointerToMdlPointerNonTemporal(
-    _In_ MDL_POINTER const* Destination,
-    _In_ MDL_POINTER const* Source,
-    _In_ SIZE_T CopyLength)
-/*++
-
-Routine Description:
-
-    Copies data from one MDL chain to another MDL chain
-
-    If CopyLength plus either pointer's Offset is greater than the length
-    of that pointer's MDL chain, this routine crashes the system with a fatal
-    overflow error.
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
 
-    If permitted by the processor, this routine uses non-temporal instructions
-    to avoid placing the MDL buffers into the processor's data cache.
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
 
 Arguments:
 
-    Destination
-        A pointer at which to begin writing
+    Span
+        The MDL span to process
 
-    Source
-        A pointer at which to begin reading
+    Pattern
+        The bytes to repeat
 
-    CopyLength
-        The number of bytes to copy
+    PatternLength
+        The length of Pattern, in bytes. Must be 1, 2, 4, 8, or 16.
 
 Return Value:
 
     STATUS_SUCCESS
         Every buffer was processed successfully
 
+    STATUS_INVALID_PARAMETER
+        PatternLength is not supported; no buffers were modified
+
     STATUS_INSUFFICIENT_RESOURCES
         The system was unable to map an MDL into system address space
 
 --*/
 {
-    return MdlPairwiseIterateBuffers(
-        Destination,
-        Source,
-        CopyLength,
-        PairwiseCopyNonTemporal,
-        NULL);
+    if (ShouldUseNonTemporal(Span->Length))
+    {
+        return MdlSpanFillBuffersWithPatternNonTemporal(Span, Pattern, PatternLength);
+    }
+
+    return MdlSpanFillBuffersWithPattern(Span, Pattern, PatternLength);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlCopyMdlPointerToMdlPointerUpdateInputsNonTemporal(
-    _Inout_ MDL_POINTER* Destination,
-    _Inout_ MDL_POINTER* Source,
-    _In_ SIZE_T CopyLength)
+MdlChainFillBuffersAtOffsetWithPatternAuto(
+    _In_ MDL* MdlChain,
+    _In_ SIZE_T Offset,
+    _In_ SIZE_T FillLength,
+    _In_reads_bytes_(PatternLength) UCHAR const* Pattern,
+    _In_ SIZE_T PatternLength)
 /*++
 
 Routine Description:
 
-    Copies data from one MDL chain to another MDL chain
+    Fills the buffers at some subset of an MDL chain with a repeating pattern
 
-    If CopyLength plus either pointer's Offset is greater than the length
-    of that pointer's MDL chain, this routine crashes the system with a fatal
-    overflow error.
+    The pattern starts at Offset, so the byte at Offset + N is
+    Pattern[N % PatternLength].
 
-    This routine updates the MDL_POINTER parameters in-place to point to the
-    end of the buffer that was processed. If the entire buffer was processed,
-    the MDL_POINTER is set to a NULL Mdl with 0 Offset.
+    If Offset plus FillLength extends past the end of the MDL chain, this
+    routine crashes the system with a fatal overflow error.
 
-    If permitted by the processor, this routine uses non-temporal instructions
-    to avoid placing the MDL buffers into the processor's data cache.
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
 
 Arguments:
 
-    Destination
-        A pointer at which to begin writing
+    MdlChain
+        The chain of MDLs to process
 
-    Source
-        A pointer at which to begin reading
+    Offset
+        The offset into the MDL chain at which to begin writing the pattern
 
-    CopyLength
-        The number of bytes to copy
+    FillLength
+        The number of bytes to write
+
+    Pattern
+        The bytes to repeat
+
+    PatternLength
+        The length of Pattern, in bytes. Must be 1, 2, 4, 8, or 16.
 
 Return Value:
 
     STATUS_SUCCESS
         Every buffer was processed successfully
 
+    STATUS_INVALID_PARAMETER
+        PatternLength is not supported; no buffers were modified
+
     STATUS_INSUFFICIENT_RESOURCES
         The system was unable to map an MDL into system address space
 
 --*/
 {
-    return MdlPairwiseIterateBuffersUpdateInputs(
-        Destination,
-        Source,
-        CopyLength,
-        PairwiseCopyNonTemporal,
-        NULL);
+    MDL_SPAN Span = { { 0 } };
+    Span.Start.Mdl = MdlChain;
+    Span.Start.Offset = Offset;
+    Span.Length = FillLength;
+
+    return MdlSpanFillBuffersWithPatternAuto(&Span, Pattern, PatternLength);
 }
 
+#define PREFETCH_COPY_CONTEXT_t _MdlPrivate_PREFETCH_COPY_CONTEXT_t
+#define PREFETCH_COPY_CONTEXT _MdlPrivate_PREFETCH_COPY_CONTEXT
+
+typedef struct PREFETCH_COPY_CONTEXT_t
+{
+    // The next source byte to prefetch
+    MDL_POINTER Prefetch;
+
+    // The number of source bytes before Prefetch, and before the next byte
+    // to copy, relative to the start of the copy
+    SIZE_T Prefetched;
+    SIZE_T Copied;
+
+    // The length of the entire copy; nothing past it is prefetched
+    SIZE_T CopyLength;
+} PREFETCH_COPY_CONTEXT;
+
+#define InitializePrefetchCopy _MdlPrivate_InitializePrefetchCopy
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
-NTSTATUS
-MdlCopyMdlChainToMdlChainAtOffsetNonTemporal(
-    _In_ MDL* DestinationMdlChain,
-    _In_ SIZE_T DestinationOffset,
-    _In_ MDL* SourceMdlChain,
-    _In_ SIZE_T SourceOffset,
+void InitializePrefetchCopy(
+    _Out_ PREFETCH_COPY_CONTEXT* Context,
+    _In_ MDL_POINTER const* Source,
     _In_ SIZE_T CopyLength)
 /*++
 
 Routine Description:
 
-    Copies data from one MDL chain to another MDL chain
+    Implementation detail - do not invoke this routine directly
 
-    If CopyLength plus either Offset is greater than the length of the
-    corresponding MDL chain, this routine crashes the system with a fatal
-    overflow error.
+--*/
+{
+    Context->Prefetch = *Source;
+    Context->Prefetched = 0;
+    Context->Copied = 0;
+    Context->CopyLength = CopyLength;
+}
 
-    If permitted by the processor, this routine uses non-temporal instructions
-    to avoid placing the MDL buffers into the processor's data cache.
+#define PrefetchSource _MdlPrivate_PrefetchSource
 
-Arguments:
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void PrefetchSource(
+    _Inout_ PREFETCH_COPY_CONTEXT* Context,
+    _In_ SIZE_T SkipUntil,
+    _In_ SIZE_T PrefetchUntil)
+/*++
 
-    DestinationMdlChain
-        The MDL chain to write into
+Routine Description:
 
-    DestinationOffset
-        The byte offset at which to begin writing
+    Implementation detail - do not invoke this routine directly
 
-    SourceMdlChain
-        The MDL chain to read from
+    Moves the prefetch pointer forward to PrefetchUntil, crossing into later
+    MDLs as needed. Bytes before SkipUntil are about to be copied anyway, so
+    they are passed over without being prefetched.
 
-    SourceOffset
-        The byte offset at which to begin reading
+--*/
+{
+    PrefetchUntil = MinSizeT(PrefetchUntil, Context->CopyLength);
 
-    CopyLength
-        The number of bytes to copy
+    while (Context->Prefetched < PrefetchUntil && Context->Prefetch.Mdl)
+    {
+        MDL* Mdl = Context->Prefetch.Mdl;
+        SIZE_T const MdlLength = MmGetMdlByteCount(Mdl);
 
-Return Value:
+        if (Context->Prefetch.Offset >= MdlLength)
+        {
+            Context->Prefetch.Offset -= MdlLength;
+            Context->Prefetch.Mdl = Mdl->Next;
+            continue;
+        }
 
-    STATUS_SUCCESS
-        Every buffer was processed successfully
+        SIZE_T Length = MinSizeT(
+            MdlLength - Context->Prefetch.Offset,
+            PrefetchUntil - Context->Prefetched);
 
-    STATUS_INSUFFICIENT_RESOURCES
-        The system was unable to map an MDL into system address space
+        if (Context->Prefetched < SkipUntil)
+        {
+            Length = MinSizeT(Length, SkipUntil - Context->Prefetched);
+        }
+        else
+        {
+            UCHAR const* Buffer = MDL_MAP_CONST_BUFFER(Mdl);
 
---*/
-{
-    MDL_POINTER Source = { 0 };
-    Source.Mdl = SourceMdlChain;
-    Source.Offset = SourceOffset;
+            // If the MDL can't be mapped, the copy will fail on it anyway
+            if (Buffer)
+            {
+                Buffer += Context->Prefetch.Offset;
 
-    MDL_POINTER Destination = { 0 };
-    Destination.Mdl = DestinationMdlChain;
-    Destination.Offset = DestinationOffset;
+                for (SIZE_T i = 0; i < Length; i += SYSTEM_CACHE_ALIGNMENT_SIZE)
+                {
+                    MDL_PREFETCH_CACHELINE(Buffer + i);
+                }
+            }
+        }
 
-    return MdlCopyMdlPointerToMdlPointerUpdateInputsNonTemporal(
-        &Destination,
-        &Source,
-        CopyLength);
+        Context->Prefetch.Offset += Length;
+        Context->Prefetched += Length;
+    }
 }
 
-#define PairwiseEqual _MdlPrivate_PairwiseEqual
+#define WriteOperator _MdlPrivate_WriteOperator
 
-MDL_BUFFER_PAIRWISE_OPERATOR PairwiseEqual;
+MDL_BUFFER_OPERATOR WriteOperator;
 
 _Use_decl_annotations_
 inline
-NTSTATUS PairwiseEqual(
+NTSTATUS WriteOperator(
     PVOID OperatorContext,
-    MDL_POINTER const* MdlPointer1,
-    MDL_POINTER const* MdlPointer2,
-    SIZE_T BufferLength)
+    MDL_SPAN const* Span)
 /*++
 
 Routine Description:
@@ -2921,64 +3984,43 @@ Routine Description:
 
 --*/
 {
-    UNREFERENCED_PARAMETER(OperatorContext);
-
-    UCHAR const* Buffer1 = MDL_MAP_CONST_BUFFER(MdlPointer1->Mdl);
-    UCHAR const* Buffer2 = MDL_MAP_CONST_BUFFER(MdlPointer2->Mdl);
+    UCHAR const** Source = (UCHAR const**)OperatorContext;
 
-    if (!Buffer1 || !Buffer2)
+    UCHAR* Buffer = MDL_MAP_BUFFER(Span->Start.Mdl);
+    if (!Buffer)
     {
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    BOOLEAN IsEqual = RtlEqualMemory(
-        Buffer1 + MdlPointer1->Offset,
-        Buffer2 + MdlPointer2->Offset,
-        BufferLength);
+    RtlCopyMemory(Buffer + Span->Start.Offset, *Source, Span->Length);
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_TEMPORAL, Span->Length));
+    *Source += Span->Length;
 
-    if (IsEqual)
-    {
-        // Keep going
-        return STATUS_SUCCESS;
-    }
-    else
-    {
-        // At least one difference was found; stop iterating the MDL chain now
-        return STATUS_STOP_ITERATION;
-    }
+    return STATUS_SUCCESS;
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlEqualBufferContents(
-    _In_ MDL_POINTER const* MdlPointer1,
-    _In_ MDL_POINTER const* MdlPointer2,
-    _In_ SIZE_T ComparisonLength,
-    _Out_ BOOLEAN* AreBuffersEqual)
+MdlCopyFlatBufferToMdlSpan(
+    _In_ MDL_SPAN const* DestinationSpan,
+    _In_reads_(DestinationSpan->Length) UCHAR const* SourceBuffer)
 /*++
 
 Routine Description:
 
-    Determines if the contents of two MDL chains' buffers are bytewise equal
+    Copies data from a single buffer into an MDL chain
 
-    If ComparisonLength plus either pointer's Offset is greater than the total
-    length of the corresponding MDL chain, this routine crashes the system with
-    a fatal overflow error.
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
 
 Arguments:
 
-    MdlPointer1
-        The first MDL chain to compare
-
-    MdlPointer2
-        The second MDL chain to compare
-
-    ComparisonLength
-        The number of bytes to compare
+    DestinationSpan
+        The span of bytes to write into
 
-    AreBuffersEqual
-        Receives TRUE if the buffers are exactly equal, or FALSE otherwise
+    SourceBuffer
+        The buffer to read from
 
 Return Value:
 
@@ -2990,65 +4032,43 @@ Return Value:
 
 --*/
 {
-    NTSTATUS NtStatus = MdlPairwiseIterateBuffers(
-        MdlPointer1,
-        MdlPointer2,
-        ComparisonLength,
-        PairwiseEqual,
-        NULL);
-
-    if (STATUS_SUCCESS == NtStatus)
-    {
-        *AreBuffersEqual = TRUE;
-        return STATUS_SUCCESS;
-    }
-    else if (STATUS_STOP_ITERATION == NtStatus)
-    {
-        *AreBuffersEqual = FALSE;
-        return STATUS_SUCCESS;
-    }
-    else
-    {
-        *AreBuffersEqual = FALSE;
-        return NtStatus;
-    }
+    return MdlSpanIterateBuffers(
+        DestinationSpan,
+        WriteOperator,
+        &SourceBuffer);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlEqualBufferContentsUpdateInputs(
-    _Inout_ MDL_POINTER* MdlPointer1,
-    _Inout_ MDL_POINTER* MdlPointer2,
-    _In_ SIZE_T ComparisonLength,
-    _Out_ BOOLEAN* AreBuffersEqual)
+MdlCopyFlatBufferToMdlChainAtOffset(
+    _In_ MDL* DestinationMdlChain,
+    _In_ SIZE_T DestinationOffset,
+    _In_reads_(CopyLength) UCHAR const* SourceBuffer,
+    _In_ SIZE_T CopyLength)
 /*++
 
 Routine Description:
 
-    Determines if the contents of two MDL chains' buffers are bytewise equal
-
-    If ComparisonLength plus either pointer's Offset is greater than the total
-    length of the corresponding MDL chain, this routine crashes the system with
-    a fatal overflow error.
+    Copies data from a single buffer into an MDL chain
 
-    This routine updates the MDL_POINTER parameters in-place to point to the
-    end of the buffer that was processed. If the entire buffer was processed,
-    the MDL_POINTER is set to a NULL Mdl with 0 Offset.
+    If the DestinationOffset plus CopyLength is greater than the total length
+    of the MDL chain, this routine crashes the system wtih a fatal overflow
+    error.
 
 Arguments:
 
-    MdlPointer1
-        The first MDL chain to compare
+    DestinationMdlChain
+        The MDL chain to write into
 
-    MdlPointer2
-        The second MDL chain to compare
+    DestinationOffset
+        The byte offset at which to begin writing into
 
-    ComparisonLength
-        The number of bytes to compare
+    SourceBuffer
+        The buffer to read from
 
-    AreBuffersEqual
-        Receives TRUE if the buffers are exactly equal, or FALSE otherwise
+    CopyLength
+        The number of bytes to copy
 
 Return Value:
 
@@ -3060,69 +4080,120 @@ Return Value:
 
 --*/
 {
-    NTSTATUS NtStatus = MdlPairwiseIterateBuffersUpdateInputs(
-        MdlPointer1,
-        MdlPointer2,
-        ComparisonLength,
-        PairwiseEqual,
-        NULL);
+    MDL_SPAN Destination = { { 0 } };
+    Destination.Start.Mdl = DestinationMdlChain;
+    Destination.Start.Offset = DestinationOffset;
+    Destination.Length = CopyLength;
 
-    if (STATUS_SUCCESS == NtStatus)
-    {
-        *AreBuffersEqual = TRUE;
-        return STATUS_SUCCESS;
-    }
-    else if (STATUS_STOP_ITERATION == NtStatus)
-    {
-        *AreBuffersEqual = FALSE;
-        return STATUS_SUCCESS;
-    }
-    else
+    return MdlCopyFlatBufferToMdlSpan(
+        &Destination,
+        SourceBuffer);
+}
+
+#define ReadOperator _MdlPrivate_ReadOperator
+MDL_BUFFER_OPERATOR ReadOperator;
+
+_Use_decl_annotations_
+inline
+NTSTATUS ReadOperator(
+    PVOID OperatorContext,
+    MDL_SPAN const* Span)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    UCHAR** Destination = (UCHAR**)OperatorContext;
+
+    UCHAR const* Buffer = MDL_MAP_CONST_BUFFER(Span->Start.Mdl);
+    if (!Buffer)
     {
-        *AreBuffersEqual = FALSE;
-        return NtStatus;
+        return STATUS_INSUFFICIENT_RESOURCES;
     }
+
+    RtlCopyMemory(
+        *Destination,
+        Buffer + Span->Start.Offset,
+        Span->Length);
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_TEMPORAL, Span->Length));
+
+    *Destination += Span->Length;
+
+    return STATUS_SUCCESS;
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 NTSTATUS
-MdlEqualBufferContentsAtOffset(
-    _In_ MDL* MdlChain1,
-    _In_ SIZE_T Offset1,
-    _In_ MDL* MdlChain2,
-    _In_ SIZE_T Offset2,
-    _In_ SIZE_T ComparisonLength,
-    _Out_ BOOLEAN* AreBuffersEqual)
+MdlCopyMdlSpanToFlatBuffer(
+    _Out_writes_(Source->Length) UCHAR* DestinationBuffer,
+    _In_ MDL_SPAN const* Source)
 /*++
 
 Routine Description:
 
-    Determines if the contents of two MDL chains' buffers are bytewise equal
+    Copies data from an MDL span into a buffer
 
-    If ComparisonLength plus either Offset is greater than the total length of
-    the corresponding MDL chain, this routine crashes the system with a fatal
-    overflow error.
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
 
 Arguments:
 
-    MdlChain1
-        The first MDL to compare
+    DestinationBuffer
+        The buffer to write into
 
-    Offset1
-        The byte offset into the first MDL chain at which to begin the comparison
+    Source
+        The MDL span to read from
 
-    MdlChain2
-        The second MDL to compare
+Return Value:
 
-    Offset2
-        The byte offset into the second MDL chain at which to begin the comparison
+    STATUS_SUCCESS
+        Every buffer was processed successfully
 
-    ComparisonLength
-        The number of bytes to compare
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
 
-    AreBuffersEqual
-        Receives TRUE if the buffers are exactly equal, or FALSE otherwise
+--*/
+{
+    return MdlSpanIterateBuffers(
+        Source,
+        ReadOperator,
+        &DestinationBuffer);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlChainAtOffsetToFlatBuffer(
+    _Out_writes_(CopyLength) UCHAR* DestinationBuffer,
+    _In_ MDL* SourceMdlChain,
+    _In_ SIZE_T SourceOffset,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from an MDL chain into a buffer
+
+    If SourceOffset plus CopyLength is greater than the total length of the MDL
+    chain, this routine crashes the system with a fatal overflow error.
+
+Arguments:
+
+    DestinationBuffer
+        The buffer to write into
+
+    SourceMdlChain
+        The MDL chain to read from
+
+    SourceOffset
+        The offset into the MDL chain at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
 
 Return Value:
 
@@ -3134,40 +4205,5115 @@ Return Value:
 
 --*/
 {
-    MDL_POINTER MdlPointer1 = { 0 };
-    MdlPointer1.Mdl = MdlChain1;
-    MdlPointer1.Offset = Offset1;
+    MDL_SPAN Source = { { 0 } };
+    Source.Start.Mdl = SourceMdlChain;
+    Source.Start.Offset = SourceOffset;
+    Source.Length = CopyLength;
 
-    MDL_POINTER MdlPointer2 = { 0 };
-    MdlPointer2.Mdl = MdlChain2;
-    MdlPointer2.Offset = Offset2;
+    return MdlCopyMdlSpanToFlatBuffer(
+        DestinationBuffer,
+        &Source);
+}
 
-    return MdlEqualBufferContentsUpdateInputs(
-        &MdlPointer1,
-        &MdlPointer2,
-        ComparisonLength,
-        AreBuffersEqual);
+#define PairwiseCopy _MdlPrivate_PairwiseCopy
+
+MDL_BUFFER_PAIRWISE_OPERATOR PairwiseCopy;
+
+_Use_decl_annotations_
+inline
+NTSTATUS PairwiseCopy(
+    PVOID OperatorContext,
+    MDL_POINTER const* MdlPointer1,
+    MDL_POINTER const* MdlPointer2,
+    SIZE_T BufferLength)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    UNREFERENCED_PARAMETER(OperatorContext);
+
+    UCHAR* DestinationBuffer = MDL_MAP_BUFFER(MdlPointer1->Mdl);
+    UCHAR const* SourceBuffer = MDL_MAP_CONST_BUFFER(MdlPointer2->Mdl);
+
+    if (!SourceBuffer || !DestinationBuffer)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlCopyMemory(
+        DestinationBuffer + MdlPointer1->Offset,
+        SourceBuffer + MdlPointer2->Offset,
+        BufferLength);
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_TEMPORAL, BufferLength));
+
+    return STATUS_SUCCESS;
 }
 
+#define PairwiseCopyWithPrefetch _MdlPrivate_PairwiseCopyWithPrefetch
+
+MDL_BUFFER_PAIRWISE_OPERATOR PairwiseCopyWithPrefetch;
+
+_Use_decl_annotations_
+inline
+NTSTATUS PairwiseCopyWithPrefetch(
+    PVOID OperatorContext,
+    MDL_POINTER const* MdlPointer1,
+    MDL_POINTER const* MdlPointer2,
+    SIZE_T BufferLength)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Copies up to MDL_COPY_PREFETCH_DISTANCE bytes at a time. Before each
+    piece, prefetches the MDL_COPY_PREFETCH_DISTANCE bytes of the source that
+    follow it, even if they are in later MDLs.
+
+--*/
+{
+    PREFETCH_COPY_CONTEXT* Context = (PREFETCH_COPY_CONTEXT*)OperatorContext;
+
+    UCHAR* DestinationBuffer = MDL_MAP_BUFFER(MdlPointer1->Mdl);
+    UCHAR const* SourceBuffer = MDL_MAP_CONST_BUFFER(MdlPointer2->Mdl);
+
+    if (!SourceBuffer || !DestinationBuffer)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    DestinationBuffer += MdlPointer1->Offset;
+    SourceBuffer += MdlPointer2->Offset;
+
+    for (SIZE_T Copied = 0; Copied < BufferLength; )
+    {
+        SIZE_T const PieceLength = MinSizeT(BufferLength - Copied, MDL_COPY_PREFETCH_DISTANCE);
+        SIZE_T const PieceEnd = Context->Copied + PieceLength;
+
+        PrefetchSource(Context, PieceEnd, PieceEnd + MDL_COPY_PREFETCH_DISTANCE);
+
+        RtlCopyMemory(
+            DestinationBuffer + Copied,
+            SourceBuffer + Copied,
+            PieceLength);
+
+        Copied += PieceLength;
+        Context->Copied = PieceEnd;
+    }
+
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_TEMPORAL, BufferLength));
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlPointerToMdlPointer(
+    _In_ MDL_POINTER const* Destination,
+    _In_ MDL_POINTER const* Source,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain
+
+    If CopyLength plus either pointer's Offset is greater than the length
+    of that pointer's MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+Arguments:
+
+    Destination
+        A pointer at which to begin writing
+
+    Source
+        A pointer at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return MdlPairwiseIterateBuffers(
+        Destination,
+        Source,
+        CopyLength,
+        PairwiseCopy,
+        NULL);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlPointerToMdlPointerUpdateInputs(
+    _Inout_ MDL_POINTER* Destination,
+    _Inout_ MDL_POINTER* Source,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain
+
+    If CopyLength plus either pointer's Offset is greater than the length
+    of that pointer's MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    This routine updates the MDL_POINTER parameters in-place to point to the
+    end of the buffer that was processed. If the entire buffer was processed,
+    the MDL_POINTER is set to a NULL Mdl with 0 Offset.
+
+Arguments:
+
+    Destination
+        A pointer at which to begin writing
+
+    Source
+        A pointer at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return MdlPairwiseIterateBuffersUpdateInputs(
+        Destination,
+        Source,
+        CopyLength,
+        PairwiseCopy,
+        NULL);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlChainToMdlChainAtOffset(
+    _In_ MDL* DestinationMdlChain,
+    _In_ SIZE_T DestinationOffset,
+    _In_ MDL* SourceMdlChain,
+    _In_ SIZE_T SourceOffset,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain
+
+    If CopyLength plus either Offset is greater than the length of the
+    corresponding MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+Arguments:
+
+    DestinationMdlChain
+        The MDL chain to write into
+
+    DestinationOffset
+        The byte offset at which to begin writing
+
+    SourceMdlChain
+        The MDL chain to read from
+
+    SourceOffset
+        The byte offset at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_POINTER Source = { 0 };
+    Source.Mdl = SourceMdlChain;
+    Source.Offset = SourceOffset;
+
+    MDL_POINTER Destination = { 0 };
+    Destination.Mdl = DestinationMdlChain;
+    Destination.Offset = DestinationOffset;
+
+    return MdlCopyMdlPointerToMdlPointerUpdateInputs(
+        &Destination,
+        &Source,
+        CopyLength);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlPointerToMdlPointerWithPrefetch(
+    _In_ MDL_POINTER const* Destination,
+    _In_ MDL_POINTER const* Source,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain, prefetching the
+    source MDL_COPY_PREFETCH_DISTANCE bytes ahead of the copy
+
+    This is useful when the source is on another NUMA node. See the topic
+    "NUMA" at the top of this header file.
+
+    If CopyLength plus either pointer's Offset is greater than the length
+    of that pointer's MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+Arguments:
+
+    Destination
+        A pointer at which to begin writing
+
+    Source
+        A pointer at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    PREFETCH_COPY_CONTEXT Context;
+    InitializePrefetchCopy(&Context, Source, CopyLength);
+
+    return MdlPairwiseIterateBuffers(
+        Destination,
+        Source,
+        CopyLength,
+        PairwiseCopyWithPrefetch,
+        &Context);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlChainToMdlChainAtOffsetWithPrefetch(
+    _In_ MDL* DestinationMdlChain,
+    _In_ SIZE_T DestinationOffset,
+    _In_ MDL* SourceMdlChain,
+    _In_ SIZE_T SourceOffset,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain, prefetching the
+    source MDL_COPY_PREFETCH_DISTANCE bytes ahead of the copy
+
+    This is useful when the source is on another NUMA node. See the topic
+    "NUMA" at the top of this header file.
+
+    If CopyLength plus either Offset is greater than the length of the
+    corresponding MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+Arguments:
+
+    DestinationMdlChain
+        The MDL chain to write into
+
+    DestinationOffset
+        The byte offset at which to begin writing
+
+    SourceMdlChain
+        The MDL chain to read from
+
+    SourceOffset
+        The byte offset at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_POINTER Source = { 0 };
+    Source.Mdl = SourceMdlChain;
+    Source.Offset = SourceOffset;
+
+    MDL_POINTER Destination = { 0 };
+    Destination.Mdl = DestinationMdlChain;
+    Destination.Offset = DestinationOffset;
+
+    return MdlCopyMdlPointerToMdlPointerWithPrefetch(
+        &Destination,
+        &Source,
+        CopyLength);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyFlatBufferToMdlMappedSpan(
+    _In_ MDL_MAPPED_SPAN const* Destination,
+    _In_reads_(Destination->Length) UCHAR const* SourceBuffer)
+/*++
+
+Routine Description:
+
+    Copies data from a single buffer into every fragment of a mapped span
+
+Arguments:
+
+    Destination
+        The mapped span to write into
+
+    SourceBuffer
+        The buffer to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_TEMPORAL, Destination->Length));
+
+    for (SIZE_T i = 0; i < Destination->NumberOfFragments; i++)
+    {
+        MDL_MAPPED_FRAGMENT const* Fragment = &Destination->Fragments[i];
+
+        RtlCopyMemory(Fragment->Buffer, SourceBuffer, Fragment->Length);
+        SourceBuffer += Fragment->Length;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlMappedSpanToFlatBuffer(
+    _Out_writes_(Source->Length) UCHAR* DestinationBuffer,
+    _In_ MDL_MAPPED_SPAN const* Source)
+/*++
+
+Routine Description:
+
+    Copies every fragment of a mapped span into a single buffer
+
+Arguments:
+
+    DestinationBuffer
+        The buffer to write into
+
+    Source
+        The mapped span to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_TEMPORAL, Source->Length));
+
+    for (SIZE_T i = 0; i < Source->NumberOfFragments; i++)
+    {
+        MDL_MAPPED_FRAGMENT const* Fragment = &Source->Fragments[i];
+
+        RtlCopyMemory(DestinationBuffer, Fragment->Buffer, Fragment->Length);
+        DestinationBuffer += Fragment->Length;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlMappedSpanToMdlMappedSpan(
+    _In_ MDL_MAPPED_SPAN const* Destination,
+    _In_ MDL_MAPPED_SPAN const* Source)
+/*++
+
+Routine Description:
+
+    Copies every byte of one mapped span to the start of another mapped span
+
+    If the Destination is shorter than the Source, this routine crashes the
+    system with a fatal overflow error.
+
+Arguments:
+
+    Destination
+        The mapped span to write into
+
+    Source
+        The mapped span to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    if (Destination->Length < Source->Length)
+    {
+        ReportFatalOverflow(NULL, Source->Length);
+    }
+
+    SIZE_T DestinationIndex = 0;
+    SIZE_T DestinationOffset = 0;
+    SIZE_T SourceIndex = 0;
+    SIZE_T SourceOffset = 0;
+    SIZE_T BytesRemaining = Source->Length;
+
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_TEMPORAL, Source->Length));
+
+    while (BytesRemaining > 0)
+    {
+        MDL_MAPPED_FRAGMENT const* DestinationFragment = &Destination->Fragments[DestinationIndex];
+        MDL_MAPPED_FRAGMENT const* SourceFragment = &Source->Fragments[SourceIndex];
+
+        SIZE_T CommonLength =
+            MinSizeT(BytesRemaining,
+            MinSizeT(DestinationFragment->Length - DestinationOffset,
+                     SourceFragment->Length - SourceOffset));
+
+        RtlCopyMemory(
+            DestinationFragment->Buffer + DestinationOffset,
+            SourceFragment->Buffer + SourceOffset,
+            CommonLength);
+
+        DestinationOffset += CommonLength;
+        if (DestinationOffset == DestinationFragment->Length)
+        {
+            DestinationIndex += 1;
+            DestinationOffset = 0;
+        }
+
+        SourceOffset += CommonLength;
+        if (SourceOffset == SourceFragment->Length)
+        {
+            SourceIndex += 1;
+            SourceOffset = 0;
+        }
+
+        BytesRemaining -= CommonLength;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+#define WriteOperatorNonTemporal _MdlPrivate_WriteOperatorNonTemporal
+
+MDL_BUFFER_OPERATOR WriteOperatorNonTemporal;
+
+_Use_decl_annotations_
+inline
+NTSTATUS WriteOperatorNonTemporal(
+    PVOID OperatorContext,
+    MDL_SPAN const* Span)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    UCHAR const** Source = (UCHAR const**)OperatorContext;
+
+    UCHAR* Buffer = MDL_MAP_BUFFER(Span->Start.Mdl);
+    if (!Buffer)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlCopyMemoryNonTemporal(Buffer + Span->Start.Offset, *Source, Span->Length);
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_NON_TEMPORAL, Span->Length));
+    *Source += Span->Length;
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyFlatBufferToMdlSpanNonTemporal(
+    _In_ MDL_SPAN const* DestinationSpan,
+    _In_reads_(DestinationSpan->Length) UCHAR const* SourceBuffer)
+/*++
+
+Routine Description:
+
+    Copies data from a single buffer into an MDL chain
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    DestinationSpan
+        The span of bytes to write into
+
+    SourceBuffer
+        The buffer to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return MdlSpanIterateBuffers(
+        DestinationSpan,
+        WriteOperatorNonTemporal,
+        &SourceBuffer);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyFlatBufferToMdlChainAtOffsetNonTemporal(
+    _In_ MDL* DestinationMdlChain,
+    _In_ SIZE_T DestinationOffset,
+    _In_reads_(CopyLength) UCHAR const* SourceBuffer,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from a single buffer into an MDL chain
+
+    If the DestinationOffset plus CopyLength is greater than the total length
+    of the MDL chain, this routine crashes the system wtih a fatal overflow
+    error.
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    DestinationMdlChain
+        The MDL chain to write into
+
+    DestinationOffset
+        The byte offset at which to begin writing into
+
+    SourceBuffer
+        The buffer to read from
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_SPAN Destination = { { 0 } };
+    Destination.Start.Mdl = DestinationMdlChain;
+    Destination.Start.Offset = DestinationOffset;
+    Destination.Length = CopyLength;
+
+    return MdlCopyFlatBufferToMdlSpanNonTemporal(
+        &Destination,
+        SourceBuffer);
+}
+
+#define ReadOperatorNonTemporal _MdlPrivate_ReadOperatorNonTemporal
+MDL_BUFFER_OPERATOR ReadOperatorNonTemporal;
+
+_Use_decl_annotations_
+inline
+NTSTATUS ReadOperatorNonTemporal(
+    PVOID OperatorContext,
+    MDL_SPAN const* Span)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    UCHAR** Destination = (UCHAR**)OperatorContext;
+
+    UCHAR const* Buffer = MDL_MAP_CONST_BUFFER(Span->Start.Mdl);
+    if (!Buffer)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlCopyMemoryNonTemporal(
+        *Destination,
+        Buffer + Span->Start.Offset,
+        Span->Length);
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_NON_TEMPORAL, Span->Length));
+
+    *Destination += Span->Length;
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlSpanToFlatBufferNonTemporal(
+    _Out_writes_(Source->Length) UCHAR* DestinationBuffer,
+    _In_ MDL_SPAN const* Source)
+/*++
+
+Routine Description:
+
+    Copies data from an MDL span into a buffer
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    DestinationBuffer
+        The buffer to write into
+
+    Source
+        The MDL span to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return MdlSpanIterateBuffers(
+        Source,
+        ReadOperatorNonTemporal,
+        &DestinationBuffer);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlChainAtOffsetToFlatBufferNonTemporal(
+    _Out_writes_(CopyLength) UCHAR* DestinationBuffer,
+    _In_ MDL* SourceMdlChain,
+    _In_ SIZE_T SourceOffset,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from an MDL chain into a buffer
+
+    If SourceOffset plus CopyLength is greater than the total length of the MDL
+    chain, this routine crashes the system with a fatal overflow error.
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    DestinationBuffer
+        The buffer to write into
+
+    SourceMdlChain
+        The MDL chain to read from
+
+    SourceOffset
+        The offset into the MDL chain at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_SPAN Source = { { 0 } };
+    Source.Start.Mdl = SourceMdlChain;
+    Source.Start.Offset = SourceOffset;
+    Source.Length = CopyLength;
+
+    return MdlCopyMdlSpanToFlatBufferNonTemporal(
+        DestinationBuffer,
+        &Source);
+}
+
+#define PairwiseCopyNonTemporal _MdlPrivate_PairwiseCopyNonTemporal
+
+MDL_BUFFER_PAIRWISE_OPERATOR PairwiseCopyNonTemporal;
+
+_Use_decl_annotations_
+inline
+NTSTATUS PairwiseCopyNonTemporal(
+    PVOID OperatorContext,
+    MDL_POINTER const* MdlPointer1,
+    MDL_POINTER const* MdlPointer2,
+    SIZE_T BufferLength)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    UNREFERENCED_PARAMETER(OperatorContext);
+
+    UCHAR* DestinationBuffer = MDL_MAP_BUFFER(MdlPointer1->Mdl);
+    UCHAR const* SourceBuffer = MDL_MAP_CONST_BUFFER(MdlPointer2->Mdl);
+
+    if (!SourceBuffer || !DestinationBuffer)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlCopyMemoryNonTemporal(
+        DestinationBuffer + MdlPointer1->Offset,
+        SourceBuffer + MdlPointer2->Offset,
+        BufferLength);
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_NON_TEMPORAL, BufferLength));
+
+    return STATUS_SUCCESS;
+}
+
+#define PairwiseCopyWithPrefetchNonTemporal _MdlPrivate_PairwiseCopyWithPrefetchNonTemporal
+
+MDL_BUFFER_PAIRWISE_OPERATOR PairwiseCopyWithPrefetchNonTemporal;
+
+_Use_decl_annotations_
+inline
+NTSTATUS PairwiseCopyWithPrefetchNonTemporal(
+    PVOID OperatorContext,
+    MDL_POINTER const* MdlPointer1,
+    MDL_POINTER const* MdlPointer2,
+    SIZE_T BufferLength)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Copies up to MDL_COPY_PREFETCH_DISTANCE bytes at a time. Before each
+    piece, prefetches the MDL_COPY_PREFETCH_DISTANCE bytes of the source that
+    follow it, even if they are in later MDLs.
+
+--*/
+{
+    PREFETCH_COPY_CONTEXT* Context = (PREFETCH_COPY_CONTEXT*)OperatorContext;
+
+    UCHAR* DestinationBuffer = MDL_MAP_BUFFER(MdlPointer1->Mdl);
+    UCHAR const* SourceBuffer = MDL_MAP_CONST_BUFFER(MdlPointer2->Mdl);
+
+    if (!SourceBuffer || !DestinationBuffer)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    DestinationBuffer += MdlPointer1->Offset;
+    SourceBuffer += MdlPointer2->Offset;
+
+    for (SIZE_T Copied = 0; Copied < BufferLength; )
+    {
+        SIZE_T const PieceLength = MinSizeT(BufferLength - Copied, MDL_COPY_PREFETCH_DISTANCE);
+        SIZE_T const PieceEnd = Context->Copied + PieceLength;
+
+        PrefetchSource(Context, PieceEnd, PieceEnd + MDL_COPY_PREFETCH_DISTANCE);
+
+        RtlCopyMemoryNonTemporal(
+            DestinationBuffer + Copied,
+            SourceBuffer + Copied,
+            PieceLength);
+
+        Copied += PieceLength;
+        Context->Copied = PieceEnd;
+    }
+
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_NON_TEMPORAL, BufferLength));
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlPointerToMdlPointerNonTemporal(
+    _In_ MDL_POINTER const* Destination,
+    _In_ MDL_POINTER const* Source,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain
+
+    If CopyLength plus either pointer's Offset is greater than the length
+    of that pointer's MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    Destination
+        A pointer at which to begin writing
+
+    Source
+        A pointer at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return MdlPairwiseIterateBuffers(
+        Destination,
+        Source,
+        CopyLength,
+        PairwiseCopyNonTemporal,
+        NULL);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlPointerToMdlPointerUpdateInputsNonTemporal(
+    _Inout_ MDL_POINTER* Destination,
+    _Inout_ MDL_POINTER* Source,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain
+
+    If CopyLength plus either pointer's Offset is greater than the length
+    of that pointer's MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    This routine updates the MDL_POINTER parameters in-place to point to the
+    end of the buffer that was processed. If the entire buffer was processed,
+    the MDL_POINTER is set to a NULL Mdl with 0 Offset.
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    Destination
+        A pointer at which to begin writing
+
+    Source
+        A pointer at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return MdlPairwiseIterateBuffersUpdateInputs(
+        Destination,
+        Source,
+        CopyLength,
+        PairwiseCopyNonTemporal,
+        NULL);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlChainToMdlChainAtOffsetNonTemporal(
+    _In_ MDL* DestinationMdlChain,
+    _In_ SIZE_T DestinationOffset,
+    _In_ MDL* SourceMdlChain,
+    _In_ SIZE_T SourceOffset,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain
+
+    If CopyLength plus either Offset is greater than the length of the
+    corresponding MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    DestinationMdlChain
+        The MDL chain to write into
+
+    DestinationOffset
+        The byte offset at which to begin writing
+
+    SourceMdlChain
+        The MDL chain to read from
+
+    SourceOffset
+        The byte offset at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_POINTER Source = { 0 };
+    Source.Mdl = SourceMdlChain;
+    Source.Offset = SourceOffset;
+
+    MDL_POINTER Destination = { 0 };
+    Destination.Mdl = DestinationMdlChain;
+    Destination.Offset = DestinationOffset;
+
+    return MdlCopyMdlPointerToMdlPointerUpdateInputsNonTemporal(
+        &Destination,
+        &Source,
+        CopyLength);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlPointerToMdlPointerWithPrefetchNonTemporal(
+    _In_ MDL_POINTER const* Destination,
+    _In_ MDL_POINTER const* Source,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain, prefetching the
+    source MDL_COPY_PREFETCH_DISTANCE bytes ahead of the copy
+
+    This is useful when the source is on another NUMA node. See the topic
+    "NUMA" at the top of this header file.
+
+    If CopyLength plus either pointer's Offset is greater than the length
+    of that pointer's MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    Destination
+        A pointer at which to begin writing
+
+    Source
+        A pointer at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    PREFETCH_COPY_CONTEXT Context;
+    InitializePrefetchCopy(&Context, Source, CopyLength);
+
+    return MdlPairwiseIterateBuffers(
+        Destination,
+        Source,
+        CopyLength,
+        PairwiseCopyWithPrefetchNonTemporal,
+        &Context);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlChainToMdlChainAtOffsetWithPrefetchNonTemporal(
+    _In_ MDL* DestinationMdlChain,
+    _In_ SIZE_T DestinationOffset,
+    _In_ MDL* SourceMdlChain,
+    _In_ SIZE_T SourceOffset,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain, prefetching the
+    source MDL_COPY_PREFETCH_DISTANCE bytes ahead of the copy
+
+    This is useful when the source is on another NUMA node. See the topic
+    "NUMA" at the top of this header file.
+
+    If CopyLength plus either Offset is greater than the length of the
+    corresponding MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    DestinationMdlChain
+        The MDL chain to write into
+
+    DestinationOffset
+        The byte offset at which to begin writing
+
+    SourceMdlChain
+        The MDL chain to read from
+
+    SourceOffset
+        The byte offset at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_POINTER Source = { 0 };
+    Source.Mdl = SourceMdlChain;
+    Source.Offset = SourceOffset;
+
+    MDL_POINTER Destination = { 0 };
+    Destination.Mdl = DestinationMdlChain;
+    Destination.Offset = DestinationOffset;
+
+    return MdlCopyMdlPointerToMdlPointerWithPrefetchNonTemporal(
+        &Destination,
+        &Source,
+        CopyLength);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyFlatBufferToMdlMappedSpanNonTemporal(
+    _In_ MDL_MAPPED_SPAN const* Destination,
+    _In_reads_(Destination->Length) UCHAR const* SourceBuffer)
+/*++
+
+Routine Description:
+
+    Copies data from a single buffer into every fragment of a mapped span
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    Destination
+        The mapped span to write into
+
+    SourceBuffer
+        The buffer to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_NON_TEMPORAL, Destination->Length));
+
+    for (SIZE_T i = 0; i < Destination->NumberOfFragments; i++)
+    {
+        MDL_MAPPED_FRAGMENT const* Fragment = &Destination->Fragments[i];
+
+        RtlCopyMemoryNonTemporal(Fragment->Buffer, SourceBuffer, Fragment->Length);
+        SourceBuffer += Fragment->Length;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlMappedSpanToFlatBufferNonTemporal(
+    _Out_writes_(Source->Length) UCHAR* DestinationBuffer,
+    _In_ MDL_MAPPED_SPAN const* Source)
+/*++
+
+Routine Description:
+
+    Copies every fragment of a mapped span into a single buffer
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    DestinationBuffer
+        The buffer to write into
+
+    Source
+        The mapped span to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_NON_TEMPORAL, Source->Length));
+
+    for (SIZE_T i = 0; i < Source->NumberOfFragments; i++)
+    {
+        MDL_MAPPED_FRAGMENT const* Fragment = &Source->Fragments[i];
+
+        RtlCopyMemoryNonTemporal(DestinationBuffer, Fragment->Buffer, Fragment->Length);
+        DestinationBuffer += Fragment->Length;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlMappedSpanToMdlMappedSpanNonTemporal(
+    _In_ MDL_MAPPED_SPAN const* Destination,
+    _In_ MDL_MAPPED_SPAN const* Source)
+/*++
+
+Routine Description:
+
+    Copies every byte of one mapped span to the start of another mapped span
+
+    If the Destination is shorter than the Source, this routine crashes the
+    system with a fatal overflow error.
+
+    If permitted by the processor, this routine uses non-temporal instructions
+    to avoid placing the MDL buffers into the processor's data cache.
+
+Arguments:
+
+    Destination
+        The mapped span to write into
+
+    Source
+        The mapped span to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    if (Destination->Length < Source->Length)
+    {
+        ReportFatalOverflow(NULL, Source->Length);
+    }
+
+    SIZE_T DestinationIndex = 0;
+    SIZE_T DestinationOffset = 0;
+    SIZE_T SourceIndex = 0;
+    SIZE_T SourceOffset = 0;
+    SIZE_T BytesRemaining = Source->Length;
+
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordMdlCopy(NDL_STATISTICS_COPY_NON_TEMPORAL, Source->Length));
+
+    while (BytesRemaining > 0)
+    {
+        MDL_MAPPED_FRAGMENT const* DestinationFragment = &Destination->Fragments[DestinationIndex];
+        MDL_MAPPED_FRAGMENT const* SourceFragment = &Source->Fragments[SourceIndex];
+
+        SIZE_T CommonLength =
+            MinSizeT(BytesRemaining,
+            MinSizeT(DestinationFragment->Length - DestinationOffset,
+                     SourceFragment->Length - SourceOffset));
+
+        RtlCopyMemoryNonTemporal(
+            DestinationFragment->Buffer + DestinationOffset,
+            SourceFragment->Buffer + SourceOffset,
+            CommonLength);
+
+        DestinationOffset += CommonLength;
+        if (DestinationOffset == DestinationFragment->Length)
+        {
+            DestinationIndex += 1;
+            DestinationOffset = 0;
+        }
+
+        SourceOffset += CommonLength;
+        if (SourceOffset == SourceFragment->Length)
+        {
+            SourceIndex += 1;
+            SourceOffset = 0;
+        }
+
+        BytesRemaining -= CommonLength;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyFlatBufferToMdlSpanAuto(
+    _In_ MDL_SPAN const* DestinationSpan,
+    _In_reads_(DestinationSpan->Length) UCHAR const* SourceBuffer)
+/*++
+
+Routine Description:
+
+    Copies data from a single buffer into an MDL chain
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    DestinationSpan
+        The span of bytes to write into
+
+    SourceBuffer
+        The buffer to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    if (ShouldUseNonTemporal(DestinationSpan->Length))
+    {
+        return MdlCopyFlatBufferToMdlSpanNonTemporal(DestinationSpan, SourceBuffer);
+    }
+
+    return MdlCopyFlatBufferToMdlSpan(DestinationSpan, SourceBuffer);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyFlatBufferToMdlChainAtOffsetAuto(
+    _In_ MDL* DestinationMdlChain,
+    _In_ SIZE_T DestinationOffset,
+    _In_reads_(CopyLength) UCHAR const* SourceBuffer,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from a single buffer into an MDL chain
+
+    If the DestinationOffset plus CopyLength is greater than the total length
+    of the MDL chain, this routine crashes the system wtih a fatal overflow
+    error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    DestinationMdlChain
+        The MDL chain to write into
+
+    DestinationOffset
+        The byte offset at which to begin writing into
+
+    SourceBuffer
+        The buffer to read from
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_SPAN Destination = { { 0 } };
+    Destination.Start.Mdl = DestinationMdlChain;
+    Destination.Start.Offset = DestinationOffset;
+    Destination.Length = CopyLength;
+
+    return MdlCopyFlatBufferToMdlSpanAuto(
+        &Destination,
+        SourceBuffer);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlSpanToFlatBufferAuto(
+    _Out_writes_(Source->Length) UCHAR* DestinationBuffer,
+    _In_ MDL_SPAN const* Source)
+/*++
+
+Routine Description:
+
+    Copies data from an MDL span into a buffer
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    DestinationBuffer
+        The buffer to write into
+
+    Source
+        The MDL span to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    if (ShouldUseNonTemporal(Source->Length))
+    {
+        return MdlCopyMdlSpanToFlatBufferNonTemporal(DestinationBuffer, Source);
+    }
+
+    return MdlCopyMdlSpanToFlatBuffer(DestinationBuffer, Source);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlChainAtOffsetToFlatBufferAuto(
+    _Out_writes_(CopyLength) UCHAR* DestinationBuffer,
+    _In_ MDL* SourceMdlChain,
+    _In_ SIZE_T SourceOffset,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from an MDL chain into a buffer
+
+    If SourceOffset plus CopyLength is greater than the total length of the MDL
+    chain, this routine crashes the system with a fatal overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    DestinationBuffer
+        The buffer to write into
+
+    SourceMdlChain
+        The MDL chain to read from
+
+    SourceOffset
+        The offset into the MDL chain at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_SPAN Source = { { 0 } };
+    Source.Start.Mdl = SourceMdlChain;
+    Source.Start.Offset = SourceOffset;
+    Source.Length = CopyLength;
+
+    return MdlCopyMdlSpanToFlatBufferAuto(
+        DestinationBuffer,
+        &Source);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlPointerToMdlPointerAuto(
+    _In_ MDL_POINTER const* Destination,
+    _In_ MDL_POINTER const* Source,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain
+
+    If CopyLength plus either pointer's Offset is greater than the length
+    of that pointer's MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    Destination
+        A pointer at which to begin writing
+
+    Source
+        A pointer at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    if (ShouldUseNonTemporal(CopyLength))
+    {
+        return MdlCopyMdlPointerToMdlPointerNonTemporal(Destination, Source, CopyLength);
+    }
+
+    return MdlCopyMdlPointerToMdlPointer(Destination, Source, CopyLength);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlPointerToMdlPointerUpdateInputsAuto(
+    _Inout_ MDL_POINTER* Destination,
+    _Inout_ MDL_POINTER* Source,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain
+
+    If CopyLength plus either pointer's Offset is greater than the length
+    of that pointer's MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    This routine updates the MDL_POINTER parameters in-place to point to the
+    end of the buffer that was processed. If the entire buffer was processed,
+    the MDL_POINTER is set to a NULL Mdl with 0 Offset.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    Destination
+        A pointer at which to begin writing
+
+    Source
+        A pointer at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    if (ShouldUseNonTemporal(CopyLength))
+    {
+        return MdlCopyMdlPointerToMdlPointerUpdateInputsNonTemporal(Destination, Source, CopyLength);
+    }
+
+    return MdlCopyMdlPointerToMdlPointerUpdateInputs(Destination, Source, CopyLength);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlChainToMdlChainAtOffsetAuto(
+    _In_ MDL* DestinationMdlChain,
+    _In_ SIZE_T DestinationOffset,
+    _In_ MDL* SourceMdlChain,
+    _In_ SIZE_T SourceOffset,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain
+
+    If CopyLength plus either Offset is greater than the length of the
+    corresponding MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    DestinationMdlChain
+        The MDL chain to write into
+
+    DestinationOffset
+        The byte offset at which to begin writing
+
+    SourceMdlChain
+        The MDL chain to read from
+
+    SourceOffset
+        The byte offset at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_POINTER Source = { 0 };
+    Source.Mdl = SourceMdlChain;
+    Source.Offset = SourceOffset;
+
+    MDL_POINTER Destination = { 0 };
+    Destination.Mdl = DestinationMdlChain;
+    Destination.Offset = DestinationOffset;
+
+    return MdlCopyMdlPointerToMdlPointerUpdateInputsAuto(
+        &Destination,
+        &Source,
+        CopyLength);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlPointerToMdlPointerWithPrefetchAuto(
+    _In_ MDL_POINTER const* Destination,
+    _In_ MDL_POINTER const* Source,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain, prefetching the
+    source MDL_COPY_PREFETCH_DISTANCE bytes ahead of the copy
+
+    This is useful when the source is on another NUMA node. See the topic
+    "NUMA" at the top of this header file.
+
+    If CopyLength plus either pointer's Offset is greater than the length
+    of that pointer's MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    Destination
+        A pointer at which to begin writing
+
+    Source
+        A pointer at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    if (ShouldUseNonTemporal(CopyLength))
+    {
+        return MdlCopyMdlPointerToMdlPointerWithPrefetchNonTemporal(Destination, Source, CopyLength);
+    }
+
+    return MdlCopyMdlPointerToMdlPointerWithPrefetch(Destination, Source, CopyLength);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlChainToMdlChainAtOffsetWithPrefetchAuto(
+    _In_ MDL* DestinationMdlChain,
+    _In_ SIZE_T DestinationOffset,
+    _In_ MDL* SourceMdlChain,
+    _In_ SIZE_T SourceOffset,
+    _In_ SIZE_T CopyLength)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain, prefetching the
+    source MDL_COPY_PREFETCH_DISTANCE bytes ahead of the copy
+
+    This is useful when the source is on another NUMA node. See the topic
+    "NUMA" at the top of this header file.
+
+    If CopyLength plus either Offset is greater than the length of the
+    corresponding MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    DestinationMdlChain
+        The MDL chain to write into
+
+    DestinationOffset
+        The byte offset at which to begin writing
+
+    SourceMdlChain
+        The MDL chain to read from
+
+    SourceOffset
+        The byte offset at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_POINTER Source = { 0 };
+    Source.Mdl = SourceMdlChain;
+    Source.Offset = SourceOffset;
+
+    MDL_POINTER Destination = { 0 };
+    Destination.Mdl = DestinationMdlChain;
+    Destination.Offset = DestinationOffset;
+
+    return MdlCopyMdlPointerToMdlPointerWithPrefetchAuto(
+        &Destination,
+        &Source,
+        CopyLength);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyFlatBufferToMdlMappedSpanAuto(
+    _In_ MDL_MAPPED_SPAN const* Destination,
+    _In_reads_(Destination->Length) UCHAR const* SourceBuffer)
+/*++
+
+Routine Description:
+
+    Copies data from a single buffer into every fragment of a mapped span
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    Destination
+        The mapped span to write into
+
+    SourceBuffer
+        The buffer to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    if (ShouldUseNonTemporal(Destination->Length))
+    {
+        return MdlCopyFlatBufferToMdlMappedSpanNonTemporal(Destination, SourceBuffer);
+    }
+
+    return MdlCopyFlatBufferToMdlMappedSpan(Destination, SourceBuffer);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlMappedSpanToFlatBufferAuto(
+    _Out_writes_(Source->Length) UCHAR* DestinationBuffer,
+    _In_ MDL_MAPPED_SPAN const* Source)
+/*++
+
+Routine Description:
+
+    Copies every fragment of a mapped span into a single buffer
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    DestinationBuffer
+        The buffer to write into
+
+    Source
+        The mapped span to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    if (ShouldUseNonTemporal(Source->Length))
+    {
+        return MdlCopyMdlMappedSpanToFlatBufferNonTemporal(DestinationBuffer, Source);
+    }
+
+    return MdlCopyMdlMappedSpanToFlatBuffer(DestinationBuffer, Source);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlMappedSpanToMdlMappedSpanAuto(
+    _In_ MDL_MAPPED_SPAN const* Destination,
+    _In_ MDL_MAPPED_SPAN const* Source)
+/*++
+
+Routine Description:
+
+    Copies every byte of one mapped span to the start of another mapped span
+
+    If the Destination is shorter than the Source, this routine crashes the
+    system with a fatal overflow error.
+
+    If the operation is large enough to make it worthwhile, this routine uses
+    non-temporal instructions to avoid placing the MDL buffers into the
+    processor's data cache. See the topic "Temporal and non-temporal".
+
+Arguments:
+
+    Destination
+        The mapped span to write into
+
+    Source
+        The mapped span to read from
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    if (ShouldUseNonTemporal(Source->Length))
+    {
+        return MdlCopyMdlMappedSpanToMdlMappedSpanNonTemporal(Destination, Source);
+    }
+
+    return MdlCopyMdlMappedSpanToMdlMappedSpan(Destination, Source);
+}
+
+#define BATCH_CURSOR_t _MdlPrivate_BATCH_CURSOR_t
+#define BATCH_CURSOR _MdlPrivate_BATCH_CURSOR
+
+typedef struct BATCH_CURSOR_t
+{
+    // The MDL_POINTER::Mdl that the caller used to identify this position
+    MDL* Origin;
+
+    // The MDL_POINTER::Offset, relative to Origin, of this position
+    SIZE_T OriginOffset;
+
+    // The same position, in normal form
+    MDL_POINTER Position;
+} BATCH_CURSOR;
+
+#define SeekBatchCursor _MdlPrivate_SeekBatchCursor
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void SeekBatchCursor(
+    _Inout_ BATCH_CURSOR* Cursor,
+    _In_ MDL_POINTER const* Target)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Moves the cursor to Target. If Target is at or after the cursor's position
+    in the same MDL chain, the cursor moves forward from where it is, rather
+    than walking the MDL chain again from the beginning.
+
+--*/
+{
+    if (Cursor->Origin == Target->Mdl && Target->Offset >= Cursor->OriginOffset)
+    {
+        SIZE_T Delta = Target->Offset - Cursor->OriginOffset;
+
+        if (Delta > 0)
+        {
+            if (!Cursor->Position.Mdl)
+            {
+                ReportFatalOverflow(Target->Mdl, Target->Offset);
+            }
+
+            MdlPointerAdvanceBytes(&Cursor->Position, Delta);
+        }
+    }
+    else
+    {
+        Cursor->Origin = Target->Mdl;
+        Cursor->Position = *Target;
+    }
+
+    Cursor->OriginOffset = Target->Offset;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlSpansToMdlPointers(
+    _In_reads_(NumberOfDescriptors) MDL_COPY_DESCRIPTOR const* Descriptors,
+    _In_ SIZE_T NumberOfDescriptors)
+/*++
+
+Routine Description:
+
+    Executes a batch of copies, each from an MDL span to an MDL pointer
+
+    This is equivalent to calling MdlCopyMdlPointerToMdlPointer once for each
+    descriptor, but is cheaper when several descriptors refer to the same MDL
+    chain in ascending order. This routine remembers its position in the
+    destination chain and in up to MDL_COPY_BATCH_SOURCE_CURSORS source chains,
+    so a batch that gathers headers and payloads from a few chains into one
+    destination walks each chain only once.
+
+    Each descriptor is copied as if by MdlCopyMdlPointerToMdlPointerAuto, so
+    large descriptors are copied with non-temporal instructions and small ones
+    with regular instructions. See the topic "Temporal and non-temporal" at the
+    top of this header file.
+
+    If any descriptor's Source.Length plus either pointer's Offset is greater
+    than the length of that pointer's MDL chain, this routine crashes the
+    system with a fatal overflow error. The first descriptor must have a
+    non-NULL Destination.Mdl.
+
+Arguments:
+
+    Descriptors
+        The copies to perform, in order
+
+    NumberOfDescriptors
+        The number of elements in the Descriptors array
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every descriptor was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space. Some
+        descriptors may have already been copied.
+
+--*/
+{
+    BATCH_CURSOR Destination = { 0 };
+    BATCH_CURSOR Sources[MDL_COPY_BATCH_SOURCE_CURSORS] = { { 0 } };
+    SIZE_T NextSourceToReplace = 0;
+
+    for (SIZE_T i = 0; i < NumberOfDescriptors; i++)
+    {
+        MDL_COPY_DESCRIPTOR const* Descriptor = &Descriptors[i];
+        SIZE_T CopyLength = Descriptor->Source.Length;
+
+        if (Descriptor->Destination.Mdl)
+        {
+            SeekBatchCursor(&Destination, &Descriptor->Destination);
+        }
+
+        if (0 == CopyLength)
+        {
+            continue;
+        }
+
+        BATCH_CURSOR* Source = NULL;
+        for (SIZE_T j = 0; j < MDL_COPY_BATCH_SOURCE_CURSORS; j++)
+        {
+            if (Sources[j].Origin == Descriptor->Source.Start.Mdl)
+            {
+                Source = &Sources[j];
+                break;
+            }
+        }
+
+        if (!Source)
+        {
+            Source = &Sources[NextSourceToReplace];
+            NextSourceToReplace = (NextSourceToReplace + 1) % MDL_COPY_BATCH_SOURCE_CURSORS;
+        }
+
+        SeekBatchCursor(Source, &Descriptor->Source.Start);
+
+        NTSTATUS NtStatus = MdlPairwiseIterateBuffersUpdateInputs(
+            &Destination.Position,
+            &Source->Position,
+            CopyLength,
+            ShouldUseNonTemporal(CopyLength)
+                ? PairwiseCopyNonTemporal
+                : PairwiseCopy,
+            NULL);
+
+        if (STATUS_SUCCESS != NtStatus)
+        {
+            return NtStatus;
+        }
+
+        Source->OriginOffset += CopyLength;
+        Destination.OriginOffset += CopyLength;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+#define NumaCopyDpc _MdlPrivate_NumaCopyDpc
+
+_Function_class_(KDEFERRED_ROUTINE)
+_IRQL_requires_(DISPATCH_LEVEL)
+_IRQL_requires_same_
+inline
+void NumaCopyDpc(
+    _In_ KDPC* Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Copies up to MDL_NUMA_COPY_MAXIMUM_DPC_LENGTH bytes of one chunk of an
+    MDL_NUMA_COPY. If the chunk has more, the DPC queues itself again, to the
+    tail of the same processor's DPC queue. The last chunk to finish invokes
+    the completion routine.
+
+--*/
+{
+    UNREFERENCED_PARAMETER(SystemArgument1);
+    UNREFERENCED_PARAMETER(SystemArgument2);
+
+    MDL_NUMA_COPY_CHUNK* Chunk = (MDL_NUMA_COPY_CHUNK*)DeferredContext;
+    MDL_NUMA_COPY* NumaCopy = Chunk->NumaCopy;
+
+    SIZE_T const RoundLength = MinSizeT(Chunk->Length, MDL_NUMA_COPY_MAXIMUM_DPC_LENGTH);
+
+    // Each round prefetches only its own bytes, so it never touches the
+    // source that a later round copies
+    PREFETCH_COPY_CONTEXT Context;
+    InitializePrefetchCopy(&Context, &Chunk->Source, RoundLength);
+
+    NTSTATUS NtStatus = MdlPairwiseIterateBuffersUpdateInputs(
+        &Chunk->Destination,
+        &Chunk->Source,
+        RoundLength,
+        NumaCopy->NonTemporal
+            ? PairwiseCopyWithPrefetchNonTemporal
+            : PairwiseCopyWithPrefetch,
+        &Context);
+
+    if (STATUS_SUCCESS != NtStatus)
+    {
+        (void)InterlockedCompareExchange(
+            (LONG volatile*)&NumaCopy->NtStatus, NtStatus, STATUS_SUCCESS);
+    }
+    else if (Chunk->Length > RoundLength)
+    {
+        Chunk->Length -= RoundLength;
+        (void)KeInsertQueueDpc(Dpc, NULL, NULL);
+        return;
+    }
+
+    if (0 == InterlockedDecrement(&NumaCopy->ChunksRemaining))
+    {
+        NumaCopy->CompletionRoutine(
+            NumaCopy,
+            NumaCopy->CompletionContext,
+            NumaCopy->NtStatus);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlPointerToMdlPointerOnNode(
+    _Out_ MDL_NUMA_COPY* NumaCopy,
+    _Out_writes_(MaximumChunks) MDL_NUMA_COPY_CHUNK* Chunks,
+    _In_ ULONG MaximumChunks,
+    _In_ MDL_POINTER const* Destination,
+    _In_ MDL_POINTER const* Source,
+    _In_ SIZE_T CopyLength,
+    _In_ USHORT DestinationNode,
+    _In_ MDL_NUMA_COPY_COMPLETION* CompletionRoutine,
+    _In_opt_ PVOID CompletionContext)
+/*++
+
+Routine Description:
+
+    Copies data from one MDL chain to another MDL chain, on processors of the
+    NUMA node that holds the destination's buffers
+
+    If DestinationNode is not the current processor's node, and CopyLength is
+    at least MDL_NUMA_COPY_MINIMUM_CHUNK_LENGTH, this routine splits the copy
+    into up to MaximumChunks chunks of at least
+    MDL_NUMA_COPY_MINIMUM_CHUNK_LENGTH bytes each, and queues a DPC for each
+    chunk to a different processor of DestinationNode. Each DPC copies at
+    most MDL_NUMA_COPY_MAXIMUM_DPC_LENGTH bytes, then queues itself again
+    until its chunk is done, so the time spent in any one DPC is bounded no
+    matter how large CopyLength is. This routine returns STATUS_PENDING
+    without waiting for the DPCs. Once every chunk has finished,
+    CompletionRoutine is invoked at DISPATCH_LEVEL, on one of those
+    processors, possibly before this routine returns. NumaCopy, Chunks, and
+    both MDL chains must remain valid until then.
+
+    Otherwise, this routine copies the data on the current processor, as if by
+    MdlCopyMdlPointerToMdlPointerWithPrefetchAuto, and does not invoke
+    CompletionRoutine.
+
+    Either way, each chunk is copied with non-temporal instructions if
+    CopyLength is large enough. See the topic "NUMA" at the top of this
+    header file.
+
+    If CopyLength plus either pointer's Offset is greater than the length
+    of that pointer's MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+Arguments:
+
+    NumaCopy
+        Storage to track the copy until it completes
+
+    Chunks
+        Storage for the chunks of the copy
+
+    MaximumChunks
+        The number of elements in the Chunks array
+
+    Destination
+        A pointer at which to begin writing
+
+    Source
+        A pointer at which to begin reading
+
+    CopyLength
+        The number of bytes to copy
+
+    DestinationNode
+        The NUMA node number of the memory that Destination describes
+
+    CompletionRoutine
+        Invoked once all chunks have finished, if this routine returns
+        STATUS_PENDING
+
+    CompletionContext
+        Any optional context you'd like to pass to CompletionRoutine
+
+Return Value:
+
+    STATUS_PENDING
+        The chunks have been queued, and CompletionRoutine will be invoked
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully on the current processor
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    BOOLEAN const NonTemporal = ShouldUseNonTemporal(CopyLength);
+
+    ULONG NumberOfChunks = 0;
+    GROUP_AFFINITY Affinity = { 0 };
+    ULONG NumberOfProcessors = 0;
+
+    if (DestinationNode != KeGetCurrentNodeNumber()
+        && CopyLength >= MDL_NUMA_COPY_MINIMUM_CHUNK_LENGTH)
+    {
+        KeQueryNodeActiveAffinity(DestinationNode, &Affinity, NULL);
+
+        //
+        // If the node spans several processor groups, the count reported by
+        // KeQueryNodeActiveAffinity includes processors outside the one group
+        // it returns.  Only the processors in the returned mask can be used.
+        // If there are none, the copy runs on the current processor.
+        //
+        NumberOfProcessors = RtlNumberOfSetBitsUlongPtr(Affinity.Mask);
+
+        SIZE_T const ChunksByLength = CopyLength / MDL_NUMA_COPY_MINIMUM_CHUNK_LENGTH;
+
+        NumberOfChunks = NumberOfProcessors;
+
+        if (NumberOfChunks > MaximumChunks)
+        {
+            NumberOfChunks = MaximumChunks;
+        }
+
+        if (NumberOfChunks > ChunksByLength)
+        {
+            NumberOfChunks = (ULONG)ChunksByLength;
+        }
+    }
+
+    if (0 == NumberOfChunks)
+    {
+        PREFETCH_COPY_CONTEXT Context;
+        InitializePrefetchCopy(&Context, Source, CopyLength);
+
+        return MdlPairwiseIterateBuffers(
+            Destination,
+            Source,
+            CopyLength,
+            NonTemporal
+                ? PairwiseCopyWithPrefetchNonTemporal
+                : PairwiseCopyWithPrefetch,
+            &Context);
+    }
+
+    NumaCopy->CompletionRoutine = CompletionRoutine;
+    NumaCopy->CompletionContext = CompletionContext;
+    NumaCopy->NonTemporal = NonTemporal;
+    NumaCopy->ChunksRemaining = (LONG)NumberOfChunks;
+    NumaCopy->NtStatus = STATUS_SUCCESS;
+
+    //
+    // Find every chunk's position before queuing any DPC, so the MDL chains
+    // are walked once in total, and so an overflow crashes the system before
+    // any chunk has been copied.
+    //
+    SIZE_T const ChunkLength = CopyLength / NumberOfChunks;
+    MDL_POINTER NextDestination = *Destination;
+    MDL_POINTER NextSource = *Source;
+
+    for (ULONG i = 0; i < NumberOfChunks; i++)
+    {
+        MDL_NUMA_COPY_CHUNK* Chunk = &Chunks[i];
+
+        Chunk->NumaCopy = NumaCopy;
+        Chunk->Destination = NextDestination;
+        Chunk->Source = NextSource;
+        Chunk->Length = (i + 1 == NumberOfChunks)
+            ? CopyLength - i * ChunkLength
+            : ChunkLength;
+
+        MdlPointerAdvanceBytes(&NextDestination, Chunk->Length);
+        MdlPointerAdvanceBytes(&NextSource, Chunk->Length);
+    }
+
+    //
+    // Give each chunk its own processor of the node, starting from a
+    // different one on each processor that calls this routine, so that
+    // concurrent copies to the same node spread out.
+    //
+    ULONG const FirstProcessor = KeGetCurrentProcessorIndex() % NumberOfProcessors;
+
+    for (ULONG i = 0; i < NumberOfChunks; i++)
+    {
+        MDL_NUMA_COPY_CHUNK* Chunk = &Chunks[i];
+        ULONG const Ordinal = (FirstProcessor + i) % NumberOfProcessors;
+
+        // Find the Ordinal-th processor in the node's affinity mask
+        ULONG_PTR Mask = Affinity.Mask;
+        for (ULONG j = 0; j < Ordinal; j++)
+        {
+            Mask &= Mask - 1;
+        }
+
+        PROCESSOR_NUMBER ProcessorNumber = { 0 };
+        ProcessorNumber.Group = Affinity.Group;
+        ProcessorNumber.Number = (UCHAR)RtlFindLeastSignificantBit((ULONGLONG)Mask);
+
+        KeInitializeDpc(&Chunk->Dpc, NumaCopyDpc, Chunk);
+        (void)KeSetTargetProcessorDpcEx(&Chunk->Dpc, &ProcessorNumber);
+        KeSetImportanceDpc(&Chunk->Dpc, MediumHighImportance);
+        (void)KeInsertQueueDpc(&Chunk->Dpc, NULL, NULL);
+    }
+
+    return STATUS_PENDING;
+}
+
+#define PairwiseEqual _MdlPrivate_PairwiseEqual
+
+MDL_BUFFER_PAIRWISE_OPERATOR PairwiseEqual;
+
+_Use_decl_annotations_
+inline
+NTSTATUS PairwiseEqual(
+    PVOID OperatorContext,
+    MDL_POINTER const* MdlPointer1,
+    MDL_POINTER const* MdlPointer2,
+    SIZE_T BufferLength)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    UNREFERENCED_PARAMETER(OperatorContext);
+
+    UCHAR const* Buffer1 = MDL_MAP_CONST_BUFFER(MdlPointer1->Mdl);
+    UCHAR const* Buffer2 = MDL_MAP_CONST_BUFFER(MdlPointer2->Mdl);
+
+    if (!Buffer1 || !Buffer2)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    BOOLEAN IsEqual = RtlEqualMemory(
+        Buffer1 + MdlPointer1->Offset,
+        Buffer2 + MdlPointer2->Offset,
+        BufferLength);
+
+    if (IsEqual)
+    {
+        // Keep going
+        return STATUS_SUCCESS;
+    }
+    else
+    {
+        // At least one difference was found; stop iterating the MDL chain now
+        return STATUS_STOP_ITERATION;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlEqualBufferContents(
+    _In_ MDL_POINTER const* MdlPointer1,
+    _In_ MDL_POINTER const* MdlPointer2,
+    _In_ SIZE_T ComparisonLength,
+    _Out_ BOOLEAN* AreBuffersEqual)
+/*++
+
+Routine Description:
+
+    Determines if the contents of two MDL chains' buffers are bytewise equal
+
+    If ComparisonLength plus either pointer's Offset is greater than the total
+    length of the corresponding MDL chain, this routine crashes the system with
+    a fatal overflow error.
+
+Arguments:
+
+    MdlPointer1
+        The first MDL chain to compare
+
+    MdlPointer2
+        The second MDL chain to compare
+
+    ComparisonLength
+        The number of bytes to compare
+
+    AreBuffersEqual
+        Receives TRUE if the buffers are exactly equal, or FALSE otherwise
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    NTSTATUS NtStatus = MdlPairwiseIterateBuffers(
+        MdlPointer1,
+        MdlPointer2,
+        ComparisonLength,
+        PairwiseEqual,
+        NULL);
+
+    if (STATUS_SUCCESS == NtStatus)
+    {
+        *AreBuffersEqual = TRUE;
+        return STATUS_SUCCESS;
+    }
+    else if (STATUS_STOP_ITERATION == NtStatus)
+    {
+        *AreBuffersEqual = FALSE;
+        return STATUS_SUCCESS;
+    }
+    else
+    {
+        *AreBuffersEqual = FALSE;
+        return NtStatus;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlEqualBufferContentsUpdateInputs(
+    _Inout_ MDL_POINTER* MdlPointer1,
+    _Inout_ MDL_POINTER* MdlPointer2,
+    _In_ SIZE_T ComparisonLength,
+    _Out_ BOOLEAN* AreBuffersEqual)
+/*++
+
+Routine Description:
+
+    Determines if the contents of two MDL chains' buffers are bytewise equal
+
+    If ComparisonLength plus either pointer's Offset is greater than the total
+    length of the corresponding MDL chain, this routine crashes the system with
+    a fatal overflow error.
+
+    This routine updates the MDL_POINTER parameters in-place to point to the
+    end of the buffer that was processed. If the entire buffer was processed,
+    the MDL_POINTER is set to a NULL Mdl with 0 Offset.
+
+Arguments:
+
+    MdlPointer1
+        The first MDL chain to compare
+
+    MdlPointer2
+        The second MDL chain to compare
+
+    ComparisonLength
+        The number of bytes to compare
+
+    AreBuffersEqual
+        Receives TRUE if the buffers are exactly equal, or FALSE otherwise
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    NTSTATUS NtStatus = MdlPairwiseIterateBuffersUpdateInputs(
+        MdlPointer1,
+        MdlPointer2,
+        ComparisonLength,
+        PairwiseEqual,
+        NULL);
+
+    if (STATUS_SUCCESS == NtStatus)
+    {
+        *AreBuffersEqual = TRUE;
+        return STATUS_SUCCESS;
+    }
+    else if (STATUS_STOP_ITERATION == NtStatus)
+    {
+        *AreBuffersEqual = FALSE;
+        return STATUS_SUCCESS;
+    }
+    else
+    {
+        *AreBuffersEqual = FALSE;
+        return NtStatus;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlEqualBufferContentsAtOffset(
+    _In_ MDL* MdlChain1,
+    _In_ SIZE_T Offset1,
+    _In_ MDL* MdlChain2,
+    _In_ SIZE_T Offset2,
+    _In_ SIZE_T ComparisonLength,
+    _Out_ BOOLEAN* AreBuffersEqual)
+/*++
+
+Routine Description:
+
+    Determines if the contents of two MDL chains' buffers are bytewise equal
+
+    If ComparisonLength plus either Offset is greater than the total length of
+    the corresponding MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+Arguments:
+
+    MdlChain1
+        The first MDL to compare
+
+    Offset1
+        The byte offset into the first MDL chain at which to begin the comparison
+
+    MdlChain2
+        The second MDL to compare
+
+    Offset2
+        The byte offset into the second MDL chain at which to begin the comparison
+
+    ComparisonLength
+        The number of bytes to compare
+
+    AreBuffersEqual
+        Receives TRUE if the buffers are exactly equal, or FALSE otherwise
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_POINTER MdlPointer1 = { 0 };
+    MdlPointer1.Mdl = MdlChain1;
+    MdlPointer1.Offset = Offset1;
+
+    MDL_POINTER MdlPointer2 = { 0 };
+    MdlPointer2.Mdl = MdlChain2;
+    MdlPointer2.Offset = Offset2;
+
+    return MdlEqualBufferContentsUpdateInputs(
+        &MdlPointer1,
+        &MdlPointer2,
+        ComparisonLength,
+        AreBuffersEqual);
+}
+
+#define FindFirstMismatch _MdlPrivate_FindFirstMismatch
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+SIZE_T FindFirstMismatch(
+    _In_reads_(Length) UCHAR const* Buffer1,
+    _In_reads_(Length) UCHAR const* Buffer2,
+    _In_ SIZE_T Length)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Returns the index of the first byte that differs between the buffers, or
+    Length if the buffers are equal.
+
+--*/
+{
+    SIZE_T Offset = 0;
+
+#if defined(_M_AMD64)
+    while (Length - Offset >= sizeof(__m128i))
+    {
+        __m128i const Bytes1 = _mm_loadu_si128((__m128i const*)(Buffer1 + Offset));
+        __m128i const Bytes2 = _mm_loadu_si128((__m128i const*)(Buffer2 + Offset));
+
+        ULONG const Mismatches =
+            0xFFFF ^ (ULONG)_mm_movemask_epi8(_mm_cmpeq_epi8(Bytes1, Bytes2));
+
+        if (0 != Mismatches)
+        {
+            ULONG Index;
+            _BitScanForward(&Index, Mismatches);
+            return Offset + Index;
+        }
+
+        Offset += sizeof(__m128i);
+    }
+#endif
+
+    while (Length - Offset >= sizeof(ULONG64))
+    {
+        ULONG64 Word1;
+        ULONG64 Word2;
+        RtlCopyMemory(&Word1, Buffer1 + Offset, sizeof(ULONG64));
+        RtlCopyMemory(&Word2, Buffer2 + Offset, sizeof(ULONG64));
+
+        ULONG64 const Mismatches = Word1 ^ Word2;
+        if (0 != Mismatches)
+        {
+#if defined(_M_AMD64) || defined(_M_ARM64)
+            ULONG Index;
+            _BitScanForward64(&Index, Mismatches);
+            return Offset + Index / 8;
+#else
+            break;
+#endif
+        }
+
+        Offset += sizeof(ULONG64);
+    }
+
+    while (Offset < Length && Buffer1[Offset] == Buffer2[Offset])
+    {
+        Offset += 1;
+    }
+
+    return Offset;
+}
+
+#define COMPARE_OPERATOR_CONTEXT_t _MdlPrivate_COMPARE_OPERATOR_CONTEXT_t
+#define COMPARE_OPERATOR_CONTEXT _MdlPrivate_COMPARE_OPERATOR_CONTEXT
+
+typedef struct COMPARE_OPERATOR_CONTEXT_t
+{
+    // The number of bytes found to be equal so far
+    SIZE_T BytesCompared;
+
+    // The offset of the first mismatch into the current pair of buffers
+    SIZE_T MismatchOffset;
+} COMPARE_OPERATOR_CONTEXT;
+
+#define PairwiseCompare _MdlPrivate_PairwiseCompare
+
+MDL_BUFFER_PAIRWISE_OPERATOR PairwiseCompare;
+
+_Use_decl_annotations_
+inline
+NTSTATUS PairwiseCompare(
+    PVOID OperatorContext,
+    MDL_POINTER const* MdlPointer1,
+    MDL_POINTER const* MdlPointer2,
+    SIZE_T BufferLength)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    COMPARE_OPERATOR_CONTEXT* Context = (COMPARE_OPERATOR_CONTEXT*)OperatorContext;
+
+    UCHAR const* Buffer1 = MDL_MAP_CONST_BUFFER(MdlPointer1->Mdl);
+    UCHAR const* Buffer2 = MDL_MAP_CONST_BUFFER(MdlPointer2->Mdl);
+
+    if (!Buffer1 || !Buffer2)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    SIZE_T MismatchOffset = FindFirstMismatch(
+        Buffer1 + MdlPointer1->Offset,
+        Buffer2 + MdlPointer2->Offset,
+        BufferLength);
+
+    if (MismatchOffset == BufferLength)
+    {
+        // Keep going
+        Context->BytesCompared += BufferLength;
+        return STATUS_SUCCESS;
+    }
+    else
+    {
+        // Found the first difference; stop iterating the MDL chain now
+        Context->MismatchOffset = MismatchOffset;
+        return STATUS_STOP_ITERATION;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCompareBufferContents(
+    _In_ MDL_POINTER const* MdlPointer1,
+    _In_ MDL_POINTER const* MdlPointer2,
+    _In_ SIZE_T ComparisonLength,
+    _Out_ SIZE_T* MismatchOffset)
+/*++
+
+Routine Description:
+
+    Finds the first byte that differs between the contents of two MDL chains'
+    buffers
+
+    If ComparisonLength plus either pointer's Offset is greater than the total
+    length of the corresponding MDL chain, this routine crashes the system with
+    a fatal overflow error.
+
+Arguments:
+
+    MdlPointer1
+        The first MDL chain to compare
+
+    MdlPointer2
+        The second MDL chain to compare
+
+    ComparisonLength
+        The number of bytes to compare
+
+    MismatchOffset
+        Receives the offset, relative to the start of the comparison, of the
+        first byte that differs, or ComparisonLength if the buffers are equal
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    COMPARE_OPERATOR_CONTEXT Context = { 0 };
+
+    NTSTATUS NtStatus = MdlPairwiseIterateBuffers(
+        MdlPointer1,
+        MdlPointer2,
+        ComparisonLength,
+        PairwiseCompare,
+        &Context);
+
+    if (STATUS_SUCCESS == NtStatus)
+    {
+        *MismatchOffset = ComparisonLength;
+        return STATUS_SUCCESS;
+    }
+    else if (STATUS_STOP_ITERATION == NtStatus)
+    {
+        *MismatchOffset = Context.BytesCompared + Context.MismatchOffset;
+        return STATUS_SUCCESS;
+    }
+    else
+    {
+        *MismatchOffset = Context.BytesCompared;
+        return NtStatus;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCompareBufferContentsUpdateInputs(
+    _Inout_ MDL_POINTER* MdlPointer1,
+    _Inout_ MDL_POINTER* MdlPointer2,
+    _In_ SIZE_T ComparisonLength,
+    _Out_ SIZE_T* MismatchOffset)
+/*++
+
+Routine Description:
+
+    Finds the first byte that differs between the contents of two MDL chains'
+    buffers
+
+    If ComparisonLength plus either pointer's Offset is greater than the total
+    length of the corresponding MDL chain, this routine crashes the system with
+    a fatal overflow error.
+
+    This routine updates the MDL_POINTER parameters in-place to point to the
+    first byte that differs, or to the end of the compared region if the
+    buffers are equal. If that is the end of the MDL chain, the MDL_POINTER is
+    set to a NULL Mdl with 0 Offset.
+
+Arguments:
+
+    MdlPointer1
+        The first MDL chain to compare
+
+    MdlPointer2
+        The second MDL chain to compare
+
+    ComparisonLength
+        The number of bytes to compare
+
+    MismatchOffset
+        Receives the offset, relative to the start of the comparison, of the
+        first byte that differs, or ComparisonLength if the buffers are equal
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    COMPARE_OPERATOR_CONTEXT Context = { 0 };
+
+    NTSTATUS NtStatus = MdlPairwiseIterateBuffersUpdateInputs(
+        MdlPointer1,
+        MdlPointer2,
+        ComparisonLength,
+        PairwiseCompare,
+        &Context);
+
+    if (STATUS_SUCCESS == NtStatus)
+    {
+        *MismatchOffset = ComparisonLength;
+        return STATUS_SUCCESS;
+    }
+    else if (STATUS_STOP_ITERATION == NtStatus)
+    {
+        MdlPointerAdvanceBytes(MdlPointer1, Context.MismatchOffset);
+        MdlPointerAdvanceBytes(MdlPointer2, Context.MismatchOffset);
+
+        *MismatchOffset = Context.BytesCompared + Context.MismatchOffset;
+        return STATUS_SUCCESS;
+    }
+    else
+    {
+        *MismatchOffset = Context.BytesCompared;
+        return NtStatus;
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlSpanCompareBufferContents(
+    _In_ MDL_SPAN const* Span1,
+    _In_ MDL_SPAN const* Span2,
+    _Out_ SIZE_T* MismatchOffset)
+/*++
+
+Routine Description:
+
+    Finds the first byte that differs between the contents of two MDL spans
+
+    If the spans have different lengths and the shorter span is equal to the
+    start of the longer span, the first mismatch is considered to be at the end
+    of the shorter span.
+
+    If either Span extends past the end of its MDL chain, this routine crashes
+    the system with a fatal overflow error.
+
+Arguments:
+
+    Span1
+        The first MDL span to compare
+
+    Span2
+        The second MDL span to compare
+
+    MismatchOffset
+        Receives the offset, relative to the start of the spans, of the first
+        byte that differs, or the length of the spans if they are equal
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return MdlCompareBufferContents(
+        &Span1->Start,
+        &Span2->Start,
+        MinSizeT(Span1->Length, Span2->Length),
+        MismatchOffset);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCompareBufferContentsAtOffset(
+    _In_ MDL* MdlChain1,
+    _In_ SIZE_T Offset1,
+    _In_ MDL* MdlChain2,
+    _In_ SIZE_T Offset2,
+    _In_ SIZE_T ComparisonLength,
+    _Out_ SIZE_T* MismatchOffset)
+/*++
+
+Routine Description:
+
+    Finds the first byte that differs between the contents of two MDL chains'
+    buffers
+
+    If ComparisonLength plus either Offset is greater than the total length of
+    the corresponding MDL chain, this routine crashes the system with a fatal
+    overflow error.
+
+Arguments:
+
+    MdlChain1
+        The first MDL to compare
+
+    Offset1
+        The byte offset into the first MDL chain at which to begin the comparison
+
+    MdlChain2
+        The second MDL to compare
+
+    Offset2
+        The byte offset into the second MDL chain at which to begin the comparison
+
+    ComparisonLength
+        The number of bytes to compare
+
+    MismatchOffset
+        Receives the offset, relative to Offset1 and Offset2, of the first byte
+        that differs, or ComparisonLength if the buffers are equal
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_POINTER MdlPointer1 = { 0 };
+    MdlPointer1.Mdl = MdlChain1;
+    MdlPointer1.Offset = Offset1;
+
+    MDL_POINTER MdlPointer2 = { 0 };
+    MdlPointer2.Mdl = MdlChain2;
+    MdlPointer2.Offset = Offset2;
+
+    return MdlCompareBufferContentsUpdateInputs(
+        &MdlPointer1,
+        &MdlPointer2,
+        ComparisonLength,
+        MismatchOffset);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlMappedSpanCompareBufferContents(
+    _In_ MDL_MAPPED_SPAN const* MappedSpan1,
+    _In_ MDL_MAPPED_SPAN const* MappedSpan2,
+    _Out_ SIZE_T* MismatchOffset)
+/*++
+
+Routine Description:
+
+    Finds the first byte that differs between the contents of two mapped spans
+
+    If the spans have different lengths and the shorter span is equal to the
+    start of the longer span, the first mismatch is considered to be at the end
+    of the shorter span.
+
+Arguments:
+
+    MappedSpan1
+        The first mapped span to compare
+
+    MappedSpan2
+        The second mapped span to compare
+
+    MismatchOffset
+        Receives the offset, relative to the start of the spans, of the first
+        byte that differs, or the length of the spans if they are equal
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    SIZE_T Index1 = 0;
+    SIZE_T Offset1 = 0;
+    SIZE_T Index2 = 0;
+    SIZE_T Offset2 = 0;
+    SIZE_T BytesCompared = 0;
+    SIZE_T ComparisonLength = MinSizeT(MappedSpan1->Length, MappedSpan2->Length);
+
+    while (BytesCompared < ComparisonLength)
+    {
+        MDL_MAPPED_FRAGMENT const* Fragment1 = &MappedSpan1->Fragments[Index1];
+        MDL_MAPPED_FRAGMENT const* Fragment2 = &MappedSpan2->Fragments[Index2];
+
+        SIZE_T CommonLength =
+            MinSizeT(ComparisonLength - BytesCompared,
+            MinSizeT(Fragment1->Length - Offset1, Fragment2->Length - Offset2));
+
+        SIZE_T Mismatch = FindFirstMismatch(
+            Fragment1->Buffer + Offset1,
+            Fragment2->Buffer + Offset2,
+            CommonLength);
+
+        if (Mismatch != CommonLength)
+        {
+            *MismatchOffset = BytesCompared + Mismatch;
+            return STATUS_SUCCESS;
+        }
+
+        Offset1 += CommonLength;
+        if (Offset1 == Fragment1->Length)
+        {
+            Index1 += 1;
+            Offset1 = 0;
+        }
+
+        Offset2 += CommonLength;
+        if (Offset2 == Fragment2->Length)
+        {
+            Index2 += 1;
+            Offset2 = 0;
+        }
+
+        BytesCompared += CommonLength;
+    }
+
+    *MismatchOffset = ComparisonLength;
+    return STATUS_SUCCESS;
+}
+
+#define CHECKSUM_OPERATOR_CONTEXT_t _MdlPrivate_CHECKSUM_OPERATOR_CONTEXT_t
+#define CHECKSUM_OPERATOR_CONTEXT _MdlPrivate_CHECKSUM_OPERATOR_CONTEXT
+
+typedef struct CHECKSUM_OPERATOR_CONTEXT_t
+{
+    // The sum of each buffer's 16-bit partial Internet checksum, or the
+    // running CRC32C
+    ULONG64 Accumulator;
+
+    // The number of bytes checksummed so far
+    SIZE_T BytesProcessed;
+
+    // If not NULL, each MDL buffer is also copied here
+    UCHAR* FlatDestination;
+
+    // If not NULL, each MDL buffer is written from here, and the data written
+    // is checksummed
+    UCHAR const* FlatSource;
+
+    // TRUE if the processor has CRC32C instructions
+    BOOLEAN UseHardware;
+} CHECKSUM_OPERATOR_CONTEXT;
+
+#define FoldInternetChecksum _MdlPrivate_FoldInternetChecksum
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+ULONG FoldInternetChecksum(
+    _In_ ULONG64 Sum)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+    Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+    Sum = (Sum & 0xFFFF) + (Sum >> 16);
+    Sum = (Sum & 0xFFFF) + (Sum >> 16);
+
+    return (ULONG)Sum;
+}
+
+#define ComputeInternetChecksum _MdlPrivate_ComputeInternetChecksum
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+ULONG ComputeInternetChecksum(
+    _In_reads_(Length) UCHAR const* Source,
+    _Out_writes_opt_(Length) UCHAR* Destination,
+    _In_ SIZE_T Length)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Returns the 16-bit one's complement sum of the buffer, folded but not
+    complemented, in the byte order of the buffer. If Destination is not NULL,
+    the buffer is also copied there.
+
+--*/
+{
+    ULONG64 Sum0 = 0;
+    ULONG64 Sum1 = 0;
+    ULONG64 Word0;
+    ULONG64 Word1;
+
+    if (Destination == NULL)
+    {
+        while (Length >= 2 * sizeof(ULONG64))
+        {
+            RtlCopyMemory(&Word0, Source, sizeof(ULONG64));
+            RtlCopyMemory(&Word1, Source + sizeof(ULONG64), sizeof(ULONG64));
+
+            Sum0 += Word0;
+            Sum0 += (Sum0 < Word0);
+            Sum1 += Word1;
+            Sum1 += (Sum1 < Word1);
+
+            Source += 2 * sizeof(ULONG64);
+            Length -= 2 * sizeof(ULONG64);
+        }
+    }
+    else
+    {
+        while (Length >= 2 * sizeof(ULONG64))
+        {
+            RtlCopyMemory(&Word0, Source, sizeof(ULONG64));
+            RtlCopyMemory(&Word1, Source + sizeof(ULONG64), sizeof(ULONG64));
+            RtlCopyMemory(Destination, &Word0, sizeof(ULONG64));
+            RtlCopyMemory(Destination + sizeof(ULONG64), &Word1, sizeof(ULONG64));
+
+            Sum0 += Word0;
+            Sum0 += (Sum0 < Word0);
+            Sum1 += Word1;
+            Sum1 += (Sum1 < Word1);
+
+            Source += 2 * sizeof(ULONG64);
+            Destination += 2 * sizeof(ULONG64);
+            Length -= 2 * sizeof(ULONG64);
+        }
+    }
+
+    if (Length >= sizeof(ULONG64))
+    {
+        RtlCopyMemory(&Word0, Source, sizeof(ULONG64));
+        if (Destination != NULL)
+        {
+            RtlCopyMemory(Destination, &Word0, sizeof(ULONG64));
+            Destination += sizeof(ULONG64);
+        }
+
+        Sum0 += Word0;
+        Sum0 += (Sum0 < Word0);
+
+        Source += sizeof(ULONG64);
+        Length -= sizeof(ULONG64);
+    }
+
+    if (Length > 0)
+    {
+        Word0 = 0;
+        RtlCopyMemory(&Word0, Source, Length);
+        if (Destination != NULL)
+        {
+            RtlCopyMemory(Destination, Source, Length);
+        }
+
+        Sum0 += Word0;
+        Sum0 += (Sum0 < Word0);
+    }
+
+    return FoldInternetChecksum(FoldInternetChecksum(Sum0) + FoldInternetChecksum(Sum1));
+}
+
+#define IsCrc32cHardwareAvailable _MdlPrivate_IsCrc32cHardwareAvailable
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN IsCrc32cHardwareAvailable()
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+#if defined(_M_AMD64) && defined(PF_SSE4_2_INSTRUCTIONS_AVAILABLE)
+    return ExIsProcessorFeaturePresent(PF_SSE4_2_INSTRUCTIONS_AVAILABLE);
+#elif defined(_M_ARM64) && defined(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE)
+    return ExIsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE);
+#else
+    return FALSE;
+#endif
+}
+
+#define ComputeCrc32c _MdlPrivate_ComputeCrc32c
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+ULONG ComputeCrc32c(
+    _In_ ULONG Crc,
+    _In_reads_(Length) UCHAR const* Source,
+    _Out_writes_opt_(Length) UCHAR* Destination,
+    _In_ SIZE_T Length,
+    _In_ BOOLEAN UseHardware)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Updates a raw (not inverted) CRC32C with the contents of the buffer. If
+    Destination is not NULL, the buffer is also copied there.
+
+--*/
+{
+#if defined(_M_AMD64) || defined(_M_ARM64)
+    if (UseHardware)
+    {
+        while (Length >= sizeof(ULONG64))
+        {
+            ULONG64 Word;
+            RtlCopyMemory(&Word, Source, sizeof(Word));
+            if (Destination != NULL)
+            {
+                RtlCopyMemory(Destination, &Word, sizeof(Word));
+                Destination += sizeof(Word);
+            }
+
+#if defined(_M_AMD64)
+            Crc = (ULONG)_mm_crc32_u64(Crc, Word);
+#else
+            Crc = __crc32cd(Crc, Word);
+#endif
+
+            Source += sizeof(Word);
+            Length -= sizeof(Word);
+        }
+
+        for (; Length > 0; Length--, Source++)
+        {
+            if (Destination != NULL)
+            {
+                *Destination++ = *Source;
+            }
+
+#if defined(_M_AMD64)
+            Crc = _mm_crc32_u8(Crc, *Source);
+#else
+            Crc = __crc32cb(Crc, *Source);
+#endif
+        }
+
+        return Crc;
+    }
+#else
+    UNREFERENCED_PARAMETER(UseHardware);
+#endif
+
+    ULONG const Table[16] =
+    {
+        0x00000000, 0x105EC76F, 0x20BD8EDE, 0x30E349B1,
+        0x417B1DBC, 0x5125DAD3, 0x61C69362, 0x7198540D,
+        0x82F63B78, 0x92A8FC17, 0xA24BB5A6, 0xB21572C9,
+        0xC38D26C4, 0xD3D3E1AB, 0xE330A81A, 0xF36E6F75,
+    };
+
+    for (; Length > 0; Length--, Source++)
+    {
+        if (Destination != NULL)
+        {
+            *Destination++ = *Source;
+        }
+
+        Crc ^= *Source;
+        Crc = (Crc >> 4) ^ Table[Crc & 0xF];
+        Crc = (Crc >> 4) ^ Table[Crc & 0xF];
+    }
+
+    return Crc;
+}
+
+#define ChecksumOperatorInternetChecksum _MdlPrivate_ChecksumOperatorInternetChecksum
+
+MDL_BUFFER_OPERATOR ChecksumOperatorInternetChecksum;
+
+_Use_decl_annotations_
+inline
+NTSTATUS ChecksumOperatorInternetChecksum(
+    PVOID OperatorContext,
+    MDL_SPAN const* Span)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    CHECKSUM_OPERATOR_CONTEXT* Context = (CHECKSUM_OPERATOR_CONTEXT*)OperatorContext;
+    UCHAR const* Source;
+    UCHAR* Destination = NULL;
+
+    if (Context->FlatSource)
+    {
+        UCHAR* Buffer = MDL_MAP_BUFFER(Span->Start.Mdl);
+        if (!Buffer)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        Source = Context->FlatSource;
+        Destination = Buffer + Span->Start.Offset;
+        Context->FlatSource += Span->Length;
+    }
+    else
+    {
+        UCHAR const* Buffer = MDL_MAP_CONST_BUFFER(Span->Start.Mdl);
+        if (!Buffer)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        Source = Buffer + Span->Start.Offset;
+        if (Context->FlatDestination)
+        {
+            Destination = Context->FlatDestination;
+            Context->FlatDestination += Span->Length;
+        }
+    }
+
+    ULONG PartialSum = ComputeInternetChecksum(Source, Destination, Span->Length);
+
+    if (0 != (Context->BytesProcessed & 1))
+    {
+        PartialSum = ((PartialSum & 0xFF) << 8) | (PartialSum >> 8);
+    }
+
+    Context->Accumulator += PartialSum;
+    Context->BytesProcessed += Span->Length;
+
+    return STATUS_SUCCESS;
+}
+
+#define SpanChecksumInternetChecksum _MdlPrivate_SpanChecksumInternetChecksum
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS SpanChecksumInternetChecksum(
+    _In_ MDL_SPAN const* Span,
+    _In_opt_ UCHAR* FlatDestination,
+    _In_opt_ UCHAR const* FlatSource,
+    _In_ USHORT InitialChecksum,
+    _Out_ USHORT* Checksum)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    CHECKSUM_OPERATOR_CONTEXT Context = { 0 };
+    Context.FlatDestination = FlatDestination;
+    Context.FlatSource = FlatSource;
+    Context.Accumulator = InitialChecksum;
+    Context.UseHardware = FALSE;
+
+    NTSTATUS NtStatus = MdlSpanIterateBuffers(Span, ChecksumOperatorInternetChecksum, &Context);
+    if (STATUS_SUCCESS != NtStatus)
+    {
+        *Checksum = 0;
+        return NtStatus;
+    }
+
+    *Checksum = (USHORT)FoldInternetChecksum(Context.Accumulator);
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlSpanComputeInternetChecksum(
+    _In_ MDL_SPAN const* Span,
+    _In_ USHORT InitialChecksum,
+    _Out_ USHORT* Checksum)
+/*++
+
+Routine Description:
+
+    Computes the Internet checksum of the buffers contained in the MDL span
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    The result is the 16-bit one's complement sum of the data as defined by
+    RFC 1071, in the byte order of the data. It is not complemented; store
+    (USHORT)~Checksum into a TCP, UDP, or IP header. Buffers that begin on an
+    odd byte boundary are handled correctly.
+
+Arguments:
+
+    Span
+        The MDL span to process
+
+    InitialChecksum
+        A partial checksum to add to the result, for example the sum of a
+        pseudo-header, or 0. To continue a previous checksum, pass its
+        result here; this is only valid if the previous data had an even
+        length.
+
+    Checksum
+        Receives the Internet checksum of the data
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return SpanChecksumInternetChecksum(Span, NULL, NULL, InitialChecksum, Checksum);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlChainComputeInternetChecksumAtOffset(
+    _In_ MDL* MdlChain,
+    _In_ SIZE_T Offset,
+    _In_ SIZE_T Length,
+    _In_ USHORT InitialChecksum,
+    _Out_ USHORT* Checksum)
+/*++
+
+Routine Description:
+
+    Computes the Internet checksum of the buffers at some subset of an MDL
+    chain
+
+    If Offset plus Length extends past the end of the MDL chain, this routine
+    crashes the system with a fatal overflow error.
+
+    The result is the 16-bit one's complement sum of the data as defined by
+    RFC 1071, in the byte order of the data. It is not complemented; store
+    (USHORT)~Checksum into a TCP, UDP, or IP header. Buffers that begin on an
+    odd byte boundary are handled correctly.
+
+Arguments:
+
+    MdlChain
+        The MDL chain to process
+
+    Offset
+        The offset into the MDL chain's buffers at which to begin
+
+    Length
+        The number of bytes to process
+
+    InitialChecksum
+        A partial checksum to add to the result, for example the sum of a
+        pseudo-header, or 0. To continue a previous checksum, pass its
+        result here; this is only valid if the previous data had an even
+        length.
+
+    Checksum
+        Receives the Internet checksum of the data
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_SPAN Span = { { 0 } };
+    Span.Start.Mdl = MdlChain;
+    Span.Start.Offset = Offset;
+    Span.Length = Length;
+
+    return SpanChecksumInternetChecksum(&Span, NULL, NULL, InitialChecksum, Checksum);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlSpanToFlatBufferWithInternetChecksum(
+    _Out_writes_(Source->Length) UCHAR* DestinationBuffer,
+    _In_ MDL_SPAN const* Source,
+    _In_ USHORT InitialChecksum,
+    _Out_ USHORT* Checksum)
+/*++
+
+Routine Description:
+
+    Copies data from an MDL span into a buffer, and computes the
+    Internet checksum of the data in the same pass
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    The result is the 16-bit one's complement sum of the data as defined by
+    RFC 1071, in the byte order of the data. It is not complemented; store
+    (USHORT)~Checksum into a TCP, UDP, or IP header. Buffers that begin on an
+    odd byte boundary are handled correctly.
+
+Arguments:
+
+    DestinationBuffer
+        The buffer to write into
+
+    Source
+        The MDL span to read from
+
+    InitialChecksum
+        A partial checksum to add to the result, for example the sum of a
+        pseudo-header, or 0. To continue a previous checksum, pass its
+        result here; this is only valid if the previous data had an even
+        length.
+
+    Checksum
+        Receives the Internet checksum of the data
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return SpanChecksumInternetChecksum(Source, DestinationBuffer, NULL, InitialChecksum, Checksum);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyFlatBufferToMdlSpanWithInternetChecksum(
+    _In_ MDL_SPAN const* DestinationSpan,
+    _In_reads_(DestinationSpan->Length) UCHAR const* SourceBuffer,
+    _In_ USHORT InitialChecksum,
+    _Out_ USHORT* Checksum)
+/*++
+
+Routine Description:
+
+    Copies data from a single buffer into an MDL chain, and computes the
+    Internet checksum of the data in the same pass
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    The result is the 16-bit one's complement sum of the data as defined by
+    RFC 1071, in the byte order of the data. It is not complemented; store
+    (USHORT)~Checksum into a TCP, UDP, or IP header. Buffers that begin on an
+    odd byte boundary are handled correctly.
+
+Arguments:
+
+    DestinationSpan
+        The span of bytes to write into
+
+    SourceBuffer
+        The buffer to read from
+
+    InitialChecksum
+        A partial checksum to add to the result, for example the sum of a
+        pseudo-header, or 0. To continue a previous checksum, pass its
+        result here; this is only valid if the previous data had an even
+        length.
+
+    Checksum
+        Receives the Internet checksum of the data
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return SpanChecksumInternetChecksum(DestinationSpan, NULL, SourceBuffer, InitialChecksum, Checksum);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlMappedSpanComputeInternetChecksum(
+    _In_ MDL_MAPPED_SPAN const* MappedSpan,
+    _In_ USHORT InitialChecksum,
+    _Out_ USHORT* Checksum)
+/*++
+
+Routine Description:
+
+    Computes the Internet checksum of every fragment of a mapped span
+
+    The result is the 16-bit one's complement sum of the data as defined by
+    RFC 1071, in the byte order of the data. It is not complemented; store
+    (USHORT)~Checksum into a TCP, UDP, or IP header. Buffers that begin on an
+    odd byte boundary are handled correctly.
+
+Arguments:
+
+    MappedSpan
+        The mapped span to process
+
+    InitialChecksum
+        A partial checksum to add to the result, for example the sum of a
+        pseudo-header, or 0. To continue a previous checksum, pass its
+        result here; this is only valid if the previous data had an even
+        length.
+
+    Checksum
+        Receives the Internet checksum of the data
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    ULONG64 Accumulator = InitialChecksum;
+    SIZE_T BytesProcessed = 0;
+
+    for (SIZE_T i = 0; i < MappedSpan->NumberOfFragments; i++)
+    {
+        MDL_MAPPED_FRAGMENT const* Fragment = &MappedSpan->Fragments[i];
+
+        ULONG PartialSum = ComputeInternetChecksum(Fragment->Buffer, NULL, Fragment->Length);
+        if (0 != (BytesProcessed & 1))
+        {
+            PartialSum = ((PartialSum & 0xFF) << 8) | (PartialSum >> 8);
+        }
+
+        Accumulator += PartialSum;
+        BytesProcessed += Fragment->Length;
+    }
+
+    *Checksum = (USHORT)FoldInternetChecksum(Accumulator);
+    return STATUS_SUCCESS;
+}
+
+#define ChecksumOperatorCrc32c _MdlPrivate_ChecksumOperatorCrc32c
+
+MDL_BUFFER_OPERATOR ChecksumOperatorCrc32c;
+
+_Use_decl_annotations_
+inline
+NTSTATUS ChecksumOperatorCrc32c(
+    PVOID OperatorContext,
+    MDL_SPAN const* Span)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    CHECKSUM_OPERATOR_CONTEXT* Context = (CHECKSUM_OPERATOR_CONTEXT*)OperatorContext;
+    UCHAR const* Source;
+    UCHAR* Destination = NULL;
+
+    if (Context->FlatSource)
+    {
+        UCHAR* Buffer = MDL_MAP_BUFFER(Span->Start.Mdl);
+        if (!Buffer)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        Source = Context->FlatSource;
+        Destination = Buffer + Span->Start.Offset;
+        Context->FlatSource += Span->Length;
+    }
+    else
+    {
+        UCHAR const* Buffer = MDL_MAP_CONST_BUFFER(Span->Start.Mdl);
+        if (!Buffer)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        Source = Buffer + Span->Start.Offset;
+        if (Context->FlatDestination)
+        {
+            Destination = Context->FlatDestination;
+            Context->FlatDestination += Span->Length;
+        }
+    }
+
+    Context->Accumulator = ComputeCrc32c(
+        (ULONG)Context->Accumulator, Source, Destination, Span->Length, Context->UseHardware);
+    Context->BytesProcessed += Span->Length;
+
+    return STATUS_SUCCESS;
+}
+
+#define SpanChecksumCrc32c _MdlPrivate_SpanChecksumCrc32c
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS SpanChecksumCrc32c(
+    _In_ MDL_SPAN const* Span,
+    _In_opt_ UCHAR* FlatDestination,
+    _In_opt_ UCHAR const* FlatSource,
+    _In_ ULONG InitialChecksum,
+    _Out_ ULONG* Checksum)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    CHECKSUM_OPERATOR_CONTEXT Context = { 0 };
+    Context.FlatDestination = FlatDestination;
+    Context.FlatSource = FlatSource;
+    Context.Accumulator = ~InitialChecksum;
+    Context.UseHardware = IsCrc32cHardwareAvailable();
+
+    NTSTATUS NtStatus = MdlSpanIterateBuffers(Span, ChecksumOperatorCrc32c, &Context);
+    if (STATUS_SUCCESS != NtStatus)
+    {
+        *Checksum = 0;
+        return NtStatus;
+    }
+
+    *Checksum = ~(ULONG)Context.Accumulator;
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlSpanComputeCrc32c(
+    _In_ MDL_SPAN const* Span,
+    _In_ ULONG InitialChecksum,
+    _Out_ ULONG* Checksum)
+/*++
+
+Routine Description:
+
+    Computes the CRC32C of the buffers contained in the MDL span
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    The result uses the Castagnoli polynomial (0x1EDC6F41) with the usual
+    initial and final inversion, as used by iSCSI and SCTP. When available,
+    the processor's CRC32C instructions are used.
+
+Arguments:
+
+    Span
+        The MDL span to process
+
+    InitialChecksum
+        The CRC32C of any preceding data, or 0 to start a new CRC
+
+    Checksum
+        Receives the CRC32C of the data
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return SpanChecksumCrc32c(Span, NULL, NULL, InitialChecksum, Checksum);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlChainComputeCrc32cAtOffset(
+    _In_ MDL* MdlChain,
+    _In_ SIZE_T Offset,
+    _In_ SIZE_T Length,
+    _In_ ULONG InitialChecksum,
+    _Out_ ULONG* Checksum)
+/*++
+
+Routine Description:
+
+    Computes the CRC32C of the buffers at some subset of an MDL
+    chain
+
+    If Offset plus Length extends past the end of the MDL chain, this routine
+    crashes the system with a fatal overflow error.
+
+    The result uses the Castagnoli polynomial (0x1EDC6F41) with the usual
+    initial and final inversion, as used by iSCSI and SCTP. When available,
+    the processor's CRC32C instructions are used.
+
+Arguments:
+
+    MdlChain
+        The MDL chain to process
+
+    Offset
+        The offset into the MDL chain's buffers at which to begin
+
+    Length
+        The number of bytes to process
+
+    InitialChecksum
+        The CRC32C of any preceding data, or 0 to start a new CRC
+
+    Checksum
+        Receives the CRC32C of the data
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    MDL_SPAN Span = { { 0 } };
+    Span.Start.Mdl = MdlChain;
+    Span.Start.Offset = Offset;
+    Span.Length = Length;
+
+    return SpanChecksumCrc32c(&Span, NULL, NULL, InitialChecksum, Checksum);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyMdlSpanToFlatBufferWithCrc32c(
+    _Out_writes_(Source->Length) UCHAR* DestinationBuffer,
+    _In_ MDL_SPAN const* Source,
+    _In_ ULONG InitialChecksum,
+    _Out_ ULONG* Checksum)
+/*++
+
+Routine Description:
+
+    Copies data from an MDL span into a buffer, and computes the
+    CRC32C of the data in the same pass
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    The result uses the Castagnoli polynomial (0x1EDC6F41) with the usual
+    initial and final inversion, as used by iSCSI and SCTP. When available,
+    the processor's CRC32C instructions are used.
+
+Arguments:
+
+    DestinationBuffer
+        The buffer to write into
+
+    Source
+        The MDL span to read from
+
+    InitialChecksum
+        The CRC32C of any preceding data, or 0 to start a new CRC
+
+    Checksum
+        Receives the CRC32C of the data
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return SpanChecksumCrc32c(Source, DestinationBuffer, NULL, InitialChecksum, Checksum);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCopyFlatBufferToMdlSpanWithCrc32c(
+    _In_ MDL_SPAN const* DestinationSpan,
+    _In_reads_(DestinationSpan->Length) UCHAR const* SourceBuffer,
+    _In_ ULONG InitialChecksum,
+    _Out_ ULONG* Checksum)
+/*++
+
+Routine Description:
+
+    Copies data from a single buffer into an MDL chain, and computes the
+    CRC32C of the data in the same pass
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+    The result uses the Castagnoli polynomial (0x1EDC6F41) with the usual
+    initial and final inversion, as used by iSCSI and SCTP. When available,
+    the processor's CRC32C instructions are used.
+
+Arguments:
+
+    DestinationSpan
+        The span of bytes to write into
+
+    SourceBuffer
+        The buffer to read from
+
+    InitialChecksum
+        The CRC32C of any preceding data, or 0 to start a new CRC
+
+    Checksum
+        Receives the CRC32C of the data
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    return SpanChecksumCrc32c(DestinationSpan, NULL, SourceBuffer, InitialChecksum, Checksum);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlMappedSpanComputeCrc32c(
+    _In_ MDL_MAPPED_SPAN const* MappedSpan,
+    _In_ ULONG InitialChecksum,
+    _Out_ ULONG* Checksum)
+/*++
+
+Routine Description:
+
+    Computes the CRC32C of every fragment of a mapped span
+
+    The result uses the Castagnoli polynomial (0x1EDC6F41) with the usual
+    initial and final inversion, as used by iSCSI and SCTP. When available,
+    the processor's CRC32C instructions are used.
+
+Arguments:
+
+    MappedSpan
+        The mapped span to process
+
+    InitialChecksum
+        The CRC32C of any preceding data, or 0 to start a new CRC
+
+    Checksum
+        Receives the CRC32C of the data
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every buffer was processed successfully
+
+--*/
+{
+    BOOLEAN UseHardware = IsCrc32cHardwareAvailable();
+    ULONG Crc = ~InitialChecksum;
+
+    for (SIZE_T i = 0; i < MappedSpan->NumberOfFragments; i++)
+    {
+        MDL_MAPPED_FRAGMENT const* Fragment = &MappedSpan->Fragments[i];
+
+        Crc = ComputeCrc32c(Crc, Fragment->Buffer, NULL, Fragment->Length, UseHardware);
+    }
+
+    *Checksum = ~Crc;
+    return STATUS_SUCCESS;
+}
+
+#define CursorAdvanceWithinMdl _MdlPrivate_CursorAdvanceWithinMdl
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void CursorAdvanceWithinMdl(
+    _Inout_ MDL_CURSOR* Cursor,
+    _In_ SIZE_T Delta)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Moves the cursor forward by Delta bytes, which must not extend past the end
+    of the current MDL, and then restores normal form.
+
+--*/
+{
+    Cursor->Position.Offset += Delta;
+    Cursor->BytesRemaining -= Delta;
+
+    while (Cursor->Position.Mdl &&
+        Cursor->Position.Offset >= MmGetMdlByteCount(Cursor->Position.Mdl))
+    {
+        Cursor->Position.Offset -= MmGetMdlByteCount(Cursor->Position.Mdl);
+        Cursor->Position.Mdl = Cursor->Position.Mdl->Next;
+        Cursor->MappedBuffer = NULL;
+    }
+}
+
+#define CursorGetBytesInMdl _MdlPrivate_CursorGetBytesInMdl
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+SIZE_T CursorGetBytesInMdl(
+    _In_ MDL_CURSOR const* Cursor)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Returns the number of bytes of the span that remain in the current MDL.
+
+--*/
+{
+    if (!Cursor->Position.Mdl)
+    {
+        // The span claims more bytes than the MDL chain has
+        ReportFatalOverflow(Cursor->Position.Mdl, Cursor->BytesRemaining);
+    }
+
+    return MinSizeT(
+        Cursor->BytesRemaining,
+        MmGetMdlByteCount(Cursor->Position.Mdl) - Cursor->Position.Offset);
+}
+
+#define CursorMapBuffer _MdlPrivate_CursorMapBuffer
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+UCHAR const* CursorMapBuffer(
+    _Inout_ MDL_CURSOR* Cursor)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Returns the system address of the byte at the cursor, or NULL if the
+    current MDL could not be mapped.
+
+--*/
+{
+    if (!Cursor->MappedBuffer)
+    {
+        Cursor->MappedBuffer = MDL_MAP_CONST_BUFFER(Cursor->Position.Mdl);
+        if (!Cursor->MappedBuffer)
+        {
+            return NULL;
+        }
+    }
+
+    return Cursor->MappedBuffer + Cursor->Position.Offset;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+MdlCursorInitialize(
+    _Out_ MDL_CURSOR* Cursor,
+    _In_ MDL_SPAN const* Span)
+/*++
+
+Routine Description:
+
+    Initializes a cursor to read the bytes of an MDL span, starting at the
+    beginning of the span
+
+    The MDL chain must not change while the cursor is in use.
+
+    If the Span extends past the end of the MDL chain, either this routine or
+    the cursor routine that reaches the end of the MDL chain crashes the system
+    with a fatal overflow error.
+
+Arguments:
+
+    Cursor
+        The cursor to initialize
+
+    Span
+        The bytes that the cursor will read
+
+--*/
+{
+    Cursor->Position = Span->Start;
+    Cursor->BytesRemaining = Span->Length;
+    Cursor->MappedBuffer = NULL;
+
+    if (Cursor->Position.Mdl)
+    {
+        MdlPointerNormalize(&Cursor->Position);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCursorRead(
+    _Inout_ MDL_CURSOR* Cursor,
+    _Out_writes_(Length) UCHAR* Destination,
+    _In_ SIZE_T Length)
+/*++
+
+Routine Description:
+
+    Copies bytes from the cursor into a flat buffer, and advances the cursor
+    past them
+
+    If the cursor's span extends past the end of the MDL chain, and this
+    routine reaches the end of the MDL chain, this routine crashes the system
+    with a fatal overflow error.
+
+Arguments:
+
+    Cursor
+        The cursor to read from
+
+    Destination
+        Receives the bytes
+
+    Length
+        The number of bytes to read
+
+Return Value:
+
+    STATUS_SUCCESS
+        The bytes were copied, and the cursor was advanced
+
+    STATUS_BUFFER_TOO_SMALL
+        Fewer than Length bytes remain in the cursor's span. The cursor is
+        unchanged.
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space. The
+        cursor was advanced past any bytes that were already copied.
+
+--*/
+{
+    if (Length > Cursor->BytesRemaining)
+    {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    while (Length > 0)
+    {
+        SIZE_T BytesInMdl = MinSizeT(Length, CursorGetBytesInMdl(Cursor));
+
+        UCHAR const* Source = CursorMapBuffer(Cursor);
+        if (!Source)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        RtlCopyMemory(Destination, Source, BytesInMdl);
+
+        CursorAdvanceWithinMdl(Cursor, BytesInMdl);
+        Destination += BytesInMdl;
+        Length -= BytesInMdl;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCursorPeek(
+    _Inout_ MDL_CURSOR* Cursor,
+    _Out_writes_(Length) UCHAR* Destination,
+    _In_ SIZE_T Length)
+/*++
+
+Routine Description:
+
+    Copies bytes from the cursor into a flat buffer, without advancing the
+    cursor
+
+    The cursor may remember the mapping of the current MDL, so it is passed by
+    non-const pointer, but its position does not change.
+
+    If the cursor's span extends past the end of the MDL chain, and this
+    routine reaches the end of the MDL chain, this routine crashes the system
+    with a fatal overflow error.
+
+Arguments:
+
+    Cursor
+        The cursor to read from
+
+    Destination
+        Receives the bytes
+
+    Length
+        The number of bytes to read
+
+Return Value:
+
+    STATUS_SUCCESS
+        The bytes were copied
+
+    STATUS_BUFFER_TOO_SMALL
+        Fewer than Length bytes remain in the cursor's span
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    if (Length > Cursor->BytesRemaining)
+    {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    if (Length > 0 && Length <= CursorGetBytesInMdl(Cursor))
+    {
+        UCHAR const* Source = CursorMapBuffer(Cursor);
+        if (!Source)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        RtlCopyMemory(Destination, Source, Length);
+        return STATUS_SUCCESS;
+    }
+
+    MDL_CURSOR LocalCursor = *Cursor;
+    return MdlCursorRead(&LocalCursor, Destination, Length);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCursorSkip(
+    _Inout_ MDL_CURSOR* Cursor,
+    _In_ SIZE_T Length)
+/*++
+
+Routine Description:
+
+    Advances the cursor without reading any bytes
+
+    If the cursor's span extends past the end of the MDL chain, and this
+    routine reaches the end of the MDL chain, this routine crashes the system
+    with a fatal overflow error.
+
+Arguments:
+
+    Cursor
+        The cursor to advance
+
+    Length
+        The number of bytes to skip
+
+Return Value:
+
+    STATUS_SUCCESS
+        The cursor was advanced
+
+    STATUS_BUFFER_TOO_SMALL
+        Fewer than Length bytes remain in the cursor's span. The cursor is
+        unchanged.
+
+--*/
+{
+    if (Length > Cursor->BytesRemaining)
+    {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    while (Length > 0)
+    {
+        SIZE_T BytesInMdl = MinSizeT(Length, CursorGetBytesInMdl(Cursor));
+
+        CursorAdvanceWithinMdl(Cursor, BytesInMdl);
+        Length -= BytesInMdl;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlCursorGetContiguous(
+    _Inout_ MDL_CURSOR* Cursor,
+    _In_ SIZE_T Length,
+    _Out_writes_(Length) UCHAR* Storage,
+    _Outptr_result_bytebuffer_(Length) UCHAR const** Data)
+/*++
+
+Routine Description:
+
+    Gets a pointer to the next Length bytes at the cursor, and advances the
+    cursor past them
+
+    If the bytes are contained in a single MDL, Data receives a pointer
+    directly into the MDL's buffer and Storage is not touched. Otherwise, the
+    bytes are copied into Storage and Data receives Storage. Either way, the
+    pointer is only valid while the MDL chain's buffers are valid, and you must
+    not write through it.
+
+    If the cursor's span extends past the end of the MDL chain, and this
+    routine reaches the end of the MDL chain, this routine crashes the system
+    with a fatal overflow error.
+
+Arguments:
+
+    Cursor
+        The cursor to read from
+
+    Length
+        The number of bytes to get
+
+    Storage
+        A buffer of at least Length bytes, used if the bytes straddle more than
+        one MDL
+
+    Data
+        Receives a pointer to the bytes
+
+Return Value:
+
+    STATUS_SUCCESS
+        Data points to the bytes, and the cursor was advanced
+
+    STATUS_BUFFER_TOO_SMALL
+        Fewer than Length bytes remain in the cursor's span. The cursor is
+        unchanged.
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    *Data = Storage;
+
+    if (Length > Cursor->BytesRemaining)
+    {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    if (Length == 0)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    if (Length <= CursorGetBytesInMdl(Cursor))
+    {
+        UCHAR const* Source = CursorMapBuffer(Cursor);
+        if (!Source)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        CursorAdvanceWithinMdl(Cursor, Length);
+        *Data = Source;
+        return STATUS_SUCCESS;
+    }
+
+    MDL_CURSOR LocalCursor = *Cursor;
+    NTSTATUS NtStatus = MdlCursorRead(&LocalCursor, Storage, Length);
+    if (STATUS_SUCCESS != NtStatus)
+    {
+        return NtStatus;
+    }
+
+    *Cursor = LocalCursor;
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlSpanGetContiguousOrCopy(
+    _In_ MDL_SPAN const* Span,
+    _Out_writes_(Span->Length) UCHAR* Storage,
+    _Outptr_result_bytebuffer_(Span->Length) UCHAR const** Data,
+    _Out_opt_ BOOLEAN* Copied)
+/*++
+
+Routine Description:
+
+    Gets a pointer to the bytes of an MDL span, copying them only if they
+    straddle more than one MDL
+
+    This is the one-shot version of MdlCursorGetContiguous. If the span is
+    contained in a single MDL, Data receives a pointer directly into the MDL's
+    buffer and Storage is not touched. Otherwise, the bytes are copied into
+    Storage and Data receives Storage. Either way, the pointer is only valid
+    while the MDL chain's buffers are valid, and you must not write through it.
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+Arguments:
+
+    Span
+        The bytes to get
+
+    Storage
+        A buffer of at least Span->Length bytes, used if the bytes straddle
+        more than one MDL
+
+    Data
+        Receives a pointer to the bytes
+
+    Copied
+        Optional. Receives TRUE if the bytes were copied into Storage, or FALSE
+        if Data points into the MDL's buffer.
+
+Return Value:
+
+    STATUS_SUCCESS
+        Data points to the bytes
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space
+
+--*/
+{
+    *Data = Storage;
+
+    if (Copied)
+    {
+        *Copied = FALSE;
+    }
+
+    if (Span->Length == 0)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    MDL_CURSOR Cursor;
+    MdlCursorInitialize(&Cursor, Span);
+
+    if (Span->Length <= CursorGetBytesInMdl(&Cursor))
+    {
+        UCHAR const* Source = CursorMapBuffer(&Cursor);
+        if (!Source)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        *Data = Source;
+        return STATUS_SUCCESS;
+    }
+
+    NTSTATUS NtStatus = MdlCursorRead(&Cursor, Storage, Span->Length);
+    if (STATUS_SUCCESS != NtStatus)
+    {
+        return NtStatus;
+    }
+
+    if (Copied)
+    {
+        *Copied = TRUE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+typedef
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_IRQL_requires_same_
+_Function_class_(MDL_ALLOCATE_PARTIAL_MDL)
+MDL*
+MDL_ALLOCATE_PARTIAL_MDL(
+    _In_opt_ PVOID PoolContext,
+    _In_ PVOID VirtualAddress,
+    _In_ ULONG Length);
+/*++
+
+Routine Description:
+
+    A callback that provides an MDL to be initialized with IoBuildPartialMdl
+
+Arguments:
+
+    PoolContext
+        The Context from the MDL_PARTIAL_MDL_POOL
+
+    VirtualAddress
+        The virtual address that the partial MDL will describe, in the same
+        address space as MmGetMdlVirtualAddress of the original MDL
+
+    Length
+        The number of bytes that the partial MDL will describe
+
+Return Value:
+
+    An MDL that is large enough to describe Length bytes at VirtualAddress,
+    for example, one returned by IoAllocateMdl(VirtualAddress, Length, FALSE,
+    FALSE, NULL). Or NULL, if no MDL is available.
+
+--*/
+
+typedef
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_IRQL_requires_same_
+_Function_class_(MDL_FREE_PARTIAL_MDL)
+void
+MDL_FREE_PARTIAL_MDL(
+    _In_opt_ PVOID PoolContext,
+    _In_ MDL* Mdl);
+/*++
+
+Routine Description:
+
+    A callback that takes back an MDL that was provided by a
+    MDL_ALLOCATE_PARTIAL_MDL callback
+
+    The partial MDL may have been mapped into system address space. Before
+    you free or reuse it, call MmPrepareMdlForReuse.
+
+Arguments:
+
+    PoolContext
+        The Context from the MDL_PARTIAL_MDL_POOL
+
+    Mdl
+        The MDL to free
+
+--*/
+
+// An MDL_PARTIAL_MDL_POOL supplies the MDLs for the partial MDL chains built
+// by MdlSpanBuildPartialMdlChain and MdlSpanSplitIntoChains.
+typedef struct MDL_PARTIAL_MDL_POOL_t
+{
+    MDL_ALLOCATE_PARTIAL_MDL* Allocate;
+    MDL_FREE_PARTIAL_MDL* Free;
+    PVOID Context;
+} MDL_PARTIAL_MDL_POOL;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+MdlFreePartialMdlChain(
+    _In_opt_ MDL* MdlChain,
+    _In_ MDL_PARTIAL_MDL_POOL const* Pool)
+/*++
+
+Routine Description:
+
+    Returns each MDL of a partial MDL chain to the pool it came from
+
+Arguments:
+
+    MdlChain
+        A chain built by MdlSpanBuildPartialMdlChain or MdlSpanSplitIntoChains
+
+    Pool
+        The pool that was used to build the chain
+
+--*/
+{
+    while (MdlChain)
+    {
+        MDL* Next = MdlChain->Next;
+        Pool->Free(Pool->Context, MdlChain);
+        MdlChain = Next;
+    }
+}
+
+#define BuildPartialMdlChain _MdlPrivate_BuildPartialMdlChain
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS BuildPartialMdlChain(
+    _Inout_ MDL_POINTER* Start,
+    _In_ SIZE_T Length,
+    _In_ MDL_PARTIAL_MDL_POOL const* Pool,
+    _Outptr_result_maybenull_ MDL** MdlChain)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Builds a partial MDL chain for Length bytes at Start, and moves Start past
+    those bytes.
+
+--*/
+{
+    MDL** Tail = MdlChain;
+    *MdlChain = NULL;
+
+    while (Length > 0)
+    {
+        MdlPointerNormalize(Start);
+        if (!Start->Mdl)
+        {
+            ReportFatalOverflow(Start->Mdl, Length);
+        }
+
+        ULONG PieceLength = (ULONG)MinSizeT(
+            Length,
+            MmGetMdlByteCount(Start->Mdl) - Start->Offset);
+
+        PVOID VirtualAddress = (UCHAR*)MmGetMdlVirtualAddress(Start->Mdl) + Start->Offset;
+
+        MDL* Partial = Pool->Allocate(Pool->Context, VirtualAddress, PieceLength);
+        if (!Partial)
+        {
+            MdlFreePartialMdlChain(*MdlChain, Pool);
+            *MdlChain = NULL;
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        IoBuildPartialMdl(Start->Mdl, Partial, VirtualAddress, PieceLength);
+        Partial->Next = NULL;
+
+        *Tail = Partial;
+        Tail = &Partial->Next;
+
+        Start->Offset += PieceLength;
+        Length -= PieceLength;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlSpanBuildPartialMdlChain(
+    _In_ MDL_SPAN const* Span,
+    _In_ MDL_PARTIAL_MDL_POOL const* Pool,
+    _Outptr_result_maybenull_ MDL** MdlChain)
+/*++
+
+Routine Description:
+
+    Builds a new MDL chain that describes exactly the bytes of an MDL span
+
+    Each MDL of the new chain is a partial MDL, built by IoBuildPartialMdl from
+    the corresponding MDL of the span's chain. No payload is copied. The first
+    and last partial MDLs are trimmed to the span's boundaries, so the new
+    chain starts at offset 0 and its total length is the span's length.
+
+    The new chain is valid only while the original MDLs remain valid. Free it
+    with MdlFreePartialMdlChain.
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+Arguments:
+
+    Span
+        The bytes to describe
+
+    Pool
+        Provides the MDLs for the new chain
+
+    MdlChain
+        Receives the new MDL chain, or NULL if the span is empty
+
+Return Value:
+
+    STATUS_SUCCESS
+        The chain was built
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The pool did not provide an MDL. Nothing was built.
+
+--*/
+{
+    MDL_POINTER Start = Span->Start;
+
+    return BuildPartialMdlChain(&Start, Span->Length, Pool, MdlChain);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+MdlSpanSplitIntoChains(
+    _In_ MDL_SPAN const* Span,
+    _In_ SIZE_T ChunkLength,
+    _In_ MDL_PARTIAL_MDL_POOL const* Pool,
+    _Out_writes_to_(MaximumChains, *NumberOfChains) MDL** MdlChains,
+    _In_ SIZE_T MaximumChains,
+    _Out_ SIZE_T* NumberOfChains)
+/*++
+
+Routine Description:
+
+    Splits an MDL span into consecutive chunks, and builds a new partial MDL
+    chain for each chunk
+
+    Each chunk is ChunkLength bytes, except for the last chunk, which holds
+    whatever remains. For example, to segment a TCP payload, pass the MSS as
+    ChunkLength.
+
+    The span's chain is walked only once, regardless of the number of chunks.
+    Each new chain is built as by MdlSpanBuildPartialMdlChain; free each one
+    with MdlFreePartialMdlChain.
+
+    If the Span extends past the end of the MDL chain, this routine crashes the
+    system with a fatal overflow error.
+
+Arguments:
+
+    Span
+        The bytes to split
+
+    ChunkLength
+        The number of bytes in each chunk. Must not be 0.
+
+    Pool
+        Provides the MDLs for the new chains
+
+    MdlChains
+        Receives one new MDL chain for each chunk
+
+    MaximumChains
+        The number of elements in the MdlChains array
+
+    NumberOfChains
+        Receives the number of chains that were built
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every chain was built
+
+    STATUS_INVALID_PARAMETER
+        ChunkLength is 0
+
+    STATUS_BUFFER_TOO_SMALL
+        MdlChains does not have room for every chunk. NumberOfChains receives
+        the number of elements needed, and nothing was built.
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The pool did not provide an MDL. Nothing was built.
+
+--*/
+{
+    *NumberOfChains = 0;
+
+    if (0 == ChunkLength)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    SIZE_T ChainsNeeded = Span->Length / ChunkLength
+        + ((0 != Span->Length % ChunkLength) ? 1 : 0);
+
+    if (ChainsNeeded > MaximumChains)
+    {
+        *NumberOfChains = ChainsNeeded;
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    MDL_POINTER Start = Span->Start;
+    SIZE_T BytesRemaining = Span->Length;
+
+    for (SIZE_T i = 0; i < ChainsNeeded; i++)
+    {
+        SIZE_T Length = MinSizeT(BytesRemaining, ChunkLength);
+
+        NTSTATUS NtStatus = BuildPartialMdlChain(&Start, Length, Pool, &MdlChains[i]);
+        if (STATUS_SUCCESS != NtStatus)
+        {
+            while (i > 0)
+            {
+                i -= 1;
+                MdlFreePartialMdlChain(MdlChains[i], Pool);
+                MdlChains[i] = NULL;
+            }
+
+            return NtStatus;
+        }
+
+        BytesRemaining -= Length;
+    }
+
+    *NumberOfChains = ChainsNeeded;
+    return STATUS_SUCCESS;
+}
+
+#ifdef __cplusplus
+
+namespace ndis
+{
+
+namespace details
+{
+
+inline void mdl_prefetch_cacheline(_In_opt_ void const *address)
+{
+    MDL_PREFETCH_CACHELINE(address);
+    UNREFERENCED_PARAMETER(address);
+}
+
+//
+// A forward iterator over the non-empty buffers of an MDL span.  Don't use
+// this directly; use ndis::mdl_span_fragments instead.
+//
+// Each element is an MDL_SPAN that covers the part of one MDL's buffer that
+// is inside the span, exactly as MdlSpanIterateBuffers would pass it to its
+// callback.
+//
+class mdl_span_fragment_iterator
+{
+public:
+#ifdef NDIS_ITERATOR_CATEGORY
+    using iterator_category = NDIS_ITERATOR_CATEGORY;
+#endif
+    using difference_type = LONG_PTR;
+    using value_type = MDL_SPAN;
+    using pointer = MDL_SPAN const *;
+    using reference = MDL_SPAN const &;
+
+    mdl_span_fragment_iterator() = default;
+
+    explicit mdl_span_fragment_iterator(_In_ MDL_SPAN const &span)
+        : remaining{span.Length}
+    {
+        seek(span.Start.Mdl, span.Start.Offset);
+    }
+
+    reference operator*() const { return fragment; }
+    pointer operator->() const { return &fragment; }
+
+    mdl_span_fragment_iterator &operator++()
+    {
+        seek(fragment.Start.Mdl->Next, 0);
+        return *this;
+    }
+
+    mdl_span_fragment_iterator operator++(int)
+    {
+        mdl_span_fragment_iterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    bool operator==(mdl_span_fragment_iterator const &rhs) const
+    {
+        return fragment.Start.Mdl == rhs.fragment.Start.Mdl;
+    }
+
+    bool operator!=(mdl_span_fragment_iterator const &rhs) const
+    {
+        return fragment.Start.Mdl != rhs.fragment.Start.Mdl;
+    }
+
+private:
+    // Moves to the first non-empty buffer that starts at or after offset
+    // bytes into mdl, or to the end if the span has no bytes left.
+    void seek(_In_opt_ MDL *mdl, SIZE_T offset)
+    {
+        MDL *previous = fragment.Start.Mdl;
+
+        fragment = MDL_SPAN{};
+
+        if (0 == remaining)
+        {
+            return;
+        }
+
+        for (; mdl; mdl = mdl->Next)
+        {
+            MDL_PREFETCH_CACHELINE(mdl->Next);
+
+            SIZE_T const byteCount = MmGetMdlByteCount(mdl);
+            if (byteCount > offset)
+            {
+                fragment.Start.Mdl = mdl;
+                fragment.Start.Offset = offset;
+                fragment.Length = MinSizeT(byteCount - offset, remaining);
+                remaining -= fragment.Length;
+                return;
+            }
+
+            offset -= byteCount;
+            previous = mdl;
+        }
+
+        ReportFatalOverflow(previous, offset + remaining);
+    }
+
+    MDL_SPAN fragment = {};
+    SIZE_T remaining = 0;
+};
+
+class mdl_span_fragment_range
+{
+public:
+    using iterator = mdl_span_fragment_iterator;
+
+    explicit mdl_span_fragment_range(_In_ MDL_SPAN const &s) : span{s} {}
+
+    iterator begin() const { return iterator{span}; }
+    iterator end() const { return iterator{}; }
+
+private:
+    MDL_SPAN span;
+};
+
+} // namespace details
+
+//
+// Ranges over each MDL of zero or more MDLs, and over each non-empty buffer
+// of an MDL span, for use with a range-based for loop:
+//
+//      for (auto mdl : ndis::mdl_chain(mdlChain)) {
+//          totalLength += MmGetMdlByteCount(mdl);
+//      }
+//
+//      for (auto const &fragment : ndis::mdl_span_fragments(span)) {
+//          . . . fragment.Start.Mdl, fragment.Start.Offset, fragment.Length . . .
+//      }
+//
+// The ranges prefetch each MDL's successor with MDL_PREFETCH_CACHELINE.  Use
+// ndis::mdl_chain_safe if the loop body changes mdl->Next, for example to
+// free each MDL.
+//
+
+inline auto mdl_chain(_In_opt_ MDL *mdlChain)
+{
+    return details::chain_range<MDL, false, details::mdl_prefetch_cacheline>{mdlChain};
+}
+
+inline auto mdl_chain(_In_opt_ MDL const *mdlChain)
+{
+    return details::chain_range<MDL const, false, details::mdl_prefetch_cacheline>{mdlChain};
+}
+
+inline auto mdl_chain_safe(_In_opt_ MDL *mdlChain)
+{
+    return details::chain_range<MDL, true, details::mdl_prefetch_cacheline>{mdlChain};
+}
+
+inline auto mdl_span_fragments(_In_ MDL_SPAN const &span)
+{
+    return details::mdl_span_fragment_range{span};
+}
+
+} // namespace ndis
+
+#endif // __cplusplus
+
 #undef STATUS_STOP_ITERATION
 #undef ReportFatalOverflow
 #undef MinSizeT
 #undef MapOperator
+#undef MAP_FRAGMENTS_CONTEXT_t
+#undef MAP_FRAGMENTS_CONTEXT
+#undef MapFragmentsOperator
+#undef FinishMapFragments
 #undef SEEK_OPERATOR_CONTEXT_t
 #undef SEEK_OPERATOR_CONTEXT
 #undef SeekOperator
+#undef NonTemporalThreshold
+#undef GetNonTemporalThreshold
+#undef ShouldUseNonTemporal
+#undef AUTO_OPERATOR_CONTEXT_t
+#undef AUTO_OPERATOR_CONTEXT
+#undef InitializeAutoOperator
+#undef AutoOperator
 #undef ZeroOperator
 #undef ZeroOperatorNonTemporal
 #undef ZeroOperatorSecure
 #undef FillOperator
 #undef FillOperatorNonTemporal
+#undef FILL_PATTERN_CONTEXT_t
+#undef FILL_PATTERN_CONTEXT
+#undef InitializeFillPattern
+#undef FillWithPattern
+#undef FillPatternOperator
+#undef FillPatternOperatorNonTemporal
+#undef PREFETCH_COPY_CONTEXT_t
+#undef PREFETCH_COPY_CONTEXT
+#undef InitializePrefetchCopy
+#undef PrefetchSource
 #undef WriteOperator
 #undef ReadOperator
 #undef PairwiseCopy
+#undef PairwiseCopyWithPrefetch
 #undef WriteOperatorNonTemporal
 #undef ReadOperatorNonTemporal
 #undef PairwiseCopyNonTemporal
+#undef PairwiseCopyWithPrefetchNonTemporal
+#undef BATCH_CURSOR_t
+#undef BATCH_CURSOR
+#undef SeekBatchCursor
+#undef NumaCopyDpc
 #undef PairwiseEqual
+#undef FindFirstMismatch
+#undef COMPARE_OPERATOR_CONTEXT_t
+#undef COMPARE_OPERATOR_CONTEXT
+#undef PairwiseCompare
+#undef CHECKSUM_OPERATOR_CONTEXT_t
+#undef CHECKSUM_OPERATOR_CONTEXT
+#undef FoldInternetChecksum
+#undef ComputeInternetChecksum
+#undef IsCrc32cHardwareAvailable
+#undef ComputeCrc32c
+#undef ChecksumOperatorInternetChecksum
+#undef SpanChecksumInternetChecksum
+#undef ChecksumOperatorCrc32c
+#undef SpanChecksumCrc32c
+#undef CursorAdvanceWithinMdl
+#undef CursorGetBytesInMdl
+#undef CursorMapBuffer
+#undef BuildPartialMdlChain
 
 #pragma warning(pop)
 
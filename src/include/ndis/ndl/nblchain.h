@@ -39,8 +39,72 @@ Table of Contents:
         NdisLastNblInNblChainWithCount
         NdisLastNbInNbChain
         NdisLastNbInNbChainWithCount
+        NdisGetNblChainInformation
         NdisSetStatusInNblChain
 
+        NdisInitializeNblPrefetchWindow
+        NdisAdvanceNblPrefetchWindow
+
+Prefetching:
+
+    Walking an NBL chain is a pointer chase: the address of each NBL is not
+    known until the previous NBL has been read.  The classifiers in
+    nblclassify.h hide some of that latency by prefetching Nbl->Next while
+    they classify Nbl.  If you define NDIS_NBL_PREFETCH_DISTANCE to a value
+    larger than 1 before including this header, the walkers in this library
+    instead keep a pointer that runs NDIS_NBL_PREFETCH_DISTANCE NBLs ahead,
+    so a cache miss on the lead NBL overlaps with work on several earlier NBLs.
+    Walkers that touch each NBL's NET_BUFFERs also prefetch FirstNetBuffer
+    (and, if requested, its CurrentMdl) ahead of time.
+
+    A prefetch never waits on memory: every pointer it follows was read from
+    a cache line that was prefetched on an earlier step.  So the window
+    prefetches in stages.  Each step prefetches the next lead NBL, then the
+    FirstNetBuffer of the NBL that led on the previous step, then the
+    CurrentMdl of the NET_BUFFER prefetched on the previous step.  Each stage
+    you request puts the lead NBL one more NBL ahead of the walker.  For
+    example, with NDIS_NBL_PREFETCH_NET_BUFFER | NDIS_NBL_PREFETCH_MDL and
+    the default distance of 1, the window prefetches NBLs 3 ahead of the
+    walker, NET_BUFFERs 2 ahead, and MDLs 1 ahead.
+
+    You can use the same mechanism in your own loops with an
+    NBL_PREFETCH_WINDOW:
+
+        NBL_PREFETCH_WINDOW prefetch;
+        NdisInitializeNblPrefetchWindow(&prefetch, nblChain, NDIS_NBL_PREFETCH_NET_BUFFER);
+
+        for (NET_BUFFER_LIST *nbl = nblChain; nbl; nbl = nbl->Next)
+        {
+            NdisAdvanceNblPrefetchWindow(&prefetch, nbl);
+            . . . touch nbl and nbl->FirstNetBuffer . . .
+        }
+
+    Deeper prefetching is a trade-off: it pays off when each NBL takes a while
+    to process, but wastes bandwidth on short chains.  The lead NBL is still
+    found by a pointer chase, one cache miss at a time, so a larger distance
+    cannot make a walk that does little work per NBL go faster.  The
+    NET_BUFFER and MDL stages are what usually help such a walk, because
+    their cache misses overlap with the miss on the lead NBL.  Measure (see
+    prefetchbench) before you change the default.
+
+C++ ranges:
+
+    C++ code can walk a chain with a range-based for loop instead of writing
+    out the pointer chase.  The ranges prefetch each node's successor, like
+    the walkers in this library do:
+
+        for (auto nbl : ndis::nbl_chain(nblChain))
+        {
+            for (auto nb : ndis::nb_chain(NET_BUFFER_LIST_FIRST_NB(nbl)))
+            {
+                . . . touch nb . . .
+            }
+        }
+
+    ndis::nbl_chain_safe and ndis::nb_chain_safe read each node's Next field
+    before the loop body runs, so the body may move the node to another chain
+    or queue.
+
 Environment:
 
     Kernel mode
@@ -53,10 +117,167 @@ Environment:
 #include <winapifamily.h>
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
 
+#include <ndis/ndl/chainiterator.h>
+
 #ifndef NDIS_ASSERT
 #    define NDIS_ASSERT(x) NT_ASSERT(x)
 #endif
 
+#ifndef NDIS_NBL_PREFETCH_DISTANCE
+#    define NDIS_NBL_PREFETCH_DISTANCE 1
+#endif
+
+#if NDIS_NBL_PREFETCH_DISTANCE < 1
+#    error NDIS_NBL_PREFETCH_DISTANCE must be at least 1
+#endif
+
+// Flags for NdisInitializeNblPrefetchWindow
+
+// Also prefetch each NBL's FirstNetBuffer
+#define NDIS_NBL_PREFETCH_NET_BUFFER    0x00000001
+
+// Also prefetch the CurrentMdl of each NBL's FirstNetBuffer.  This implies
+// NDIS_NBL_PREFETCH_NET_BUFFER.
+#define NDIS_NBL_PREFETCH_MDL           0x00000002
+
+typedef struct NBL_PREFETCH_WINDOW_t
+{
+    // The lead NBL, which was prefetched on the last step, or NULL if the end
+    // of the chain has been reached
+    NET_BUFFER_LIST const *Ahead;
+
+    // The NET_BUFFER that was prefetched on the last step, or NULL
+    NET_BUFFER const *NetBuffer;
+
+    // Any of the NDIS_NBL_PREFETCH_XXX flags
+    ULONG Flags;
+} NBL_PREFETCH_WINDOW;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisStepNblPrefetchWindow(
+    _Inout_ NBL_PREFETCH_WINDOW *Window)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Moves each stage of the window forward by one NBL.  Only pointers held in
+    cache lines that were prefetched on the previous step are read.
+
+Arguments:
+
+    Window - The window to step
+
+--*/
+{
+    NET_BUFFER_LIST const *const Previous = Window->Ahead;
+
+    if ((Window->Flags & NDIS_NBL_PREFETCH_MDL) != 0 && Window->NetBuffer != NULL)
+    {
+        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Window->NetBuffer->CurrentMdl);
+    }
+
+    if (Previous == NULL)
+    {
+        Window->NetBuffer = NULL;
+        return;
+    }
+
+    Window->Ahead = Previous->Next;
+    PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Window->Ahead);
+
+    if ((Window->Flags & (NDIS_NBL_PREFETCH_NET_BUFFER | NDIS_NBL_PREFETCH_MDL)) != 0)
+    {
+        Window->NetBuffer = Previous->FirstNetBuffer;
+        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Window->NetBuffer);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisInitializeNblPrefetchWindow(
+    _Out_ NBL_PREFETCH_WINDOW *Window,
+    _In_opt_ NET_BUFFER_LIST const *NblChain,
+    _In_ ULONG Flags)
+/*++
+
+Routine Description:
+
+    Prepares to prefetch NBLs ahead of a walk over an NBL chain
+
+    This issues prefetches for the first NDIS_NBL_PREFETCH_DISTANCE - 1 NBLs
+    after the head of the chain, plus one more NBL for each of the
+    NET_BUFFER and MDL stages requested in Flags.  Call
+    NdisAdvanceNblPrefetchWindow as you visit each NBL to keep the prefetches
+    ahead of the walk.
+
+    The first few NBLs of the chain are read right away, so the walk only
+    benefits from staging once it is past them.
+
+Arguments:
+
+    Window - The window to initialize
+
+    NblChain - Zero or more NBLs that are about to be walked
+
+    Flags - Any of the NDIS_NBL_PREFETCH_XXX flags
+
+--*/
+{
+    ULONG Steps = NDIS_NBL_PREFETCH_DISTANCE - 1;
+
+    if ((Flags & NDIS_NBL_PREFETCH_MDL) != 0)
+    {
+        Steps += 2;
+    }
+    else if ((Flags & NDIS_NBL_PREFETCH_NET_BUFFER) != 0)
+    {
+        Steps += 1;
+    }
+
+    Window->Ahead = NblChain;
+    Window->NetBuffer = NULL;
+    Window->Flags = Flags;
+
+    for (ULONG i = 0; i < Steps && Window->Ahead != NULL; i++)
+    {
+        NdisStepNblPrefetchWindow(Window);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisAdvanceNblPrefetchWindow(
+    _Inout_ NBL_PREFETCH_WINDOW *Window,
+    _In_ NET_BUFFER_LIST const *Nbl)
+/*++
+
+Routine Description:
+
+    Issues prefetches for the NBLs ahead of Nbl
+
+    Call this once for each NBL in the chain, in order, before touching the
+    NBL.  With the default NDIS_NBL_PREFETCH_DISTANCE of 1 and no flags, this
+    is the same as prefetching Nbl->Next.
+
+Arguments:
+
+    Window - A window initialized with NdisInitializeNblPrefetchWindow
+
+    Nbl - The NBL the walker is about to visit
+
+--*/
+{
+    UNREFERENCED_PARAMETER(Nbl);
+
+    NdisStepNblPrefetchWindow(Window);
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 ULONG
@@ -144,8 +365,16 @@ Return Value:
 {
     ULONG Count = 0;
 
+#if NDIS_NBL_PREFETCH_DISTANCE > 1
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_NBL_PREFETCH_NET_BUFFER);
+#endif
+
     while (NblChain)
     {
+#if NDIS_NBL_PREFETCH_DISTANCE > 1
+        NdisAdvanceNblPrefetchWindow(&Prefetch, NblChain);
+#endif
         Count += NdisNumNbsInNbChain(NblChain->FirstNetBuffer);
         NblChain = NblChain->Next;
     }
@@ -208,8 +437,16 @@ Return Value:
 {
     ULONG64 ByteCount = 0;
 
+#if NDIS_NBL_PREFETCH_DISTANCE > 1
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_NBL_PREFETCH_NET_BUFFER);
+#endif
+
     while (NblChain)
     {
+#if NDIS_NBL_PREFETCH_DISTANCE > 1
+        NdisAdvanceNblPrefetchWindow(&Prefetch, NblChain);
+#endif
         ByteCount += NdisNumDataBytesInNbChain(NblChain->FirstNetBuffer);
         NblChain = NblChain->Next;
     }
@@ -357,6 +594,130 @@ Return Value:
     return Nb;
 }
 
+// Flags for NdisGetNblChainInformation
+
+// Fill in NBL_CHAIN_INFORMATION::NumberOfNbs
+#define NDIS_NBL_CHAIN_INFORMATION_NB_COUNT     0x00000001
+
+// Fill in NBL_CHAIN_INFORMATION::DataLength
+#define NDIS_NBL_CHAIN_INFORMATION_DATA_LENGTH  0x00000002
+
+// Fill in NBL_CHAIN_INFORMATION::NumberOfMdls
+#define NDIS_NBL_CHAIN_INFORMATION_MDL_COUNT    0x00000004
+
+#define NDIS_NBL_CHAIN_INFORMATION_ALL          0x00000007
+
+typedef struct NBL_CHAIN_INFORMATION_t
+{
+    // The number of NBLs in the NBL chain
+    SIZE_T NumberOfNbls;
+
+    // The last NBL in the NBL chain
+    NET_BUFFER_LIST *LastNbl;
+
+    // The total number of NBs in the NBL chain, or 0 if
+    // NDIS_NBL_CHAIN_INFORMATION_NB_COUNT was not requested
+    SIZE_T NumberOfNbs;
+
+    // The total number of bytes of data in the NBL chain, or 0 if
+    // NDIS_NBL_CHAIN_INFORMATION_DATA_LENGTH was not requested
+    ULONG64 DataLength;
+
+    // The total number of MDLs needed to describe the data in the NBL chain,
+    // counting from each NB's CurrentMdl, or 0 if
+    // NDIS_NBL_CHAIN_INFORMATION_MDL_COUNT was not requested.  MDLs past the
+    // end of an NB's data are not counted.
+    SIZE_T NumberOfMdls;
+} NBL_CHAIN_INFORMATION;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisGetNblChainInformation(
+    _In_ NET_BUFFER_LIST *NblChain,
+    _In_ ULONG Flags,
+    _Out_ NBL_CHAIN_INFORMATION *Information)
+/*++
+
+Routine Description:
+
+    Obtains some metadata about an NBL chain in a single walk
+
+    This is equivalent to calling NdisLastNblInNblChainWithCount,
+    NdisNumNbsInNblChain, and NdisNumDataBytesInNblChain on the same chain,
+    except the chain is only traversed once.  The NBL count and last NBL are
+    always returned; the NET_BUFFERs and MDLs are only visited if you request
+    information that requires them.
+
+Arguments:
+
+    NblChain - One or more NBLs
+
+    Flags - Any of the NDIS_NBL_CHAIN_INFORMATION_XXX flags
+
+    Information - Receives some metadata about the NBL chain
+
+--*/
+{
+    NET_BUFFER_LIST *Nbl = NblChain;
+    SIZE_T NblCount = 0;
+    SIZE_T NbCount = 0;
+    SIZE_T MdlCount = 0;
+    ULONG64 DataLength = 0;
+
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(
+        &Prefetch,
+        NblChain,
+        (Flags != 0) ? NDIS_NBL_PREFETCH_NET_BUFFER : 0);
+
+    while (TRUE)
+    {
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+        NblCount++;
+
+        if (Flags != 0)
+        {
+            for (NET_BUFFER *Nb = Nbl->FirstNetBuffer; Nb != NULL; Nb = Nb->Next)
+            {
+                NbCount++;
+                DataLength += Nb->DataLength;
+
+                if ((Flags & NDIS_NBL_CHAIN_INFORMATION_MDL_COUNT) != 0)
+                {
+                    ULONG64 Remaining = (ULONG64)Nb->CurrentMdlOffset + Nb->DataLength;
+
+                    for (MDL *Mdl = Nb->CurrentMdl;
+                        Nb->DataLength != 0 && Remaining != 0 && Mdl != NULL;
+                        Mdl = Mdl->Next)
+                    {
+                        ULONG const ByteCount = MmGetMdlByteCount(Mdl);
+
+                        MdlCount++;
+                        Remaining -= (Remaining < ByteCount) ? Remaining : ByteCount;
+                    }
+                }
+            }
+        }
+
+        if (Nbl->Next == NULL)
+        {
+            break;
+        }
+
+        Nbl = Nbl->Next;
+    }
+
+    Information->NumberOfNbls = NblCount;
+    Information->LastNbl = Nbl;
+    Information->NumberOfNbs =
+        ((Flags & NDIS_NBL_CHAIN_INFORMATION_NB_COUNT) != 0) ? NbCount : 0;
+    Information->DataLength =
+        ((Flags & NDIS_NBL_CHAIN_INFORMATION_DATA_LENGTH) != 0) ? DataLength : 0;
+    Information->NumberOfMdls = MdlCount;
+}
+
 #ifdef __cplusplus
 
 // Repeat the NdisLastXxxInXxxChain functions with `const` inputs & outputs.
@@ -574,5 +935,59 @@ Arguments:
     }
 }
 
+#ifdef __cplusplus
+
+namespace ndis
+{
+
+//
+// Ranges over zero or more NBLs or NBs, for use with a range-based for loop:
+//
+//      for (auto nbl : ndis::nbl_chain(nblChain)) {
+//          nbl->Status = NDIS_STATUS_SUCCESS;
+//      }
+//
+// Use the _safe variants if the loop body changes node->Next:
+//
+//      for (auto nbl : ndis::nbl_chain_safe(nblChain)) {
+//          nbl->Next = nullptr;
+//          queue.append_one_nbl(nbl);
+//      }
+//
+
+inline auto nbl_chain(_In_opt_ NET_BUFFER_LIST *nblChain)
+{
+    return details::chain_range<NET_BUFFER_LIST, false>{nblChain};
+}
+
+inline auto nbl_chain(_In_opt_ NET_BUFFER_LIST const *nblChain)
+{
+    return details::chain_range<NET_BUFFER_LIST const, false>{nblChain};
+}
+
+inline auto nbl_chain_safe(_In_opt_ NET_BUFFER_LIST *nblChain)
+{
+    return details::chain_range<NET_BUFFER_LIST, true>{nblChain};
+}
+
+inline auto nb_chain(_In_opt_ NET_BUFFER *nbChain)
+{
+    return details::chain_range<NET_BUFFER, false>{nbChain};
+}
+
+inline auto nb_chain(_In_opt_ NET_BUFFER const *nbChain)
+{
+    return details::chain_range<NET_BUFFER const, false>{nbChain};
+}
+
+inline auto nb_chain_safe(_In_opt_ NET_BUFFER *nbChain)
+{
+    return details::chain_range<NET_BUFFER, true>{nbChain};
+}
+
+} // namespace ndis
+
+#endif // __cplusplus
+
 #endif // WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
 #pragma endregion
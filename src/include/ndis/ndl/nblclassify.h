@@ -150,6 +150,57 @@ Many buckets (with callback):
     the algorithm does more work up front, in the hopes that you'll save cycles
     later by having bigger batches.
 
+    If the chain interleaves more distinct values than the lookahead can track
+    (for example, hundreds of TCP flows in a single indication), use
+    NdisClassifyNblChainByValueHashed instead.  It tracks each distinct value
+    in an open-addressed hash table, and invokes your flush callback once per
+    distinct value, after the whole chain has been classified.
+
+    You choose how many values the table can track, and provide its storage
+    from nonpaged pool, since it is too large for a kernel stack.  If a chain
+    has more distinct values than that, then whenever a new value does not
+    fit, every batch collected so far is flushed and the table starts over.
+    Values that appear on both sides of that point are flushed more than
+    once.  To rule that out, size the table for the longest chain you will
+    classify; a chain of N NBLs has at most N distinct values.  A large table
+    is no slower than a small one for chains with few values.
+
+    A table may only be used by one routine at a time, so give each
+    processor or receive queue its own:
+
+        // When the receive queue is created
+        SIZE_T const size = NBL_CLASSIFICATION_HASH_TABLE_STORAGE_SIZE(MAX_RECEIVE_BATCH);
+        queue->hashStorage = ExAllocatePool2(POOL_FLAG_NON_PAGED, size, MY_POOLTAG);
+        NdisInitializeNblClassificationHashTable(&queue->hashTable, queue->hashStorage, size);
+
+        void ReceivePackets(MY_QUEUE *queue, NET_BUFFER_LIST *incomingNbls)
+        {
+            NdisClassifyNblChainByValueHashed(
+                incomingNbls, GetFlow, NULL, ReceivePacketsOnFlow, NULL, &queue->hashTable);
+        }
+
+    If you'd rather keep the chain and just have similar NBLs next to each
+    other (for example, to coalesce segments of the same flow), use
+    NdisGroupNblChainByValue.  It uses the same kind of table to relink the
+    chain so that NBLs with the same value are adjacent.  Their relative order is
+    preserved, and the groups appear in the order each value was first seen.
+    The chain of 5 NBLs from the VLAN example above becomes:
+
+        A[VLAN=1] -> B[VLAN=1] -> E[VLAN=1] -> C[VLAN=2] -> D[VLAN=2]
+
+Buckets within buckets:
+
+    Sometimes you need to split a chain by index, then batch each index's NBLs
+    by value.  For example, a send-complete handler might separate out the NBLs
+    it originated (by SourceHandle), then batch the rest by destination port.
+    Rather than calling NdisClassifyNblChain2WithCount followed by
+    NdisClassifyNblChainByValueWithCount, which walks the chain twice, use
+    NdisClassifyNblChainByIndexAndValueWithCount.  You supply an index
+    classifier, plus an array of NBL_CLASSIFICATION_BUCKETs that each hold a
+    value classifier and a flush callback for that index.  The chain is walked
+    once, and each bucket's flush callback receives the same batches it would
+    have received from NdisClassifyNblChainByValueWithCount.
+
 Many buckets (no callback function):
 
     If it's inconvenient to process NBLs within a callback function, you can
@@ -217,6 +268,32 @@ Specific classifiers:
 
         B[CancelId=3] => D[CancelId=3] => NULL
 
+C++ templates:
+
+    Each of the routines above invokes your classification callback through
+    a function pointer, once per NBL.  If you are writing C++, you can instead
+    use the templates in the `ndis` namespace, which accept any callable
+    (including a lambda).  The compiler can then inline your classifier and
+    flush logic directly into the classification loop:
+
+        void ReceivePackets(NET_BUFFER_LIST *incomingNbls)
+        {
+            ndis::classify_nbl_chain_by_value(
+                incomingNbls,
+                [](NET_BUFFER_LIST *nbl)
+                {
+                    return NDIS_GET_NET_BUFFER_LIST_VLAN_ID(nbl);
+                },
+                [](auto vlan, NBL_QUEUE *queue)
+                {
+                    DispatchInputForVlan(queue->First, vlan);
+                });
+        }
+
+    Each template accepts either NBL_QUEUEs or NBL_COUNTED_QUEUEs.  The
+    classification value may be any type that can be copied and compared with
+    `!=`.
+
 Table of Contents:
 
         NdisClassifyNblChain2
@@ -227,6 +304,11 @@ Table of Contents:
         NdisClassifyNblChainByValueWithCount
         NdisClassifyNblChainByValueLookahead
         NdisClassifyNblChainByValueLookaheadWithCount
+        NdisInitializeNblClassificationHashTable
+        NdisClassifyNblChainByValueHashed
+        NdisClassifyNblChainByValueHashedWithCount
+        NdisGroupNblChainByValue
+        NdisClassifyNblChainByIndexAndValueWithCount
         NdisPartialClassifyNblChainByValue
         NdisPartialClassifyNblChainByValueWithCount
 
@@ -234,6 +316,16 @@ Table of Contents:
         NdisClassifyNblChainBySourceHandle
         NdisClassifyNblChainByPoolHandle
 
+    C++ only:
+
+        ndis::classify_nbl_chain2
+        ndis::classify_nbl_chain_by_index
+        ndis::classify_nbl_chain_by_value
+
+        ndis::classify_nbl_chain_by_cancel_id
+        ndis::classify_nbl_chain_by_source_handle
+        ndis::classify_nbl_chain_by_pool_handle
+
 Environment:
 
     Kernel mode
@@ -247,11 +339,58 @@ Environment:
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
 
 #include <ndis/ndl/nblqueue.h>
+#include <ndis/ndl/statistics.h>
 
 #ifndef NDIS_CLASSIFY_NBL_LOOKHEAD_DEPTH
 #   define NDIS_CLASSIFY_NBL_LOOKHEAD_DEPTH 4
 #endif
 
+// Any of the NDIS_NBL_PREFETCH_XXX flags, for classifiers that inspect each
+// NBL's NET_BUFFER or MDL.  Prefetch depth is set by NDIS_NBL_PREFETCH_DISTANCE.
+#ifndef NDIS_CLASSIFY_NBL_PREFETCH_FLAGS
+#   define NDIS_CLASSIFY_NBL_PREFETCH_FLAGS 0
+#endif
+
+typedef struct NBL_CLASSIFICATION_HASH_ENTRY_t
+{
+    // The value returned by the classification callback for these NBLs
+    ULONG_PTR ClassificationResult;
+
+    // The NBLs seen so far that have this ClassificationResult
+    NBL_COUNTED_QUEUE Queue;
+
+    // The element of Slots that refers to this entry
+    SIZE_T Slot;
+} NBL_CLASSIFICATION_HASH_ENTRY;
+
+// The number of bytes of storage an NBL_CLASSIFICATION_HASH_TABLE needs to
+// track MaximumValues distinct values at once
+#define NBL_CLASSIFICATION_HASH_TABLE_STORAGE_SIZE(MaximumValues) \
+    ((SIZE_T)(MaximumValues) * (sizeof(NBL_CLASSIFICATION_HASH_ENTRY) + 2 * sizeof(ULONG)))
+
+//
+// Initialize with NdisInitializeNblClassificationHashTable.  Treat the fields
+// as opaque.
+//
+typedef struct NBL_CLASSIFICATION_HASH_TABLE_t
+{
+    // The number of elements of Entries; a power of 2
+    SIZE_T MaximumEntries;
+
+    // The number of Entries in use
+    SIZE_T NumberOfEntries;
+
+    // Open-addressed hash table with linear probing, with 2 * MaximumEntries
+    // elements.  Each slot holds 1 plus the index of an element of Entries,
+    // or 0 if the slot is unused.  There are twice as many slots as entries,
+    // so the load factor never exceeds 50%.
+    ULONG *Slots;
+
+    // Entries, in the order their ClassificationResult was first seen.
+    // Only the first NumberOfEntries elements are initialized.
+    NBL_CLASSIFICATION_HASH_ENTRY *Entries;
+} NBL_CLASSIFICATION_HASH_TABLE;
+
 typedef
 _IRQL_requires_max_(DISPATCH_LEVEL)
 _IRQL_requires_same_
@@ -372,6 +511,29 @@ Arguments:
 
 --*/
 
+typedef struct NBL_CLASSIFICATION_BUCKET_t
+{
+    // Initialize these fields before calling
+    // NdisClassifyNblChainByIndexAndValueWithCount.
+
+    // Classifies the NBLs in this bucket by value.  May be NULL, in which case
+    // every NBL in this bucket has a ClassificationResult of 0.
+    NDIS_NBL_CLASSIFICATION_VALUE_CALLBACK *ClassificationCallback;
+    PVOID ClassificationContext;
+
+    // Receives each batch of NBLs in this bucket that have the same value
+    NDIS_NBL_FLUSH_WITH_COUNT_CALLBACK *FlushCallback;
+    PVOID FlushContext;
+
+    // The remaining fields are used internally by the classifier.
+
+    // The value of the NBLs in Queue
+    ULONG_PTR ClassificationResult;
+
+    // NBLs waiting to be flushed
+    NBL_COUNTED_QUEUE Queue;
+} NBL_CLASSIFICATION_BUCKET;
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 void
@@ -402,6 +564,9 @@ Arguments:
 
 --*/
 {
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
     NET_BUFFER_LIST *Nbl = NblChain;
     NET_BUFFER_LIST *First = Nbl;
     NET_BUFFER_LIST *Previous;
@@ -411,7 +576,7 @@ Arguments:
     NDIS_ASSERT_VALID_NBL_QUEUE(Queue0);
     NDIS_ASSERT_VALID_NBL_QUEUE(Queue1);
 
-    PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
     ThisIndex = ClassificationCallback(ClassificationContext, Nbl);
@@ -423,7 +588,7 @@ Arguments:
 
     while (Nbl != NULL)
     {
-        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
         ThisIndex = ClassificationCallback(ClassificationContext, Nbl);
@@ -466,6 +631,9 @@ Routine Description:
 
 --*/
 {
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
     NET_BUFFER_LIST *Nbl = NblChain;
     NET_BUFFER_LIST *First = Nbl;
     NET_BUFFER_LIST *Previous;
@@ -476,7 +644,7 @@ Routine Description:
     NDIS_ASSERT_VALID_NBL_COUNTED_QUEUE(Queue0);
     NDIS_ASSERT_VALID_NBL_COUNTED_QUEUE(Queue1);
 
-    PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
     ThisIndex = ClassificationCallback(ClassificationContext, Nbl);
@@ -488,7 +656,7 @@ Routine Description:
 
     while (Nbl != NULL)
     {
-        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
         ThisIndex = ClassificationCallback(ClassificationContext, Nbl);
@@ -548,6 +716,9 @@ Arguments:
 
 --*/
 {
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
     NET_BUFFER_LIST *Nbl = NblChain;
     NET_BUFFER_LIST *First = Nbl;
     NET_BUFFER_LIST *Previous;
@@ -563,7 +734,7 @@ Arguments:
     UNREFERENCED_PARAMETER(NumberOfQueues);
 #endif
 
-    PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
     ThisIndex = ClassificationCallback(ClassificationContext, Nbl);
@@ -575,7 +746,7 @@ Arguments:
 
     while (Nbl != NULL)
     {
-        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
         ThisIndex = ClassificationCallback(ClassificationContext, Nbl);
@@ -616,6 +787,9 @@ Routine Description:
 
 --*/
 {
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
     NET_BUFFER_LIST *Nbl = NblChain;
     NET_BUFFER_LIST *First = Nbl;
     NET_BUFFER_LIST *Previous;
@@ -633,7 +807,7 @@ Routine Description:
     UNREFERENCED_PARAMETER(NumberOfQueues);
 #endif
 
-    PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
     ThisIndex = ClassificationCallback(ClassificationContext, Nbl);
@@ -645,7 +819,7 @@ Routine Description:
 
     while (Nbl != NULL)
     {
-        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
         ThisIndex = ClassificationCallback(ClassificationContext, Nbl);
@@ -707,12 +881,16 @@ Arguments
 
 --*/
 {
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
     NBL_QUEUE Queue;
     NdisInitializeNblQueue(&Queue);
 
     NET_BUFFER_LIST *FirstNbl = NblChain;
     NET_BUFFER_LIST *PreviousNbl = FirstNbl;
     NET_BUFFER_LIST *Nbl = FirstNbl;
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
     ULONG_PTR TargetClassification = ClassificationCallback(ClassificationContext, Nbl);
 
@@ -727,7 +905,7 @@ Arguments
             break;
         }
 
-        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
         ULONG_PTR NextClassification = ClassificationCallback(ClassificationContext, Nbl);
@@ -766,12 +944,16 @@ Routine Description:
 
 --*/
 {
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
     NBL_COUNTED_QUEUE Queue;
     NdisInitializeNblCountedQueue(&Queue);
 
     NET_BUFFER_LIST *FirstNbl = NblChain;
     NET_BUFFER_LIST *PreviousNbl = FirstNbl;
     NET_BUFFER_LIST *Nbl = FirstNbl;
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
     ULONG_PTR TargetClassification = ClassificationCallback(ClassificationContext, Nbl);
     SIZE_T Count = 1;
@@ -787,7 +969,7 @@ Routine Description:
             break;
         }
 
-        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
         ULONG_PTR NextClassification = ClassificationCallback(ClassificationContext, Nbl);
@@ -851,13 +1033,21 @@ Arguments
 
 --*/
 {
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
     NBL_QUEUE Queue[NDIS_CLASSIFY_NBL_LOOKHEAD_DEPTH];
     ULONG_PTR TargetClassification[ARRAYSIZE(Queue)];
     BOOLEAN Valid[ARRAYSIZE(Queue)] = { TRUE };
+#if NDL_ENABLE_STATISTICS
+    // The number of NBLs in each queue, for the batch size counters
+    SIZE_T StatisticsCount[ARRAYSIZE(Queue)] = { 1 };
+#endif
 
     NET_BUFFER_LIST *FirstNbl = NblChain;
     NET_BUFFER_LIST *PreviousNbl = FirstNbl;
     NET_BUFFER_LIST *Nbl = FirstNbl;
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
     SIZE_T PreviousIndex = 0;
     NdisInitializeNblQueue(&Queue[PreviousIndex]);
@@ -873,7 +1063,7 @@ Arguments
             break;
         }
 
-        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
         ULONG_PTR NextClassification = ClassificationCallback(ClassificationContext, Nbl);
@@ -892,6 +1082,7 @@ Arguments
                     Valid[i] = TRUE;
                     TargetClassification[i] = NextClassification;
                     NdisInitializeNblQueue(&Queue[i]);
+                    NDL_STATISTICS_RECORD(StatisticsCount[i] = 0);
                     goto Found;
                 }
 
@@ -904,6 +1095,8 @@ Arguments
             }
 
             const SIZE_T EvictionIndex = (PreviousIndex + 1) % ARRAYSIZE(Queue);
+            NDL_STATISTICS_RECORD(NdlStatisticsRecordClassifyEviction());
+            NDL_STATISTICS_RECORD(NdlStatisticsRecordClassifyBatch(StatisticsCount[EvictionIndex]));
 #pragma warning(suppress:6387) // 'FlushContext' could be NULL
             FlushCallback(FlushContext, TargetClassification[EvictionIndex], &Queue[EvictionIndex]);
 
@@ -911,10 +1104,12 @@ Arguments
             PreviousIndex = EvictionIndex;
             TargetClassification[EvictionIndex] = NextClassification;
             NdisInitializeNblQueue(&Queue[EvictionIndex]);
+            NDL_STATISTICS_RECORD(StatisticsCount[EvictionIndex] = 0);
         }
 
     Found:
 
+        NDL_STATISTICS_RECORD(StatisticsCount[PreviousIndex] += 1);
         PreviousNbl = Nbl;
     }
 
@@ -925,6 +1120,7 @@ Arguments
             break;
         }
 
+        NDL_STATISTICS_RECORD(NdlStatisticsRecordClassifyBatch(StatisticsCount[i]));
 #pragma warning(suppress:6387) // 'FlushContext' could be NULL
         FlushCallback(FlushContext, TargetClassification[i], &Queue[i]);
     }
@@ -949,6 +1145,9 @@ Routine Description:
 
 --*/
 {
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
     NBL_COUNTED_QUEUE Queue[NDIS_CLASSIFY_NBL_LOOKHEAD_DEPTH];
     ULONG_PTR TargetClassification[ARRAYSIZE(Queue)];
     SIZE_T Count[ARRAYSIZE(Queue)] = { 1 };
@@ -956,6 +1155,7 @@ Routine Description:
     NET_BUFFER_LIST *FirstNbl = NblChain;
     NET_BUFFER_LIST *PreviousNbl = FirstNbl;
     NET_BUFFER_LIST *Nbl = FirstNbl;
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
     SIZE_T PreviousIndex = 0;
     NdisInitializeNblCountedQueue(&Queue[PreviousIndex]);
@@ -972,7 +1172,7 @@ Routine Description:
             break;
         }
 
-        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
         ULONG_PTR NextClassification = ClassificationCallback(ClassificationContext, Nbl);
@@ -1009,6 +1209,8 @@ Routine Description:
             }
 
             const SIZE_T EvictionIndex = (PreviousIndex + 1) % ARRAYSIZE(Queue);
+            NDL_STATISTICS_RECORD(NdlStatisticsRecordClassifyEviction());
+            NDL_STATISTICS_RECORD(NdlStatisticsRecordClassifyBatch(Queue[EvictionIndex].NblCount));
 #pragma warning(suppress:6387) // 'FlushContext' could be NULL
             FlushCallback(FlushContext, TargetClassification[EvictionIndex], &Queue[EvictionIndex]);
 
@@ -1031,6 +1233,7 @@ Routine Description:
             break;
         }
 
+        NDL_STATISTICS_RECORD(NdlStatisticsRecordClassifyBatch(Queue[i].NblCount));
 #pragma warning(suppress:6387) // 'FlushContext' could be NULL
         FlushCallback(FlushContext, TargetClassification[i], &Queue[i]);
     }
@@ -1039,234 +1242,785 @@ Routine Description:
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 void
-NdisPartialClassifyNblChainByValue(
-    _Inout_ NET_BUFFER_LIST **NblChain,
-    _In_ NDIS_NBL_CLASSIFICATION_VALUE_CALLBACK *ClassificationCallback,
-    _In_opt_ PVOID ClassificationContext,
-    _Out_ NBL_QUEUE *HomogenousQueue,
-    _Out_opt_ ULONG_PTR *ClassificationResult)
+NdisInitializeNblClassificationHashTable(
+    _Out_ NBL_CLASSIFICATION_HASH_TABLE *Table,
+    _Out_writes_bytes_(StorageSize) void *Storage,
+    _In_ SIZE_T StorageSize)
 /*++
 
 Routine Description:
 
-    This routine removes similar NBLs from the front of the chain
+    Prepares an NBL_CLASSIFICATION_HASH_TABLE for use
 
-    Similarity is defined by a classification callback function that you
-    provide.  Two NBLs are considered to be similar if and only if your
-    classification callback returns the same integer value for each.
+    The table tracks the largest power of 2 number of distinct values that
+    fits in StorageSize bytes.  To track N values, where N is a power of 2,
+    provide NBL_CLASSIFICATION_HASH_TABLE_STORAGE_SIZE(N) bytes.
 
-    You'd typically call NdisPartialClassifyNblChainByValue routine repeatedly
-    on an input chain, until there's no more NBLs remaining.
+    Call this once, when you allocate the storage.  The table may then be
+    passed to any number of NdisClassifyNblChainByValueHashed and
+    NdisGroupNblChainByValue calls, one at a time.  Each call touches only
+    the parts of the table it uses, so a large table costs no more than a
+    small one for a chain with few distinct values.
 
-Arguments
+Arguments:
 
-    NblChain - Address of an NBL chain that contains the input.  On return,
-        contains the head of the remaining NBLs
+    Table - The table to initialize
 
-    ClassificationCallback - Callback that returns an integer (or pointer) that
-        indicates whether two NBLs should be batched together
+    Storage - Nonpaged memory for the table, aligned to at least
+        MEMORY_ALLOCATION_ALIGNMENT.  It must remain valid while the table is
+        in use.
 
-    ClassificationContext - Any optional context you'd like to pass to your callback
+    StorageSize - The size of Storage, in bytes.  This must be at least
+        NBL_CLASSIFICATION_HASH_TABLE_STORAGE_SIZE(1).
 
-    HomogenousQueue - On return, contains one or more similar NBLs from the
-        input chain
+--*/
+{
+    SIZE_T MaximumEntries = 1;
 
-    ClassificationResult - On return, contains the return value of your
-        ClassificationCallback for each of the NBLs in HomogenousQueue
+    NDIS_ASSERT(StorageSize >= NBL_CLASSIFICATION_HASH_TABLE_STORAGE_SIZE(1));
+
+    while (MaximumEntries < MAXULONG / 4 &&
+        NBL_CLASSIFICATION_HASH_TABLE_STORAGE_SIZE(MaximumEntries * 2) <= StorageSize)
+    {
+        MaximumEntries *= 2;
+    }
+
+    Table->MaximumEntries = MaximumEntries;
+    Table->NumberOfEntries = 0;
+    Table->Entries = (NBL_CLASSIFICATION_HASH_ENTRY *)Storage;
+    Table->Slots = (ULONG *)(Table->Entries + MaximumEntries);
+
+    RtlZeroMemory(Table->Slots, 2 * MaximumEntries * sizeof(Table->Slots[0]));
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisResetNblClassificationHashTable(
+    _Inout_ NBL_CLASSIFICATION_HASH_TABLE *Table)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Empties the table.  Only the slots of the entries in use are cleared, so
+    this costs as much as the number of distinct values last tracked,
+    regardless of the size of the table.
 
 --*/
 {
-    NdisInitializeNblQueue(HomogenousQueue);
+    for (SIZE_T i = 0; i < Table->NumberOfEntries; i++)
+    {
+        Table->Slots[Table->Entries[i].Slot] = 0;
+    }
 
-    NET_BUFFER_LIST *FirstNbl = *NblChain;
-    NET_BUFFER_LIST *PreviousNbl = FirstNbl;
-    NET_BUFFER_LIST *Nbl = FirstNbl;
-#pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
-    ULONG_PTR TargetClassification = ClassificationCallback(ClassificationContext, Nbl);
+    Table->NumberOfEntries = 0;
+}
 
-    while (TRUE)
-    {
-        Nbl = Nbl->Next;
-        if (Nbl == NULL)
-        {
-            *NblChain = NULL;
-            break;
-        }
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NBL_CLASSIFICATION_HASH_ENTRY *
+NdisLookupNblClassificationHashEntry(
+    _Inout_ NBL_CLASSIFICATION_HASH_TABLE *Table,
+    _In_ ULONG_PTR ClassificationResult)
+/*++
 
-        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+Routine Description:
 
-#pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
-        ULONG_PTR NextClassification = ClassificationCallback(ClassificationContext, Nbl);
-        if (NextClassification != TargetClassification)
+    Implementation detail - do not invoke this routine directly
+
+    Finds the entry for a ClassificationResult, adding a new empty entry if
+    the value has not been seen before
+
+Arguments:
+
+    Table - The table to search
+
+    ClassificationResult - The value to look up
+
+Return Value:
+
+    The entry for ClassificationResult, or NULL if the value is new and every
+    entry is already in use.
+
+--*/
+{
+    SIZE_T const SlotMask = 2 * Table->MaximumEntries - 1;
+
+    // Fibonacci hashing: multiply by 2^64 / phi and keep the high bits, which
+    // spreads out pointers and small integers alike.
+    ULONG64 const Hash = (ULONG64)ClassificationResult * 0x9E3779B97F4A7C15ull;
+    SIZE_T Slot = (SIZE_T)(Hash >> 32) & SlotMask;
+
+    while (Table->Slots[Slot] != 0)
+    {
+        NBL_CLASSIFICATION_HASH_ENTRY *const Entry = &Table->Entries[Table->Slots[Slot] - 1];
+        if (Entry->ClassificationResult == ClassificationResult)
         {
-            PreviousNbl->Next = NULL;
-            *NblChain = Nbl;
-            break;
+            return Entry;
         }
 
-        PreviousNbl = Nbl;
+        Slot = (Slot + 1) & SlotMask;
     }
 
-    NdisAppendNblChainToNblQueueFast(HomogenousQueue, FirstNbl, PreviousNbl);
-
-    if (ARGUMENT_PRESENT(ClassificationResult))
+    if (Table->NumberOfEntries == Table->MaximumEntries)
     {
-        *ClassificationResult = TargetClassification;
+        return NULL;
     }
 
-    NDIS_ASSERT_VALID_NBL_QUEUE(HomogenousQueue);
+    NBL_CLASSIFICATION_HASH_ENTRY *const Entry = &Table->Entries[Table->NumberOfEntries];
+    Table->NumberOfEntries += 1;
+    Table->Slots[Slot] = (ULONG)Table->NumberOfEntries;
+
+    Entry->ClassificationResult = ClassificationResult;
+    Entry->Slot = Slot;
+    NdisInitializeNblCountedQueue(&Entry->Queue);
+
+    return Entry;
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 void
-NdisPartialClassifyNblChainByValueWithCount(
-    _Inout_ NET_BUFFER_LIST **NblChain,
+NdisClassifyNblChainByValueHashedWithCount(
+    _In_ NET_BUFFER_LIST *NblChain,
     _In_ NDIS_NBL_CLASSIFICATION_VALUE_CALLBACK *ClassificationCallback,
     _In_opt_ PVOID ClassificationContext,
-    _Out_ NBL_COUNTED_QUEUE *HomogenousQueue,
-    _Out_opt_ ULONG_PTR *ClassificationResult)
+    _In_ NDIS_NBL_FLUSH_WITH_COUNT_CALLBACK *FlushCallback,
+    _In_opt_ PVOID FlushContext,
+    _Inout_ NBL_CLASSIFICATION_HASH_TABLE *Table)
 /*++
 
 Routine Description:
 
-    Similar to NdisPartialClassifyNblChainByValue, except results are provided
+    Similar to NdisClassifyNblChainByValueHashed, except results are provided
     in an NBL_COUNTED_QUEUE.  Refer to the documentation for
-    NdisPartialClassifyNblChainByValue.
+    NdisClassifyNblChainByValueHashed.
 
 --*/
 {
-    NdisInitializeNblCountedQueue(HomogenousQueue);
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
 
-    NET_BUFFER_LIST *FirstNbl = *NblChain;
+    NdisResetNblClassificationHashTable(Table);
+
+    NET_BUFFER_LIST *FirstNbl = NblChain;
     NET_BUFFER_LIST *PreviousNbl = FirstNbl;
     NET_BUFFER_LIST *Nbl = FirstNbl;
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
     ULONG_PTR TargetClassification = ClassificationCallback(ClassificationContext, Nbl);
     SIZE_T Count = 1;
 
+    // The table is empty, so this cannot fail
+    NBL_CLASSIFICATION_HASH_ENTRY *Entry = NdisLookupNblClassificationHashEntry(
+        Table, TargetClassification);
+
     while (TRUE)
     {
         Nbl = Nbl->Next;
         if (Nbl == NULL)
         {
-            *NblChain = NULL;
+            NdisAppendNblChainToNblCountedQueueFast(&Entry->Queue, FirstNbl, PreviousNbl, Count);
             break;
         }
 
-        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Nbl->Next);
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
 
 #pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
         ULONG_PTR NextClassification = ClassificationCallback(ClassificationContext, Nbl);
-        if (NextClassification != TargetClassification)
+        if (NextClassification == TargetClassification)
+        {
+            Count += 1;
+        }
+        else
         {
             PreviousNbl->Next = NULL;
-            *NblChain = Nbl;
-            break;
+            NdisAppendNblChainToNblCountedQueueFast(&Entry->Queue, FirstNbl, PreviousNbl, Count);
+
+            Entry = NdisLookupNblClassificationHashEntry(Table, NextClassification);
+            if (Entry == NULL)
+            {
+                // The table is full: flush everything collected so far, and
+                // start over with an empty table
+                for (SIZE_T i = 0; i < Table->NumberOfEntries; i++)
+                {
+#pragma warning(suppress:6387) // 'FlushContext' could be NULL
+                    FlushCallback(
+                        FlushContext,
+                        Table->Entries[i].ClassificationResult,
+                        &Table->Entries[i].Queue);
+                }
+
+                NdisResetNblClassificationHashTable(Table);
+                Entry = NdisLookupNblClassificationHashEntry(Table, NextClassification);
+            }
+
+            FirstNbl = Nbl;
+            TargetClassification = NextClassification;
+            Count = 1;
         }
 
         PreviousNbl = Nbl;
     }
 
-    NdisAppendNblChainToNblCountedQueueFast(HomogenousQueue, FirstNbl, PreviousNbl, Count);
-
-    if (ARGUMENT_PRESENT(ClassificationResult))
+    for (SIZE_T i = 0; i < Table->NumberOfEntries; i++)
     {
-        *ClassificationResult = TargetClassification;
+#pragma warning(suppress:6387) // 'FlushContext' could be NULL
+        FlushCallback(
+            FlushContext,
+            Table->Entries[i].ClassificationResult,
+            &Table->Entries[i].Queue);
     }
-
-    NDIS_ASSERT_VALID_NBL_COUNTED_QUEUE(HomogenousQueue);
 }
 
-inline NDIS_NBL_CLASSIFICATION_INDEX_CALLBACK NdisNblClassifierForCancelId;
+typedef struct NBL_FLUSH_WITHOUT_COUNT_CONTEXT_t
+{
+    NDIS_NBL_FLUSH_CALLBACK *FlushCallback;
+    PVOID FlushContext;
+} NBL_FLUSH_WITHOUT_COUNT_CONTEXT;
+
+inline NDIS_NBL_FLUSH_WITH_COUNT_CALLBACK NdisNblFlushWithoutCount;
 
 _Use_decl_annotations_
 inline
-SIZE_T
-NdisNblClassifierForCancelId(PVOID ClassificationContext, NET_BUFFER_LIST *Nbl)
+void
+NdisNblFlushWithoutCount(PVOID FlushContext, ULONG_PTR ClassificationResult, NBL_COUNTED_QUEUE *Queue)
 {
-    return Nbl->NetBufferListInfo[NetBufferListCancelId] == ClassificationContext ? 1 : 0;
+    NBL_FLUSH_WITHOUT_COUNT_CONTEXT const *const Context =
+        (NBL_FLUSH_WITHOUT_COUNT_CONTEXT const *)FlushContext;
+
+#pragma warning(suppress:6387) // 'FlushContext' could be NULL
+    Context->FlushCallback(Context->FlushContext, ClassificationResult, &Queue->Queue);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 void
-NdisClassifyNblChainByCancelId(
+NdisClassifyNblChainByValueHashed(
     _In_ NET_BUFFER_LIST *NblChain,
-    _In_ PVOID CancelId,
-    _Inout_ NBL_QUEUE *KeepQueue,
-    _Inout_ NBL_QUEUE *CancelQueue)
+    _In_ NDIS_NBL_CLASSIFICATION_VALUE_CALLBACK *ClassificationCallback,
+    _In_opt_ PVOID ClassificationContext,
+    _In_ NDIS_NBL_FLUSH_CALLBACK *FlushCallback,
+    _In_opt_ PVOID FlushContext,
+    _Inout_ NBL_CLASSIFICATION_HASH_TABLE *Table)
 /*++
 
 Routine Description:
 
-    Separates out any NBL with a given CancelId
+    This routine calls your callback with batches of similar NBLs
 
-Arguments:
+    Similarity is defined by a classification callback function that you
+    provide.  Two NBLs are considered to be similar if and only if your
+    classification callback returns the same integer value for each.
 
-    NblChain - The NBL chain to look through
+    This routine is a drop-in replacement to NdisClassifyNblChainByValue.  The
+    difference is that this routine gathers all similar NBLs into a single
+    batch, no matter how they are interleaved in the chain.  Your flush
+    callback is invoked once per distinct value, in the order each value was
+    first seen, after the entire chain has been classified.
+
+    That holds as long as the chain has no more distinct values than Table
+    can track.  If a new value does not fit, every batch collected so far is
+    flushed, the table is emptied, and classification continues with the new
+    value.  So values that appear on both sides of that point are flushed
+    more than once, and batches are no longer flushed in first-seen order.
+    A table that tracks as many values as the longest chain you classify
+    never has to do this.
 
-    CancelId - The CancelId to search for
+Arguments
 
-    KeepQueue - Receives any NBLs that did not match the CancelId
+    NblChain - An NBL chain that contains the input.  The chain will be
+        unlinked as part of the operation of this routine.
 
-    CancelQueue - Receives any NBLs that matched the CancelId
+    ClassificationCallback - Callback that returns an integer (or pointer) that
+        indicates whether two NBLs should be batched together
+
+    ClassificationContext - Any optional context you'd like to pass to your callback
+
+    FlushCallback - Callback that is called with each batch of homogenous NBLs
+
+    FlushContext - Any optional context you'd like to pass to your callback
+
+    Table - A table initialized with NdisInitializeNblClassificationHashTable.
+        It may not be used by any other routine until this routine returns,
+        including from your callbacks.
 
 --*/
 {
-    NdisClassifyNblChain2(
+    NBL_FLUSH_WITHOUT_COUNT_CONTEXT Context;
+    Context.FlushCallback = FlushCallback;
+    Context.FlushContext = FlushContext;
+
+    NdisClassifyNblChainByValueHashedWithCount(
         NblChain,
-        NdisNblClassifierForCancelId,
-        CancelId,
-        KeepQueue,
-        CancelQueue);
+        ClassificationCallback,
+        ClassificationContext,
+        NdisNblFlushWithoutCount,
+        &Context,
+        Table);
 }
 
-inline NDIS_NBL_CLASSIFICATION_INDEX_CALLBACK NdisNblClassifierForSourceHandle;
+inline NDIS_NBL_FLUSH_WITH_COUNT_CALLBACK NdisNblFlushToGroupedQueue;
 
 _Use_decl_annotations_
 inline
-SIZE_T
-NdisNblClassifierForSourceHandle(PVOID ClassificationContext, NET_BUFFER_LIST *Nbl)
+void
+NdisNblFlushToGroupedQueue(PVOID FlushContext, ULONG_PTR ClassificationResult, NBL_COUNTED_QUEUE *Queue)
 {
-    return Nbl->SourceHandle == ClassificationContext ? 1 : 0;
+    UNREFERENCED_PARAMETER(ClassificationResult);
+
+#pragma warning(suppress:6387) // 'FlushContext' could be NULL
+    NdisAppendNblQueueToNblQueueFast((NBL_QUEUE *)FlushContext, &Queue->Queue);
 }
 
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
-void
-NdisClassifyNblChainBySourceHandle(
-    _In_ NET_BUFFER_LIST *NblChain,
-    _In_ NDIS_HANDLE MySourceHandle,
-    _Inout_ NBL_QUEUE *TheirQueue,
-    _Inout_ NBL_QUEUE *MyQueue)
+NET_BUFFER_LIST *
+NdisGroupNblChainByValue(
+    _In_opt_ NET_BUFFER_LIST *NblChain,
+    _In_ NDIS_NBL_CLASSIFICATION_VALUE_CALLBACK *ClassificationCallback,
+    _In_opt_ PVOID ClassificationContext,
+    _Inout_ NBL_CLASSIFICATION_HASH_TABLE *Table)
 /*++
 
 Routine Description:
 
-    Separates an NBL chain by each NBL's SourceHandle
+    Reorders an NBL chain so that all similar NBLs are adjacent
 
-Arguments:
+    Similarity is defined by a classification callback function that you
+    provide, exactly as for NdisClassifyNblChainByValue.  The grouping is
+    stable: NBLs with the same value keep their relative order, and the groups
+    appear in the order each value was first seen.  For example, given
 
-    NblChain - The NBL chain to look through
+        A[1] -> B[2] -> C[1] -> D[3] -> E[2]
 
-    MySourceHandle - The SourceHandle to search for
+    this routine returns
 
-    TheirQueue - Receives any NBLs that did not match the SourceHandle
+        A[1] -> C[1] -> B[2] -> E[2] -> D[3]
 
-    MyQueue - Receives any NBLs that matched the SourceHandle
+    so a later NdisClassifyNblChainByValue over the result finds the fewest
+    possible batches.
 
---*/
-{
-    NdisClassifyNblChain2(
-        NblChain,
-        NdisNblClassifierForSourceHandle,
-        MySourceHandle,
-        TheirQueue,
-        MyQueue);
-}
+    The routine does not allocate memory, and does O(n) work: it classifies
+    each NBL once, and relinks each run of similar NBLs once.  That holds as
+    long as the chain has no more distinct values than Table can track.  If a
+    new value does not fit, the groups collected so far are appended to the
+    result, the table is emptied, and grouping continues with the new value.
+    So a value that appears on both sides of that point forms two groups.  A
+    table that tracks as many values as the chain has NBLs always finds the
+    fewest groups.
 
-inline NDIS_NBL_CLASSIFICATION_INDEX_CALLBACK NdisNblClassifierForPoolHandle;
+Arguments
+
+    NblChain - Zero or more NBLs.  The chain is relinked in place.
+
+    ClassificationCallback - Callback that returns an integer (or pointer) that
+        indicates whether two NBLs should be grouped together
+
+    ClassificationContext - Any optional context you'd like to pass to your callback
+
+    Table - A table initialized with NdisInitializeNblClassificationHashTable.
+        It may not be used by any other routine until this routine returns,
+        including from your callback.
+
+Return Value:
+
+    The grouped chain, which contains the same NBLs as NblChain
+
+--*/
+{
+    if (NblChain == NULL)
+    {
+        return NULL;
+    }
+
+    NBL_QUEUE Grouped;
+    NdisInitializeNblQueue(&Grouped);
+
+    NdisClassifyNblChainByValueHashedWithCount(
+        NblChain,
+        ClassificationCallback,
+        ClassificationContext,
+        NdisNblFlushToGroupedQueue,
+        &Grouped,
+        Table);
+
+    return NdisPopAllFromNblQueue(&Grouped);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisClassifyNblChainByIndexAndValueWithCount(
+    _In_ NET_BUFFER_LIST *NblChain,
+    _In_ NDIS_NBL_CLASSIFICATION_INDEX_CALLBACK *ClassificationCallback,
+    _In_opt_ PVOID ClassificationContext,
+    _Inout_updates_(NumberOfBuckets) NBL_CLASSIFICATION_BUCKET *Buckets,
+    _In_ SIZE_T NumberOfBuckets)
+/*++
+
+Routine Description:
+
+    Separates an NBL chain into N buckets, then calls each bucket's flush
+    callback with batches of similar NBLs in that bucket
+
+    This produces the same batches as NdisClassifyNblChainByIndexWithCount
+    followed by NdisClassifyNblChainByValueWithCount on each of the resulting
+    queues, but walks the NBL chain only once.  Within a bucket, batches are
+    flushed in the order the NBLs appeared in the chain.  Batches from
+    different buckets may be interleaved.
+
+Arguments:
+
+    NblChain - An NBL chain that contains the input.  The chain will be
+        unlinked as part of the operation of this routine.
+
+    ClassificationCallback - A function (that you implement) that returns the
+        index of the bucket for each NBL
+
+    ClassificationContext - Any optional context you'd like to pass to your callback
+
+    Buckets - An array of buckets.  The caller must initialize the
+        ClassificationCallback, ClassificationContext, FlushCallback, and
+        FlushContext of each bucket.
+
+    NumberOfBuckets - The number of elements in the array
+
+--*/
+{
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
+    NET_BUFFER_LIST *FirstNbl = NblChain;
+    NET_BUFFER_LIST *PreviousNbl = FirstNbl;
+    NET_BUFFER_LIST *Nbl = FirstNbl;
+    NBL_CLASSIFICATION_BUCKET *CurrentBucket;
+    SIZE_T Count = 1;
+
+    for (SIZE_T i = 0; i < NumberOfBuckets; i++)
+    {
+        NdisInitializeNblCountedQueue(&Buckets[i].Queue);
+    }
+
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+#pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
+    SIZE_T Index = ClassificationCallback(ClassificationContext, Nbl);
+    NDIS_ASSERT(Index < NumberOfBuckets);
+
+    CurrentBucket = &Buckets[Index];
+    CurrentBucket->ClassificationResult = 0;
+    if (CurrentBucket->ClassificationCallback != NULL)
+    {
+#pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
+        CurrentBucket->ClassificationResult = CurrentBucket->ClassificationCallback(
+            CurrentBucket->ClassificationContext, Nbl);
+    }
+
+    while (TRUE)
+    {
+        Nbl = Nbl->Next;
+        if (Nbl == NULL)
+        {
+            NdisAppendNblChainToNblCountedQueueFast(
+                &CurrentBucket->Queue, FirstNbl, PreviousNbl, Count);
+            break;
+        }
+
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+#pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
+        Index = ClassificationCallback(ClassificationContext, Nbl);
+        NDIS_ASSERT(Index < NumberOfBuckets);
+
+        NBL_CLASSIFICATION_BUCKET *const Bucket = &Buckets[Index];
+        ULONG_PTR Value = 0;
+        if (Bucket->ClassificationCallback != NULL)
+        {
+#pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
+            Value = Bucket->ClassificationCallback(Bucket->ClassificationContext, Nbl);
+        }
+
+        if (Bucket == CurrentBucket && Value == CurrentBucket->ClassificationResult)
+        {
+            Count += 1;
+        }
+        else
+        {
+            PreviousNbl->Next = NULL;
+            NdisAppendNblChainToNblCountedQueueFast(
+                &CurrentBucket->Queue, FirstNbl, PreviousNbl, Count);
+
+            if (Value != Bucket->ClassificationResult
+                && !NdisIsNblCountedQueueEmpty(&Bucket->Queue))
+            {
+#pragma warning(suppress:6387) // 'FlushContext' could be NULL
+                Bucket->FlushCallback(
+                    Bucket->FlushContext, Bucket->ClassificationResult, &Bucket->Queue);
+                NdisInitializeNblCountedQueue(&Bucket->Queue);
+            }
+
+            Bucket->ClassificationResult = Value;
+            CurrentBucket = Bucket;
+            FirstNbl = Nbl;
+            Count = 1;
+        }
+
+        PreviousNbl = Nbl;
+    }
+
+    for (SIZE_T i = 0; i < NumberOfBuckets; i++)
+    {
+        if (!NdisIsNblCountedQueueEmpty(&Buckets[i].Queue))
+        {
+#pragma warning(suppress:6387) // 'FlushContext' could be NULL
+            Buckets[i].FlushCallback(
+                Buckets[i].FlushContext, Buckets[i].ClassificationResult, &Buckets[i].Queue);
+        }
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisPartialClassifyNblChainByValue(
+    _Inout_ NET_BUFFER_LIST **NblChain,
+    _In_ NDIS_NBL_CLASSIFICATION_VALUE_CALLBACK *ClassificationCallback,
+    _In_opt_ PVOID ClassificationContext,
+    _Out_ NBL_QUEUE *HomogenousQueue,
+    _Out_opt_ ULONG_PTR *ClassificationResult)
+/*++
+
+Routine Description:
+
+    This routine removes similar NBLs from the front of the chain
+
+    Similarity is defined by a classification callback function that you
+    provide.  Two NBLs are considered to be similar if and only if your
+    classification callback returns the same integer value for each.
+
+    You'd typically call NdisPartialClassifyNblChainByValue routine repeatedly
+    on an input chain, until there's no more NBLs remaining.
+
+Arguments
+
+    NblChain - Address of an NBL chain that contains the input.  On return,
+        contains the head of the remaining NBLs
+
+    ClassificationCallback - Callback that returns an integer (or pointer) that
+        indicates whether two NBLs should be batched together
+
+    ClassificationContext - Any optional context you'd like to pass to your callback
+
+    HomogenousQueue - On return, contains one or more similar NBLs from the
+        input chain
+
+    ClassificationResult - On return, contains the return value of your
+        ClassificationCallback for each of the NBLs in HomogenousQueue
+
+--*/
+{
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, *NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
+    NdisInitializeNblQueue(HomogenousQueue);
+
+    NET_BUFFER_LIST *FirstNbl = *NblChain;
+    NET_BUFFER_LIST *PreviousNbl = FirstNbl;
+    NET_BUFFER_LIST *Nbl = FirstNbl;
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+#pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
+    ULONG_PTR TargetClassification = ClassificationCallback(ClassificationContext, Nbl);
+
+    while (TRUE)
+    {
+        Nbl = Nbl->Next;
+        if (Nbl == NULL)
+        {
+            *NblChain = NULL;
+            break;
+        }
+
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+#pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
+        ULONG_PTR NextClassification = ClassificationCallback(ClassificationContext, Nbl);
+        if (NextClassification != TargetClassification)
+        {
+            PreviousNbl->Next = NULL;
+            *NblChain = Nbl;
+            break;
+        }
+
+        PreviousNbl = Nbl;
+    }
+
+    NdisAppendNblChainToNblQueueFast(HomogenousQueue, FirstNbl, PreviousNbl);
+
+    if (ARGUMENT_PRESENT(ClassificationResult))
+    {
+        *ClassificationResult = TargetClassification;
+    }
+
+    NDIS_ASSERT_VALID_NBL_QUEUE(HomogenousQueue);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisPartialClassifyNblChainByValueWithCount(
+    _Inout_ NET_BUFFER_LIST **NblChain,
+    _In_ NDIS_NBL_CLASSIFICATION_VALUE_CALLBACK *ClassificationCallback,
+    _In_opt_ PVOID ClassificationContext,
+    _Out_ NBL_COUNTED_QUEUE *HomogenousQueue,
+    _Out_opt_ ULONG_PTR *ClassificationResult)
+/*++
+
+Routine Description:
+
+    Similar to NdisPartialClassifyNblChainByValue, except results are provided
+    in an NBL_COUNTED_QUEUE.  Refer to the documentation for
+    NdisPartialClassifyNblChainByValue.
+
+--*/
+{
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, *NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
+    NdisInitializeNblCountedQueue(HomogenousQueue);
+
+    NET_BUFFER_LIST *FirstNbl = *NblChain;
+    NET_BUFFER_LIST *PreviousNbl = FirstNbl;
+    NET_BUFFER_LIST *Nbl = FirstNbl;
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+#pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
+    ULONG_PTR TargetClassification = ClassificationCallback(ClassificationContext, Nbl);
+    SIZE_T Count = 1;
+
+    while (TRUE)
+    {
+        Nbl = Nbl->Next;
+        if (Nbl == NULL)
+        {
+            *NblChain = NULL;
+            break;
+        }
+
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+#pragma warning(suppress:6387) // 'ClassificationContext' could be NULL
+        ULONG_PTR NextClassification = ClassificationCallback(ClassificationContext, Nbl);
+        if (NextClassification != TargetClassification)
+        {
+            PreviousNbl->Next = NULL;
+            *NblChain = Nbl;
+            break;
+        }
+
+        PreviousNbl = Nbl;
+    }
+
+    NdisAppendNblChainToNblCountedQueueFast(HomogenousQueue, FirstNbl, PreviousNbl, Count);
+
+    if (ARGUMENT_PRESENT(ClassificationResult))
+    {
+        *ClassificationResult = TargetClassification;
+    }
+
+    NDIS_ASSERT_VALID_NBL_COUNTED_QUEUE(HomogenousQueue);
+}
+
+inline NDIS_NBL_CLASSIFICATION_INDEX_CALLBACK NdisNblClassifierForCancelId;
+
+_Use_decl_annotations_
+inline
+SIZE_T
+NdisNblClassifierForCancelId(PVOID ClassificationContext, NET_BUFFER_LIST *Nbl)
+{
+    return Nbl->NetBufferListInfo[NetBufferListCancelId] == ClassificationContext ? 1 : 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisClassifyNblChainByCancelId(
+    _In_ NET_BUFFER_LIST *NblChain,
+    _In_ PVOID CancelId,
+    _Inout_ NBL_QUEUE *KeepQueue,
+    _Inout_ NBL_QUEUE *CancelQueue)
+/*++
+
+Routine Description:
+
+    Separates out any NBL with a given CancelId
+
+Arguments:
+
+    NblChain - The NBL chain to look through
+
+    CancelId - The CancelId to search for
+
+    KeepQueue - Receives any NBLs that did not match the CancelId
+
+    CancelQueue - Receives any NBLs that matched the CancelId
+
+--*/
+{
+    NdisClassifyNblChain2(
+        NblChain,
+        NdisNblClassifierForCancelId,
+        CancelId,
+        KeepQueue,
+        CancelQueue);
+}
+
+inline NDIS_NBL_CLASSIFICATION_INDEX_CALLBACK NdisNblClassifierForSourceHandle;
+
+_Use_decl_annotations_
+inline
+SIZE_T
+NdisNblClassifierForSourceHandle(PVOID ClassificationContext, NET_BUFFER_LIST *Nbl)
+{
+    return Nbl->SourceHandle == ClassificationContext ? 1 : 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisClassifyNblChainBySourceHandle(
+    _In_ NET_BUFFER_LIST *NblChain,
+    _In_ NDIS_HANDLE MySourceHandle,
+    _Inout_ NBL_QUEUE *TheirQueue,
+    _Inout_ NBL_QUEUE *MyQueue)
+/*++
+
+Routine Description:
+
+    Separates an NBL chain by each NBL's SourceHandle
+
+Arguments:
+
+    NblChain - The NBL chain to look through
+
+    MySourceHandle - The SourceHandle to search for
+
+    TheirQueue - Receives any NBLs that did not match the SourceHandle
+
+    MyQueue - Receives any NBLs that matched the SourceHandle
+
+--*/
+{
+    NdisClassifyNblChain2(
+        NblChain,
+        NdisNblClassifierForSourceHandle,
+        MySourceHandle,
+        TheirQueue,
+        MyQueue);
+}
+
+inline NDIS_NBL_CLASSIFICATION_INDEX_CALLBACK NdisNblClassifierForPoolHandle;
 
 _Use_decl_annotations_
 inline
@@ -1310,5 +2064,368 @@ Arguments:
         MyQueue);
 }
 
+#ifdef __cplusplus
+
+namespace ndis {
+
+namespace details
+{
+
+inline
+void
+initialize_nbl_queue(
+    _Out_ NBL_QUEUE *Queue)
+{
+    NdisInitializeNblQueue(Queue);
+}
+
+inline
+void
+initialize_nbl_queue(
+    _Out_ NBL_COUNTED_QUEUE *Queue)
+{
+    NdisInitializeNblCountedQueue(Queue);
+}
+
+inline
+void
+append_nbl_run(
+    _Inout_ NBL_QUEUE *Queue,
+    _In_ NET_BUFFER_LIST *First,
+    _In_ NET_BUFFER_LIST *Last,
+    _In_ SIZE_T)
+{
+    NdisAppendNblChainToNblQueueFast(Queue, First, Last);
+}
+
+inline
+void
+append_nbl_run(
+    _Inout_ NBL_COUNTED_QUEUE *Queue,
+    _In_ NET_BUFFER_LIST *First,
+    _In_ NET_BUFFER_LIST *Last,
+    _In_ SIZE_T Count)
+{
+    NdisAppendNblChainToNblCountedQueueFast(Queue, First, Last, Count);
+}
+
+} // namespace details
+
+template <typename TQueue, typename Classifier>
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+classify_nbl_chain2(
+    _In_ NET_BUFFER_LIST *NblChain,
+    Classifier &&ClassificationCallback,
+    _Inout_ TQueue *Queue0,
+    _Inout_ TQueue *Queue1)
+/*++
+
+Routine Description:
+
+    Separates an NBL chain into 2 queues, based on a callable that you provide
+
+    This is the same as NdisClassifyNblChain2 or
+    NdisClassifyNblChain2WithCount, except the classifier is not invoked
+    through a function pointer.
+
+Arguments:
+
+    NblChain - A chain of NBLs to sift through
+
+    ClassificationCallback - Invoked as `ClassificationCallback(Nbl)`.  Returns
+        false (or 0) to put the NBL into Queue0, or true (or 1) to put the NBL
+        into Queue1
+
+    Queue0 - Receives all NBLs for which the classifier returns false
+
+    Queue1 - Receives all NBLs for which the classifier returns true
+
+--*/
+{
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
+    NET_BUFFER_LIST *Nbl = NblChain;
+    NET_BUFFER_LIST *First = Nbl;
+    NET_BUFFER_LIST *Previous = Nbl;
+    SIZE_T Count = 1;
+
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+    bool CurrentIndex = !!ClassificationCallback(Nbl);
+    Nbl = Nbl->Next;
+
+    while (Nbl != nullptr)
+    {
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+        bool const ThisIndex = !!ClassificationCallback(Nbl);
+
+        if (ThisIndex != CurrentIndex)
+        {
+            Previous->Next = nullptr;
+            details::append_nbl_run(CurrentIndex ? Queue1 : Queue0, First, Previous, Count);
+
+            CurrentIndex = ThisIndex;
+            First = Nbl;
+            Count = 1;
+        }
+        else
+        {
+            Count++;
+        }
+
+        Previous = Nbl;
+        Nbl = Nbl->Next;
+    }
+
+    details::append_nbl_run(CurrentIndex ? Queue1 : Queue0, First, Previous, Count);
+}
+
+template <typename TQueue, typename Classifier>
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+classify_nbl_chain_by_index(
+    _In_ NET_BUFFER_LIST *NblChain,
+    Classifier &&ClassificationCallback,
+    _Inout_updates_(NumberOfQueues) TQueue *Queues,
+    _In_ SIZE_T NumberOfQueues)
+/*++
+
+Routine Description:
+
+    Separates an NBL chain into N queues, based on a callable that you provide
+
+    This is the same as NdisClassifyNblChainByIndex or
+    NdisClassifyNblChainByIndexWithCount, except the classifier is not
+    invoked through a function pointer.
+
+Arguments:
+
+    NblChain - A chain of NBLs to sift through
+
+    ClassificationCallback - Invoked as `ClassificationCallback(Nbl)`.  Returns
+        the index of the queue that receives the NBL
+
+    Queues - An array of initialized queues
+
+    NumberOfQueues - The number of elements in the array
+
+--*/
+{
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
+    NET_BUFFER_LIST *Nbl = NblChain;
+    NET_BUFFER_LIST *First = Nbl;
+    NET_BUFFER_LIST *Previous = Nbl;
+    SIZE_T Count = 1;
+
+    UNREFERENCED_PARAMETER(NumberOfQueues);
+
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+    SIZE_T CurrentIndex = static_cast<SIZE_T>(ClassificationCallback(Nbl));
+    NDIS_ASSERT(CurrentIndex < NumberOfQueues);
+    Nbl = Nbl->Next;
+
+    while (Nbl != nullptr)
+    {
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+        SIZE_T const ThisIndex = static_cast<SIZE_T>(ClassificationCallback(Nbl));
+        NDIS_ASSERT(ThisIndex < NumberOfQueues);
+
+        if (ThisIndex != CurrentIndex)
+        {
+            Previous->Next = nullptr;
+            details::append_nbl_run(&Queues[CurrentIndex], First, Previous, Count);
+
+            CurrentIndex = ThisIndex;
+            First = Nbl;
+            Count = 1;
+        }
+        else
+        {
+            Count++;
+        }
+
+        Previous = Nbl;
+        Nbl = Nbl->Next;
+    }
+
+    details::append_nbl_run(&Queues[CurrentIndex], First, Previous, Count);
+}
+
+template <typename TQueue = NBL_QUEUE, typename Classifier, typename Flush>
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+classify_nbl_chain_by_value(
+    _In_ NET_BUFFER_LIST *NblChain,
+    Classifier &&ClassificationCallback,
+    Flush &&FlushCallback)
+/*++
+
+Routine Description:
+
+    This routine calls your callable with batches of similar NBLs
+
+    This is the same as NdisClassifyNblChainByValue, except the classifier and
+    flush callback are not invoked through function pointers.  To receive
+    NBL_COUNTED_QUEUEs, as with NdisClassifyNblChainByValueWithCount, invoke
+    this as `classify_nbl_chain_by_value<NBL_COUNTED_QUEUE>(...)`.
+
+Arguments
+
+    NblChain - An NBL chain that contains the input.  The chain will be
+        unlinked as part of the operation of this routine.
+
+    ClassificationCallback - Invoked as `ClassificationCallback(Nbl)`.  Returns
+        a value that indicates whether two NBLs should be batched together
+
+    FlushCallback - Invoked as `FlushCallback(Value, Queue)` with each batch
+        of homogenous NBLs, where Value is the result of ClassificationCallback
+        and Queue is a TQueue *
+
+--*/
+{
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(&Prefetch, NblChain, NDIS_CLASSIFY_NBL_PREFETCH_FLAGS);
+
+    TQueue Queue;
+    details::initialize_nbl_queue(&Queue);
+
+    NET_BUFFER_LIST *FirstNbl = NblChain;
+    NET_BUFFER_LIST *PreviousNbl = FirstNbl;
+    NET_BUFFER_LIST *Nbl = FirstNbl;
+    NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+    auto TargetClassification = ClassificationCallback(Nbl);
+    SIZE_T Count = 1;
+
+    while (true)
+    {
+        Nbl = Nbl->Next;
+        if (Nbl == nullptr)
+        {
+            details::append_nbl_run(&Queue, FirstNbl, PreviousNbl, Count);
+            FlushCallback(TargetClassification, &Queue);
+            break;
+        }
+
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+        auto NextClassification = ClassificationCallback(Nbl);
+        if (NextClassification != TargetClassification)
+        {
+            PreviousNbl->Next = nullptr;
+            details::append_nbl_run(&Queue, FirstNbl, PreviousNbl, Count);
+            FlushCallback(TargetClassification, &Queue);
+
+            details::initialize_nbl_queue(&Queue);
+            FirstNbl = Nbl;
+            TargetClassification = NextClassification;
+            Count = 1;
+        }
+        else
+        {
+            Count++;
+        }
+
+        PreviousNbl = Nbl;
+    }
+}
+
+template <typename TQueue>
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+classify_nbl_chain_by_cancel_id(
+    _In_ NET_BUFFER_LIST *NblChain,
+    _In_ PVOID CancelId,
+    _Inout_ TQueue *KeepQueue,
+    _Inout_ TQueue *CancelQueue)
+/*++
+
+Routine Description:
+
+    Separates out any NBL with a given CancelId.  Refer to the documentation
+    for NdisClassifyNblChainByCancelId.
+
+--*/
+{
+    classify_nbl_chain2(
+        NblChain,
+        [CancelId](NET_BUFFER_LIST *Nbl)
+        {
+            return Nbl->NetBufferListInfo[NetBufferListCancelId] == CancelId;
+        },
+        KeepQueue,
+        CancelQueue);
+}
+
+template <typename TQueue>
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+classify_nbl_chain_by_source_handle(
+    _In_ NET_BUFFER_LIST *NblChain,
+    _In_ NDIS_HANDLE MySourceHandle,
+    _Inout_ TQueue *TheirQueue,
+    _Inout_ TQueue *MyQueue)
+/*++
+
+Routine Description:
+
+    Separates an NBL chain by each NBL's SourceHandle.  Refer to the
+    documentation for NdisClassifyNblChainBySourceHandle.
+
+--*/
+{
+    classify_nbl_chain2(
+        NblChain,
+        [MySourceHandle](NET_BUFFER_LIST *Nbl)
+        {
+            return Nbl->SourceHandle == MySourceHandle;
+        },
+        TheirQueue,
+        MyQueue);
+}
+
+template <typename TQueue>
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+classify_nbl_chain_by_pool_handle(
+    _In_ NET_BUFFER_LIST *NblChain,
+    _In_ NDIS_HANDLE MyPoolHandle,
+    _Inout_ TQueue *TheirQueue,
+    _Inout_ TQueue *MyQueue)
+/*++
+
+Routine Description:
+
+    Separates an NBL chain by each NBL's NdisPoolHandle.  Refer to the
+    documentation for NdisClassifyNblChainByPoolHandle.
+
+--*/
+{
+    classify_nbl_chain2(
+        NblChain,
+        [MyPoolHandle](NET_BUFFER_LIST *Nbl)
+        {
+            return Nbl->NdisPoolHandle == MyPoolHandle;
+        },
+        TheirQueue,
+        MyQueue);
+}
+
+} // namespace ndis
+
+#endif // __cplusplus
+
 #endif // WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
 #pragma endregion
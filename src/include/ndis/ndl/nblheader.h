@@ -0,0 +1,194 @@
+/*++
+
+    Copyright (c) Microsoft. All rights reserved.
+
+    This code is licensed under the MIT License.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+
+Module Name:
+
+    nblheader.h
+
+Provenance:
+
+    Version 1.2.0 from https://github.com/microsoft/ndis-driver-library
+
+Abstract:
+
+    Utility functions for reading the packet headers of an NBL chain
+
+    NdisGetNblChainContiguousHeaders runs MdlSpanGetContiguousOrCopy (see
+    mdl.h) on the first N bytes of each NBL in a chain, in one prefetching
+    walk over the chain.  Each header is returned as a pointer directly into
+    the NBL's MDL, unless its bytes straddle more than one MDL; only then are
+    they copied into a buffer that you provide:
+
+        NBL_CONTIGUOUS_HEADER Headers[64];
+        UCHAR Storage[64 * sizeof(ETHERNET_HEADER)];
+        SIZE_T NumberOfHeaders;
+
+        NdisGetNblChainContiguousHeaders(
+            NblChain, sizeof(ETHERNET_HEADER), Storage, Headers, 64, &NumberOfHeaders);
+
+        for (SIZE_T i = 0; i < NumberOfHeaders; i++)
+        {
+            . . . parse Headers[i].Data . . .
+        }
+
+    This lives in its own header, rather than in mdl.h, so that mdl.h stays
+    free of any dependency on NDIS.
+
+Table of Contents:
+
+        NdisGetNblChainContiguousHeaders
+
+Environment:
+
+    Kernel mode
+
+--*/
+
+#pragma once
+
+#pragma region System Family (kernel drivers) with Desktop Family for compat
+#include <winapifamily.h>
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+
+#include <ndis/ndl/nblchain.h>
+#include <ndis/ndl/mdl.h>
+
+// An NBL_CONTIGUOUS_HEADER describes the first bytes of one NBL, as returned by
+// NdisGetNblChainContiguousHeaders.
+typedef struct NBL_CONTIGUOUS_HEADER_t
+{
+    // The NBL that the header was read from
+    NET_BUFFER_LIST *Nbl;
+
+    // The header bytes, either in the MDL's buffer or in the caller's
+    // storage, or NULL if the MDL could not be mapped
+    UCHAR const *Data;
+
+    // The number of bytes at Data
+    SIZE_T Length;
+
+    // TRUE if the bytes straddled more than one MDL and were copied into the
+    // caller's storage
+    BOOLEAN Copied;
+} NBL_CONTIGUOUS_HEADER;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+NdisGetNblChainContiguousHeaders(
+    _In_opt_ NET_BUFFER_LIST *NblChain,
+    _In_ SIZE_T HeaderLength,
+    _Out_writes_bytes_(MaximumHeaders * HeaderLength) UCHAR *Storage,
+    _Out_writes_to_(MaximumHeaders, *NumberOfHeaders) NBL_CONTIGUOUS_HEADER *Headers,
+    _In_ SIZE_T MaximumHeaders,
+    _Out_ SIZE_T *NumberOfHeaders)
+/*++
+
+Routine Description:
+
+    Gets a pointer to the first HeaderLength bytes of each NBL in a chain,
+    copying them only if they straddle more than one MDL
+
+    This runs MdlSpanGetContiguousOrCopy on the first NET_BUFFER of each NBL,
+    in a single walk over the chain that prefetches each NBL's NET_BUFFER and
+    current MDL ahead of time (see NdisInitializeNblPrefetchWindow). This is
+    usually what you want if you parse the headers of a batch of received
+    packets.
+
+    Headers[i] describes the i-th NBL. If its bytes straddle more than one
+    MDL, they are copied to Storage + i * HeaderLength. If a NET_BUFFER has
+    fewer than HeaderLength bytes of data, Headers[i].Length is its
+    DataLength.
+
+    If an MDL cannot be mapped, Headers[i].Data is NULL, and the walk
+    continues with the next NBL.
+
+    Only the first NET_BUFFER of each NBL is read; if your NBLs can carry more
+    than one NET_BUFFER, use MdlSpanGetContiguousOrCopy for the others.
+
+Arguments:
+
+    NblChain - Zero or more NBLs
+
+    HeaderLength - The number of bytes to get from the start of each NBL's
+        data
+
+    Storage - A buffer of at least MaximumHeaders * HeaderLength bytes, used
+        for headers that straddle more than one MDL
+
+    Headers - Receives one entry per NBL
+
+    MaximumHeaders - The number of elements in Headers
+
+    NumberOfHeaders - Receives the number of elements of Headers that were
+        written
+
+Return Value:
+
+    STATUS_SUCCESS
+        Every NBL was processed, and every NBL's header was mapped
+
+    STATUS_BUFFER_TOO_SMALL
+        The chain has more than MaximumHeaders NBLs. The first MaximumHeaders
+        NBLs were processed; you can call this routine again, starting at
+        Headers[MaximumHeaders - 1].Nbl->Next, to process the rest.
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to map an MDL into system address space for at
+        least one NBL. Every NBL was processed, and the Data of each affected
+        entry is NULL. If the chain also has more than MaximumHeaders NBLs,
+        STATUS_BUFFER_TOO_SMALL is returned instead.
+
+--*/
+{
+    NTSTATUS NtStatus = STATUS_SUCCESS;
+    SIZE_T i = 0;
+
+    NBL_PREFETCH_WINDOW Prefetch;
+    NdisInitializeNblPrefetchWindow(
+        &Prefetch, NblChain, NDIS_NBL_PREFETCH_NET_BUFFER | NDIS_NBL_PREFETCH_MDL);
+
+    for (NET_BUFFER_LIST *Nbl = NblChain; Nbl; Nbl = Nbl->Next, i++)
+    {
+        if (i == MaximumHeaders)
+        {
+            NtStatus = STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        NdisAdvanceNblPrefetchWindow(&Prefetch, Nbl);
+
+        NBL_CONTIGUOUS_HEADER *const Header = &Headers[i];
+        NET_BUFFER *const Nb = NET_BUFFER_LIST_FIRST_NB(Nbl);
+
+        MDL_SPAN Span = { { 0 } };
+        Span.Start.Mdl = NET_BUFFER_CURRENT_MDL(Nb);
+        Span.Start.Offset = NET_BUFFER_CURRENT_MDL_OFFSET(Nb);
+        Span.Length = (HeaderLength < NET_BUFFER_DATA_LENGTH(Nb))
+            ? HeaderLength
+            : NET_BUFFER_DATA_LENGTH(Nb);
+
+        Header->Nbl = Nbl;
+        Header->Length = Span.Length;
+
+        if (STATUS_SUCCESS != MdlSpanGetContiguousOrCopy(
+            &Span, Storage + i * HeaderLength, &Header->Data, &Header->Copied))
+        {
+            Header->Data = NULL;
+            NtStatus = STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    *NumberOfHeaders = i;
+    return NtStatus;
+}
+
+#endif // WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+#pragma endregion
@@ -0,0 +1,498 @@
+/*++
+
+    Copyright (c) Microsoft. All rights reserved.
+
+    This code is licensed under the MIT License.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+
+Module Name:
+
+    nblparallelflush.h
+
+Provenance:
+
+    Version 1.2.0 from https://github.com/microsoft/ndis-driver-library
+
+Abstract:
+
+    Defines the NBL_PARALLEL_FLUSH, which spreads batches of similar NBLs
+    across processors
+
+    NdisClassifyNblChainByValue invokes your NDIS_NBL_FLUSH_CALLBACK for each
+    batch, one after another, on the processor that is classifying the chain.
+    If a single indication carries many flows, that one processor does all
+    the work while others sit idle.
+
+    The NBL_PARALLEL_FLUSH has one lane for each active processor.  When you
+    dispatch an NBL chain, it is classified by value, and each batch is
+    appended to a lane chosen by hashing the batch's classification value.
+    Each lane has a DPC targeted to its own processor, which invokes your
+    flush callback on the lane's NBLs.  All batches with the same
+    classification value go to the same lane, so they are flushed in the
+    order they were dispatched.
+
+    Only one processor drains a lane at a time.  When a lane's DPC finishes
+    its own lane, it steals one other lane that has NBLs waiting and that no
+    processor is draining yet, so a processor that is slow to run its DPC
+    doesn't hold up the flows assigned to it.
+
+    Your classification callback is invoked twice for each NBL: once on the
+    dispatching processor, to choose a lane, and once on the processor that
+    drains the lane, to rebuild the batches.  It must be cheap and must
+    return the same value both times.
+
+Example usage:
+
+    NBL_PARALLEL_FLUSH Receive;
+    NdisInitializeNblParallelFlush(
+        &Receive, GetFlow, NULL, ReceivePacketsOnFlow, Adapter, MY_POOLTAG);
+
+    // In the receive path:
+    NdisDispatchNblChainToParallelFlush(&Receive, NblChain);
+
+    // At PASSIVE_LEVEL, once nothing dispatches to it anymore:
+    NdisUninitializeNblParallelFlush(&Receive);
+
+Synchronization:
+
+    You may call NdisDispatchNblChainToParallelFlush on several processors at
+    once.  Each lane is protected by its own spin lock.
+
+    Your flush callback is invoked at DISPATCH_LEVEL, on any processor, and
+    may run concurrently with itself for batches that have different
+    classification values.  It is never invoked concurrently for two batches
+    that have the same classification value.
+
+Table of Contents:
+
+        NdisUninitializeNblParallelFlush
+        NdisInitializeNblParallelFlush
+        NdisDispatchNblChainToParallelFlush
+
+Environment:
+
+    Kernel mode
+
+--*/
+
+#pragma once
+
+#pragma region System Family (kernel drivers) with Desktop Family for compat
+#include <winapifamily.h>
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+
+#include <ndis/ndl/nblclassify.h>
+
+typedef struct NBL_PARALLEL_FLUSH_t NBL_PARALLEL_FLUSH;
+
+//
+// Each lane sits in its own cache line, so that processors draining
+// different lanes never write to the same cache line.
+//
+typedef struct DECLSPEC_CACHEALIGN NBL_PARALLEL_FLUSH_LANE_t
+{
+    // Protects Pending and Claimed
+    KSPIN_LOCK Lock;
+
+    // TRUE while a processor is draining this lane
+    BOOLEAN Claimed;
+
+    // The NBLs waiting for the flush callback, in the order they were
+    // dispatched
+    NBL_QUEUE Pending;
+
+    NBL_PARALLEL_FLUSH *ParallelFlush;
+
+    // Targeted to the lane's own processor
+    KDPC Dpc;
+} NBL_PARALLEL_FLUSH_LANE;
+
+typedef struct NBL_PARALLEL_FLUSH_t
+{
+    NDIS_NBL_CLASSIFICATION_VALUE_CALLBACK *ClassificationCallback;
+    PVOID ClassificationContext;
+
+    NDIS_NBL_FLUSH_CALLBACK *FlushCallback;
+    PVOID FlushContext;
+
+    // The number of elements in Lanes; one per active processor index
+    ULONG NumberOfLanes;
+
+    NBL_PARALLEL_FLUSH_LANE *Lanes;
+} NBL_PARALLEL_FLUSH;
+
+//
+// Implementation detail - do not use this structure directly
+//
+typedef struct NBL_PARALLEL_FLUSH_STAGING_t
+{
+    NBL_PARALLEL_FLUSH *ParallelFlush;
+
+    // The lane that receives Queue, or NULL if Queue is empty
+    NBL_PARALLEL_FLUSH_LANE *Lane;
+
+    // Consecutive batches that hash to the same Lane
+    NBL_QUEUE Queue;
+} NBL_PARALLEL_FLUSH_STAGING;
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+void
+NdisUninitializeNblParallelFlush(
+    _Inout_ NBL_PARALLEL_FLUSH *ParallelFlush)
+/*++
+
+Routine Description:
+
+    Waits for every lane to be flushed, then frees the resources of an
+    NBL_PARALLEL_FLUSH
+
+    You must ensure that nothing calls NdisDispatchNblChainToParallelFlush
+    while, or after, this routine runs.
+
+Arguments:
+
+    ParallelFlush - The NBL_PARALLEL_FLUSH to uninitialize
+
+--*/
+{
+    if (ParallelFlush->Lanes == NULL)
+    {
+        return;
+    }
+
+    //
+    // Every lane with pending NBLs either has its DPC queued, or is claimed
+    // by a DPC that keeps draining it until it is empty.  So once the queued
+    // DPCs have run, every lane is empty.
+    //
+    KeFlushQueuedDpcs();
+
+    for (ULONG i = 0; i < ParallelFlush->NumberOfLanes; i++)
+    {
+        NDIS_ASSERT(!ParallelFlush->Lanes[i].Claimed);
+        NDIS_ASSERT(NdisIsNblQueueEmpty(&ParallelFlush->Lanes[i].Pending));
+    }
+
+    ExFreePool(ParallelFlush->Lanes);
+
+    ParallelFlush->Lanes = NULL;
+    ParallelFlush->NumberOfLanes = 0;
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+NdisDrainNblParallelFlushLane(
+    _Inout_ NBL_PARALLEL_FLUSH_LANE *Lane)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Claims the lane, if no other processor has, and invokes the flush
+    callback until the lane is empty.
+
+--*/
+{
+    NBL_PARALLEL_FLUSH *ParallelFlush = Lane->ParallelFlush;
+
+    KeAcquireSpinLockAtDpcLevel(&Lane->Lock);
+
+    if (Lane->Claimed || NdisIsNblQueueEmpty(&Lane->Pending))
+    {
+        KeReleaseSpinLockFromDpcLevel(&Lane->Lock);
+        return FALSE;
+    }
+
+    Lane->Claimed = TRUE;
+
+    while (TRUE)
+    {
+        NET_BUFFER_LIST *NblChain = NdisPopAllFromNblQueue(&Lane->Pending);
+
+        if (NblChain == NULL)
+        {
+            Lane->Claimed = FALSE;
+            break;
+        }
+
+        KeReleaseSpinLockFromDpcLevel(&Lane->Lock);
+
+        NdisClassifyNblChainByValue(
+            NblChain,
+            ParallelFlush->ClassificationCallback,
+            ParallelFlush->ClassificationContext,
+            ParallelFlush->FlushCallback,
+            ParallelFlush->FlushContext);
+
+        KeAcquireSpinLockAtDpcLevel(&Lane->Lock);
+    }
+
+    KeReleaseSpinLockFromDpcLevel(&Lane->Lock);
+
+    return TRUE;
+}
+
+_Function_class_(KDEFERRED_ROUTINE)
+_IRQL_requires_(DISPATCH_LEVEL)
+_IRQL_requires_same_
+inline
+void
+NdisNblParallelFlushDpc(
+    _In_ KDPC *Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Drains the DPC's own lane, then steals the next lane that still has NBLs
+    waiting and that no processor has claimed.  The stolen lane's own DPC is
+    still queued, so every lane makes progress even without the thief.
+
+--*/
+{
+    UNREFERENCED_PARAMETER(Dpc);
+    UNREFERENCED_PARAMETER(SystemArgument1);
+    UNREFERENCED_PARAMETER(SystemArgument2);
+
+    NBL_PARALLEL_FLUSH_LANE *Lane = (NBL_PARALLEL_FLUSH_LANE *)DeferredContext;
+    NBL_PARALLEL_FLUSH *ParallelFlush = Lane->ParallelFlush;
+    ULONG const Index = (ULONG)(Lane - ParallelFlush->Lanes);
+
+    NdisDrainNblParallelFlushLane(Lane);
+
+    for (ULONG i = 1; i < ParallelFlush->NumberOfLanes; i++)
+    {
+        NBL_PARALLEL_FLUSH_LANE *Victim = &ParallelFlush->Lanes[(Index + i) % ParallelFlush->NumberOfLanes];
+
+        // Skip idle lanes without touching their lock
+        if (ReadPointerNoFence((PVOID const volatile *)&Victim->Pending.First) == NULL)
+        {
+            continue;
+        }
+
+        // Steal at most one lane, so a busy processor doesn't end up
+        // draining every lane and serializing the flows again
+        if (NdisDrainNblParallelFlushLane(Victim))
+        {
+            break;
+        }
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+NdisInitializeNblParallelFlush(
+    _Out_ NBL_PARALLEL_FLUSH *ParallelFlush,
+    _In_ NDIS_NBL_CLASSIFICATION_VALUE_CALLBACK *ClassificationCallback,
+    _In_opt_ PVOID ClassificationContext,
+    _In_ NDIS_NBL_FLUSH_CALLBACK *FlushCallback,
+    _In_opt_ PVOID FlushContext,
+    _In_ ULONG PoolTag)
+/*++
+
+Routine Description:
+
+    Allocates and initializes an NBL_PARALLEL_FLUSH, with one lane for each
+    active processor
+
+Arguments:
+
+    ParallelFlush - The NBL_PARALLEL_FLUSH to initialize
+
+    ClassificationCallback - Callback that returns an integer (or pointer)
+        that indicates whether two NBLs belong to the same flow
+
+    ClassificationContext - Any optional context you'd like to pass to your
+        classification callback
+
+    FlushCallback - Callback that is called, at DISPATCH_LEVEL, with each
+        batch of homogenous NBLs
+
+    FlushContext - Any optional context you'd like to pass to your flush
+        callback
+
+    PoolTag - A pool tag to use for the allocation
+
+Return Value:
+
+    STATUS_SUCCESS
+        The NBL_PARALLEL_FLUSH was initialized; you must later call
+        NdisUninitializeNblParallelFlush
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to allocate memory
+
+--*/
+{
+    ULONG const NumberOfLanes = KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    ParallelFlush->ClassificationCallback = ClassificationCallback;
+    ParallelFlush->ClassificationContext = ClassificationContext;
+    ParallelFlush->FlushCallback = FlushCallback;
+    ParallelFlush->FlushContext = FlushContext;
+    ParallelFlush->NumberOfLanes = 0;
+    ParallelFlush->Lanes = (NBL_PARALLEL_FLUSH_LANE *)ExAllocatePool2(
+        POOL_FLAG_NON_PAGED | POOL_FLAG_CACHE_ALIGNED,
+        (SIZE_T)NumberOfLanes * sizeof(ParallelFlush->Lanes[0]),
+        PoolTag);
+
+    if (ParallelFlush->Lanes == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    for (ULONG i = 0; i < NumberOfLanes; i++)
+    {
+        NBL_PARALLEL_FLUSH_LANE *Lane = &ParallelFlush->Lanes[i];
+
+        KeInitializeSpinLock(&Lane->Lock);
+        Lane->Claimed = FALSE;
+        NdisInitializeNblQueue(&Lane->Pending);
+        Lane->ParallelFlush = ParallelFlush;
+
+        KeInitializeDpc(&Lane->Dpc, NdisNblParallelFlushDpc, Lane);
+
+        //
+        // If the processor can't be targeted, the DPC runs on whichever
+        // processor queues it, which is still correct, just not parallel.
+        //
+        PROCESSOR_NUMBER ProcessorNumber;
+        if (NT_SUCCESS(KeGetProcessorNumberFromIndex(i, &ProcessorNumber)))
+        {
+            (void)KeSetTargetProcessorDpcEx(&Lane->Dpc, &ProcessorNumber);
+        }
+
+        // Ask the target processor to run the DPC promptly, even if idle
+        KeSetImportanceDpc(&Lane->Dpc, MediumHighImportance);
+    }
+
+    ParallelFlush->NumberOfLanes = NumberOfLanes;
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisAppendNblQueueToNblParallelFlushLane(
+    _Inout_ NBL_PARALLEL_FLUSH_LANE *Lane,
+    _Inout_ NBL_QUEUE *Queue)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    KIRQL OldIrql;
+    KeAcquireSpinLock(&Lane->Lock, &OldIrql);
+
+    NdisAppendNblQueueToNblQueueFast(&Lane->Pending, Queue);
+
+    // If a processor is draining the lane, it will find these NBLs too
+    BOOLEAN const NeedsDpc = !Lane->Claimed;
+
+    KeReleaseSpinLock(&Lane->Lock, OldIrql);
+
+    if (NeedsDpc)
+    {
+        (void)KeInsertQueueDpc(&Lane->Dpc, NULL, NULL);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_IRQL_requires_same_
+_Function_class_(NDIS_NBL_FLUSH_CALLBACK)
+inline
+VOID
+NdisStageNblParallelFlushBatch(
+    _In_ PVOID FlushContext,
+    _In_ ULONG_PTR ClassificationResult,
+    _In_ NBL_QUEUE *Queue)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Collects consecutive batches that hash to the same lane, so the lane's
+    lock is taken once for all of them.
+
+--*/
+{
+    NBL_PARALLEL_FLUSH_STAGING *Staging = (NBL_PARALLEL_FLUSH_STAGING *)FlushContext;
+    NBL_PARALLEL_FLUSH *ParallelFlush = Staging->ParallelFlush;
+
+    // Fibonacci hashing, then a multiply-shift to reduce to [0, NumberOfLanes)
+    ULONG64 const Hash = (ULONG64)ClassificationResult * 0x9E3779B97F4A7C15ull;
+    ULONG const Index = (ULONG)(((Hash >> 32) * ParallelFlush->NumberOfLanes) >> 32);
+    NBL_PARALLEL_FLUSH_LANE *Lane = &ParallelFlush->Lanes[Index];
+
+    if (Staging->Lane != Lane)
+    {
+        if (Staging->Lane != NULL)
+        {
+            NdisAppendNblQueueToNblParallelFlushLane(Staging->Lane, &Staging->Queue);
+        }
+
+        Staging->Lane = Lane;
+    }
+
+    NdisAppendNblQueueToNblQueueFast(&Staging->Queue, Queue);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisDispatchNblChainToParallelFlush(
+    _Inout_ NBL_PARALLEL_FLUSH *ParallelFlush,
+    _In_ NET_BUFFER_LIST *NblChain)
+/*++
+
+Routine Description:
+
+    Classifies an NBL chain by value, and queues each batch to a lane, to be
+    flushed on another processor
+
+    This routine returns without waiting for the flush callbacks.
+
+Arguments:
+
+    ParallelFlush
+
+    NblChain - An NBL chain that contains the input.  The chain will be
+        unlinked as part of the operation of this routine.
+
+--*/
+{
+    NBL_PARALLEL_FLUSH_STAGING Staging;
+    Staging.ParallelFlush = ParallelFlush;
+    Staging.Lane = NULL;
+    NdisInitializeNblQueue(&Staging.Queue);
+
+    NdisClassifyNblChainByValue(
+        NblChain,
+        ParallelFlush->ClassificationCallback,
+        ParallelFlush->ClassificationContext,
+        NdisStageNblParallelFlushBatch,
+        &Staging);
+
+    NDIS_ASSERT(Staging.Lane != NULL);
+
+    NdisAppendNblQueueToNblParallelFlushLane(Staging.Lane, &Staging.Queue);
+}
+
+#endif // WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+#pragma endregion
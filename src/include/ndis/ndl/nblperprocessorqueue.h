@@ -0,0 +1,415 @@
+/*++
+
+    Copyright (c) Microsoft. All rights reserved.
+
+    This code is licensed under the MIT License.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+
+Module Name:
+
+    nblperprocessorqueue.h
+
+Provenance:
+
+    Version 1.2.0 from https://github.com/microsoft/ndis-driver-library
+
+Abstract:
+
+    Defines the NBL_PER_PROCESSOR_QUEUE and utility functions to operate on it
+
+    The NBL_PER_PROCESSOR_QUEUE is a set of NBL_COUNTED_QUEUEs, one for each
+    processor in the system.  Each processor appends NBLs only to its own
+    queue, so the append path never writes to a cache line that another
+    processor is using, and needs no lock or interlocked operation.  Later,
+    the queues can be drained into a single NBL_COUNTED_QUEUE in one batch.
+
+    Each processor's queue is cache-line aligned and allocated from the NUMA
+    node that the processor belongs to.
+
+Example usage:
+
+    NBL_PER_PROCESSOR_QUEUE Staging;
+    NdisInitializeNblPerProcessorQueue(&Staging, MY_POOLTAG);
+
+    // On any processor, at DISPATCH_LEVEL:
+    NdisAppendNblChainToNblPerProcessorQueueFast(&Staging, First, Last, Count);
+
+    // Later, on the same processor, at DISPATCH_LEVEL:
+    NBL_COUNTED_QUEUE Batch;
+    NdisInitializeNblCountedQueue(&Batch);
+    NdisDrainCurrentProcessorNblPerProcessorQueue(&Staging, &Batch);
+
+    // When no processor is appending to the queue:
+    NdisDrainNblPerProcessorQueue(&Staging, &Batch);
+    NdisUninitializeNblPerProcessorQueue(&Staging);
+
+Synchronization:
+
+    The routines in this header do not synchronize with each other.  The
+    append routines and NdisDrainCurrentProcessorNblPerProcessorQueue must be
+    called at DISPATCH_LEVEL, which prevents any other thread from using the
+    current processor's queue at the same time.
+
+    NdisDrainNblPerProcessorQueue and NdisIsNblPerProcessorQueueEmpty touch
+    every processor's queue.  You must ensure no processor is appending to the
+    queue while they run; for example, call them only while your data path is
+    paused.
+
+Table of Contents:
+
+        NdisUninitializeNblPerProcessorQueue
+        NdisInitializeNblPerProcessorQueue
+        NdisIsNblPerProcessorQueueEmpty
+        NdisAppendNblChainToNblPerProcessorQueueFast
+        NdisAppendNblCountedQueueToNblPerProcessorQueue
+        NdisAppendSingleNblToNblPerProcessorQueue
+        NdisDrainCurrentProcessorNblPerProcessorQueue
+        NdisDrainNblPerProcessorQueue
+
+Environment:
+
+    Kernel mode
+
+    Requires ExAllocatePool3, which is available in Windows 10, version 2004
+    and later.
+
+--*/
+
+#pragma once
+
+#pragma region System Family (kernel drivers) with Desktop Family for compat
+#include <winapifamily.h>
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+
+#include <ndis/ndl/nblqueue.h>
+#include <ndis/ndl/perprocessor.h>
+
+//
+// Each processor's NBL_COUNTED_QUEUE sits in its own cache line, so that no
+// two processors ever write to the same cache line.
+//
+typedef struct DECLSPEC_CACHEALIGN NBL_PER_PROCESSOR_QUEUE_SLOT_t
+{
+    NBL_COUNTED_QUEUE Queue;
+} NBL_PER_PROCESSOR_QUEUE_SLOT;
+
+typedef struct NBL_PER_PROCESSOR_QUEUE_t
+{
+    // The number of elements in Slots; one per possible processor index
+    ULONG NumberOfProcessors;
+
+    // The pool tag used for all allocations
+    ULONG PoolTag;
+
+    // An array of pointers to each processor's queue, indexed by the
+    // processor index (see KeGetCurrentProcessorIndex)
+    NBL_PER_PROCESSOR_QUEUE_SLOT **Slots;
+} NBL_PER_PROCESSOR_QUEUE;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisUninitializeNblPerProcessorQueue(
+    _Inout_ NBL_PER_PROCESSOR_QUEUE *PerProcessorQueue)
+/*++
+
+Routine Description:
+
+    Frees the resources of an NBL_PER_PROCESSOR_QUEUE
+
+    The queue must be empty.  Use NdisDrainNblPerProcessorQueue to remove any
+    remaining NBLs first.
+
+Arguments:
+
+    PerProcessorQueue - The queue to uninitialize
+
+--*/
+{
+    if (PerProcessorQueue->Slots == NULL)
+    {
+        return;
+    }
+
+    for (ULONG i = 0; i < PerProcessorQueue->NumberOfProcessors; i++)
+    {
+        NDIS_ASSERT(NdisIsNblCountedQueueEmpty(&PerProcessorQueue->Slots[i]->Queue));
+    }
+
+    NdlFreePerProcessorSlots(PerProcessorQueue->NumberOfProcessors, (PVOID *)PerProcessorQueue->Slots);
+
+    PerProcessorQueue->Slots = NULL;
+    PerProcessorQueue->NumberOfProcessors = 0;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NTSTATUS
+NdisInitializeNblPerProcessorQueue(
+    _Out_ NBL_PER_PROCESSOR_QUEUE *PerProcessorQueue,
+    _In_ ULONG PoolTag)
+/*++
+
+Routine Description:
+
+    Allocates and initializes an NBL_PER_PROCESSOR_QUEUE
+
+    Each processor's queue is allocated from the processor's own NUMA node,
+    if possible.  If the node has no memory available, the queue is allocated
+    from any node.
+
+Arguments:
+
+    PerProcessorQueue - The queue to initialize
+
+    PoolTag - A pool tag to use for the queue's allocations
+
+Return Value:
+
+    STATUS_SUCCESS
+        The queue was initialized; you must later call
+        NdisUninitializeNblPerProcessorQueue
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to allocate memory
+
+--*/
+{
+    ULONG NumberOfProcessors;
+
+    PerProcessorQueue->NumberOfProcessors = 0;
+    PerProcessorQueue->PoolTag = PoolTag;
+    PerProcessorQueue->Slots = (NBL_PER_PROCESSOR_QUEUE_SLOT **)NdlAllocatePerProcessorSlots(
+        sizeof(NBL_PER_PROCESSOR_QUEUE_SLOT), PoolTag, &NumberOfProcessors);
+
+    if (PerProcessorQueue->Slots == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    for (ULONG i = 0; i < NumberOfProcessors; i++)
+    {
+        NdisInitializeNblCountedQueue(&PerProcessorQueue->Slots[i]->Queue);
+    }
+
+    PerProcessorQueue->NumberOfProcessors = NumberOfProcessors;
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+NdisIsNblPerProcessorQueueEmpty(
+    _In_ NBL_PER_PROCESSOR_QUEUE const *PerProcessorQueue)
+/*++
+
+Routine Description:
+
+    Determines whether any processor's queue has NBLs in it
+
+    No processor may append to the queue while this routine runs.
+
+Arguments:
+
+    PerProcessorQueue
+
+Return Value:
+
+    FALSE if there is at least one NBL in any processor's queue, else
+    TRUE if there are no NBLs in the queue
+
+--*/
+{
+    for (ULONG i = 0; i < PerProcessorQueue->NumberOfProcessors; i++)
+    {
+        if (!NdisIsNblCountedQueueEmpty(&PerProcessorQueue->Slots[i]->Queue))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+NBL_COUNTED_QUEUE *
+NdisGetCurrentProcessorNblCountedQueue(
+    _In_ NBL_PER_PROCESSOR_QUEUE const *PerProcessorQueue)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    const ULONG Index = KeGetCurrentProcessorIndex();
+    NDIS_ASSERT(Index < PerProcessorQueue->NumberOfProcessors);
+
+    return &PerProcessorQueue->Slots[Index]->Queue;
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+void
+NdisAppendNblChainToNblPerProcessorQueueFast(
+    _Inout_ NBL_PER_PROCESSOR_QUEUE *PerProcessorQueue,
+    _In_ NET_BUFFER_LIST *NblChainFirst,
+    _In_ NET_BUFFER_LIST *NblChainLast,
+    _In_ SIZE_T NumNblsToAppend)
+/*++
+
+Routine Description:
+
+    Appends an NBL chain to the current processor's queue
+
+    Executes in O(1) time, without any interlocked operation.  But you must
+    know the last NBL in the chain and the number of NBLs in the chain.
+
+Arguments:
+
+    PerProcessorQueue
+
+    NblChainFirst - First NBL in the chain
+
+    NblChainLast - Last NBL in the chain (NblChainLast->Next must be NULL)
+
+    NumNblsToAppend - The number of NBLs in [NblChainFirst, NblChainLast]
+
+--*/
+{
+    NdisAppendNblChainToNblCountedQueueFast(
+        NdisGetCurrentProcessorNblCountedQueue(PerProcessorQueue),
+        NblChainFirst,
+        NblChainLast,
+        NumNblsToAppend);
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+void
+NdisAppendNblCountedQueueToNblPerProcessorQueue(
+    _Inout_ NBL_PER_PROCESSOR_QUEUE *PerProcessorQueue,
+    _Inout_ NBL_COUNTED_QUEUE *Source)
+/*++
+
+Routine Description:
+
+    Removes all the NBLs from Source and appends them to the current
+    processor's queue
+
+Arguments:
+
+    PerProcessorQueue - Receives all the NBLs from Source
+
+    Source - Donates NBLs to PerProcessorQueue; is empty after call returns
+
+--*/
+{
+    NdisAppendNblCountedQueueToNblCountedQueueFast(
+        NdisGetCurrentProcessorNblCountedQueue(PerProcessorQueue),
+        Source);
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+void
+NdisAppendSingleNblToNblPerProcessorQueue(
+    _Inout_ NBL_PER_PROCESSOR_QUEUE *PerProcessorQueue,
+    _In_ NET_BUFFER_LIST *Nbl)
+/*++
+
+Routine Description:
+
+    Appends one NBL to the current processor's queue
+
+Arguments:
+
+    PerProcessorQueue
+
+    Nbl
+
+--*/
+{
+    NdisAppendSingleNblToNblCountedQueue(
+        NdisGetCurrentProcessorNblCountedQueue(PerProcessorQueue),
+        Nbl);
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+void
+NdisDrainCurrentProcessorNblPerProcessorQueue(
+    _Inout_ NBL_PER_PROCESSOR_QUEUE *PerProcessorQueue,
+    _Inout_ NBL_COUNTED_QUEUE *Destination)
+/*++
+
+Routine Description:
+
+    Removes all the NBLs from the current processor's queue and appends them
+    to Destination
+
+    Other processors may continue to append to their own queues while this
+    routine runs.
+
+Arguments:
+
+    PerProcessorQueue - Donates the current processor's NBLs to Destination
+
+    Destination - Receives the NBLs
+
+--*/
+{
+    NdisAppendNblCountedQueueToNblCountedQueueFast(
+        Destination,
+        NdisGetCurrentProcessorNblCountedQueue(PerProcessorQueue));
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisDrainNblPerProcessorQueue(
+    _Inout_ NBL_PER_PROCESSOR_QUEUE *PerProcessorQueue,
+    _Inout_ NBL_COUNTED_QUEUE *Destination)
+/*++
+
+Routine Description:
+
+    Removes all the NBLs from every processor's queue and appends them to
+    Destination
+
+    Each processor's queue is spliced onto Destination in O(1) time, so the
+    whole operation is O(number of processors), regardless of how many NBLs
+    are in the queues.  The NBLs from each processor remain in the order they
+    were appended, and processors are visited in order of processor index.
+
+    No processor may append to the queue while this routine runs.
+
+Arguments:
+
+    PerProcessorQueue - Donates all of its NBLs to Destination
+
+    Destination - Receives the NBLs
+
+--*/
+{
+    NBL_PER_PROCESSOR_QUEUE_SLOT *const *Slots = PerProcessorQueue->Slots;
+    const ULONG NumberOfProcessors = PerProcessorQueue->NumberOfProcessors;
+
+    for (ULONG i = 0; i < NumberOfProcessors; i++)
+    {
+        if (i + 1 < NumberOfProcessors)
+        {
+            PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Slots[i + 1]);
+        }
+
+        NdisAppendNblCountedQueueToNblCountedQueueFast(Destination, &Slots[i]->Queue);
+    }
+}
+
+#endif // WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+#pragma endregion
@@ -28,6 +28,11 @@ Abstract:
     The NBL_COUNTED_QUEUE is an NBL_QUEUE, but also adds the additional feature
     of tracking how many NBLs are in the queue.
 
+    The NBL_MPSC_QUEUE is a multi-producer, single-consumer variation of the
+    NBL_QUEUE.  Any number of processors may concurrently append NBLs to the
+    queue without holding a lock, while a single consumer removes all the NBLs
+    at once, in the order they were appended.
+
 Example usage:
 
     NET_BUFFER_LIST *NblChain1 = //  A=>B=>C=>NULL
@@ -70,6 +75,15 @@ Programming languages:
     // NblQueue is now empty
     // NblChain3 is A=>B=>C=>D=>NULL
 
+    Before the call to clear(), you could also walk the queue with a
+    range-based for loop, which prefetches each NBL's successor (see
+    ndis::nbl_chain in nblchain.h):
+
+    for (NET_BUFFER_LIST *Nbl : NblQueue)
+    {
+        // Visits A, B, C, and D
+    }
+
 Table of Contents:
 
     Routines for NBL_QUEUEs:
@@ -94,6 +108,15 @@ Table of Contents:
         NdisPopAllFromNblCountedQueue
         NdisPopFirstNblFromNblCountedQueue
 
+    Routines for NBL_MPSC_QUEUEs:
+        NdisInitializeNblMpscQueue
+        NdisIsNblMpscQueueEmpty
+        NdisAppendNblChainToNblMpscQueueFast
+        NdisAppendNblChainToNblMpscQueue
+        NdisAppendSingleNblToNblMpscQueue
+        NdisAppendNblMpscQueueToNblQueue
+        NdisPopAllFromNblMpscQueue
+
 Environment:
 
     Kernel mode
@@ -158,6 +181,40 @@ typedef struct NBL_COUNTED_QUEUE_t
 #endif // __cplusplus
 } NBL_COUNTED_QUEUE;
 
+//
+// The NBL_MPSC_QUEUE has the same layout as an NBL_QUEUE, but producers
+// update it with interlocked operations.  Producers swap Last to claim the end
+// of the queue, then link their NBLs onto the previous end.  So a producer
+// never waits for another producer, and an append is O(1) regardless of
+// contention.
+//
+// Because producers and the consumer all write to this structure, you should
+// place it in its own cache line, away from any unrelated hot data.
+//
+typedef struct NBL_MPSC_QUEUE_t
+{
+    // Pointer to first NBL in chain, or NULL if the queue is empty.
+    // Written by the first producer to append to an empty queue, and by the
+    // consumer.
+    NET_BUFFER_LIST *First;
+
+    // Pointer to last NBL in chain, or to this->First if queue is empty.
+    // Updated by producers with InterlockedExchangePointer.
+    NET_BUFFER_LIST **Last;
+
+#ifdef __cplusplus
+
+    NBL_MPSC_QUEUE_t() = default;
+    ~NBL_MPSC_QUEUE_t() = default;
+
+    // Do not copy or move this data structure; it takes internal pointers to
+    // itself, and other processors may be appending to it at any time.
+    NBL_MPSC_QUEUE_t(NBL_MPSC_QUEUE_t &) = delete;
+    NBL_MPSC_QUEUE_t &operator=(NBL_MPSC_QUEUE_t &) = delete;
+
+#endif // __cplusplus
+} NBL_MPSC_QUEUE;
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 void
@@ -804,6 +861,274 @@ Return Value:
     return Nbl;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisInitializeNblMpscQueue(
+    _Out_ NBL_MPSC_QUEUE *MpscQueue)
+/*++
+
+Routine Description:
+
+    Initializes an NBL_MPSC_QUEUE datastructure
+
+    The queue must not be visible to any producer until this routine returns.
+
+Arguments:
+
+    MpscQueue
+
+--*/
+{
+    MpscQueue->First = NULL;
+
+    { C_ASSERT(FIELD_OFFSET(NET_BUFFER_LIST, Next) == 0); }
+
+    MpscQueue->Last = &MpscQueue->First;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+NdisIsNblMpscQueueEmpty(
+    _In_ NBL_MPSC_QUEUE const *MpscQueue)
+/*++
+
+Routine Description:
+
+    Determines whether any NBLs are in the queue
+
+    Producers may append to the queue at any time, so the answer is only a
+    snapshot.  However, if the consumer sees that the queue is not empty, it
+    will remain not empty until the consumer pops from it.
+
+Arguments:
+
+    MpscQueue
+
+Return Value:
+
+    FALSE if there is at least one NBL in the queue, else
+    TRUE if there are no NBLs in the queue
+
+--*/
+{
+    return ReadPointerAcquire((PVOID const volatile *)&MpscQueue->Last) == &MpscQueue->First;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisAppendNblChainToNblMpscQueueFast(
+    _Inout_ NBL_MPSC_QUEUE *MpscQueue,
+    _In_ NET_BUFFER_LIST *NblChainFirst,
+    _In_ NET_BUFFER_LIST *NblChainLast)
+/*++
+
+Routine Description:
+
+    Appends an NBL chain to an NBL_MPSC_QUEUE
+
+    Executes in O(1) time with a single interlocked operation, so it's "Fast".
+    But you must know the last NBL in the chain.  If you don't know the last
+    NBL in the chain, use NdisAppendNblChainToNblMpscQueue instead, which is
+    O(n).
+
+    Any number of processors may call this routine concurrently on the same
+    queue, and concurrently with the consumer.
+
+Arguments:
+
+    MpscQueue
+
+    NblChainFirst - First NBL in the chain
+
+    NblChainLast - Last NBL in the chain (NblChainLast->Next must be NULL)
+
+--*/
+{
+#if DBG
+    {
+        const NET_BUFFER_LIST *Last = NdisLastNblInNblChain(NblChainFirst);
+        NDIS_ASSERT(Last == NblChainLast);
+    }
+#endif
+
+    //
+    // The consumer waits for us between the exchange and the link below, so
+    // don't let this thread get preempted in there.
+    //
+    KIRQL OldIrql;
+    KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+
+    NET_BUFFER_LIST **Previous = (NET_BUFFER_LIST **)InterlockedExchangePointer(
+        (PVOID volatile *)&MpscQueue->Last, &NblChainLast->Next);
+
+    WritePointerRelease((PVOID volatile *)Previous, NblChainFirst);
+
+    KeLowerIrql(OldIrql);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisAppendNblChainToNblMpscQueue(
+    _Inout_ NBL_MPSC_QUEUE *MpscQueue,
+    _In_ NET_BUFFER_LIST *NblChain)
+/*++
+
+Routine Description:
+
+    Appends an NBL chain to an NBL_MPSC_QUEUE
+
+    This routine has the same effect as NdisAppendNblChainToNblMpscQueueFast,
+    however it is slower.  Use this routine if you don't have handy a pointer
+    to the last NBL in the chain.
+
+Arguments:
+
+    MpscQueue
+
+    NblChain
+
+--*/
+{
+    NdisAppendNblChainToNblMpscQueueFast(MpscQueue, NblChain, NdisLastNblInNblChain(NblChain));
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisAppendSingleNblToNblMpscQueue(
+    _Inout_ NBL_MPSC_QUEUE *MpscQueue,
+    _In_ NET_BUFFER_LIST *Nbl)
+/*++
+
+Routine Description:
+
+    Appends one NBL to an NBL_MPSC_QUEUE
+
+Arguments:
+
+    MpscQueue
+
+    Nbl
+
+--*/
+{
+    Nbl->Next = NULL;
+    NdisAppendNblChainToNblMpscQueueFast(MpscQueue, Nbl, Nbl);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisAppendNblMpscQueueToNblQueue(
+    _Inout_ NBL_QUEUE *Destination,
+    _Inout_ NBL_MPSC_QUEUE *Source)
+/*++
+
+Routine Description:
+
+    Removes all the NBLs from Source and appends them to Destination, in the
+    order they were appended to Source
+
+    Only the single consumer of Source may call this routine.  Producers may
+    continue to append to Source while this routine executes; any NBLs they
+    append after the queue is detached are left in Source for next time.
+
+    This routine visits each NBL it removes, because a producer might still be
+    in the middle of linking its NBLs onto the queue.  If so, this routine
+    waits for that producer to finish, which takes only a few instructions.
+
+Arguments:
+
+    Destination - Receives all the NBLs from Source
+
+    Source - Donates NBLs to Destination
+
+--*/
+{
+    NDIS_ASSERT_VALID_NBL_QUEUE(Destination);
+
+    if (NdisIsNblMpscQueueEmpty(Source))
+    {
+        return;
+    }
+
+    //
+    // The queue is not empty, so some producer has already taken &Source->First
+    // as its link.  Wait for it to store its NBLs there.
+    //
+    NET_BUFFER_LIST *First;
+    while (NULL == (First = (NET_BUFFER_LIST *)ReadPointerAcquire((PVOID const volatile *)&Source->First)))
+    {
+        YieldProcessor();
+    }
+
+    //
+    // No producer can write Source->First again until we hand it out
+    // ourselves, with the exchange below.  From then on, new producers add to
+    // an empty queue.
+    //
+    Source->First = NULL;
+
+    NET_BUFFER_LIST **Last = (NET_BUFFER_LIST **)InterlockedExchangePointer(
+        (PVOID volatile *)&Source->Last, &Source->First);
+
+    //
+    // Every producer that swapped Source->Last before we did is linking onto
+    // an NBL in our detached chain.  Wait for each of those links to land.
+    //
+    NET_BUFFER_LIST *Nbl = First;
+    while (&Nbl->Next != Last)
+    {
+        NET_BUFFER_LIST *Next;
+        while (NULL == (Next = (NET_BUFFER_LIST *)ReadPointerAcquire((PVOID const volatile *)&Nbl->Next)))
+        {
+            YieldProcessor();
+        }
+
+        PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, ReadPointerNoFence((PVOID const volatile *)&Next->Next));
+        Nbl = Next;
+    }
+
+    NdisAppendNblChainToNblQueueFast(Destination, First, Nbl);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NET_BUFFER_LIST *
+NdisPopAllFromNblMpscQueue(
+    _Inout_ NBL_MPSC_QUEUE *MpscQueue)
+/*++
+
+Routine Description:
+
+    Removes all NBLs from the queue, and returns them in a chain
+
+    Only the single consumer of the queue may call this routine.  Refer to
+    NdisAppendNblMpscQueueToNblQueue for details.
+
+Arguments:
+
+    MpscQueue
+
+Return Value:
+
+    The previous contents of the NBL_MPSC_QUEUE, in the order they were
+    appended, or NULL if the queue was empty
+
+--*/
+{
+    NBL_QUEUE Queue;
+    NdisInitializeNblQueue(&Queue);
+
+    NdisAppendNblMpscQueueToNblQueue(&Queue, MpscQueue);
+
+    return NdisPopAllFromNblQueue(&Queue);
+}
+
 #ifdef __cplusplus
 
 inline NBL_QUEUE_t::NBL_QUEUE_t(NBL_QUEUE_t &&rhs)
@@ -998,36 +1323,53 @@ struct nbl_counted_queue : public NBL_COUNTED_QUEUE
     void ASSERT_VALID() const { NDIS_ASSERT_VALID_NBL_COUNTED_QUEUE(this); }
 };
 
-namespace details
+struct nbl_mpsc_queue : public NBL_MPSC_QUEUE
 {
+    nbl_mpsc_queue() { NdisInitializeNblMpscQueue(this); }
+    ~nbl_mpsc_queue() = default;
+
+    nbl_mpsc_queue(nbl_mpsc_queue &) = delete;
+    nbl_mpsc_queue &operator=(nbl_mpsc_queue &) = delete;
+
+    bool empty() const { return !!NdisIsNblMpscQueueEmpty(this); }
+
+    void append(_In_ NET_BUFFER_LIST *first, _In_ NET_BUFFER_LIST *last)
+    {
+        NdisAppendNblChainToNblMpscQueueFast(this, first, last);
+    }
+
+    void append_slow(_In_ NET_BUFFER_LIST *nblChain) { NdisAppendNblChainToNblMpscQueue(this, nblChain); }
+
+    void append_one_nbl(_In_ NET_BUFFER_LIST *nbl) { NdisAppendSingleNblToNblMpscQueue(this, nbl); }
+
+    // Consumer only
+    NET_BUFFER_LIST *clear() { return NdisPopAllFromNblMpscQueue(this); }
+
+    // Consumer only
+    void clear(_Inout_ NBL_QUEUE *queue) { NdisAppendNblMpscQueueToNblQueue(queue, this); }
+};
 
 //
 // These exist only to make range-based for loop work; don't use them directly.
 // Instead, you can use them indirectly like this:
 //
 //      ndis::nbl_queue queue = . . .;
-//      for (auto &&nbl : queue) {
+//      for (auto nbl : queue) {
 //          DoSomething(nbl);
 //      }
 //
-class nbl_queue_iterator
-{
-public:
-    nbl_queue_iterator() : p{nullptr} {}
-    explicit nbl_queue_iterator(ndis::nbl_queue const &q) : p{q.First} {}
-
-    NET_BUFFER_LIST *operator++() { p = p->Next; return p; }
-    NET_BUFFER_LIST *operator*() { return p; }
-    bool operator!=(nbl_queue_iterator &rhs) { return p != rhs.p; }
-
-private:
-    NET_BUFFER_LIST *p;
-};
-
-} // namespace details
-
-inline auto begin(nbl_queue const &q) { return ndis::details::nbl_queue_iterator{q}; }
-inline auto end(nbl_queue const &) { return ndis::details::nbl_queue_iterator{}; }
+// To move each NBL to another queue while you walk this one, take the chain
+// out of the queue first, and walk it with ndis::nbl_chain_safe:
+//
+//      for (auto nbl : ndis::nbl_chain_safe(queue.clear())) {
+//          nbl->Next = nullptr;
+//          (ShouldDrop(nbl) ? dropQueue : keepQueue).append_one_nbl(nbl);
+//      }
+//
+inline auto begin(nbl_queue const &q) { return ndis::nbl_chain(q.First).begin(); }
+inline auto end(nbl_queue const &q) { return ndis::nbl_chain(q.First).end(); }
+inline auto begin(nbl_counted_queue const &q) { return ndis::nbl_chain(q.Queue.First).begin(); }
+inline auto end(nbl_counted_queue const &q) { return ndis::nbl_chain(q.Queue.First).end(); }
 
 } // namespace ndis
 
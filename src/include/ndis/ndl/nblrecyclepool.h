@@ -0,0 +1,735 @@
+/*++
+
+    Copyright (c) Microsoft. All rights reserved.
+
+    This code is licensed under the MIT License.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+
+Module Name:
+
+    nblrecyclepool.h
+
+Provenance:
+
+    Version 1.2.0 from https://github.com/microsoft/ndis-driver-library
+
+Abstract:
+
+    Defines the NBL_RECYCLE_POOL and utility functions to operate on it
+
+    The NBL_RECYCLE_POOL keeps NBLs that you are done with, so you can reuse
+    them later instead of freeing them and allocating new ones.  The pool does
+    not care how the NBLs were allocated, or what NET_BUFFERs and MDLs are
+    attached to them; it simply holds onto them, linked through
+    NET_BUFFER_LIST::Next.
+
+    The pool is organized as a magazine cache:
+
+    Magazines
+        A magazine is an NBL_COUNTED_QUEUE that holds up to MagazineSize NBLs.
+        Each processor has 2 magazines of its own: a loaded magazine, which
+        NBLs are taken from and returned to, and a spare.  Most allocations
+        and returns only touch the current processor's magazines, so they need
+        no lock and no interlocked operation.
+
+    Depot
+        When both of a processor's magazines are full, it hands a full
+        magazine to the depot.  When both are empty, it takes a full magazine
+        from the depot.  So a processor that mostly frees NBLs (for example,
+        the one running send-complete) feeds the processors that mostly
+        allocate them.  The depot is protected by a spin lock, but it is only
+        visited once per MagazineSize NBLs.
+
+    If the depot is empty, the pool calls your allocate callback to get a new
+    magazine's worth of NBLs.  If the depot is full, the pool calls your free
+    callback to get rid of a magazine's worth of NBLs.
+
+    Returning NBLs is O(1), as long as you return fewer than MagazineSize NBLs
+    at a time.  That fits the send-complete path, where
+    NdisClassifyNblChain2WithCount has already separated your own NBLs into an
+    NBL_COUNTED_QUEUE.  A larger return is split into magazines of
+    MagazineSize NBLs, so no magazine ever grows past MagazineSize, and the
+    NBLs that don't fit are passed to your free callback.
+
+Example usage:
+
+    NBL_RECYCLE_POOL Pool;
+    NdisInitializeNblRecyclePool(
+        &Pool, 64, 16, MyAllocateNbls, MyFreeNbls, MyContext, MY_POOLTAG);
+
+    // On any processor, at DISPATCH_LEVEL:
+    NBL_COUNTED_QUEUE Nbls;
+    NdisInitializeNblCountedQueue(&Nbls);
+    NtStatus = NdisAllocateNblsFromRecyclePool(&Pool, 8, &Nbls);
+
+    // In send-complete, at DISPATCH_LEVEL:
+    NdisClassifyNblChain2WithCount(NblChain, IsMyNbl, Filter, &Theirs, &Mine);
+    NdisReturnNblCountedQueueToRecyclePool(&Pool, &Mine);
+
+    // When no processor is using the pool:
+    NdisUninitializeNblRecyclePool(&Pool);
+
+Synchronization:
+
+    NdisAllocateNblsFromRecyclePool, NdisAllocateSingleNblFromRecyclePool,
+    NdisReturnNblCountedQueueToRecyclePool, and
+    NdisReturnSingleNblToRecyclePool must be called at DISPATCH_LEVEL, which
+    prevents any other thread from using the current processor's magazines at
+    the same time.  They may be called concurrently on different processors.
+
+    NdisUninitializeNblRecyclePool touches every processor's magazines.  You
+    must ensure no processor is using the pool while it runs.
+
+Table of Contents:
+
+        NdisUninitializeNblRecyclePool
+        NdisInitializeNblRecyclePool
+        NdisAllocateNblsFromRecyclePool
+        NdisAllocateSingleNblFromRecyclePool
+        NdisReturnNblCountedQueueToRecyclePool
+        NdisReturnSingleNblToRecyclePool
+
+Environment:
+
+    Kernel mode
+
+    Requires ExAllocatePool3, which is available in Windows 10, version 2004
+    and later.
+
+--*/
+
+#pragma once
+
+#pragma region System Family (kernel drivers) with Desktop Family for compat
+#include <winapifamily.h>
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+
+#include <ndis/ndl/nblqueue.h>
+#include <ndis/ndl/perprocessor.h>
+
+typedef
+_IRQL_requires_(DISPATCH_LEVEL)
+_IRQL_requires_same_
+_Function_class_(NBL_RECYCLE_POOL_ALLOCATE)
+void
+NBL_RECYCLE_POOL_ALLOCATE(
+    _In_opt_ PVOID Context,
+    _In_ SIZE_T NumberOfNbls,
+    _Inout_ NBL_COUNTED_QUEUE *Destination);
+/*++
+
+Routine Description:
+
+    A callback that allocates new NBLs for an NBL_RECYCLE_POOL
+
+    For example, call NdisAllocateNetBufferAndNetBufferList in a loop.
+
+Arguments:
+
+    Context - The Context that was passed to NdisInitializeNblRecyclePool
+
+    NumberOfNbls - The number of NBLs the pool would like to have
+
+    Destination - Append up to NumberOfNbls new NBLs to this queue.  If you
+        cannot allocate any NBLs, leave the queue empty.
+
+--*/
+
+typedef
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_IRQL_requires_same_
+_Function_class_(NBL_RECYCLE_POOL_FREE)
+void
+NBL_RECYCLE_POOL_FREE(
+    _In_opt_ PVOID Context,
+    _In_ NET_BUFFER_LIST *NblChain);
+/*++
+
+Routine Description:
+
+    A callback that frees NBLs that an NBL_RECYCLE_POOL does not need
+
+    For example, call NdisFreeNetBufferList on each NBL, after freeing any
+    MDLs that you attached to it.
+
+Arguments:
+
+    Context - The Context that was passed to NdisInitializeNblRecyclePool
+
+    NblChain - The NBLs to free
+
+--*/
+
+//
+// Each processor's magazines sit in their own cache line, so that no two
+// processors ever write to the same cache line.
+//
+typedef struct DECLSPEC_CACHEALIGN NBL_RECYCLE_POOL_SLOT_t
+{
+    // NBLs are allocated from and returned to this magazine
+    NBL_COUNTED_QUEUE Loaded;
+
+    // Either completely full or completely empty
+    NBL_COUNTED_QUEUE Spare;
+} NBL_RECYCLE_POOL_SLOT;
+
+typedef struct DECLSPEC_CACHEALIGN NBL_RECYCLE_POOL_DEPOT_t
+{
+    KSPIN_LOCK Lock;
+
+    // The number of elements of Magazines that hold NBLs
+    SIZE_T NumberOfFullMagazines;
+
+    // The maximum number of magazines the depot can hold
+    SIZE_T MaximumMagazines;
+
+    // An array of MaximumMagazines magazines
+    NBL_COUNTED_QUEUE *Magazines;
+} NBL_RECYCLE_POOL_DEPOT;
+
+typedef struct NBL_RECYCLE_POOL_t
+{
+    // The number of elements in Slots; one per possible processor index
+    ULONG NumberOfProcessors;
+
+    // The pool tag used for all allocations
+    ULONG PoolTag;
+
+    // The number of NBLs in a full magazine
+    SIZE_T MagazineSize;
+
+    NBL_RECYCLE_POOL_ALLOCATE *Allocate;
+    NBL_RECYCLE_POOL_FREE *Free;
+    PVOID Context;
+
+    // An array of pointers to each processor's magazines, indexed by the
+    // processor index (see KeGetCurrentProcessorIndex)
+    NBL_RECYCLE_POOL_SLOT **Slots;
+
+    NBL_RECYCLE_POOL_DEPOT Depot;
+} NBL_RECYCLE_POOL;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisFreeNblRecyclePoolMagazine(
+    _In_ NBL_RECYCLE_POOL const *Pool,
+    _Inout_ NBL_COUNTED_QUEUE *Magazine)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    if (!NdisIsNblCountedQueueEmpty(Magazine))
+    {
+        Pool->Free(Pool->Context, NdisPopAllFromNblCountedQueue(Magazine));
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisUninitializeNblRecyclePool(
+    _Inout_ NBL_RECYCLE_POOL *Pool)
+/*++
+
+Routine Description:
+
+    Frees every NBL held by an NBL_RECYCLE_POOL, using the pool's free
+    callback, and frees the pool's resources
+
+    No processor may use the pool while this routine runs.  NBLs that are
+    currently allocated from the pool are not affected; free them yourself.
+
+Arguments:
+
+    Pool - The pool to uninitialize
+
+--*/
+{
+    if (Pool->Slots != NULL)
+    {
+        for (ULONG i = 0; i < Pool->NumberOfProcessors; i++)
+        {
+            NdisFreeNblRecyclePoolMagazine(Pool, &Pool->Slots[i]->Loaded);
+            NdisFreeNblRecyclePoolMagazine(Pool, &Pool->Slots[i]->Spare);
+        }
+
+        NdlFreePerProcessorSlots(Pool->NumberOfProcessors, (PVOID *)Pool->Slots);
+
+        Pool->Slots = NULL;
+        Pool->NumberOfProcessors = 0;
+    }
+
+    if (Pool->Depot.Magazines != NULL)
+    {
+        for (SIZE_T i = 0; i < Pool->Depot.NumberOfFullMagazines; i++)
+        {
+            NdisFreeNblRecyclePoolMagazine(Pool, &Pool->Depot.Magazines[i]);
+        }
+
+        ExFreePool(Pool->Depot.Magazines);
+
+        Pool->Depot.Magazines = NULL;
+        Pool->Depot.NumberOfFullMagazines = 0;
+    }
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NTSTATUS
+NdisInitializeNblRecyclePool(
+    _Out_ NBL_RECYCLE_POOL *Pool,
+    _In_ SIZE_T MagazineSize,
+    _In_ SIZE_T MaximumDepotMagazines,
+    _In_ NBL_RECYCLE_POOL_ALLOCATE *Allocate,
+    _In_ NBL_RECYCLE_POOL_FREE *Free,
+    _In_opt_ PVOID Context,
+    _In_ ULONG PoolTag)
+/*++
+
+Routine Description:
+
+    Allocates and initializes an NBL_RECYCLE_POOL
+
+    The pool starts out empty; NBLs are allocated by the Allocate callback as
+    they are needed.
+
+    Each processor's magazines are allocated from the processor's own NUMA
+    node, if possible.  If the node has no memory available, they are
+    allocated from any node.
+
+Arguments:
+
+    Pool - The pool to initialize
+
+    MagazineSize - The number of NBLs in a magazine.  The pool holds at most
+        about (2 * NumberOfProcessors + MaximumDepotMagazines) * MagazineSize
+        NBLs.  Must not be 0.
+
+    MaximumDepotMagazines - The maximum number of full magazines in the depot
+
+    Allocate - Called to allocate new NBLs when the pool runs out
+
+    Free - Called to free NBLs that the pool has no room for
+
+    Context - Passed to Allocate and Free
+
+    PoolTag - A pool tag to use for the pool's allocations
+
+Return Value:
+
+    STATUS_SUCCESS
+        The pool was initialized; you must later call
+        NdisUninitializeNblRecyclePool
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to allocate memory
+
+--*/
+{
+    ULONG NumberOfProcessors;
+
+    NDIS_ASSERT(MagazineSize > 0);
+
+    Pool->NumberOfProcessors = 0;
+    Pool->PoolTag = PoolTag;
+    Pool->MagazineSize = MagazineSize;
+    Pool->Allocate = Allocate;
+    Pool->Free = Free;
+    Pool->Context = Context;
+    Pool->Slots = NULL;
+
+    KeInitializeSpinLock(&Pool->Depot.Lock);
+    Pool->Depot.NumberOfFullMagazines = 0;
+    Pool->Depot.MaximumMagazines = MaximumDepotMagazines;
+    Pool->Depot.Magazines = NULL;
+
+    if (MaximumDepotMagazines > 0)
+    {
+        if (MaximumDepotMagazines > MAXSIZE_T / sizeof(Pool->Depot.Magazines[0]))
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        Pool->Depot.Magazines = (NBL_COUNTED_QUEUE *)ExAllocatePool2(
+            POOL_FLAG_NON_PAGED,
+            MaximumDepotMagazines * sizeof(Pool->Depot.Magazines[0]),
+            PoolTag);
+
+        if (Pool->Depot.Magazines == NULL)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        for (SIZE_T i = 0; i < MaximumDepotMagazines; i++)
+        {
+            NdisInitializeNblCountedQueue(&Pool->Depot.Magazines[i]);
+        }
+    }
+
+    Pool->Slots = (NBL_RECYCLE_POOL_SLOT **)NdlAllocatePerProcessorSlots(
+        sizeof(NBL_RECYCLE_POOL_SLOT), PoolTag, &NumberOfProcessors);
+
+    if (Pool->Slots == NULL)
+    {
+        NdisUninitializeNblRecyclePool(Pool);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    for (ULONG i = 0; i < NumberOfProcessors; i++)
+    {
+        NdisInitializeNblCountedQueue(&Pool->Slots[i]->Loaded);
+        NdisInitializeNblCountedQueue(&Pool->Slots[i]->Spare);
+    }
+
+    Pool->NumberOfProcessors = NumberOfProcessors;
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+NBL_RECYCLE_POOL_SLOT *
+NdisGetCurrentProcessorNblRecyclePoolSlot(
+    _In_ NBL_RECYCLE_POOL const *Pool)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    const ULONG Index = KeGetCurrentProcessorIndex();
+    NDIS_ASSERT(Index < Pool->NumberOfProcessors);
+
+    return Pool->Slots[Index];
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+NdisReloadNblRecyclePoolSlot(
+    _Inout_ NBL_RECYCLE_POOL *Pool,
+    _Inout_ NBL_RECYCLE_POOL_SLOT *Slot)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Refills the empty loaded magazine from the spare, the depot, or the
+    allocate callback, in that order of preference.
+
+Return Value:
+
+    TRUE if the loaded magazine now has at least one NBL
+
+--*/
+{
+    NDIS_ASSERT(NdisIsNblCountedQueueEmpty(&Slot->Loaded));
+
+    if (!NdisIsNblCountedQueueEmpty(&Slot->Spare))
+    {
+        NdisAppendNblCountedQueueToNblCountedQueueFast(&Slot->Loaded, &Slot->Spare);
+        return TRUE;
+    }
+
+    NBL_RECYCLE_POOL_DEPOT *Depot = &Pool->Depot;
+
+    //
+    // Peek without the lock first: when the depot is empty, skip the lock.
+    //
+    if (*(SIZE_T const volatile *)&Depot->NumberOfFullMagazines != 0)
+    {
+        KeAcquireSpinLockAtDpcLevel(&Depot->Lock);
+
+        if (Depot->NumberOfFullMagazines != 0)
+        {
+            Depot->NumberOfFullMagazines -= 1;
+            NdisAppendNblCountedQueueToNblCountedQueueFast(
+                &Slot->Loaded, &Depot->Magazines[Depot->NumberOfFullMagazines]);
+        }
+
+        KeReleaseSpinLockFromDpcLevel(&Depot->Lock);
+
+        if (!NdisIsNblCountedQueueEmpty(&Slot->Loaded))
+        {
+            return TRUE;
+        }
+    }
+
+    Pool->Allocate(Pool->Context, Pool->MagazineSize, &Slot->Loaded);
+
+    return !NdisIsNblCountedQueueEmpty(&Slot->Loaded);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisSplitNblRecyclePoolMagazine(
+    _Inout_ NBL_COUNTED_QUEUE *Source,
+    _In_ SIZE_T NumberOfNbls,
+    _Inout_ NBL_COUNTED_QUEUE *Destination)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Moves the first NumberOfNbls NBLs of Source to the empty Destination.
+    Source must have more than NumberOfNbls NBLs.
+
+--*/
+{
+    NDIS_ASSERT(NumberOfNbls > 0);
+    NDIS_ASSERT(Source->NblCount > NumberOfNbls);
+    NDIS_ASSERT(NdisIsNblCountedQueueEmpty(Destination));
+
+    NET_BUFFER_LIST *First = Source->Queue.First;
+    NET_BUFFER_LIST *Last = First;
+
+    for (SIZE_T i = 1; i < NumberOfNbls; i++)
+    {
+        Last = Last->Next;
+    }
+
+    Source->Queue.First = Last->Next;
+    Source->NblCount -= NumberOfNbls;
+    Last->Next = NULL;
+
+    NdisAppendNblChainToNblCountedQueueFast(Destination, First, Last, NumberOfNbls);
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+void
+NdisReturnNblCountedQueueToRecyclePool(
+    _Inout_ NBL_RECYCLE_POOL *Pool,
+    _Inout_ NBL_COUNTED_QUEUE *Source)
+/*++
+
+Routine Description:
+
+    Returns NBLs to the pool, so they can be allocated again
+
+    Executes in O(1) time, unless Source overfills the current processor's
+    loaded magazine.  Then up to 2 * MagazineSize NBLs are
+    visited, to split off full magazines; the pool keeps 2 magazines' worth,
+    and passes the rest to the free callback.  The pool only uses
+    NET_BUFFER_LIST::Next; restore any other state of the NBLs
+    (for example, their NET_BUFFERs' DataOffset) either before you return them
+    or after you allocate them again.
+
+Arguments:
+
+    Pool
+
+    Source - Donates NBLs to the pool; is empty after call returns
+
+--*/
+{
+    NBL_RECYCLE_POOL_SLOT *Slot = NdisGetCurrentProcessorNblRecyclePoolSlot(Pool);
+
+    NdisAppendNblCountedQueueToNblCountedQueueFast(&Slot->Loaded, Source);
+
+    if (Slot->Loaded.NblCount < Pool->MagazineSize)
+    {
+        return;
+    }
+
+    //
+    // The loaded magazine is full.  If this return overfilled it, split off
+    // exactly one magazine, keep at most one more magazine's worth loaded,
+    // and free the rest, so that the pool's size stays bounded.
+    //
+    NBL_COUNTED_QUEUE Full;
+    NdisInitializeNblCountedQueue(&Full);
+
+    if (Slot->Loaded.NblCount > Pool->MagazineSize)
+    {
+        NdisSplitNblRecyclePoolMagazine(&Slot->Loaded, Pool->MagazineSize, &Full);
+
+        if (Slot->Loaded.NblCount > Pool->MagazineSize)
+        {
+            NBL_COUNTED_QUEUE Kept;
+            NdisInitializeNblCountedQueue(&Kept);
+
+            NdisSplitNblRecyclePoolMagazine(&Slot->Loaded, Pool->MagazineSize, &Kept);
+            NdisFreeNblRecyclePoolMagazine(Pool, &Slot->Loaded);
+            NdisAppendNblCountedQueueToNblCountedQueueFast(&Slot->Loaded, &Kept);
+        }
+    }
+    else
+    {
+        NdisAppendNblCountedQueueToNblCountedQueueFast(&Full, &Slot->Loaded);
+    }
+
+    //
+    // Make the full magazine the spare, and hand the old spare (if it's full)
+    // to the depot.
+    //
+    if (!NdisIsNblCountedQueueEmpty(&Slot->Spare))
+    {
+        NBL_RECYCLE_POOL_DEPOT *Depot = &Pool->Depot;
+        BOOLEAN Deposited = FALSE;
+
+        KeAcquireSpinLockAtDpcLevel(&Depot->Lock);
+
+        if (Depot->NumberOfFullMagazines < Depot->MaximumMagazines)
+        {
+            NdisAppendNblCountedQueueToNblCountedQueueFast(
+                &Depot->Magazines[Depot->NumberOfFullMagazines], &Slot->Spare);
+            Depot->NumberOfFullMagazines += 1;
+            Deposited = TRUE;
+        }
+
+        KeReleaseSpinLockFromDpcLevel(&Depot->Lock);
+
+        if (!Deposited)
+        {
+            NdisFreeNblRecyclePoolMagazine(Pool, &Slot->Spare);
+        }
+    }
+
+    NdisAppendNblCountedQueueToNblCountedQueueFast(&Slot->Spare, &Full);
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+void
+NdisReturnSingleNblToRecyclePool(
+    _Inout_ NBL_RECYCLE_POOL *Pool,
+    _In_ NET_BUFFER_LIST *Nbl)
+/*++
+
+Routine Description:
+
+    Returns one NBL to the pool, so it can be allocated again
+
+Arguments:
+
+    Pool
+
+    Nbl
+
+--*/
+{
+    NBL_COUNTED_QUEUE Single;
+    NdisInitializeNblCountedQueue(&Single);
+    NdisAppendSingleNblToNblCountedQueue(&Single, Nbl);
+
+    NdisReturnNblCountedQueueToRecyclePool(Pool, &Single);
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+NdisAllocateNblsFromRecyclePool(
+    _Inout_ NBL_RECYCLE_POOL *Pool,
+    _In_ SIZE_T NumberOfNbls,
+    _Inout_ NBL_COUNTED_QUEUE *Destination)
+/*++
+
+Routine Description:
+
+    Takes NBLs from the pool, and appends them to Destination
+
+    Whole magazines are spliced onto Destination in O(1) time; only the NBLs
+    taken from a partially-used magazine are visited one by one.
+
+Arguments:
+
+    Pool
+
+    NumberOfNbls - The number of NBLs to take
+
+    Destination - Receives the NBLs
+
+Return Value:
+
+    STATUS_SUCCESS
+        NumberOfNbls NBLs were appended to Destination
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The pool was empty and the allocate callback did not provide enough
+        NBLs.  Destination is unchanged.
+
+--*/
+{
+    NBL_RECYCLE_POOL_SLOT *Slot = NdisGetCurrentProcessorNblRecyclePoolSlot(Pool);
+
+    NBL_COUNTED_QUEUE Taken;
+    NdisInitializeNblCountedQueue(&Taken);
+
+    while (Taken.NblCount < NumberOfNbls)
+    {
+        if (NdisIsNblCountedQueueEmpty(&Slot->Loaded) &&
+            !NdisReloadNblRecyclePoolSlot(Pool, Slot))
+        {
+            NdisReturnNblCountedQueueToRecyclePool(Pool, &Taken);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        const SIZE_T Needed = NumberOfNbls - Taken.NblCount;
+
+        if (Slot->Loaded.NblCount <= Needed)
+        {
+            NdisAppendNblCountedQueueToNblCountedQueueFast(&Taken, &Slot->Loaded);
+        }
+        else
+        {
+            for (SIZE_T i = 0; i < Needed; i++)
+            {
+                NdisAppendSingleNblToNblCountedQueue(
+                    &Taken, NdisPopFirstNblFromNblCountedQueue(&Slot->Loaded));
+            }
+        }
+    }
+
+    NdisAppendNblCountedQueueToNblCountedQueueFast(Destination, &Taken);
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_(DISPATCH_LEVEL)
+inline
+NET_BUFFER_LIST *
+NdisAllocateSingleNblFromRecyclePool(
+    _Inout_ NBL_RECYCLE_POOL *Pool)
+/*++
+
+Routine Description:
+
+    Takes one NBL from the pool
+
+Arguments:
+
+    Pool
+
+Return Value:
+
+    NULL if the pool was empty and the allocate callback did not provide any
+    NBLs, else
+    an NBL whose Next is NULL
+
+--*/
+{
+    NBL_RECYCLE_POOL_SLOT *Slot = NdisGetCurrentProcessorNblRecyclePoolSlot(Pool);
+
+    if (NdisIsNblCountedQueueEmpty(&Slot->Loaded) &&
+        !NdisReloadNblRecyclePoolSlot(Pool, Slot))
+    {
+        return NULL;
+    }
+
+    return NdisPopFirstNblFromNblCountedQueue(&Slot->Loaded);
+}
+
+#endif // WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+#pragma endregion
@@ -0,0 +1,726 @@
+/*++
+
+    Copyright (c) Microsoft. All rights reserved.
+
+    This code is licensed under the MIT License.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+
+Module Name:
+
+    nblring.h
+
+Provenance:
+
+    Version 1.2.0 from https://github.com/microsoft/ndis-driver-library
+
+Abstract:
+
+    Defines the NBL_RING and utility functions to operate on it
+
+    The NBL_RING is a first-in first-out queue of NBLs with a fixed capacity.
+    Unlike an NBL_QUEUE, it holds pointers to the NBLs in its own array, so
+    that enqueueing an NBL does not write to the NBL.  When the ring is full,
+    it drops NBLs according to its NBL_RING_DROP_POLICY, and hands the
+    dropped NBLs back to you, so you can complete them.
+
+    You can also give the ring a high and a low watermark.  When the number
+    of NBLs in the ring rises to the high watermark, the ring calls your high
+    watermark callback (for example, to pause your upper layer's sends).
+    After that, once the number of NBLs falls to the low watermark, the ring
+    calls your low watermark callback (for example, to resume sending).
+
+Example usage:
+
+    NBL_RING TxRing;
+    NdisInitializeNblRing(&TxRing, 1024, NblRingDropTail, MY_POOLTAG);
+    NdisSetNblRingWatermarks(&TxRing, 768, 256, MyPauseSends, MyResumeSends, Adapter);
+
+    // In the send path, holding your lock:
+    NBL_QUEUE Dropped;
+    NdisAppendNblChainToNblRing(&TxRing, NblChain, &Dropped);
+    . . . complete NdisPopAllFromNblQueue(&Dropped) with an error . . .;
+
+    // When the hardware has room for 32 more NBLs, holding your lock:
+    NBL_QUEUE Batch;
+    NdisInitializeNblQueue(&Batch);
+    NdisPopNblsFromNblRing(&TxRing, 32, &Batch);
+
+Synchronization:
+
+    The routines in this header do not synchronize with each other; protect
+    the ring with your own lock, just as you would an NBL_QUEUE.  The
+    watermark callbacks run synchronously inside the routine that crossed
+    the watermark, so they must not call back into the same ring.
+
+Table of Contents:
+
+        NdisUninitializeNblRing
+        NdisInitializeNblRing
+        NdisSetNblRingWatermarks
+        NdisIsNblRingEmpty
+        NdisIsNblRingFull
+        NdisGetNblRingCount
+        NdisAppendNblChainToNblRing
+        NdisAppendNblQueueToNblRing
+        NdisAppendSingleNblToNblRing
+        NdisPopFirstNblFromNblRing
+        NdisPopNblsFromNblRing
+        NdisPopAllFromNblRing
+
+Environment:
+
+    Kernel mode
+
+--*/
+
+#pragma once
+
+#pragma region System Family (kernel drivers) with Desktop Family for compat
+#include <winapifamily.h>
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+
+#include <ndis/ndl/nblqueue.h>
+
+typedef enum NBL_RING_DROP_POLICY_t
+{
+    // When the ring is full, drop the new NBLs that don't fit
+    NblRingDropTail = 0,
+
+    // When the ring is full, drop the oldest NBLs to make room for new ones
+    NblRingDropHead = 1,
+} NBL_RING_DROP_POLICY;
+
+typedef struct NBL_RING_t NBL_RING;
+
+typedef
+_IRQL_requires_max_(DISPATCH_LEVEL)
+_IRQL_requires_same_
+_Function_class_(NBL_RING_WATERMARK_CALLBACK)
+void
+NBL_RING_WATERMARK_CALLBACK(
+    _In_opt_ PVOID Context,
+    _In_ NBL_RING *Ring);
+/*++
+
+Routine Description:
+
+    A callback that is invoked when an NBL_RING crosses a watermark
+
+Arguments:
+
+    Context - The Context that was passed to NdisSetNblRingWatermarks
+
+    Ring - The ring that crossed the watermark
+
+--*/
+
+typedef struct DECLSPEC_CACHEALIGN NBL_RING_t
+{
+    // An array of Capacity pointers to NBLs
+    NET_BUFFER_LIST **Slots;
+
+    // The maximum number of NBLs in the ring
+    SIZE_T Capacity;
+
+    // The index of the oldest NBL in the ring
+    SIZE_T Head;
+
+    // The index of the slot that receives the next NBL
+    SIZE_T Tail;
+
+    // The number of NBLs in the ring
+    SIZE_T Count;
+
+    NBL_RING_DROP_POLICY DropPolicy;
+
+    // TRUE after the ring rose to HighWatermark, until it falls to
+    // LowWatermark
+    BOOLEAN AboveHighWatermark;
+
+    // 0 if watermarks are disabled
+    SIZE_T HighWatermark;
+    SIZE_T LowWatermark;
+
+    NBL_RING_WATERMARK_CALLBACK *HighWatermarkCallback;
+    NBL_RING_WATERMARK_CALLBACK *LowWatermarkCallback;
+    PVOID WatermarkContext;
+} NBL_RING;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisUninitializeNblRing(
+    _Inout_ NBL_RING *Ring)
+/*++
+
+Routine Description:
+
+    Frees the resources of an NBL_RING
+
+    The ring must be empty.  Use NdisPopAllFromNblRing to remove any
+    remaining NBLs first.
+
+Arguments:
+
+    Ring - The ring to uninitialize
+
+--*/
+{
+    NDIS_ASSERT(Ring->Count == 0);
+
+    if (Ring->Slots != NULL)
+    {
+        ExFreePool(Ring->Slots);
+        Ring->Slots = NULL;
+    }
+
+    Ring->Capacity = 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+NdisInitializeNblRing(
+    _Out_ NBL_RING *Ring,
+    _In_ SIZE_T Capacity,
+    _In_ NBL_RING_DROP_POLICY DropPolicy,
+    _In_ ULONG PoolTag)
+/*++
+
+Routine Description:
+
+    Allocates and initializes an empty NBL_RING
+
+    The ring's array of NBL pointers is cache-line aligned.  Watermarks are
+    disabled until you call NdisSetNblRingWatermarks.
+
+Arguments:
+
+    Ring - The ring to initialize
+
+    Capacity - The maximum number of NBLs the ring can hold.  Must not be 0.
+
+    DropPolicy - Which NBLs to drop when an append would exceed Capacity
+
+    PoolTag - A pool tag to use for the allocation
+
+Return Value:
+
+    STATUS_SUCCESS
+        The ring was initialized; you must later call NdisUninitializeNblRing
+
+    STATUS_INVALID_PARAMETER
+        Capacity is 0
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to allocate memory
+
+--*/
+{
+    RtlZeroMemory(Ring, sizeof(*Ring));
+    Ring->DropPolicy = DropPolicy;
+
+    if (Capacity == 0)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (Capacity > MAXSIZE_T / sizeof(Ring->Slots[0]))
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Ring->Slots = (NET_BUFFER_LIST **)ExAllocatePool2(
+        POOL_FLAG_NON_PAGED | POOL_FLAG_CACHE_ALIGNED | POOL_FLAG_UNINITIALIZED,
+        Capacity * sizeof(Ring->Slots[0]),
+        PoolTag);
+
+    if (Ring->Slots == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Ring->Capacity = Capacity;
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisSetNblRingWatermarks(
+    _Inout_ NBL_RING *Ring,
+    _In_ SIZE_T HighWatermark,
+    _In_ SIZE_T LowWatermark,
+    _In_opt_ NBL_RING_WATERMARK_CALLBACK *HighWatermarkCallback,
+    _In_opt_ NBL_RING_WATERMARK_CALLBACK *LowWatermarkCallback,
+    _In_opt_ PVOID Context)
+/*++
+
+Routine Description:
+
+    Sets the watermarks for back-pressure
+
+    HighWatermarkCallback is invoked when the number of NBLs in the ring
+    rises to HighWatermark or above.  LowWatermarkCallback is invoked when
+    the number of NBLs then falls to LowWatermark or below.  Each callback is
+    invoked once per crossing, not once per NBL.
+
+Arguments:
+
+    Ring
+
+    HighWatermark - Must not exceed the ring's capacity.  Use 0 to disable
+        the watermarks.
+
+    LowWatermark - Must be less than HighWatermark
+
+    HighWatermarkCallback - Optional callback for the high watermark
+
+    LowWatermarkCallback - Optional callback for the low watermark
+
+    Context - Passed to the callbacks
+
+--*/
+{
+    NDIS_ASSERT(HighWatermark <= Ring->Capacity);
+    NDIS_ASSERT(HighWatermark == 0 || LowWatermark < HighWatermark);
+
+    Ring->HighWatermark = HighWatermark;
+    Ring->LowWatermark = LowWatermark;
+    Ring->HighWatermarkCallback = HighWatermarkCallback;
+    Ring->LowWatermarkCallback = LowWatermarkCallback;
+    Ring->WatermarkContext = Context;
+    Ring->AboveHighWatermark = FALSE;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+NdisIsNblRingEmpty(
+    _In_ NBL_RING const *Ring)
+/*++
+
+Routine Description:
+
+    Determines whether the NBL_RING is empty
+
+Arguments:
+
+    Ring
+
+Return Value:
+
+    TRUE if the ring has no NBLs
+
+--*/
+{
+    return Ring->Count == 0;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+NdisIsNblRingFull(
+    _In_ NBL_RING const *Ring)
+/*++
+
+Routine Description:
+
+    Determines whether the NBL_RING is full
+
+Arguments:
+
+    Ring
+
+Return Value:
+
+    TRUE if appending another NBL would drop an NBL
+
+--*/
+{
+    return Ring->Count == Ring->Capacity;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+SIZE_T
+NdisGetNblRingCount(
+    _In_ NBL_RING const *Ring)
+/*++
+
+Routine Description:
+
+    Gets the number of NBLs in the NBL_RING
+
+Arguments:
+
+    Ring
+
+Return Value:
+
+    The number of NBLs in the ring
+
+--*/
+{
+    return Ring->Count;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisCheckNblRingWatermarks(
+    _Inout_ NBL_RING *Ring)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    if (Ring->HighWatermark == 0)
+    {
+        return;
+    }
+
+    if (!Ring->AboveHighWatermark)
+    {
+        if (Ring->Count >= Ring->HighWatermark)
+        {
+            Ring->AboveHighWatermark = TRUE;
+
+            if (Ring->HighWatermarkCallback != NULL)
+            {
+                Ring->HighWatermarkCallback(Ring->WatermarkContext, Ring);
+            }
+        }
+    }
+    else
+    {
+        if (Ring->Count <= Ring->LowWatermark)
+        {
+            Ring->AboveHighWatermark = FALSE;
+
+            if (Ring->LowWatermarkCallback != NULL)
+            {
+                Ring->LowWatermarkCallback(Ring->WatermarkContext, Ring);
+            }
+        }
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NET_BUFFER_LIST *
+NdisRemoveHeadFromNblRing(
+    _Inout_ NBL_RING *Ring)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Removes the oldest NBL without checking watermarks.  Does not write to the
+    NBL.
+
+--*/
+{
+    NDIS_ASSERT(Ring->Count != 0);
+
+    NET_BUFFER_LIST *Nbl = Ring->Slots[Ring->Head];
+
+    Ring->Head += 1;
+    if (Ring->Head == Ring->Capacity)
+    {
+        Ring->Head = 0;
+    }
+
+    Ring->Count -= 1;
+
+    return Nbl;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+SIZE_T
+NdisAppendNblChainToNblRing(
+    _Inout_ NBL_RING *Ring,
+    _In_opt_ NET_BUFFER_LIST *NblChain,
+    _Out_ NBL_QUEUE *Dropped)
+/*++
+
+Routine Description:
+
+    Appends an NBL chain to the NBL_RING, dropping NBLs if the ring fills up
+
+    The NBLs are not written to as they are appended; only the NBLs that are
+    dropped are relinked into Dropped.
+
+Arguments:
+
+    Ring
+
+    NblChain - The NBLs to append, in order.  May be NULL.
+
+    Dropped - Receives the NBLs that were dropped, according to the ring's
+        drop policy: the NBLs from NblChain that did not fit (NblRingDropTail),
+        or the oldest NBLs in the ring (NblRingDropHead).  You must complete
+        or free them.
+
+Return Value:
+
+    The number of NBLs from NblChain that were appended
+
+--*/
+{
+    NdisInitializeNblQueue(Dropped);
+
+    SIZE_T Appended = 0;
+    NET_BUFFER_LIST *Nbl = NblChain;
+
+    while (Nbl != NULL)
+    {
+        if (Ring->Count == Ring->Capacity)
+        {
+            if (Ring->DropPolicy == NblRingDropTail)
+            {
+                NdisAppendNblChainToNblQueue(Dropped, Nbl);
+                break;
+            }
+
+            NdisAppendSingleNblToNblQueue(Dropped, NdisRemoveHeadFromNblRing(Ring));
+        }
+
+        NET_BUFFER_LIST *Next = Nbl->Next;
+
+        Ring->Slots[Ring->Tail] = Nbl;
+
+        Ring->Tail += 1;
+        if (Ring->Tail == Ring->Capacity)
+        {
+            Ring->Tail = 0;
+        }
+
+        Ring->Count += 1;
+        Appended += 1;
+
+        Nbl = Next;
+    }
+
+    NdisCheckNblRingWatermarks(Ring);
+
+    return Appended;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+SIZE_T
+NdisAppendNblQueueToNblRing(
+    _Inout_ NBL_RING *Ring,
+    _Inout_ NBL_QUEUE *Source,
+    _Out_ NBL_QUEUE *Dropped)
+/*++
+
+Routine Description:
+
+    Moves the contents of an NBL_QUEUE to the NBL_RING, dropping NBLs if the
+    ring fills up
+
+Arguments:
+
+    Ring
+
+    Source - The NBLs to append; is empty after the call returns
+
+    Dropped - Receives the NBLs that were dropped; see
+        NdisAppendNblChainToNblRing
+
+Return Value:
+
+    The number of NBLs from Source that were appended
+
+--*/
+{
+    return NdisAppendNblChainToNblRing(Ring, NdisPopAllFromNblQueue(Source), Dropped);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NET_BUFFER_LIST *
+NdisAppendSingleNblToNblRing(
+    _Inout_ NBL_RING *Ring,
+    _In_ NET_BUFFER_LIST *Nbl)
+/*++
+
+Routine Description:
+
+    Appends one NBL to the NBL_RING, dropping an NBL if the ring is full
+
+    Nbl->Next is ignored.
+
+Arguments:
+
+    Ring
+
+    Nbl - The NBL to append
+
+Return Value:
+
+    NULL if no NBL was dropped, else
+    the dropped NBL: Nbl itself (NblRingDropTail) or the oldest NBL in the
+    ring (NblRingDropHead).  Its Next is NULL.
+
+--*/
+{
+    NET_BUFFER_LIST *DroppedNbl = NULL;
+
+    if (Ring->Count == Ring->Capacity)
+    {
+        if (Ring->DropPolicy == NblRingDropTail)
+        {
+            Nbl->Next = NULL;
+            return Nbl;
+        }
+
+        DroppedNbl = NdisRemoveHeadFromNblRing(Ring);
+        DroppedNbl->Next = NULL;
+    }
+
+    Ring->Slots[Ring->Tail] = Nbl;
+
+    Ring->Tail += 1;
+    if (Ring->Tail == Ring->Capacity)
+    {
+        Ring->Tail = 0;
+    }
+
+    Ring->Count += 1;
+
+    NdisCheckNblRingWatermarks(Ring);
+
+    return DroppedNbl;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NET_BUFFER_LIST *
+NdisPopFirstNblFromNblRing(
+    _Inout_ NBL_RING *Ring)
+/*++
+
+Routine Description:
+
+    Removes the oldest NBL from the NBL_RING
+
+Arguments:
+
+    Ring
+
+Return Value:
+
+    NULL if the ring is empty, else
+    the oldest NBL, whose Next is NULL
+
+--*/
+{
+    if (Ring->Count == 0)
+    {
+        return NULL;
+    }
+
+    NET_BUFFER_LIST *Nbl = NdisRemoveHeadFromNblRing(Ring);
+    Nbl->Next = NULL;
+
+    NdisCheckNblRingWatermarks(Ring);
+
+    return Nbl;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+SIZE_T
+NdisPopNblsFromNblRing(
+    _Inout_ NBL_RING *Ring,
+    _In_ SIZE_T MaximumNbls,
+    _Inout_ NBL_QUEUE *Destination)
+/*++
+
+Routine Description:
+
+    Removes up to MaximumNbls of the oldest NBLs from the NBL_RING, and
+    appends them in order to an NBL_QUEUE
+
+Arguments:
+
+    Ring
+
+    MaximumNbls - The maximum number of NBLs to remove
+
+    Destination - Receives the NBLs
+
+Return Value:
+
+    The number of NBLs removed
+
+--*/
+{
+    SIZE_T Count = Ring->Count < MaximumNbls ? Ring->Count : MaximumNbls;
+
+    if (Count == 0)
+    {
+        return 0;
+    }
+
+    NET_BUFFER_LIST *First = NdisRemoveHeadFromNblRing(Ring);
+    NET_BUFFER_LIST *Last = First;
+
+    for (SIZE_T i = 1; i < Count; i++)
+    {
+        NET_BUFFER_LIST *Nbl = NdisRemoveHeadFromNblRing(Ring);
+        Last->Next = Nbl;
+        Last = Nbl;
+    }
+
+    Last->Next = NULL;
+
+    NdisAppendNblChainToNblQueueFast(Destination, First, Last);
+
+    NdisCheckNblRingWatermarks(Ring);
+
+    return Count;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+SIZE_T
+NdisPopAllFromNblRing(
+    _Inout_ NBL_RING *Ring,
+    _Inout_ NBL_QUEUE *Destination)
+/*++
+
+Routine Description:
+
+    Removes every NBL from the NBL_RING, and appends them in order to an
+    NBL_QUEUE
+
+Arguments:
+
+    Ring
+
+    Destination - Receives the NBLs
+
+Return Value:
+
+    The number of NBLs removed
+
+--*/
+{
+    return NdisPopNblsFromNblRing(Ring, Ring->Count, Destination);
+}
+
+#endif // WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+#pragma endregion
@@ -91,6 +91,18 @@ Usage:
             }
         }
 
+    If you have many OID requests to issue at once (for example, in your
+    FilterRestart handler), you can issue them all back-to-back with
+    NdisFIssueOidRequestBatchAndWait, and wait only once for the whole batch,
+    rather than waiting for each OID request in turn:
+
+        NDIS_OID_REQUEST OidRequests[3] = { 0 };
+        NDIS_STATUS Statuses[3];
+        . . . fill in each OID request, as above . . .;
+
+        NDIS_STATUS status = NdisFIssueOidRequestBatchAndWait(
+            filter->ndisHandle, OidRequests, Statuses, 3);
+
 Table of Contents:
 
     NdisClearOidRequestDataLength
@@ -99,6 +111,19 @@ Table of Contents:
     NdisFDispatchOidRequestComplete
     NdisFIssueOidRequestWithCallback
     NdisFIssueOidRequestAndWait
+    NdisFIssueOidRequestBatchWithCallback
+    NdisFIssueOidRequestBatchAndWait
+    NdisUninitializeOidRequestPool
+    NdisInitializeOidRequestPool
+    NdisAllocateOidRequestFromPool
+    NdisFreeOidRequestToPool
+    NdisGetPooledOidRequestBuffer
+    NdisFIssuePooledOidRequestWithCallback
+    NdisInitializeOidQueryCoalescer
+    NdisInvalidateOidQueryCoalescerCache
+    NdisUninitializeOidQueryCoalescer
+    NdisFIssueCoalescedOidQueryAndWait
+    NdisFPassthroughOidRequestEx
 
 Environment:
 
@@ -107,6 +132,8 @@ Environment:
 --*/
 #pragma once
 
+#include <ndis/ndl/statistics.h>
+
 //
 // You may replace NDIS_REPORT_FATAL_ERROR if you need to terminate the
 // system in a different manner than a simple __fastfail instruction. Note that
@@ -127,6 +154,7 @@ typedef void NDIS_OID_REQUEST_COMPLETE_CALLBACK(
 
 typedef enum NDIS_OID_REQUEST_COMPLETION_KIND
 {
+    NdisOidRequestCompletionKindPooledPassthrough = -2,
     NdisOidRequestCompletionKindPassthrough = -1,
     NdisOidRequestCompletionKindCallback = 0,
     NdisOidRequestCompletionKindEvent = 1,
@@ -154,7 +182,8 @@ typedef struct NDIS_OID_REQUEST_SOURCE_RESERVED
 
     union NDIS_OID_REQUEST_SOURCE_RESERVED_DATA
     {
-        // NdisOidRequestCompletionKindPassthrough: original OID request
+        // NdisOidRequestCompletionKindPassthrough and
+        // NdisOidRequestCompletionKindPooledPassthrough: original OID request
         NDIS_OID_REQUEST *OriginalRequest;
 
         // NdisOidRequestCompletionKindCallback: callback function
@@ -167,6 +196,160 @@ typedef struct NDIS_OID_REQUEST_SOURCE_RESERVED
 
 C_ASSERT(sizeof(NDIS_OID_REQUEST_SOURCE_RESERVED) <= FIELD_SIZE(NDIS_OID_REQUEST, SourceReserved));
 
+typedef struct NDIS_OID_REQUEST_BATCH NDIS_OID_REQUEST_BATCH;
+
+_Function_class_(NDIS_OID_REQUEST_BATCH_COMPLETE_CALLBACK)
+typedef void NDIS_OID_REQUEST_BATCH_COMPLETE_CALLBACK(
+    _In_ void *CallbackContext,
+    _In_ NDIS_OID_REQUEST_BATCH *Batch,
+    _In_ NDIS_STATUS CompletionStatus);
+
+//
+// Tracks a set of OID requests issued by NdisFIssueOidRequestBatchWithCallback.
+// Treat the fields as opaque; the structure must remain valid until the batch
+// is complete.
+//
+typedef struct NDIS_OID_REQUEST_BATCH
+{
+    // The OID requests in the batch, in a contiguous array
+    NDIS_OID_REQUEST *OidRequests;
+
+    // Receives the completion status of each OID request
+    NDIS_STATUS *Statuses;
+
+    ULONG NumberOfRequests;
+
+    // The number of OID requests that are not yet complete, plus 1 while the
+    // batch is still being issued
+    LONG OutstandingRequests;
+
+    NDIS_OID_REQUEST_BATCH_COMPLETE_CALLBACK *CallbackRoutine;
+
+    void *CallbackContext;
+} NDIS_OID_REQUEST_BATCH;
+
+typedef struct NDIS_OID_REQUEST_POOL NDIS_OID_REQUEST_POOL;
+
+//
+// Each preallocated OID request in an NDIS_OID_REQUEST_POOL starts on its own
+// cache line, and is immediately followed by its information buffer.
+//
+typedef struct DECLSPEC_CACHEALIGN NDIS_OID_REQUEST_POOL_ENTRY
+{
+    // Links the entry into NDIS_OID_REQUEST_POOL::FreeList
+    SLIST_ENTRY Link;
+
+    NDIS_OID_REQUEST_POOL *Pool;
+
+    // The caller's completion callback, for NdisFIssuePooledOidRequestWithCallback
+    NDIS_OID_REQUEST_COMPLETE_CALLBACK *CallbackRoutine;
+
+    void *CallbackContext;
+
+    // The KeQueryInterruptTime when the OID request was passed down; only
+    // used by the counters in ndis/ndl/statistics.h
+    ULONG64 IssueTime;
+
+    NDIS_OID_REQUEST OidRequest;
+} NDIS_OID_REQUEST_POOL_ENTRY;
+
+//
+// A fixed set of preallocated OID requests and information buffers.
+// Treat the fields as opaque.
+//
+typedef struct NDIS_OID_REQUEST_POOL
+{
+    SLIST_HEADER FreeList;
+
+    // A single allocation holding NumberOfRequests entries, Stride bytes apart
+    UCHAR *Entries;
+
+    SIZE_T Stride;
+
+    // The size of each entry's information buffer, in bytes
+    ULONG BufferSize;
+
+    USHORT NumberOfRequests;
+} NDIS_OID_REQUEST_POOL;
+
+//
+// Counts how NdisFPassthroughOidRequestEx forwards OID requests.
+// Zero-initialize it before first use.
+//
+typedef struct NDIS_OID_PASSTHROUGH_COUNTERS
+{
+    // Forwarded with a copy in a preallocated NDIS_OID_REQUEST_POOL entry
+    LONG64 PooledRequests;
+
+    // Forwarded with a copy from NdisAllocateCloneOidRequest
+    LONG64 ClonedRequests;
+
+    // Eligible for the pool, but every pool entry was in use
+    LONG64 PoolExhausted;
+} NDIS_OID_PASSTHROUGH_COUNTERS;
+
+typedef struct NDIS_OID_QUERY_COALESCER NDIS_OID_QUERY_COALESCER;
+
+//
+// One lower-level OID query, shared by every caller that asked the same
+// question while it was in flight. Its information buffer immediately follows
+// the structure.
+//
+typedef struct NDIS_OID_COALESCED_QUERY
+{
+    // Links the query into NDIS_OID_QUERY_COALESCER::Queries
+    LIST_ENTRY Link;
+
+    NDIS_OID_QUERY_COALESCER *Coalescer;
+
+    // NDIS_OID_COALESCED_QUERY_WAITERs to wake when the query completes
+    LIST_ENTRY Waiters;
+
+    // One reference for being in NDIS_OID_QUERY_COALESCER::Queries, plus one
+    // for each caller that has yet to copy out the result
+    LONG ReferenceCount;
+
+    BOOLEAN Complete;
+
+    // Valid once Complete is TRUE
+    NDIS_STATUS Status;
+
+    // The interrupt time when the query completed
+    ULONG64 CompletionTime;
+
+    // The query that is issued to the lower level
+    NDIS_OID_REQUEST OidRequest;
+} NDIS_OID_COALESCED_QUERY;
+
+typedef struct NDIS_OID_COALESCED_QUERY_WAITER
+{
+    // Links the waiter into NDIS_OID_COALESCED_QUERY::Waiters
+    LIST_ENTRY Link;
+
+    KEVENT WaitEvent;
+} NDIS_OID_COALESCED_QUERY_WAITER;
+
+//
+// Merges identical OID queries that are in flight at the same time, and
+// optionally caches their results for a short time. Treat the fields as
+// opaque.
+//
+typedef struct NDIS_OID_QUERY_COALESCER
+{
+    KSPIN_LOCK Lock;
+
+    // In-flight and cached NDIS_OID_COALESCED_QUERYs
+    LIST_ENTRY Queries;
+
+    NDIS_HANDLE NdisFilterHandle;
+
+    // How long a successful result may be reused, in 100ns units; 0 disables
+    // the cache
+    ULONG64 CacheLifetime;
+
+    ULONG PoolTag;
+} NDIS_OID_QUERY_COALESCER;
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 inline
 void
@@ -318,9 +501,13 @@ Return Value:
     Context->Completion.CompletionKind = NdisOidRequestCompletionKindPassthrough;
     Context->Data.OriginalRequest = OidRequest;
 
+    NDL_STATISTICS_RECORD(NdlStatisticsStartOidTimer(Clone));
+
     NdisStatus = NdisFOidRequest(NdisFilterHandle, Clone);
     if (NDIS_STATUS_PENDING != NdisStatus)
     {
+        NDL_STATISTICS_RECORD(NdlStatisticsStopOidTimer(NdisOidRequestCompletionKindPassthrough, Clone));
+
         NdisCopyOidRequestDataLength(OidRequest, Clone);
         NdisFreeCloneOidRequest(NdisFilterHandle, Clone);
     }
@@ -354,8 +541,9 @@ Routine Description:
         }
 
     This completion handler may only be used with OIDs that were driven from
-    NdisFPassthroughOidRequest, NdisFIssueOidRequestWithCallback, or
-    NdisFIssueOidRequestAndWait. If your LWF issues OIDs in other ways, you
+    NdisFPassthroughOidRequest, NdisFPassthroughOidRequestEx,
+    NdisFIssueOidRequestWithCallback, or NdisFIssueOidRequestAndWait (or the
+    routines built on them). If your LWF issues OIDs in other ways, you
     must ensure these OIDs are not passed to NdisFDispatchOidRequestComplete.
 
 Arguments:
@@ -381,6 +569,9 @@ Return Value:
     NdisOidRequestCompletionKindPassthrough - the OID request was issued by
          NdisFPassthroughOidRequest
 
+    NdisOidRequestCompletionKindPooledPassthrough - the OID request was issued
+         by NdisFPassthroughOidRequestEx, using an NDIS_OID_REQUEST_POOL
+
 --*/
 {
     NDIS_OID_REQUEST_SOURCE_RESERVED *Context =
@@ -393,6 +584,8 @@ Return Value:
     {
     case NdisOidRequestCompletionKindCallback:
         {
+            NDL_STATISTICS_RECORD(NdlStatisticsStopOidTimer(CompletionKind, OidRequest));
+
             Context->Data.CallbackRoutine(
                 Context->Completion.CallbackContext,
                 OidRequest,
@@ -413,16 +606,33 @@ Return Value:
     case NdisOidRequestCompletionKindPassthrough:
         {
             NDIS_OID_REQUEST *OriginalRequest = Context->Data.OriginalRequest;
+            NDL_STATISTICS_RECORD(NdlStatisticsStopOidTimer(CompletionKind, OidRequest));
             NdisCopyOidRequestDataLength(OriginalRequest, OidRequest);
             NdisFreeCloneOidRequest(NdisFilterHandle, OidRequest);
             NdisFOidRequestComplete(NdisFilterHandle, OriginalRequest, CompletionStatus);
         }
         break;
 
+    case NdisOidRequestCompletionKindPooledPassthrough:
+        {
+            NDIS_OID_REQUEST *OriginalRequest = Context->Data.OriginalRequest;
+            NdisCopyOidRequestDataLength(OriginalRequest, OidRequest);
+
+            NDIS_OID_REQUEST_POOL_ENTRY *Entry =
+                CONTAINING_RECORD(OidRequest, NDIS_OID_REQUEST_POOL_ENTRY, OidRequest);
+            NDL_STATISTICS_RECORD(NdlStatisticsRecordOidLatency(CompletionKind, Entry->IssueTime));
+            InterlockedPushEntrySList(&Entry->Pool->FreeList, &Entry->Link);
+
+            NdisFOidRequestComplete(NdisFilterHandle, OriginalRequest, CompletionStatus);
+        }
+        break;
+
     default:
         NDIS_REPORT_FATAL_ERROR();
     }
 
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordOidPendedCompletion(CompletionKind));
+
     return CompletionKind;
 }
 
@@ -475,7 +685,15 @@ Return Value:
     Context->Data.CallbackRoutine = CallbackRoutine;
     Context->Completion.CompletionKind = NdisOidRequestCompletionKindCallback;
 
-    return NdisFOidRequest(NdisFilterHandle, OidRequest);
+    NDL_STATISTICS_RECORD(NdlStatisticsStartOidTimer(OidRequest));
+
+    NDIS_STATUS NdisStatus = NdisFOidRequest(NdisFilterHandle, OidRequest);
+    if (NDIS_STATUS_PENDING != NdisStatus)
+    {
+        NDL_STATISTICS_RECORD(NdlStatisticsStopOidTimer(NdisOidRequestCompletionKindCallback, OidRequest));
+    }
+
+    return NdisStatus;
 }
 
 _IRQL_requires_(PASSIVE_LEVEL)
@@ -523,6 +741,10 @@ Return Value:
     KeInitializeEvent(&WaitEvent, NotificationEvent, FALSE);
     Context->Data.WaitEvent = &WaitEvent;
 
+#if NDL_ENABLE_STATISTICS
+    ULONG64 const IssueTime = KeQueryInterruptTime();
+#endif
+
     NDIS_STATUS NdisStatus = NdisFOidRequest(NdisFilterHandle, OidRequest);
     if (NDIS_STATUS_PENDING == NdisStatus)
     {
@@ -536,6 +758,1206 @@ Return Value:
         NdisStatus = ReadAcquire(&Context->Completion.StatusAsLong);
     }
 
+    NDL_STATISTICS_RECORD(NdlStatisticsRecordOidLatency(NdisOidRequestCompletionKindEvent, IssueTime));
+
     return NdisStatus;
 }
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NDIS_STATUS
+NdisGetOidRequestBatchStatus(
+    _In_ NDIS_OID_REQUEST_BATCH const *Batch)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Summarizes the completion status of every OID request in a complete batch.
+
+Return Value:
+
+    NDIS_STATUS_SUCCESS if every OID request succeeded, else
+    the status of the first OID request (in array order) that failed
+
+--*/
+{
+    for (ULONG i = 0; i < Batch->NumberOfRequests; i++)
+    {
+        if (NDIS_STATUS_SUCCESS != Batch->Statuses[i])
+        {
+            return Batch->Statuses[i];
+        }
+    }
+
+    return NDIS_STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+NdisCompleteOidRequestBatchEntry(
+    _Inout_ NDIS_OID_REQUEST_BATCH *Batch)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Drops one reference on the batch.
+
+Return Value:
+
+    TRUE if the batch is now complete
+
+--*/
+{
+    LONG Outstanding = InterlockedDecrement(&Batch->OutstandingRequests);
+    if (Outstanding < 0)
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    return 0 == Outstanding;
+}
+
+_Function_class_(NDIS_OID_REQUEST_COMPLETE_CALLBACK)
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisOidRequestBatchEntryComplete(
+    _In_ void *CallbackContext,
+    _In_ NDIS_OID_REQUEST const *OidRequest,
+    _In_ NDIS_STATUS CompletionStatus)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Handles the asynchronous completion of one OID request in a batch.
+
+--*/
+{
+    NDIS_OID_REQUEST_BATCH *Batch = (NDIS_OID_REQUEST_BATCH*)CallbackContext;
+
+    if (OidRequest < Batch->OidRequests ||
+        OidRequest >= Batch->OidRequests + Batch->NumberOfRequests)
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    Batch->Statuses[OidRequest - Batch->OidRequests] = CompletionStatus;
+
+    if (NdisCompleteOidRequestBatchEntry(Batch))
+    {
+        Batch->CallbackRoutine(
+            Batch->CallbackContext,
+            Batch,
+            NdisGetOidRequestBatchStatus(Batch));
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NDIS_STATUS
+NdisFIssueOidRequestBatchWithCallback(
+    _In_ NDIS_HANDLE NdisFilterHandle,
+    _Out_ NDIS_OID_REQUEST_BATCH *Batch,
+    _Inout_updates_(NumberOfRequests) NDIS_OID_REQUEST *OidRequests,
+    _Out_writes_(NumberOfRequests) NDIS_STATUS *Statuses,
+    _In_ ULONG NumberOfRequests,
+    _In_ NDIS_OID_REQUEST_BATCH_COMPLETE_CALLBACK *CallbackRoutine,
+    _In_opt_ void *CallbackContext)
+/*++
+
+Routine Description:
+
+    Issues several new OID requests back-to-back, without waiting for any of
+    them to complete, and invokes a callback once all of them are complete
+
+    NDIS may still deliver the OID requests to the miniport one at a time,
+    but the caller pays for at most one wait for the whole batch, instead of
+    one wait per OID request.
+
+    Your LWF's FilterOidRequestComplete handler must use
+    NdisFDispatchOidRequestComplete to handle completion of OID requests.
+
+Arguments:
+
+    NdisFilterHandle - The NDIS handle of your filter module
+
+    Batch - Storage to track the batch; must remain valid until the batch is
+        complete
+
+    OidRequests - An array of OID requests to issue to the lower level
+
+    Statuses - An array that receives the completion status of each OID
+        request; must remain valid until the batch is complete
+
+    NumberOfRequests - The number of elements in OidRequests and Statuses
+
+    CallbackRoutine - A callback function to call when every OID request in
+        the batch is complete. It is not called if this routine does not
+        return NDIS_STATUS_PENDING.
+
+    CallbackContext - An arbitrary context to pass to the callback
+
+Return Value:
+
+    NDIS_STATUS_PENDING if the batch will complete asynchronously, else
+    NDIS_STATUS_SUCCESS if every OID request succeeded synchronously, else
+    the status of the first OID request (in array order) that failed
+
+    In every case, Statuses holds each OID request's status once the batch is
+    complete.
+
+--*/
+{
+    Batch->OidRequests = OidRequests;
+    Batch->Statuses = Statuses;
+    Batch->NumberOfRequests = NumberOfRequests;
+    Batch->CallbackRoutine = CallbackRoutine;
+    Batch->CallbackContext = CallbackContext;
+
+    // Hold a reference while issuing, so the batch can't complete under us
+    Batch->OutstandingRequests = (LONG)NumberOfRequests + 1;
+    if (Batch->OutstandingRequests <= 0)
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    for (ULONG i = 0; i < NumberOfRequests; i++)
+    {
+        Statuses[i] = NDIS_STATUS_PENDING;
+
+        NDIS_STATUS NdisStatus = NdisFIssueOidRequestWithCallback(
+            NdisFilterHandle,
+            &OidRequests[i],
+            NdisOidRequestBatchEntryComplete,
+            Batch);
+        if (NDIS_STATUS_PENDING != NdisStatus)
+        {
+            Statuses[i] = NdisStatus;
+            (void)NdisCompleteOidRequestBatchEntry(Batch);
+        }
+    }
+
+    if (!NdisCompleteOidRequestBatchEntry(Batch))
+    {
+        return NDIS_STATUS_PENDING;
+    }
+
+    return NdisGetOidRequestBatchStatus(Batch);
+}
+
+_Function_class_(NDIS_OID_REQUEST_BATCH_COMPLETE_CALLBACK)
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisOidRequestBatchSignalEvent(
+    _In_ void *CallbackContext,
+    _In_ NDIS_OID_REQUEST_BATCH *Batch,
+    _In_ NDIS_STATUS CompletionStatus)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    UNREFERENCED_PARAMETER(Batch);
+    UNREFERENCED_PARAMETER(CompletionStatus);
+
+    KeSetEvent((KEVENT*)CallbackContext, IO_NO_INCREMENT, FALSE);
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NDIS_STATUS
+NdisFIssueOidRequestBatchAndWait(
+    _In_ NDIS_HANDLE NdisFilterHandle,
+    _Inout_updates_(NumberOfRequests) NDIS_OID_REQUEST *OidRequests,
+    _Out_writes_(NumberOfRequests) NDIS_STATUS *Statuses,
+    _In_ ULONG NumberOfRequests)
+/*++
+
+Routine Description:
+
+    Issues several new OID requests back-to-back, and waits once for all of
+    them to complete
+
+    Your LWF's FilterOidRequestComplete handler must use
+    NdisFDispatchOidRequestComplete to handle completion of OID requests.
+
+Arguments:
+
+    NdisFilterHandle - The NDIS handle of your filter module
+
+    OidRequests - An array of OID requests to issue to the lower level
+
+    Statuses - An array that receives the completion status of each OID
+        request
+
+    NumberOfRequests - The number of elements in OidRequests and Statuses
+
+Return Value:
+
+    NDIS_STATUS_SUCCESS if every OID request succeeded, else
+    the status of the first OID request (in array order) that failed
+
+    This routine never returns NDIS_STATUS_PENDING. (If you want asynchronous
+    processing, use NdisFIssueOidRequestBatchWithCallback instead.)
+
+--*/
+{
+    if (APC_LEVEL < KeGetCurrentIrql())
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    KEVENT WaitEvent;
+    KeInitializeEvent(&WaitEvent, NotificationEvent, FALSE);
+
+    NDIS_OID_REQUEST_BATCH Batch;
+    NDIS_STATUS NdisStatus = NdisFIssueOidRequestBatchWithCallback(
+        NdisFilterHandle,
+        &Batch,
+        OidRequests,
+        Statuses,
+        NumberOfRequests,
+        NdisOidRequestBatchSignalEvent,
+        &WaitEvent);
+    if (NDIS_STATUS_PENDING == NdisStatus)
+    {
+        NTSTATUS NtStatus = KeWaitForSingleObject(
+            &WaitEvent, Executive, KernelMode, FALSE, NULL);
+        if (STATUS_WAIT_0 != NtStatus)
+        {
+            NDIS_REPORT_FATAL_ERROR();
+        }
+
+        NdisStatus = NdisGetOidRequestBatchStatus(&Batch);
+    }
+
+    return NdisStatus;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+void
+NdisUninitializeOidRequestPool(
+    _Inout_ NDIS_OID_REQUEST_POOL *Pool)
+/*++
+
+Routine Description:
+
+    Frees the resources of an NDIS_OID_REQUEST_POOL
+
+    Every OID request must have been returned to the pool.
+
+Arguments:
+
+    Pool - The pool to uninitialize
+
+--*/
+{
+    if (NULL == Pool->Entries)
+    {
+        return;
+    }
+
+    if (QueryDepthSList(&Pool->FreeList) != Pool->NumberOfRequests)
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    ExFreePool(Pool->Entries);
+    Pool->Entries = NULL;
+    Pool->NumberOfRequests = 0;
+    InitializeSListHead(&Pool->FreeList);
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NTSTATUS
+NdisInitializeOidRequestPool(
+    _Out_ NDIS_OID_REQUEST_POOL *Pool,
+    _In_ USHORT NumberOfRequests,
+    _In_ ULONG BufferSize,
+    _In_ ULONG PoolTag)
+/*++
+
+Routine Description:
+
+    Preallocates a set of OID requests, each with its own information buffer
+
+    Allocating from and returning to the pool needs no memory allocation, so
+    you can issue OID requests on a hot path at DISPATCH_LEVEL without
+    touching the system pool.
+
+    Example usage:
+
+        NdisInitializeOidRequestPool(
+            &filter->RssOidPool, 4, sizeof(MY_RSS_PARAMETERS), MY_TAG);
+
+        . . .
+
+        NDIS_OID_REQUEST *OidRequest = NdisAllocateOidRequestFromPool(
+            &filter->RssOidPool);
+        if (NULL == OidRequest)
+        {
+            . . . all requests are in use; try again later . . .;
+        }
+
+        ULONG BufferSize;
+        MY_RSS_PARAMETERS *Parameters = (MY_RSS_PARAMETERS*)
+            NdisGetPooledOidRequestBuffer(OidRequest, &BufferSize);
+        . . . fill in Parameters . . .;
+
+        OidRequest->RequestHandle = filter->ndisHandle;
+        OidRequest->RequestType = NdisRequestSetInformation;
+        OidRequest->DATA.SET_INFORMATION.Oid = OID_GEN_RECEIVE_SCALE_PARAMETERS;
+        OidRequest->DATA.SET_INFORMATION.InformationBuffer = Parameters;
+        OidRequest->DATA.SET_INFORMATION.InformationBufferLength = BufferSize;
+
+        NDIS_STATUS status = NdisFIssuePooledOidRequestWithCallback(
+            filter->ndisHandle, OidRequest, MyRssSetComplete, filter);
+        if (NDIS_STATUS_PENDING != status)
+        {
+            . . . inspect status . . .;
+            NdisFreeOidRequestToPool(OidRequest);
+        }
+
+Arguments:
+
+    Pool - The pool to initialize
+
+    NumberOfRequests - The number of OID requests to preallocate. Must not be
+        0.
+
+    BufferSize - The size of each OID request's information buffer, in bytes.
+        May be 0.
+
+    PoolTag - A pool tag to use for the allocation
+
+Return Value:
+
+    STATUS_SUCCESS
+        The pool was initialized; you must later call
+        NdisUninitializeOidRequestPool
+
+    STATUS_INVALID_PARAMETER
+        NumberOfRequests is 0
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to allocate memory
+
+--*/
+{
+    InitializeSListHead(&Pool->FreeList);
+    Pool->Entries = NULL;
+    Pool->BufferSize = BufferSize;
+    Pool->NumberOfRequests = 0;
+    Pool->Stride = sizeof(NDIS_OID_REQUEST_POOL_ENTRY) +
+        ALIGN_UP_BY((SIZE_T)BufferSize, SYSTEM_CACHE_ALIGNMENT_SIZE);
+
+    if (0 == NumberOfRequests)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (Pool->Stride > MAXSIZE_T / NumberOfRequests)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Pool->Entries = (UCHAR*)ExAllocatePool2(
+        POOL_FLAG_NON_PAGED | POOL_FLAG_CACHE_ALIGNED,
+        Pool->Stride * NumberOfRequests,
+        PoolTag);
+    if (NULL == Pool->Entries)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Pool->NumberOfRequests = NumberOfRequests;
+
+    for (USHORT i = 0; i < NumberOfRequests; i++)
+    {
+        NDIS_OID_REQUEST_POOL_ENTRY *Entry =
+            (NDIS_OID_REQUEST_POOL_ENTRY*)(Pool->Entries + i * Pool->Stride);
+
+        Entry->Pool = Pool;
+        InterlockedPushEntrySList(&Pool->FreeList, &Entry->Link);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NDIS_OID_REQUEST *
+NdisAllocateOidRequestFromPool(
+    _Inout_ NDIS_OID_REQUEST_POOL *Pool)
+/*++
+
+Routine Description:
+
+    Takes an OID request from the pool
+
+    The OID request is zeroed, and its Header is initialized. You must fill in
+    the remaining fields, including the InformationBuffer (for example, with
+    NdisGetPooledOidRequestBuffer). The information buffer is not zeroed; it
+    holds whatever the previous user left in it.
+
+Arguments:
+
+    Pool
+
+Return Value:
+
+    NULL if every OID request in the pool is in use, else
+    an OID request, which you must give back with NdisFreeOidRequestToPool or
+    NdisFIssuePooledOidRequestWithCallback
+
+--*/
+{
+    SLIST_ENTRY *Link = InterlockedPopEntrySList(&Pool->FreeList);
+    if (NULL == Link)
+    {
+        return NULL;
+    }
+
+    NDIS_OID_REQUEST_POOL_ENTRY *Entry =
+        CONTAINING_RECORD(Link, NDIS_OID_REQUEST_POOL_ENTRY, Link);
+
+    RtlZeroMemory(&Entry->OidRequest, sizeof(Entry->OidRequest));
+    Entry->OidRequest.Header.Type = NDIS_OBJECT_TYPE_OID_REQUEST;
+    Entry->OidRequest.Header.Revision = NDIS_OID_REQUEST_REVISION_1;
+    Entry->OidRequest.Header.Size = NDIS_SIZEOF_OID_REQUEST_REVISION_1;
+
+    return &Entry->OidRequest;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisFreeOidRequestToPool(
+    _In_ NDIS_OID_REQUEST *OidRequest)
+/*++
+
+Routine Description:
+
+    Returns an OID request to the pool it was allocated from
+
+    Do not call this routine for an OID request that was issued with
+    NdisFIssuePooledOidRequestWithCallback and returned NDIS_STATUS_PENDING;
+    that OID request is returned to the pool automatically.
+
+Arguments:
+
+    OidRequest - An OID request from NdisAllocateOidRequestFromPool
+
+--*/
+{
+    NDIS_OID_REQUEST_POOL_ENTRY *Entry =
+        CONTAINING_RECORD(OidRequest, NDIS_OID_REQUEST_POOL_ENTRY, OidRequest);
+
+    InterlockedPushEntrySList(&Entry->Pool->FreeList, &Entry->Link);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void *
+NdisGetPooledOidRequestBuffer(
+    _In_ NDIS_OID_REQUEST *OidRequest,
+    _Out_ ULONG *BufferSize)
+/*++
+
+Routine Description:
+
+    Gets the preallocated information buffer of a pooled OID request
+
+    The buffer is aligned to SYSTEM_CACHE_ALIGNMENT_SIZE.
+
+Arguments:
+
+    OidRequest - An OID request from NdisAllocateOidRequestFromPool
+
+    BufferSize - Receives the size of the buffer, in bytes
+
+Return Value:
+
+    The information buffer
+
+--*/
+{
+    NDIS_OID_REQUEST_POOL_ENTRY *Entry =
+        CONTAINING_RECORD(OidRequest, NDIS_OID_REQUEST_POOL_ENTRY, OidRequest);
+
+    *BufferSize = Entry->Pool->BufferSize;
+    return Entry + 1;
+}
+
+_Function_class_(NDIS_OID_REQUEST_COMPLETE_CALLBACK)
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisPooledOidRequestComplete(
+    _In_ void *CallbackContext,
+    _In_ NDIS_OID_REQUEST const *OidRequest,
+    _In_ NDIS_STATUS CompletionStatus)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Invokes the caller's callback, then returns the OID request to its pool.
+
+--*/
+{
+    NDIS_OID_REQUEST_POOL_ENTRY *Entry = (NDIS_OID_REQUEST_POOL_ENTRY*)CallbackContext;
+
+    if (OidRequest != &Entry->OidRequest)
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    Entry->CallbackRoutine(Entry->CallbackContext, OidRequest, CompletionStatus);
+
+    NdisFreeOidRequestToPool(&Entry->OidRequest);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NDIS_STATUS
+NdisFIssuePooledOidRequestWithCallback(
+    _In_ NDIS_HANDLE NdisFilterHandle,
+    _In_ NDIS_OID_REQUEST *OidRequest,
+    _In_ NDIS_OID_REQUEST_COMPLETE_CALLBACK *CallbackRoutine,
+    _In_opt_ void *CallbackContext)
+/*++
+
+Routine Description:
+
+    Issues a pooled OID request, invokes a callback when the OID request is
+    complete, and then returns the OID request to its pool
+
+    Your LWF's FilterOidRequestComplete handler must use
+    NdisFDispatchOidRequestComplete to handle completion of OID requests.
+
+Arguments:
+
+    NdisFilterHandle - The NDIS handle of your filter module
+
+    OidRequest - An OID request from NdisAllocateOidRequestFromPool
+
+    CallbackRoutine - A callback function to call when the OID request is
+        complete. The OID request and its information buffer are valid until
+        the callback returns.
+
+    CallbackContext - An arbitrary context to pass to the callback
+
+Return Value:
+
+    NDIS_STATUS_PENDING if the OID request will complete asynchronously; it
+    will be returned to the pool after the callback, or
+
+    any other NDIS_STATUS code for synchronous completion; the callback is not
+    invoked, and you must return the OID request to the pool yourself with
+    NdisFreeOidRequestToPool
+
+--*/
+{
+    NDIS_OID_REQUEST_POOL_ENTRY *Entry =
+        CONTAINING_RECORD(OidRequest, NDIS_OID_REQUEST_POOL_ENTRY, OidRequest);
+
+    Entry->CallbackRoutine = CallbackRoutine;
+    Entry->CallbackContext = CallbackContext;
+
+    return NdisFIssueOidRequestWithCallback(
+        NdisFilterHandle,
+        OidRequest,
+        NdisPooledOidRequestComplete,
+        Entry);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisInitializeOidQueryCoalescer(
+    _Out_ NDIS_OID_QUERY_COALESCER *Coalescer,
+    _In_ NDIS_HANDLE NdisFilterHandle,
+    _In_ ULONG64 CacheLifetime,
+    _In_ ULONG PoolTag)
+/*++
+
+Routine Description:
+
+    Initializes an NDIS_OID_QUERY_COALESCER
+
+    The coalescer is opt-in: only OID queries that you issue through
+    NdisFIssueCoalescedOidQueryAndWait are merged. If several callers issue
+    the same OID query (the same RequestType, Oid, PortNumber, and
+    InformationBufferLength) while an identical query is already in flight,
+    only one query is sent to the lower level, and every caller receives a
+    copy of its result.
+
+Arguments:
+
+    Coalescer - The coalescer to initialize
+
+    NdisFilterHandle - The NDIS handle of your filter module
+
+    CacheLifetime - How long, in 100ns units, a successful result may be
+        returned to later callers without issuing a new query. Use 0 to only
+        merge queries that are in flight at the same time.
+
+    PoolTag - A pool tag to use for the coalescer's allocations
+
+--*/
+{
+    KeInitializeSpinLock(&Coalescer->Lock);
+    InitializeListHead(&Coalescer->Queries);
+    Coalescer->NdisFilterHandle = NdisFilterHandle;
+    Coalescer->CacheLifetime = CacheLifetime;
+    Coalescer->PoolTag = PoolTag;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisDereferenceOidCoalescedQuery(
+    _In_ NDIS_OID_COALESCED_QUERY *Query)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    LONG ReferenceCount = InterlockedDecrement(&Query->ReferenceCount);
+    if (ReferenceCount < 0)
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    if (0 == ReferenceCount)
+    {
+        ExFreePool(Query);
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisInvalidateOidQueryCoalescerCache(
+    _Inout_ NDIS_OID_QUERY_COALESCER *Coalescer)
+/*++
+
+Routine Description:
+
+    Discards every cached OID query result
+
+    Call this after you change the miniport's configuration, if later queries
+    must not see results from before the change. Queries that are still in
+    flight are not affected.
+
+Arguments:
+
+    Coalescer
+
+--*/
+{
+    LIST_ENTRY Stale;
+    InitializeListHead(&Stale);
+
+    KIRQL OldIrql;
+    KeAcquireSpinLock(&Coalescer->Lock, &OldIrql);
+
+    LIST_ENTRY *Link = Coalescer->Queries.Flink;
+    while (Link != &Coalescer->Queries)
+    {
+        NDIS_OID_COALESCED_QUERY *Query =
+            CONTAINING_RECORD(Link, NDIS_OID_COALESCED_QUERY, Link);
+        Link = Link->Flink;
+
+        if (Query->Complete)
+        {
+            RemoveEntryList(&Query->Link);
+            InsertTailList(&Stale, &Query->Link);
+        }
+    }
+
+    KeReleaseSpinLock(&Coalescer->Lock, OldIrql);
+
+    while (!IsListEmpty(&Stale))
+    {
+        NdisDereferenceOidCoalescedQuery(CONTAINING_RECORD(
+            RemoveHeadList(&Stale), NDIS_OID_COALESCED_QUERY, Link));
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisUninitializeOidQueryCoalescer(
+    _Inout_ NDIS_OID_QUERY_COALESCER *Coalescer)
+/*++
+
+Routine Description:
+
+    Frees the resources of an NDIS_OID_QUERY_COALESCER
+
+    No OID query may be in flight through the coalescer.
+
+Arguments:
+
+    Coalescer - The coalescer to uninitialize
+
+--*/
+{
+    NdisInvalidateOidQueryCoalescerCache(Coalescer);
+
+    if (!IsListEmpty(&Coalescer->Queries))
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+BOOLEAN
+NdisIsOidCoalescedQueryMatch(
+    _In_ NDIS_OID_COALESCED_QUERY const *Query,
+    _In_ NDIS_OID_REQUEST const *OidRequest)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    return Query->OidRequest.RequestType == OidRequest->RequestType
+        && Query->OidRequest.PortNumber == OidRequest->PortNumber
+        && Query->OidRequest.DATA.QUERY_INFORMATION.Oid == OidRequest->DATA.QUERY_INFORMATION.Oid
+        && Query->OidRequest.DATA.QUERY_INFORMATION.InformationBufferLength ==
+            OidRequest->DATA.QUERY_INFORMATION.InformationBufferLength;
+}
+
+_Function_class_(NDIS_OID_REQUEST_COMPLETE_CALLBACK)
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdisOidCoalescedQueryComplete(
+    _In_ void *CallbackContext,
+    _In_ NDIS_OID_REQUEST const *OidRequest,
+    _In_ NDIS_STATUS CompletionStatus)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Publishes the result of a shared OID query and wakes its waiters.
+
+--*/
+{
+    NDIS_OID_COALESCED_QUERY *Query = (NDIS_OID_COALESCED_QUERY*)CallbackContext;
+    NDIS_OID_QUERY_COALESCER *Coalescer = Query->Coalescer;
+
+    if (OidRequest != &Query->OidRequest)
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    LIST_ENTRY Waiters;
+    InitializeListHead(&Waiters);
+
+    BOOLEAN Cached = (0 != Coalescer->CacheLifetime) &&
+        (NDIS_STATUS_SUCCESS == CompletionStatus);
+
+    KIRQL OldIrql;
+    KeAcquireSpinLock(&Coalescer->Lock, &OldIrql);
+
+    Query->Status = CompletionStatus;
+    Query->CompletionTime = KeQueryInterruptTime();
+    Query->Complete = TRUE;
+
+    while (!IsListEmpty(&Query->Waiters))
+    {
+        InsertTailList(&Waiters, RemoveHeadList(&Query->Waiters));
+    }
+
+    if (!Cached)
+    {
+        RemoveEntryList(&Query->Link);
+    }
+
+    KeReleaseSpinLock(&Coalescer->Lock, OldIrql);
+
+    while (!IsListEmpty(&Waiters))
+    {
+        NDIS_OID_COALESCED_QUERY_WAITER *Waiter = CONTAINING_RECORD(
+            RemoveHeadList(&Waiters), NDIS_OID_COALESCED_QUERY_WAITER, Link);
+
+        // The waiter's storage may go away as soon as the event is set
+        KeSetEvent(&Waiter->WaitEvent, IO_NO_INCREMENT, FALSE);
+    }
+
+    if (!Cached)
+    {
+        NdisDereferenceOidCoalescedQuery(Query);
+    }
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NDIS_STATUS
+NdisCopyOidCoalescedQueryResult(
+    _In_ NDIS_OID_COALESCED_QUERY *Query,
+    _Inout_ NDIS_OID_REQUEST *OidRequest)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Copies the result of a complete shared OID query into the caller's OID
+    request, and drops the caller's reference on the shared query.
+
+--*/
+{
+    NDIS_STATUS NdisStatus = Query->Status;
+
+    ULONG BytesWritten = Query->OidRequest.DATA.QUERY_INFORMATION.BytesWritten;
+    if (BytesWritten > OidRequest->DATA.QUERY_INFORMATION.InformationBufferLength)
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    if (0 != BytesWritten)
+    {
+        RtlCopyMemory(
+            OidRequest->DATA.QUERY_INFORMATION.InformationBuffer,
+            Query + 1,
+            BytesWritten);
+    }
+
+    OidRequest->DATA.QUERY_INFORMATION.BytesWritten = BytesWritten;
+    OidRequest->DATA.QUERY_INFORMATION.BytesNeeded =
+        Query->OidRequest.DATA.QUERY_INFORMATION.BytesNeeded;
+
+    NdisDereferenceOidCoalescedQuery(Query);
+
+    return NdisStatus;
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+inline
+NDIS_STATUS
+NdisFIssueCoalescedOidQueryAndWait(
+    _Inout_ NDIS_OID_QUERY_COALESCER *Coalescer,
+    _Inout_ NDIS_OID_REQUEST *OidRequest)
+/*++
+
+Routine Description:
+
+    Issues an OID query and waits for it to complete, sharing the lower-level
+    query with any identical OID query that is already in flight
+
+    If the coalescer has a cache lifetime, and an identical query succeeded
+    recently enough, its result is returned without issuing a new query.
+
+    Only NdisRequestQueryInformation and NdisRequestQueryStatistics requests
+    are coalesced. Other requests, and any request when the system is unable
+    to allocate memory, are issued with NdisFIssueOidRequestAndWait.
+
+    Your LWF's FilterOidRequestComplete handler must use
+    NdisFDispatchOidRequestComplete to handle completion of OID requests.
+
+Arguments:
+
+    Coalescer
+
+    OidRequest - The OID request to issue. Your OID request itself might not
+        be sent to the lower level; on return, its information buffer,
+        BytesWritten, and BytesNeeded hold the result.
+
+Return Value:
+
+    The completion status of the OID request. This routine never returns
+    NDIS_STATUS_PENDING.
+
+--*/
+{
+    if (APC_LEVEL < KeGetCurrentIrql())
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    if (NdisRequestQueryInformation != OidRequest->RequestType &&
+        NdisRequestQueryStatistics != OidRequest->RequestType)
+    {
+        return NdisFIssueOidRequestAndWait(Coalescer->NdisFilterHandle, OidRequest);
+    }
+
+    NDIS_OID_COALESCED_QUERY *NewQuery = NULL;
+    NDIS_OID_COALESCED_QUERY_WAITER Waiter;
+    KeInitializeEvent(&Waiter.WaitEvent, NotificationEvent, FALSE);
+
+    for (;;)
+    {
+        NDIS_OID_COALESCED_QUERY *Query = NULL;
+        NDIS_OID_COALESCED_QUERY *Expired = NULL;
+
+        KIRQL OldIrql;
+        KeAcquireSpinLock(&Coalescer->Lock, &OldIrql);
+
+        for (LIST_ENTRY *Link = Coalescer->Queries.Flink;
+            Link != &Coalescer->Queries;
+            Link = Link->Flink)
+        {
+            NDIS_OID_COALESCED_QUERY *Candidate =
+                CONTAINING_RECORD(Link, NDIS_OID_COALESCED_QUERY, Link);
+
+            if (NdisIsOidCoalescedQueryMatch(Candidate, OidRequest))
+            {
+                Query = Candidate;
+                break;
+            }
+        }
+
+        if (NULL != Query && Query->Complete &&
+            KeQueryInterruptTime() - Query->CompletionTime >= Coalescer->CacheLifetime)
+        {
+            RemoveEntryList(&Query->Link);
+            Expired = Query;
+            Query = NULL;
+        }
+
+        if (NULL != Query)
+        {
+            // Join the query that's in flight, or use its cached result
+            InterlockedIncrement(&Query->ReferenceCount);
+
+            BOOLEAN Complete = Query->Complete;
+            if (!Complete)
+            {
+                InsertTailList(&Query->Waiters, &Waiter.Link);
+            }
+
+            KeReleaseSpinLock(&Coalescer->Lock, OldIrql);
+
+            if (NULL != NewQuery)
+            {
+                ExFreePool(NewQuery);
+            }
+
+            if (!Complete)
+            {
+                NTSTATUS NtStatus = KeWaitForSingleObject(
+                    &Waiter.WaitEvent, Executive, KernelMode, FALSE, NULL);
+                if (STATUS_WAIT_0 != NtStatus)
+                {
+                    NDIS_REPORT_FATAL_ERROR();
+                }
+            }
+
+            return NdisCopyOidCoalescedQueryResult(Query, OidRequest);
+        }
+
+        if (NULL != NewQuery)
+        {
+            // One reference for the list, and one for this caller
+            NewQuery->ReferenceCount = 2;
+            InsertTailList(&NewQuery->Waiters, &Waiter.Link);
+            InsertTailList(&Coalescer->Queries, &NewQuery->Link);
+        }
+
+        KeReleaseSpinLock(&Coalescer->Lock, OldIrql);
+
+        if (NULL != Expired)
+        {
+            NdisDereferenceOidCoalescedQuery(Expired);
+        }
+
+        if (NULL != NewQuery)
+        {
+            break;
+        }
+
+        // Allocate outside the lock, then look again, since another caller
+        // may have issued the same query in the meantime
+        NewQuery = (NDIS_OID_COALESCED_QUERY*)ExAllocatePool2(
+            POOL_FLAG_NON_PAGED,
+            sizeof(*NewQuery) + OidRequest->DATA.QUERY_INFORMATION.InformationBufferLength,
+            Coalescer->PoolTag);
+        if (NULL == NewQuery)
+        {
+            return NdisFIssueOidRequestAndWait(Coalescer->NdisFilterHandle, OidRequest);
+        }
+
+        NewQuery->Coalescer = Coalescer;
+        InitializeListHead(&NewQuery->Waiters);
+
+        NewQuery->OidRequest.Header = OidRequest->Header;
+        NewQuery->OidRequest.RequestType = OidRequest->RequestType;
+        NewQuery->OidRequest.PortNumber = OidRequest->PortNumber;
+        NewQuery->OidRequest.Timeout = OidRequest->Timeout;
+        NewQuery->OidRequest.RequestHandle = Coalescer->NdisFilterHandle;
+        NewQuery->OidRequest.DATA.QUERY_INFORMATION.Oid = OidRequest->DATA.QUERY_INFORMATION.Oid;
+        NewQuery->OidRequest.DATA.QUERY_INFORMATION.InformationBuffer = NewQuery + 1;
+        NewQuery->OidRequest.DATA.QUERY_INFORMATION.InformationBufferLength =
+            OidRequest->DATA.QUERY_INFORMATION.InformationBufferLength;
+    }
+
+    NDIS_STATUS NdisStatus = NdisFIssueOidRequestWithCallback(
+        Coalescer->NdisFilterHandle,
+        &NewQuery->OidRequest,
+        NdisOidCoalescedQueryComplete,
+        NewQuery);
+    if (NDIS_STATUS_PENDING != NdisStatus)
+    {
+        NdisOidCoalescedQueryComplete(NewQuery, &NewQuery->OidRequest, NdisStatus);
+    }
+
+    NTSTATUS NtStatus = KeWaitForSingleObject(
+        &Waiter.WaitEvent, Executive, KernelMode, FALSE, NULL);
+    if (STATUS_WAIT_0 != NtStatus)
+    {
+        NDIS_REPORT_FATAL_ERROR();
+    }
+
+    return NdisCopyOidCoalescedQueryResult(NewQuery, OidRequest);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NDIS_STATUS
+NdisFPassthroughOidRequestEx(
+    _In_ NDIS_HANDLE NdisFilterHandle,
+    _In_ NDIS_OID_REQUEST *OidRequest,
+    _In_ ULONG PoolTag,
+    _Inout_opt_ NDIS_OID_REQUEST_POOL *Pool,
+    _Inout_opt_ NDIS_OID_PASSTHROUGH_COUNTERS *Counters)
+/*++
+
+Routine Description:
+
+    Passes an unmodified OID request from the upper edge of a LWF to the LWF's
+    lower edge, optionally without allocating memory
+
+    NDIS requires the LWF to send its own copy of the OID request to the lower
+    level, but that copy doesn't have to come from NdisAllocateCloneOidRequest.
+    If you provide a Pool, the copy is made in a preallocated pool entry, so
+    forwarding the OID request needs no allocation. As with a clone, the
+    information buffer is shared with the original OID request, not copied.
+
+    Pass a Pool only for OIDs that you have decided are eligible: ones your
+    LWF never needs to inspect, and that arrive often enough for the
+    allocation to matter. Pass NULL for every other OID. If every entry in the
+    Pool is in use, this routine falls back to NdisAllocateCloneOidRequest.
+
+    Example usage:
+
+        NDIS_STATUS MyFilterOidRequest(
+            NDIS_HANDLE filterModuleContext,
+            NDIS_OID_REQUEST *oid)
+        {
+            MY_FILTER *filter = (MY_FILTER*)filterModuleContext;
+            return NdisFPassthroughOidRequestEx(
+                filter->ndisHandle,
+                oid,
+                MY_TAG,
+                MyIsHighRateOid(oid) ? &filter->passthroughPool : NULL,
+                &filter->passthroughCounters);
+        }
+
+    You must pair it with NdisFDispatchOidRequestComplete in the completion
+    path.
+
+Arguments:
+
+    NdisFilterHandle - The NDIS handle of your filter module
+
+    OidRequest - The OID request to pass to the lower level
+
+    PoolTag - A pool tag to use if the OID request is cloned
+
+    Pool - Optional pool to copy the OID request into. Its BufferSize may be 0.
+
+    Counters - Optional counters to update, with interlocked operations
+
+Return Value:
+
+    The return value is somewhat opaque to the caller, and should just be
+    returned back to NDIS from your FilterOidRequest handler.
+
+--*/
+{
+    NDIS_OID_REQUEST *Copy = NULL;
+
+    if (NULL != Pool)
+    {
+        Copy = NdisAllocateOidRequestFromPool(Pool);
+        if (NULL == Copy && NULL != Counters)
+        {
+            InterlockedIncrement64(&Counters->PoolExhausted);
+        }
+    }
+
+    if (NULL == Copy)
+    {
+        if (NULL != Counters)
+        {
+            InterlockedIncrement64(&Counters->ClonedRequests);
+        }
+
+        return NdisFPassthroughOidRequest(NdisFilterHandle, OidRequest, PoolTag);
+    }
+
+    if (NULL != Counters)
+    {
+        InterlockedIncrement64(&Counters->PooledRequests);
+    }
+
+    //
+    // Copy everything the lower level may look at, but none of the reserved
+    // fields, which belong to whoever owns each OID request.
+    //
+    *Copy = *OidRequest;
+    RtlZeroMemory(Copy->NdisReserved, sizeof(Copy->NdisReserved));
+    RtlZeroMemory(Copy->MiniportReserved, sizeof(Copy->MiniportReserved));
+    RtlZeroMemory(Copy->SourceReserved, sizeof(Copy->SourceReserved));
+    Copy->RequestHandle = NdisFilterHandle;
+
+    NDIS_OID_REQUEST_SOURCE_RESERVED *Context =
+        (NDIS_OID_REQUEST_SOURCE_RESERVED*)&Copy->SourceReserved[0];
+
+    Context->Completion.CompletionKind = NdisOidRequestCompletionKindPooledPassthrough;
+    Context->Data.OriginalRequest = OidRequest;
+
+    NDL_STATISTICS_RECORD(
+        CONTAINING_RECORD(Copy, NDIS_OID_REQUEST_POOL_ENTRY, OidRequest)->IssueTime =
+            KeQueryInterruptTime());
+
+    NDIS_STATUS NdisStatus = NdisFOidRequest(NdisFilterHandle, Copy);
+    if (NDIS_STATUS_PENDING != NdisStatus)
+    {
+        NDL_STATISTICS_RECORD(NdlStatisticsRecordOidLatency(
+            NdisOidRequestCompletionKindPooledPassthrough,
+            CONTAINING_RECORD(Copy, NDIS_OID_REQUEST_POOL_ENTRY, OidRequest)->IssueTime));
+
+        NdisCopyOidRequestDataLength(OidRequest, Copy);
+        NdisFreeOidRequestToPool(Copy);
+    }
+
+    return NdisStatus;
+}
@@ -0,0 +1,182 @@
+/*++
+
+    Copyright (c) Microsoft. All rights reserved.
+
+    This code is licensed under the MIT License.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+
+Module Name:
+
+    perprocessor.h
+
+Provenance:
+
+    Version 1.2.0 from https://github.com/microsoft/ndis-driver-library
+
+Abstract:
+
+    Allocates one cache-aligned slot per possible processor, each from that
+    processor's own NUMA node
+
+    You don't need to include this header yourself.  NBL_PER_PROCESSOR_QUEUE
+    in nblperprocessorqueue.h and NBL_RECYCLE_POOL in nblrecyclepool.h keep
+    their per-processor state in these slots.  This header has no dependency
+    on NDIS.H, so you may also use it for your own per-processor state.
+
+    Slots are indexed by processor index (see KeGetCurrentProcessorIndex).
+    There is a slot for every processor that could ever be added to the
+    system, not just the ones present now.  A processor that isn't present
+    yet has no known node, so its slot is allocated from any node.
+
+Table of Contents:
+
+        NdlFreePerProcessorSlots
+        NdlAllocatePerProcessorSlots
+
+Environment:
+
+    Kernel mode
+
+    Requires ExAllocatePool3, which is available in Windows 10, version 2004
+    and later.
+
+--*/
+
+#pragma once
+
+#pragma region System Family (kernel drivers) with Desktop Family for compat
+#include <winapifamily.h>
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdlFreePerProcessorSlots(
+    _In_ ULONG NumberOfProcessors,
+    _In_opt_ PVOID *Slots)
+/*++
+
+Routine Description:
+
+    Frees slots allocated by NdlAllocatePerProcessorSlots
+
+Arguments:
+
+    NumberOfProcessors - The number of slots, as returned by
+        NdlAllocatePerProcessorSlots
+
+    Slots - The slots to free, or NULL
+
+--*/
+{
+    if (Slots == NULL)
+    {
+        return;
+    }
+
+    for (ULONG i = 0; i < NumberOfProcessors; i++)
+    {
+        ExFreePool(Slots[i]);
+    }
+
+    ExFreePool(Slots);
+}
+
+_IRQL_requires_(PASSIVE_LEVEL)
+_Must_inspect_result_
+inline
+PVOID *
+NdlAllocatePerProcessorSlots(
+    _In_ SIZE_T SlotSize,
+    _In_ ULONG PoolTag,
+    _Out_ ULONG *NumberOfProcessors)
+/*++
+
+Routine Description:
+
+    Allocates an array with one zeroed, cache-aligned, nonpaged slot per
+    possible processor
+
+    Each processor's slot is allocated from the processor's own NUMA node, if
+    possible.  If the node has no memory available, the slot is allocated
+    from any node.
+
+Arguments:
+
+    SlotSize - The size of each slot, in bytes
+
+    PoolTag - A pool tag to use for all allocations
+
+    NumberOfProcessors - Receives the number of slots, or 0 on failure
+
+Return Value:
+
+    An array of pointers to the slots, indexed by processor index, which you
+    must later pass to NdlFreePerProcessorSlots; or NULL if the system was
+    unable to allocate memory, in which case nothing remains allocated
+
+--*/
+{
+    const ULONG MaximumProcessors = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    *NumberOfProcessors = 0;
+
+    PVOID *Slots = (PVOID *)ExAllocatePool2(
+        POOL_FLAG_NON_PAGED,
+        (SIZE_T)MaximumProcessors * sizeof(Slots[0]),
+        PoolTag);
+
+    if (Slots == NULL)
+    {
+        return NULL;
+    }
+
+    for (ULONG i = 0; i < MaximumProcessors; i++)
+    {
+        POOL_EXTENDED_PARAMETER Parameter = { 0 };
+        Parameter.Type = PoolExtendedParameterNumaNode;
+        Parameter.Optional = TRUE;
+        Parameter.PreferredNode = MM_ANY_NODE_OK;
+
+        PROCESSOR_NUMBER ProcessorNumber;
+        union
+        {
+            SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX Information;
+            UCHAR Buffer[sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX) + 16 * sizeof(GROUP_AFFINITY)];
+        } Relationship;
+        ULONG RelationshipLength = sizeof(Relationship);
+
+        //
+        // Processors that aren't present yet have no known node; any node
+        // will do for them.
+        //
+        if (NT_SUCCESS(KeGetProcessorNumberFromIndex(i, &ProcessorNumber)) &&
+            NT_SUCCESS(KeQueryLogicalProcessorRelationship(
+                &ProcessorNumber, RelationNumaNode, &Relationship.Information, &RelationshipLength)))
+        {
+            Parameter.PreferredNode = Relationship.Information.NumaNode.NodeNumber;
+        }
+
+        Slots[i] = ExAllocatePool3(
+            POOL_FLAG_NON_PAGED | POOL_FLAG_CACHE_ALIGNED,
+            SlotSize,
+            PoolTag,
+            &Parameter,
+            1);
+
+        if (Slots[i] == NULL)
+        {
+            NdlFreePerProcessorSlots(i, Slots);
+            return NULL;
+        }
+    }
+
+    *NumberOfProcessors = MaximumProcessors;
+    return Slots;
+}
+
+#endif // WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+#pragma endregion
@@ -0,0 +1,653 @@
+/*++
+
+    Copyright (c) Microsoft. All rights reserved.
+
+    This code is licensed under the MIT License.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+    ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+    TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+    PARTICULAR PURPOSE AND NONINFRINGEMENT.
+
+Module Name:
+
+    statistics.h
+
+Provenance:
+
+    Version 1.2.0 from https://github.com/microsoft/ndis-driver-library
+
+Abstract:
+
+    Defines optional counters that record how the NDL routines behave on
+    real traffic
+
+    The counters are compiled out unless you define NDL_ENABLE_STATISTICS to
+    1 before including any NDL header.  When they are compiled out, the NDL
+    routines contain no instrumentation at all.
+
+    When enabled, these routines are instrumented:
+
+        NdisClassifyNblChainByValueLookahead
+        NdisClassifyNblChainByValueLookaheadWithCount
+            The size of each batch passed to the flush callback, and the
+            number of batches flushed early because the lookahead was full
+
+        The MdlCopyXxx routines
+            The number of bytes copied with regular and with non-temporal
+            instructions
+
+        MDL_MAP_BUFFER and MDL_MAP_CONST_BUFFER
+            The number of MDLs mapped, and the number that failed to map.
+            If you replace these macros, wrap your mapping routine in
+            NDL_STATISTICS_RECORD_MDL_MAP to keep these counters.
+
+        NdisFIssueOidRequestAndWait
+        NdisFIssueOidRequestWithCallback
+        NdisFPassthroughOidRequest
+        NdisFPassthroughOidRequestEx
+            How long each OID request took to complete, by
+            NDIS_OID_REQUEST_COMPLETION_KIND.  SourceReserved has no room
+            for the issue time of a callback or cloned passthrough request,
+            so up to NDL_STATISTICS_OID_TIMERS of those are timed at once in
+            a shared table.  Requests issued while the table is full are
+            counted in OidUntimed instead.
+
+        NdisFDispatchOidRequestComplete
+            The number of OID requests completed asynchronously, by
+            NDIS_OID_REQUEST_COMPLETION_KIND
+
+    Each processor updates its own copy of the counters without interlocked
+    operations, so the counters are cheap, but may occasionally miss an
+    update if a thread running below DISPATCH_LEVEL moves to another
+    processor in the middle of one.  Treat them as approximate.
+
+Example usage:
+
+    #define NDL_ENABLE_STATISTICS 1
+    #include <ndis/ndl/nblclassify.h>
+
+    // In DriverEntry:
+    NdlInitializeStatistics(MY_POOLTAG);
+
+    // Any time later:
+    NDL_STATISTICS Totals;
+    NdlQueryStatistics(&Totals);
+    . . . report Totals.ClassifyNbls / Totals.ClassifyBatches . . .;
+
+    // In DriverUnload, after the data path has stopped:
+    NdlUninitializeStatistics();
+
+Histograms:
+
+    Each NDL_STATISTICS_HISTOGRAM has one bucket for each power of 2.  A
+    value V is counted in bucket floor(log2(V)), so bucket 0 counts the
+    values 0 and 1, bucket 1 counts 2 and 3, bucket 2 counts 4 through 7,
+    and so on.  OID latencies are measured in 100ns units, with
+    KeQueryInterruptTime.
+
+Table of Contents:
+
+        NdlUninitializeStatistics
+        NdlInitializeStatistics
+        NdlQueryStatistics
+
+Environment:
+
+    Kernel mode
+
+--*/
+
+#pragma once
+
+#pragma region System Family (kernel drivers) with Desktop Family for compat
+#include <winapifamily.h>
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+
+// Define NDL_ENABLE_STATISTICS to 1 to compile the counters into the NDL
+// routines.
+#ifndef NDL_ENABLE_STATISTICS
+#  define NDL_ENABLE_STATISTICS 0
+#endif
+
+#if NDL_ENABLE_STATISTICS
+#  define NDL_STATISTICS_RECORD(Expression) (Expression)
+#  define NDL_STATISTICS_RECORD_MDL_MAP(Buffer) NdlStatisticsRecordMdlMap(Buffer)
+#else
+#  define NDL_STATISTICS_RECORD(Expression) ((void)0)
+#  define NDL_STATISTICS_RECORD_MDL_MAP(Buffer) (Buffer)
+#endif
+
+#define NDL_STATISTICS_HISTOGRAM_BUCKETS 32
+
+// The MDL copy flavors that are counted separately
+#define NDL_STATISTICS_COPY_TEMPORAL 0
+#define NDL_STATISTICS_COPY_NON_TEMPORAL 1
+#define NDL_STATISTICS_COPY_FLAVORS 2
+
+// OID counters are indexed by NDIS_OID_REQUEST_COMPLETION_KIND plus this bias
+#define NDL_STATISTICS_OID_COMPLETION_KIND_BIAS 2
+#define NDL_STATISTICS_OID_COMPLETION_KINDS 4
+
+// The number of callback and cloned passthrough OID requests that can be
+// timed at the same time.  You may replace this with a power of 2.
+#ifndef NDL_STATISTICS_OID_TIMERS
+#  define NDL_STATISTICS_OID_TIMERS 64
+#endif
+
+#if (NDL_STATISTICS_OID_TIMERS & (NDL_STATISTICS_OID_TIMERS - 1)) != 0
+#  error NDL_STATISTICS_OID_TIMERS must be a power of 2
+#endif
+
+typedef struct NDL_STATISTICS_HISTOGRAM_t
+{
+    ULONG64 Buckets[NDL_STATISTICS_HISTOGRAM_BUCKETS];
+} NDL_STATISTICS_HISTOGRAM;
+
+//
+// Every field is a ULONG64, so NdlQueryStatistics can total them generically.
+//
+typedef struct NDL_STATISTICS_t
+{
+    // The number of batches passed to the flush callback
+    ULONG64 ClassifyBatches;
+
+    // The total number of NBLs in those batches
+    ULONG64 ClassifyNbls;
+
+    // The number of batches that were flushed early, to make room in the
+    // lookahead for a new classification value
+    ULONG64 ClassifyEvictions;
+
+    // The number of NBLs in each batch
+    NDL_STATISTICS_HISTOGRAM ClassifyBatchSize;
+
+    // Indexed by NDL_STATISTICS_COPY_XXX
+    ULONG64 MdlBytesCopied[NDL_STATISTICS_COPY_FLAVORS];
+    ULONG64 MdlBuffersCopied[NDL_STATISTICS_COPY_FLAVORS];
+
+    ULONG64 MdlMaps;
+    ULONG64 MdlMapFailures;
+
+    // Indexed by NDIS_OID_REQUEST_COMPLETION_KIND plus
+    // NDL_STATISTICS_OID_COMPLETION_KIND_BIAS
+    ULONG64 OidPendedCompletions[NDL_STATISTICS_OID_COMPLETION_KINDS];
+    NDL_STATISTICS_HISTOGRAM OidLatency[NDL_STATISTICS_OID_COMPLETION_KINDS];
+
+    // The number of OID requests that were not timed, because every
+    // NDL_STATISTICS_OID_TIMERS slot was in use
+    ULONG64 OidUntimed;
+} NDL_STATISTICS;
+
+C_ASSERT(sizeof(NDL_STATISTICS) % sizeof(ULONG64) == 0);
+
+//
+// Each processor's counters sit in their own cache lines, so that no two
+// processors ever write to the same cache line.
+//
+typedef struct DECLSPEC_CACHEALIGN NDL_STATISTICS_PROCESSOR_t
+{
+    NDL_STATISTICS Statistics;
+} NDL_STATISTICS_PROCESSOR;
+
+//
+// Implementation detail - do not use this structure directly
+//
+typedef struct NDL_STATISTICS_OID_TIMER_t
+{
+    // The OID request being timed, or NULL if the slot is free
+    PVOID volatile OidRequest;
+
+    // The KeQueryInterruptTime when OidRequest was issued
+    ULONG64 IssueTime;
+} NDL_STATISTICS_OID_TIMER;
+
+//
+// Implementation detail - do not use this structure directly
+//
+typedef struct NDL_STATISTICS_STATE_t
+{
+    // The number of elements in Processors; one per possible processor index
+    ULONG NumberOfProcessors;
+
+    // NULL unless NdlInitializeStatistics succeeded
+    NDL_STATISTICS_PROCESSOR *Processors;
+
+#if NDL_ENABLE_STATISTICS
+    // Issue times of OID requests that have nowhere else to keep them
+    NDL_STATISTICS_OID_TIMER OidTimers[NDL_STATISTICS_OID_TIMERS];
+#endif
+} NDL_STATISTICS_STATE;
+
+DECLSPEC_SELECTANY NDL_STATISTICS_STATE NdlStatisticsState;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdlUninitializeStatistics(
+    void)
+/*++
+
+Routine Description:
+
+    Frees the counters
+
+    No NDL routine may be running on any processor while this routine runs.
+
+--*/
+{
+    if (NdlStatisticsState.Processors != NULL)
+    {
+        ExFreePool(NdlStatisticsState.Processors);
+    }
+
+    NdlStatisticsState.Processors = NULL;
+    NdlStatisticsState.NumberOfProcessors = 0;
+
+#if NDL_ENABLE_STATISTICS
+    RtlZeroMemory(NdlStatisticsState.OidTimers, sizeof(NdlStatisticsState.OidTimers));
+#endif
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+NTSTATUS
+NdlInitializeStatistics(
+    _In_ ULONG PoolTag)
+/*++
+
+Routine Description:
+
+    Allocates zeroed counters for each processor, and starts recording
+
+    Until this routine succeeds, the instrumented routines record nothing.
+    Call it once, for example from DriverEntry, before any NDL routine runs.
+
+Arguments:
+
+    PoolTag - A pool tag to use for the allocation
+
+Return Value:
+
+    STATUS_SUCCESS
+        The counters were allocated; you must later call
+        NdlUninitializeStatistics
+
+    STATUS_NOT_SUPPORTED
+        NDL_ENABLE_STATISTICS is not defined to 1
+
+    STATUS_INSUFFICIENT_RESOURCES
+        The system was unable to allocate memory
+
+--*/
+{
+#if NDL_ENABLE_STATISTICS
+    ULONG const NumberOfProcessors = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    NDL_STATISTICS_PROCESSOR *Processors = (NDL_STATISTICS_PROCESSOR *)ExAllocatePool2(
+        POOL_FLAG_NON_PAGED | POOL_FLAG_CACHE_ALIGNED,
+        (SIZE_T)NumberOfProcessors * sizeof(Processors[0]),
+        PoolTag);
+
+    if (Processors == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    NdlStatisticsState.NumberOfProcessors = NumberOfProcessors;
+    NdlStatisticsState.Processors = Processors;
+
+    return STATUS_SUCCESS;
+#else
+    UNREFERENCED_PARAMETER(PoolTag);
+
+    return STATUS_NOT_SUPPORTED;
+#endif
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdlQueryStatistics(
+    _Out_ NDL_STATISTICS *Totals)
+/*++
+
+Routine Description:
+
+    Adds up every processor's counters
+
+    The counters keep running while this routine reads them, so the totals
+    are a close approximation rather than an exact snapshot.  To measure an
+    interval, query the totals twice and subtract.
+
+Arguments:
+
+    Totals - Receives the sum of every processor's counters, or zeros if the
+        counters are not initialized
+
+--*/
+{
+    RtlZeroMemory(Totals, sizeof(*Totals));
+
+    ULONG64 *Total = (ULONG64 *)Totals;
+
+    for (ULONG i = 0; i < NdlStatisticsState.NumberOfProcessors; i++)
+    {
+        ULONG64 const volatile *Counter =
+            (ULONG64 const volatile *)&NdlStatisticsState.Processors[i].Statistics;
+
+        for (SIZE_T j = 0; j < sizeof(*Totals) / sizeof(ULONG64); j++)
+        {
+            Total[j] += Counter[j];
+        }
+    }
+}
+
+_IRQL_requires_max_(HIGH_LEVEL)
+inline
+NDL_STATISTICS *
+NdlGetCurrentProcessorStatistics(
+    void)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    ULONG const Index = KeGetCurrentProcessorIndex();
+
+    if (Index >= NdlStatisticsState.NumberOfProcessors)
+    {
+        return NULL;
+    }
+
+    return &NdlStatisticsState.Processors[Index].Statistics;
+}
+
+_IRQL_requires_max_(HIGH_LEVEL)
+inline
+void
+NdlStatisticsRecordHistogram(
+    _Inout_ NDL_STATISTICS_HISTOGRAM *Histogram,
+    _In_ ULONG64 Value)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    SIZE_T Bucket = 0;
+    if (Value > 1)
+    {
+        Bucket = (SIZE_T)RtlFindMostSignificantBit(Value);
+    }
+
+    if (Bucket >= NDL_STATISTICS_HISTOGRAM_BUCKETS)
+    {
+        Bucket = NDL_STATISTICS_HISTOGRAM_BUCKETS - 1;
+    }
+
+    Histogram->Buckets[Bucket] += 1;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdlStatisticsRecordClassifyBatch(
+    _In_ SIZE_T NumberOfNbls)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    NDL_STATISTICS *Statistics = NdlGetCurrentProcessorStatistics();
+    if (Statistics == NULL)
+    {
+        return;
+    }
+
+    Statistics->ClassifyBatches += 1;
+    Statistics->ClassifyNbls += NumberOfNbls;
+    NdlStatisticsRecordHistogram(&Statistics->ClassifyBatchSize, NumberOfNbls);
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdlStatisticsRecordClassifyEviction(
+    void)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    NDL_STATISTICS *Statistics = NdlGetCurrentProcessorStatistics();
+    if (Statistics == NULL)
+    {
+        return;
+    }
+
+    Statistics->ClassifyEvictions += 1;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdlStatisticsRecordMdlCopy(
+    _In_ SIZE_T Flavor,
+    _In_ SIZE_T Length)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    NDL_STATISTICS *Statistics = NdlGetCurrentProcessorStatistics();
+    if (Statistics == NULL)
+    {
+        return;
+    }
+
+    Statistics->MdlBytesCopied[Flavor] += Length;
+    Statistics->MdlBuffersCopied[Flavor] += 1;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+PVOID
+NdlStatisticsRecordMdlMap(
+    _In_opt_ PVOID Buffer)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Returns Buffer, so it can wrap a mapping routine in an expression.
+
+--*/
+{
+    NDL_STATISTICS *Statistics = NdlGetCurrentProcessorStatistics();
+    if (Statistics != NULL)
+    {
+        Statistics->MdlMaps += 1;
+
+        if (Buffer == NULL)
+        {
+            Statistics->MdlMapFailures += 1;
+        }
+    }
+
+    return Buffer;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdlStatisticsRecordOidPendedCompletion(
+    _In_ LONG CompletionKind)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+--*/
+{
+    NDL_STATISTICS *Statistics = NdlGetCurrentProcessorStatistics();
+    if (Statistics == NULL)
+    {
+        return;
+    }
+
+    Statistics->OidPendedCompletions[CompletionKind + NDL_STATISTICS_OID_COMPLETION_KIND_BIAS] += 1;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdlStatisticsRecordOidLatency(
+    _In_ LONG CompletionKind,
+    _In_ ULONG64 IssueTime)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    IssueTime is the KeQueryInterruptTime when the OID request was issued.
+
+--*/
+{
+    NDL_STATISTICS *Statistics = NdlGetCurrentProcessorStatistics();
+    if (Statistics == NULL)
+    {
+        return;
+    }
+
+    NdlStatisticsRecordHistogram(
+        &Statistics->OidLatency[CompletionKind + NDL_STATISTICS_OID_COMPLETION_KIND_BIAS],
+        KeQueryInterruptTime() - IssueTime);
+}
+
+#if NDL_ENABLE_STATISTICS
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+ULONG
+NdlStatisticsHashOidRequest(
+    _In_ void const *OidRequest)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Returns the first slot of NdlStatisticsState.OidTimers to probe for
+    OidRequest.
+
+--*/
+{
+    return (ULONG)(((ULONG_PTR)OidRequest / sizeof(PVOID)) & (NDL_STATISTICS_OID_TIMERS - 1));
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdlStatisticsStartOidTimer(
+    _In_ void *OidRequest)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Records the issue time of an OID request in a free slot, so that
+    NdlStatisticsStopOidTimer can find it.  Call this before the OID request
+    is passed down.
+
+--*/
+{
+    NDL_STATISTICS *Statistics = NdlGetCurrentProcessorStatistics();
+    if (Statistics == NULL)
+    {
+        return;
+    }
+
+    ULONG64 const IssueTime = KeQueryInterruptTime();
+    ULONG const First = NdlStatisticsHashOidRequest(OidRequest);
+
+    for (ULONG i = 0; i < NDL_STATISTICS_OID_TIMERS; i++)
+    {
+        NDL_STATISTICS_OID_TIMER *Timer =
+            &NdlStatisticsState.OidTimers[(First + i) & (NDL_STATISTICS_OID_TIMERS - 1)];
+
+        if (Timer->OidRequest == NULL &&
+            InterlockedCompareExchangePointer(&Timer->OidRequest, OidRequest, NULL) == NULL)
+        {
+            // The OID request has not been passed down yet, so nothing can be
+            // looking for this slot until the caller returns.
+            Timer->IssueTime = IssueTime;
+            return;
+        }
+    }
+
+    Statistics->OidUntimed += 1;
+}
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+inline
+void
+NdlStatisticsStopOidTimer(
+    _In_ LONG CompletionKind,
+    _In_ void *OidRequest)
+/*++
+
+Routine Description:
+
+    Implementation detail - do not invoke this routine directly
+
+    Records the latency of an OID request timed by NdlStatisticsStartOidTimer,
+    and frees its slot.  Does nothing if the OID request was not timed.  Call
+    this before the OID request is freed or handed back to its owner.
+
+--*/
+{
+    if (NdlStatisticsState.Processors == NULL)
+    {
+        return;
+    }
+
+    ULONG const First = NdlStatisticsHashOidRequest(OidRequest);
+
+    for (ULONG i = 0; i < NDL_STATISTICS_OID_TIMERS; i++)
+    {
+        NDL_STATISTICS_OID_TIMER *Timer =
+            &NdlStatisticsState.OidTimers[(First + i) & (NDL_STATISTICS_OID_TIMERS - 1)];
+
+        if (Timer->OidRequest == OidRequest)
+        {
+            ULONG64 const IssueTime = Timer->IssueTime;
+            InterlockedExchangePointer(&Timer->OidRequest, NULL);
+
+            NdlStatisticsRecordOidLatency(CompletionKind, IssueTime);
+            return;
+        }
+    }
+}
+
+#endif // NDL_ENABLE_STATISTICS
+
+#endif // WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_SYSTEM | WINAPI_PARTITION_DESKTOP)
+#pragma endregion
@@ -12,10 +12,18 @@
 where dotnet >NUL || goto :MissingDotnet
 where t4 >NUL || goto :MissingT4
 
+call :generate ndl statistics || goto :EOF
+call :generate ndl chainiterator || goto :EOF
+call :generate ndl perprocessor || goto :EOF
 call :generate ndl nblchain || goto :EOF
 call :generate ndl nblqueue || goto :EOF
+call :generate ndl nblperprocessorqueue || goto :EOF
+call :generate ndl nblrecyclepool || goto :EOF
+call :generate ndl nblring || goto :EOF
 call :generate ndl nblclassify || goto :EOF
+call :generate ndl nblparallelflush || goto :EOF
 call :generate ndl mdl || goto :EOF
+call :generate ndl nblheader || goto :EOF
 call :generate ndl oidrequest || goto :EOF
 call :generate compat fileio || goto :EOF
 